@@ -0,0 +1,84 @@
+/* Setup shared by the microbenchmarks */
+#define _POSIX_C_SOURCE 200809L // setenv
+
+#include <stdlib.h>
+#include <time.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/cartridge.h"
+#include "cboy/mbc.h"
+#include "cboy/cpu.h"
+#include "cboy/memory.h"
+#include "cboy/ppu.h"
+#include "cboy/apu.h"
+#include "cboy/joypad.h"
+#include "bench.h"
+
+#define BENCH_ROM_BANKS 2
+
+gameboy *init_bench_gameboy(enum GAMEBOY_MODE mode)
+{
+    gameboy *gb = calloc(1, sizeof(gameboy));
+    if (gb == NULL)
+        return NULL;
+
+    // the APU needs an audio device, but nothing is played
+    setenv("SDL_AUDIODRIVER", "dummy", 0);
+
+    gb->run_mode = mode;
+    gb->tac = 0xf8;
+    gb->boot_rom_disabled = true;
+    gb->svbk = 0xff;
+    gb->vbk = 0xfe;
+
+    gb->joypad = init_joypad();
+    gb->cart = init_cartridge();
+    gb->apu = init_apu();
+    gb->memory = init_memory_map();
+    init_cpu(&gb->cpu, mode);
+    gb->ppu = init_ppu(mode);
+
+    if (!gb->joypad || !gb->cart || !gb->apu || !gb->memory || !gb->ppu)
+    {
+        free_gameboy(gb);
+        return NULL;
+    }
+
+    // a blank 32KB cartridge with an MBC5, so code can run from ROM
+    gb->cart->rom_banks = calloc(BENCH_ROM_BANKS, sizeof(uint8_t *));
+    if (gb->cart->rom_banks == NULL)
+    {
+        free_gameboy(gb);
+        return NULL;
+    }
+
+    gb->cart->num_rom_banks = BENCH_ROM_BANKS;
+    for (int i = 0; i < BENCH_ROM_BANKS; ++i)
+    {
+        gb->cart->rom_banks[i] = calloc(ROM_BANK_SIZE, sizeof(uint8_t));
+        if (gb->cart->rom_banks[i] == NULL)
+        {
+            free_gameboy(gb);
+            return NULL;
+        }
+    }
+
+    gb->cart->rom_banks_bitsize = 1;
+    gb->cart->mbc_type = MBC5;
+    init_mbc(MBC5, gb->cart->mbc);
+    map_cartridge_banks(gb->cart);
+
+    // the I/O handlers of the core specialized for the mode, as in init_gameboy
+    if (mode == GB_CGB_MODE)
+        init_io_registers_cgb(gb);
+    else
+        init_io_registers_dmg(gb);
+    remap_memory(gb);
+
+    return gb;
+}
+
+double elapsed_ns(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
@@ -0,0 +1,17 @@
+#ifndef GB_BENCH_H
+#define GB_BENCH_H
+
+#include <time.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+
+/* A Game Boy with all of its components except the screen, and
+ * a blank 32KB MBC5 cartridge, for timing parts of the emulator
+ * in isolation. Returns NULL if initialization fails.
+ */
+gameboy *init_bench_gameboy(enum GAMEBOY_MODE mode);
+
+// nanoseconds between two CLOCK_MONOTONIC readings
+double elapsed_ns(struct timespec *start, struct timespec *end);
+
+#endif /* GB_BENCH_H */
@@ -0,0 +1,88 @@
+/* Instruction throughput microbenchmark
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Measures how many instructions per second execute_instruction
+ * runs, on an arithmetic-heavy loop in ROM and in WRAM. The PPU,
+ * timer, and APU aren't stepped, so only the CPU core is timed.
+ *
+ * Build and run with `make bench && bin/cpu_bench [instructions]`.
+ */
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/cpu.h"
+#include "cboy/memory.h"
+#include "cboy/instructions.h"
+#include "cboy/log.h"
+#include "bench.h"
+
+#define DEFAULT_INSTRUCTIONS 50000000L
+
+static const uint8_t program[] = {
+    0x06, 0x10,       //         LD B, 0x10
+    0x81,             // inner:  ADD A, C
+    0x8a,             //         ADC A, D
+    0x93,             //         SUB A, E
+    0xac,             //         XOR A, H
+    0x2c,             //         INC L
+    0xcb, 0x01,       //         RLC C
+    0xcb, 0x5f,       //         BIT 3, A
+    0xfe, 0x42,       //         CP A, 0x42
+    0x05,             //         DEC B
+    0x20, 0xf2,       //         JR NZ, inner
+    0xc3, 0x00, 0x00, //         JP start (filled in by run_bench)
+};
+
+// runs the program from the given buffer, mapped at start
+static void run_bench(gameboy *gb, const char *name, uint8_t *buffer,
+                      uint16_t start, long num_instructions)
+{
+    memcpy(buffer, program, sizeof program);
+    buffer[sizeof program - 2] = start & 0xff;
+    buffer[sizeof program - 1] = start >> 8;
+    gb->cpu.reg.pc = start;
+
+    struct timespec start_time, end_time;
+    uint64_t m_cycles = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    for (long i = 0; i < num_instructions; ++i)
+        m_cycles += execute_instruction(gb);
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    double ns = elapsed_ns(&start_time, &end_time);
+    printf("%s: %.1f million instructions/s (%.2f ns per instruction, %.1fx real time)\n",
+           name,
+           num_instructions / ns * 1e3,
+           ns / num_instructions,
+           m_cycles * 4 / (double)GB_CPU_FREQUENCY / (ns / 1e9));
+}
+
+int main(int argc, char *argv[])
+{
+    long num_instructions = argc > 1 ? atol(argv[1]) : DEFAULT_INSTRUCTIONS;
+    if (num_instructions <= 0)
+    {
+        LOG_ERROR("Usage: %s [instructions]\n", argv[0]);
+        return 1;
+    }
+
+    gameboy *gb = init_bench_gameboy(GB_DMG_MODE);
+    if (gb == NULL)
+    {
+        LOG_ERROR("Failed to initialize the emulator\n");
+        return 1;
+    }
+
+    // switchable ROM bank and WRAM bank 0
+    run_bench(gb, "ROM", gb->cart->rom_banks[1], 0x4000, num_instructions);
+    run_bench(gb, "WRAM", gb->memory->wram[0], 0xc000, num_instructions);
+
+    free_gameboy(gb);
+    return 0;
+}
@@ -0,0 +1,101 @@
+/* I/O register access microbenchmark
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * Measures the average cost of CPU reads and writes to the I/O
+ * registers (0xff00-0xff7f and IE) in both DMG and CGB mode, through
+ * the read_byte/write_byte of the core specialized for the mode (as
+ * the game loop makes them) and through the generic ones which check
+ * the mode at runtime.
+ *
+ * Build and run with `make bench && bin/io_bench [iterations]`.
+ */
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/memory.h"
+#include "cboy/log.h"
+#include "bench.h"
+
+#define DEFAULT_ITERATIONS 200000
+
+/* Registers that are safe to write repeatedly without starting
+ * a DMA transfer, a speed switch, or turning off the LCD/APU.
+ */
+static const uint16_t write_registers[] = {
+    JOYP_REGISTER, SB_REGISTER, TMA_REGISTER, IF_REGISTER,
+    NR50_REGISTER, NR51_REGISTER, SCY_REGISTER, SCX_REGISTER,
+    LYC_REGISTER, BGP_REGISTER, OBP0_REGISTER, OBP1_REGISTER,
+    WY_REGISTER, WX_REGISTER, FF72_REGISTER, FF73_REGISTER, IE_REGISTER,
+};
+
+#define NUM_WRITE_REGISTERS (sizeof write_registers / sizeof write_registers[0])
+
+typedef uint8_t (*read_fn)(gameboy *gb, uint16_t address);
+typedef void (*write_fn)(gameboy *gb, uint16_t address, uint8_t value);
+
+static void time_accesses(gameboy *gb, const char *name, read_fn read, write_fn write, long iterations)
+{
+    struct timespec start, end;
+    volatile uint8_t sink = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; ++i)
+    {
+        for (uint16_t address = 0xff00; address <= 0xff7f; ++address)
+            sink ^= read(gb, address);
+        sink ^= read(gb, IE_REGISTER);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double read_ns = elapsed_ns(&start, &end) / ((double)iterations * 129);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; ++i)
+    {
+        for (size_t r = 0; r < NUM_WRITE_REGISTERS; ++r)
+            write(gb, write_registers[r], (uint8_t)i);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double write_ns = elapsed_ns(&start, &end) / ((double)iterations * NUM_WRITE_REGISTERS);
+
+    printf("%s: read %.2f ns, write %.2f ns per I/O register access\n", name, read_ns, write_ns);
+}
+
+static bool run_bench(enum GAMEBOY_MODE mode, long iterations)
+{
+    gameboy *gb = init_bench_gameboy(mode);
+    if (gb == NULL)
+    {
+        LOG_ERROR("Failed to initialize the emulator\n");
+        return false;
+    }
+
+    if (mode == GB_CGB_MODE)
+        time_accesses(gb, "CGB core", read_byte_cgb, write_byte_cgb, iterations);
+    else
+        time_accesses(gb, "DMG core", read_byte_dmg, write_byte_dmg, iterations);
+
+    time_accesses(gb, mode == GB_CGB_MODE ? "CGB generic" : "DMG generic", read_byte, write_byte, iterations);
+
+    free_gameboy(gb);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    long iterations = argc > 1 ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0)
+    {
+        LOG_ERROR("Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    if (!run_bench(GB_DMG_MODE, iterations) || !run_bench(GB_CGB_MODE, iterations))
+        return 1;
+
+    return 0;
+}
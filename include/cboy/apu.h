@@ -27,6 +27,11 @@
 #define WAVE_RAM_START 0xff30
 #define WAVE_RAM_STOP  0xff3f
 
+enum AUDIO_MODE {
+    AUDIO_INLINE, // synthesize audio on the emulation thread as the APU runs
+    AUDIO_THREAD, // synthesize it on a worker thread, from a log of register writes
+};
+
 typedef enum APU_CHANNELS {
     CHANNEL_ONE,
     CHANNEL_TWO,
@@ -34,6 +39,9 @@ typedef enum APU_CHANNELS {
     CHANNEL_FOUR,
 } APU_CHANNELS;
 
+typedef struct gameboy gameboy;
+typedef struct gb_apu_worker gb_apu_worker;
+
 typedef struct apu_pulse_channel {
     uint8_t duty_number;
     uint8_t duty_pos;
@@ -121,6 +129,14 @@ typedef struct gb_apu {
     // for downsampling, one sample per channel
     float curr_channel_samples[4];
 
+    /* While fast-forwarding, every decimation output samples
+     * are averaged into one (see speed.h). These are the sums
+     * of the ones so far, and how many there have been.
+     */
+    uint8_t decimation;
+    float decimated_left, decimated_right;
+    uint8_t num_decimated;
+
     uint8_t frame_seq_pos;
     uint16_t clock;
 
@@ -128,9 +144,10 @@ typedef struct gb_apu {
     apu_pulse_channel channel_two;
     apu_wave_channel channel_three;
     apu_noise_channel channel_four;
-} gb_apu;
 
-typedef struct gameboy gameboy;
+    // NULL unless synthesizing on a worker thread, see below
+    gb_apu_worker *worker;
+} gb_apu;
 
 void apu_write(gameboy *gb, uint16_t address, uint8_t value);
 uint8_t apu_read(gameboy *gb, uint16_t address);
@@ -140,4 +157,36 @@ void deinit_apu(gb_apu *apu);
 
 void run_apu(gameboy *gb, uint8_t num_clocks);
 
+/* Audio frames in the buffer, plus any still to be synthesized by a
+ * worker thread. Emulation waits on this to keep to audio's pace.
+ */
+uint32_t buffered_audio_frames(gb_apu *apu);
+
+/* Worker thread
+ * ~~~~~~~~~~~~~
+ * With a worker thread (AUDIO_THREAD), the emulation thread only keeps
+ * what the CPU can see: the registers, wave RAM, and what turns the
+ * channels on and off in NR52 (the frame sequencer's length counters
+ * and sweep). Each register write is queued with the clock it's made
+ * at, and the worker runs its own copy of the APU up to that clock
+ * before making it, synthesizing, filtering and mixing the output as
+ * it goes. So the audio comes out just as it would on one thread.
+ */
+
+/* Start synthesizing on a worker thread, from the APU's current state.
+ * Returns false on failure.
+ */
+bool start_apu_worker(gameboy *gb);
+
+/* Wait for the worker to catch up, and bring the rest of the APU's
+ * state (what's only needed to synthesize audio) up to date from it.
+ * Needed before that state is read, like to save it.
+ */
+void sync_apu(gb_apu *apu);
+
+/* Wait for the worker to catch up, then start it over from the APU's
+ * state. Needed whenever that's replaced, like by loading a state.
+ */
+void restart_apu(gb_apu *apu);
+
 #endif /* GB_APU_H */
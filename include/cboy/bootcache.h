@@ -0,0 +1,41 @@
+#ifndef GB_BOOTCACHE_H
+#define GB_BOOTCACHE_H
+
+#include <stdbool.h>
+
+/* Boot snapshot cache
+ * ~~~~~~~~~~~~~~~~~~~
+ * Running the boot ROM takes a few emulated seconds, but where it
+ * leaves the machine only depends on the boot ROM, the cartridge
+ * header it reads, and whether monochrome mode was forced. So the
+ * state right after the boot ROM's last instruction is saved in a
+ * cache directory, keyed by those, and later runs with the same key
+ * start from it instead of running the boot ROM again.
+ *
+ * Snapshots hold the emulator's structs as they are in memory, and
+ * what's in them depends on how it emulates the boot ROM, so each is
+ * keyed by an ID of the build that saved it as well: a checksum of
+ * the sources, passed in by the makefile (BUILD_ID). A snapshot saved
+ * by a different build is treated as a miss.
+ */
+
+typedef struct gameboy gameboy;
+
+// where a boot snapshot is to be saved, and its key
+typedef struct gb_boot_snapshot gb_boot_snapshot;
+
+/* Start from the cached boot snapshot in cache_dir if there is a
+ * valid one for the loaded boot ROM and cartridge. Otherwise
+ * arrange for it to be saved when the boot ROM finishes.
+ * Returns true if a snapshot was restored.
+ */
+bool restore_boot_snapshot(gameboy *gb, const char *cache_dir, bool force_dmg);
+
+/* Save the state after the boot ROM's last instruction,
+ * if restore_boot_snapshot() didn't find a snapshot.
+ */
+void save_boot_snapshot(gameboy *gb);
+
+void free_boot_snapshot(gb_boot_snapshot *snapshot);
+
+#endif /* GB_BOOTCACHE_H */
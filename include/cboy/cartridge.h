@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "cboy/mbc.h"
+#include "cboy/romfile.h"
 
 /* cartridge errors during init process */
 typedef enum ROM_LOAD_STATUS {
@@ -13,6 +14,27 @@ typedef enum ROM_LOAD_STATUS {
     ROM_LOAD_ERROR,
 } ROM_LOAD_STATUS;
 
+/* Where the current time comes from when importing and
+ * saving RTC data. Only the wall clock makes runs depend
+ * on when (and for how long) the emulator was run.
+ */
+enum TIME_SOURCE {
+    TIME_SOURCE_WALL,     // the host's wall clock
+    TIME_SOURCE_FIXED,    // always the epoch
+    TIME_SOURCE_EMULATED, // the epoch plus emulated time elapsed
+};
+
+typedef struct gb_time_source {
+    enum TIME_SOURCE type;
+
+    // UNIX time in seconds. In emulated mode this is replaced by
+    // the save file's timestamp, so no time passes between runs.
+    uint64_t epoch;
+
+    // normal-speed clocks emulated so far
+    uint64_t elapsed_clocks;
+} gb_time_source;
+
 typedef struct gb_cartridge {
     /* The cartridge's ROM banks. There are a
      * minimum of 2 banks and a max of 512 banks.
@@ -29,12 +51,22 @@ typedef struct gb_cartridge {
     uint16_t ram_banks_bitsize;
 
     bool has_rtc;
+    gb_time_source time_source;
 
     /* the cartridge's MBC */
     MBC_TYPE mbc_type;
     cartridge_mbc *mbc;
 } gb_cartridge;
 
+/* The cartridge header fields (in ROM bank 0) used to set up the cartridge */
+typedef struct gb_rom_header {
+    char title[17];         // printable part of 0x134-0x143, NUL-terminated
+    uint8_t cgb_flag;       // 0x143: bit 7 set if the game supports CGB mode
+    MBC_TYPE mbc_type;      // from 0x147
+    uint16_t num_rom_banks; // from 0x148
+    int ext_ram_size;       // in bytes, from 0x149
+} gb_rom_header;
+
 /* free the memory allocated for the cartridge */
 void unload_cartridge(gb_cartridge *cart);
 
@@ -42,11 +74,29 @@ void unload_cartridge(gb_cartridge *cart);
 gb_cartridge *init_cartridge(void);
 
 /* load a ROM file into the cartridge struct */
-ROM_LOAD_STATUS load_rom(gb_cartridge *cart, FILE *rom_file);
+ROM_LOAD_STATUS load_rom(gb_cartridge *cart, gb_rom_file *rom_file);
+
+/* Parse the header of the given ROM bank 0. Returns false
+ * if it's malformed, in which case load_rom would reject it.
+ */
+bool parse_rom_header(const uint8_t *rom0, gb_rom_header *header);
+
+/* Parse the header of a ROM file and compute its hash_rom()
+ * without loading it. Returns MALFORMED_ROM if the header is.
+ */
+ROM_LOAD_STATUS hash_rom_file(gb_rom_file *rom_file, gb_rom_header *header, uint64_t *hash);
 
 /* print the ROM's title */
 void print_rom_title(gb_cartridge *cart);
 
+/* 64-bit hash of the full ROM contents, used to
+ * identify the game in files tied to a ROM
+ */
+uint64_t hash_rom(gb_cartridge *cart);
+
+/* current UNIX time (seconds) according to the time source */
+uint64_t current_time(gb_time_source *time_source);
+
 /* Write cartridge RAM to a file */
 void save_cartridge_ram(gb_cartridge *cart, const char *romfile);
 
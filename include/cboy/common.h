@@ -20,6 +20,10 @@ enum GB_MMIO_REGISTER {
     /* joypad */
     JOYP_REGISTER  = 0xff00,
 
+    /* serial transfer */
+    SB_REGISTER    = 0xff01,
+    SC_REGISTER    = 0xff02,
+
     /* timer registers */
     DIV_REGISTER   = 0xff04,
     TIMA_REGISTER  = 0xff05,
@@ -88,6 +92,7 @@ enum GB_MMIO_REGISTER {
     HDMA3_REGISTER = 0xff53,
     HDMA4_REGISTER = 0xff54,
     HDMA5_REGISTER = 0xff55,
+    RP_REGISTER    = 0xff56,
     BCPS_REGISTER  = 0xff68,
     BCPD_REGISTER  = 0xff69,
     OCPS_REGISTER  = 0xff6a,
@@ -95,6 +100,14 @@ enum GB_MMIO_REGISTER {
     OPRI_REGISTER  = 0xff6c,
     SVBK_REGISTER  = 0xff70,
 
+    /* undocumented CGB registers */
+    FF72_REGISTER  = 0xff72,
+    FF73_REGISTER  = 0xff73,
+    FF74_REGISTER  = 0xff74,
+    FF75_REGISTER  = 0xff75,
+    PCM12_REGISTER = 0xff76,
+    PCM34_REGISTER = 0xff77,
+
     /* interrupt enable */
     IE_REGISTER    = 0xffff,
 };
@@ -5,18 +5,63 @@
 #include <stdbool.h>
 #include "cboy/common.h"
 
+/* Lazy flags
+ * ~~~~~~~~~~
+ * Most flag results are overwritten before anything reads them,
+ * so the instructions which set flags most often only record their
+ * operation (see set_lazy_flags). Z and C are read straight from the
+ * recorded result, which conditional jumps and ADC/SBC need. N and H
+ * are only worked out, and F stored, when something needs all four
+ * flags: DAA, PUSH AF, or a single flag update.
+ */
+enum LAZY_FLAGS {
+    FLAGS_EVALUATED, // N and H are up to date in F
+    LAZY_ADD,        // ADD, ADC
+    LAZY_SUB,        // SUB, SBC, CP
+    LAZY_AND,        // AND
+    LAZY_LOGIC,      // OR, XOR, and the CB-prefixed rotates and shifts
+    LAZY_INC,        // INC r8 (carry unaffected)
+    LAZY_DEC,        // DEC r8 (carry unaffected)
+    LAZY_BIT,        // BIT (carry unaffected)
+};
+
+/* A pair of 8-bit registers that can also be accessed as one
+ * 16-bit register, with hi in the high byte (e.g. B in BC).
+ */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define REGISTER_PAIR(pair, hi, lo) \
+    union {                         \
+        uint16_t pair;              \
+        struct { uint8_t hi, lo; }; \
+    }
+#else
+#define REGISTER_PAIR(pair, hi, lo) \
+    union {                         \
+        uint16_t pair;              \
+        struct { uint8_t lo, hi; }; \
+    }
+#endif
+
 // the Game Boy CPU registers
 typedef struct gb_registers {
-    uint8_t a;
-    uint8_t b;
-    uint8_t c;
-    uint8_t d;
-    uint8_t e;
-    uint8_t f;
-    uint8_t h;
-    uint8_t l;
+    REGISTER_PAIR(af, a, f); // F is only valid after evaluate_flags()
+    REGISTER_PAIR(bc, b, c);
+    REGISTER_PAIR(de, d, e);
+    REGISTER_PAIR(hl, h, l);
     uint16_t sp; // stack pointer
     uint16_t pc; // program counter
+
+    /* The last flag-setting operation, packed so that recording it
+     * is a single store:
+     *
+     *  bits 0-7:   result (Z is set if 0)
+     *  bit 8:      carry out (C)
+     *  bits 16-23: XOR of the operands, for working out H
+     *  bits 24-31: enum LAZY_FLAGS
+     *
+     * N and H in F are stale unless the operation is FLAGS_EVALUATED.
+     */
+    uint32_t lazy_flags;
 } gb_registers;
 
 // the Game Boy CPU
@@ -30,6 +75,17 @@ typedef struct gb_cpu {
     // the interrupt flags and enable registers
     uint8_t if_register, ie_register;
 
+    /* Cached interrupt state, so the CPU doesn't have to
+     * recompute it before every instruction. Kept up to
+     * date by update_interrupt_state().
+     *
+     * interrupts_pending: IF & IE (requested and enabled)
+     * interrupt_serviceable: the IME is set and an
+     *                        interrupt is pending
+     */
+    uint8_t interrupts_pending;
+    bool interrupt_serviceable;
+
     // to keep track of when the HALT bug occurs
     // See: https://gbdev.io/pandocs/halt.html?highlight=HALT#halt
     bool halt_bug;
@@ -41,38 +97,30 @@ typedef struct gb_cpu {
     bool ime_delayed_set;
 
     // the CPU's registers
-    gb_registers *reg;
+    gb_registers reg;
 } gb_cpu;
 
 // initializes the Game Boy's CPU
-gb_cpu *init_cpu(enum GAMEBOY_MODE gb_mode);
-
-// free the CPU struct
-void free_cpu(gb_cpu *cpu);
+void init_cpu(gb_cpu *cpu, enum GAMEBOY_MODE gb_mode);
 
-/* Utility functions for reading and writing
- * to the bc register. This register is composed
- * of register b in the high byte and register
- * c in the low byte of the two-byte register.
- */
-uint16_t read_bc(gb_registers *reg);
-
-void write_bc(gb_registers *reg, uint16_t value);
-
-/* Similar utility functions for the af, de, and hl registers
- * ----------------------------------------------------------
+/* Read and write the af register. BC, DE, and HL are
+ * accessed directly (e.g. reg->bc), but AF has to go
+ * through these to keep F in sync with the lazy flags.
  */
 uint16_t read_af(gb_registers *reg);
 
 void write_af(gb_registers *reg, uint16_t value);
 
-uint16_t read_de(gb_registers *reg);
-
-void write_de(gb_registers *reg, uint16_t value);
-
-uint16_t read_hl(gb_registers *reg);
+/* Record a flag-setting operation instead of computing the flags.
+ * x and y are its operands and result its 9-bit result (carry out
+ * in bit 8). For the operations which leave the carry flag alone,
+ * only the low byte of result is used.
+ */
+void set_lazy_flags(gb_registers *reg, enum LAZY_FLAGS op,
+                    uint8_t x, uint8_t y, uint16_t result);
 
-void write_hl(gb_registers *reg, uint16_t value);
+// compute the flags from the last lazy operation and store them in F
+void evaluate_flags(gb_registers *reg);
 
 // utility function for setting all flags at once
 void set_flags(gb_registers *reg, bool zero, bool subtract,
@@ -96,6 +144,11 @@ bool read_half_carry_flag(gb_registers *reg);
 
 bool read_carry_flag(gb_registers *reg);
 
+/* Recompute the cached interrupt state. Must be called
+ * whenever IF, IE, or the IME flag changes.
+ */
+void update_interrupt_state(gb_cpu *cpu);
+
 uint8_t interrupt_register_read(gb_cpu *cpu, uint16_t address);
 void interrupt_register_write(gb_cpu *cpu, uint16_t address, uint8_t value);
 
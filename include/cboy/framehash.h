@@ -0,0 +1,52 @@
+#ifndef GB_FRAMEHASH_H
+#define GB_FRAMEHASH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+enum FRAME_HASH_MODE {
+    FRAME_HASH_OFF,
+    FRAME_HASH_RECORD, // write each frame's hash to a file
+    FRAME_HASH_VERIFY, // compare each frame's hash against a golden file
+};
+
+/* Tracks per-frame hashing of the PPU's frame buffer so that
+ * changes to the renderer can be checked against known-good
+ * output. A hash is produced once per frame, upon VBlank.
+ */
+typedef struct gb_frame_hasher {
+    enum FRAME_HASH_MODE mode;
+    FILE *hash_file;
+    char *hash_filename;
+
+    // number of frames hashed so far
+    uint64_t frame_count;
+
+    // set once a frame fails to match the golden file
+    bool mismatch_found;
+} gb_frame_hasher;
+
+// 64-bit XXH64 hash of the given bytes, implemented in-tree
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed);
+
+/* Opens the hash file for the given mode. In verify mode the
+ * file must already exist and start with a valid header.
+ *
+ * Returns NULL if the file can't be opened or is malformed.
+ */
+gb_frame_hasher *init_frame_hasher(enum FRAME_HASH_MODE mode, const char *filename);
+
+void free_frame_hasher(gb_frame_hasher *hasher);
+
+/* Hash the given frame buffer and either record the hash or
+ * check it against the next hash in the golden file.
+ *
+ * On the first mismatch the offending frame is saved as a PPM
+ * image next to the golden file. Returns false once emulation
+ * should stop (mismatch, end of golden file, or I/O error).
+ */
+bool process_frame_hash(gb_frame_hasher *hasher, const uint16_t *frame_buffer);
+
+#endif /* GB_FRAMEHASH_H */
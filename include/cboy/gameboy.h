@@ -10,10 +10,29 @@
 #include "cboy/ppu.h"
 #include "cboy/joypad.h"
 #include "cboy/apu.h"
+#include "cboy/framehash.h"
+#include "cboy/movie.h"
+#include "cboy/statehash.h"
+#include "cboy/bootcache.h"
+#include "cboy/pacer.h"
+#include "cboy/speed.h"
+#include "cboy/link.h"
+#include "cboy/mailbox.h"
 
 #define DMG_BOOT_ROM_SIZE  256 /* bytes */
 #define CGB_BOOT_ROM_SIZE 2304 /* bytes */
 
+/* The emulator core (see src/core_template.h) is compiled once
+ * per Game Boy mode with GB_CORE_MODE defined, which turns mode
+ * checks into constants. Everywhere else the mode is checked
+ * at runtime.
+ */
+#ifdef GB_CORE_MODE
+#define IS_CGB_MODE(gb) (GB_CORE_MODE == GB_CGB_MODE)
+#else
+#define IS_CGB_MODE(gb) ((gb)->run_mode == GB_CGB_MODE)
+#endif
+
 /* 4 seems like a good default */
 #define DEFAULT_WINDOW_SCALE 4
 
@@ -22,34 +41,105 @@ struct gb_init_args {
     char *romfile;
     bool force_dmg;
     int window_scale;
+
+    // per-frame hashing of the frame buffer for regression checks
+    enum FRAME_HASH_MODE frame_hash_mode;
+    char *frame_hash_file;
+
+    // per-frame hashing of the full emulation state (NULL if off)
+    char *state_hash_file;
+
+    // joypad input movie recording/replay
+    enum MOVIE_MODE movie_mode;
+    char *movie_file;
+
+    // where the RTC gets the current time from
+    enum TIME_SOURCE time_source;
+    uint64_t time_epoch;
+
+    // directory of boot snapshots (NULL if off), see bootcache.h
+    char *boot_cache_dir;
+
+    // how emulation is kept at the Game Boy's speed
+    enum SYNC_MODE sync_mode;
+
+    // what TAB speeds up to: 2, 4, 8, or UNCAPPED_SPEED
+    uint8_t fast_forward_speed;
+
+    // whether scanlines are drawn as they're reached or a frame at a time
+    enum RENDER_MODE render_mode;
+
+    // whether audio is synthesized on the emulation thread or a worker
+    enum AUDIO_MODE audio_mode;
 };
 
 typedef struct gameboy {
-    gb_cpu *cpu;
+    gb_cpu cpu;
     gb_memory *memory;
     gb_cartridge *cart;
     gb_ppu *ppu;
     gb_joypad *joypad;
     gb_apu *apu;
 
+    // NULL unless frame hashing was requested
+    gb_frame_hasher *frame_hasher;
+
+    // NULL unless state hashing was requested
+    gb_state_hasher *state_hasher;
+
+    // NULL unless recording or replaying an input movie
+    gb_movie *movie;
+
     // if the Game Boy is still on
     bool is_on;
 
     enum GAMEBOY_MODE run_mode;
 
+    // the game loop specialized for run_mode, chosen at init
+    void (*run)(struct gameboy *gb);
+
     uint8_t boot_rom[CGB_BOOT_ROM_SIZE]; // big enough for DMG and CGB
     bool run_boot_rom;
     bool boot_rom_disabled;
 
+    // NULL unless the state is to be saved once the boot ROM finishes
+    gb_boot_snapshot *boot_snapshot;
+    bool boot_rom_finished_signal;
+
     bool is_stopped, dma_requested;
 
+    /* Host pointer to the page of memory the PC is in, so opcodes
+     * and operands can be fetched without going through read_byte.
+     * Only valid for addresses in [fetch_start, fetch_start + fetch_size).
+     * See fetch_byte().
+     */
+    const uint8_t *fetch_page;
+    uint16_t fetch_start, fetch_size;
+
+    /* The CPU's memory page table: host pointers to each 4KB page
+     * of the address space which is plain memory (ROM, VRAM, WRAM,
+     * ECHO RAM), so read_byte/write_byte can access it directly.
+     * Pages which need more than that (cartridge RAM, OAM and I/O,
+     * the boot ROM while it's mapped) are NULL. During an OAM DMA
+     * transfer, all but the last page are blocked. See remap_memory().
+     */
+    const uint8_t *read_pages[NUM_MEMORY_PAGES];
+    uint8_t *write_pages[NUM_MEMORY_PAGES];
+
     // so we can poll input once per frame
     bool frame_presented_signal;
 
     // we use sync-to-audio to maintain appropriate emulation speed
     bool audio_sync_signal;
 
-    bool throttle_fps;
+    /* Other ways of maintaining it, which pace frames instead. While
+     * the LCD is off there are no frames, so audio sync takes over.
+     */
+    enum SYNC_MODE sync_mode;
+    gb_frame_pacer *pacer; // NULL unless sync_mode is SYNC_CLOCK
+
+    // normal speed or fast-forwarding, see speed.h
+    gb_speed_control speed;
 
     /* The Game Boy's internal 16-bit clock counter.
      * The DIV register at memory address 0xff04 is
@@ -61,6 +151,23 @@ typedef struct gameboy {
     // timer counter, modulo, and control registers
     uint8_t tima, tma, tac;
 
+    // normal-speed clocks emulated since power on
+    uint64_t master_clock;
+
+    // CPU clocks until the serial transfer this Game Boy
+    // is clocking completes, or 0 if there isn't one
+    uint16_t serial_clocks;
+
+    // NULL unless linked to another Game Boy, see link.h
+    gb_link_port *link;
+
+    // passes frames and input to and from the main thread while
+    // the Game Boy runs on its own thread, see mailbox.h
+    gb_mailbox *mailbox;
+
+    // master clock to check for input at next (see process_input())
+    uint64_t next_input_check;
+
     uint8_t key0; // GB compatibility
     uint8_t vbk;  // VRAM bank
     uint8_t svbk; // WRAM bank
@@ -72,9 +179,10 @@ typedef struct gameboy {
     uint16_t vram_dma_source;
     uint16_t vram_dma_dest;
     uint16_t vram_dma_length;
-    bool gdma_running;
     bool hdma_running;
-    bool hblank_signal; // to time HDMA transfers
+
+    // 0x10-byte blocks of VRAM DMA the CPU is still stalled for
+    uint8_t vram_dma_stall;
 
     /* A counter to track the number of clocks since
      * a DMA transfer was requested so that we can
@@ -118,8 +226,13 @@ uint8_t cgb_core_io_read(gameboy *gb, uint16_t address);
 
 bool maybe_switch_speed(gameboy *gb);
 
-// the emulator's game loop
+/* The emulator's game loop. run_gameboy() checks the mode
+ * at runtime, while the _dmg and _cgb variants are built
+ * from the same source specialized for their mode.
+ */
 void run_gameboy(gameboy *gb);
+void run_gameboy_dmg(gameboy *gb);
+void run_gameboy_cgb(gameboy *gb);
 
 void report_volume_level(gameboy *gb, bool add_newline);
 
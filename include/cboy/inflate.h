@@ -0,0 +1,71 @@
+#ifndef GB_INFLATE_H
+#define GB_INFLATE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Streaming DEFLATE (RFC 1951) decompression, implemented in-tree
+ * after zlib's puff.c. Compressed data is pulled from a file as
+ * output is requested, so a caller can look at the start of the
+ * decompressed data before the rest has been inflated.
+ */
+
+#define INFLATE_WINDOW_SIZE 32768 /* bytes */
+
+enum INFLATE_STATE {
+    INFLATE_BLOCK_START, // about to read a block header
+    INFLATE_STORED,      // in an uncompressed block
+    INFLATE_HUFFMAN,     // in a fixed or dynamic Huffman block
+    INFLATE_DONE,        // past the final block
+};
+
+// canonical Huffman code, as symbol counts per code length
+typedef struct gb_huffman {
+    uint16_t count[16];
+    uint16_t symbol[288];
+} gb_huffman;
+
+typedef struct gb_inflater {
+    FILE *in;
+    uint8_t in_buf[4096];
+    size_t in_pos, in_len;
+
+    // bits read from the input but not yet used
+    uint32_t bit_buf;
+    int bit_count;
+
+    // the last 32KB of output, for back-references
+    uint8_t window[INFLATE_WINDOW_SIZE];
+    uint32_t window_pos;
+    bool window_full;
+
+    enum INFLATE_STATE state;
+    bool final_block;
+    uint16_t stored_left;
+    gb_huffman lencode, distcode;
+
+    // a back-reference not yet fully copied to the output
+    uint16_t copy_len, copy_dist;
+
+    // set if the input is malformed (error) or can't be read (io_error)
+    bool error, io_error;
+} gb_inflater;
+
+/* Start inflating the DEFLATE stream at the file's current position */
+void init_inflater(gb_inflater *inflater, FILE *in);
+
+/* Inflate up to len bytes into buffer. Returns the number of bytes
+ * inflated, which is less than len only at the end of the stream
+ * or if an error occurred.
+ */
+size_t inflate_read(gb_inflater *inflater, uint8_t *buffer, size_t len);
+
+/* Read up to len bytes of what follows the end of the stream (such
+ * as gzip's trailer), some of which may already have been read into
+ * the input buffer. Returns 0 unless the whole stream's been inflated.
+ */
+size_t inflate_read_trailer(gb_inflater *inflater, uint8_t *buffer, size_t len);
+
+#endif /* GB_INFLATE_H */
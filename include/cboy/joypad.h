@@ -21,6 +21,25 @@ typedef struct gameboy gameboy;
 // handle Game Boy key presses
 void handle_keypress(gameboy *gb, SDL_KeyboardEvent *key);
 
+// normal-speed clocks between checks for input (about a millisecond)
+#define INPUT_CHECK_CLOCKS 4096
+
+// which of the input queued for a Game Boy to apply (see mailbox.h)
+enum INPUT_TIMING {
+    INPUT_DUE,       // events whose time has come
+    INPUT_JOYP_READ, // JOYP is being read: events up to the first changing the buttons
+    INPUT_FRAME_END, // the end of a frame: every event if recording a movie, else those due
+};
+
+/* Apply the input queued for the Game Boy by the main thread, and
+ * set when to check for it next (gb->next_input_check). Turns the
+ * Game Boy off if its window has been closed.
+ *
+ * While a movie is recorded, input is only applied at the end of each
+ * frame, so it's replayed at the same point.
+ */
+void process_input(gameboy *gb, enum INPUT_TIMING timing);
+
 /* Report the value of the JOYP register
  *
  * JOYP bit meanings (0=selected)
@@ -39,6 +58,12 @@ uint8_t report_button_states(gameboy *gb);
 // Update the selected button set given a value written to JOYP
 void update_button_set(gameboy *gb, uint8_t value);
 
+/* Set the state of every button at once (0=pressed), e.g. from an
+ * input movie. A Joypad interrupt is requested if a button in a
+ * selected button set is newly pressed.
+ */
+void set_button_states(gameboy *gb, uint8_t direction_state, uint8_t action_state);
+
 gb_joypad *init_joypad(void);
 
 void free_joypad(gb_joypad *joypad);
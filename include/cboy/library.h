@@ -0,0 +1,59 @@
+#ifndef GB_LIBRARY_H
+#define GB_LIBRARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "cboy/cartridge.h"
+
+/* ROM library
+ * ~~~~~~~~~~~
+ * An index of the ROMs (.gb, .gbc, .gz, and .zip files, see romfile.h)
+ * under a directory, so games can be listed and looked up without
+ * opening every ROM. The index is stored in the directory as LIBRARY_INDEX_NAME and brought
+ * up to date whenever the library is opened: only ROMs which are new,
+ * or whose size or modification time changed, are read again, and
+ * they're read in parallel.
+ */
+#define LIBRARY_INDEX_NAME ".cboylib"
+
+typedef struct gb_library_entry {
+    char *path; // including the library directory
+
+    // the ROM file's size and modification time when it was indexed
+    uint64_t file_size;
+    int64_t mtime;
+
+    uint64_t rom_hash; // see hash_rom()
+    gb_rom_header header;
+
+    // the file couldn't be read (as opposed to not being a valid ROM),
+    // so it's left out of the index to be read again next time
+    bool unreadable;
+} gb_library_entry;
+
+typedef struct gb_library {
+    // sorted by title, then path
+    gb_library_entry *entries;
+    size_t num_entries;
+} gb_library;
+
+/* Index the ROMs under the given directory, reusing and
+ * updating its saved index. Returns NULL on failure.
+ */
+gb_library *open_library(const char *dir);
+
+void free_library(gb_library *library);
+
+/* Find the ROMs whose title contains the query (ignoring case), or
+ * whose hash is the query in hex. Returns the number of matches and
+ * points *match at the first one.
+ */
+size_t find_in_library(gb_library *library, const char *query, gb_library_entry **match);
+
+/* List the ROMs matching the query (see find_in_library),
+ * or every ROM if the query is NULL.
+ */
+void print_library(gb_library *library, const char *query);
+
+#endif /* GB_LIBRARY_H */
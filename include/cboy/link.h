@@ -0,0 +1,84 @@
+#ifndef GB_LINK_H
+#define GB_LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Link cable
+ * ~~~~~~~~~~
+ * Connects the serial ports of two Game Boys run in this process,
+ * each on a thread of its own. The threads don't run in lockstep,
+ * each keeps its own time in normal-speed clocks (its master clock),
+ * and they only wait on each other around serial transfers:
+ *
+ *  - When one of them starts clocking a transfer, it hands its byte
+ *    and the time the transfer completes at to the cable. When the
+ *    transfer completes, it waits for the other to reply with the
+ *    byte it shifted out (see receive_serial_byte()).
+ *  - The other replies as soon as its own time reaches the completion
+ *    time, so a byte arrives when it would on hardware unless the
+ *    receiver had already run past that time.
+ *  - They sync up every LINK_SYNC_CLOCKS of their own time, and
+ *    neither runs more than LINK_MAX_SKEW clocks ahead of the other.
+ *    A Game Boy waiting on the other to clock a transfer doesn't run
+ *    ahead by more than the shortest transfer the other can clock, so
+ *    it sees every transfer start before it completes.
+ *
+ * The main thread presents their frames and passes each the input
+ * for its window (see mailbox.h).
+ *
+ * The other end of the cable can also be a Game Boy run by another
+ * process, in which case it's plugged into a socket (see socklink.h).
+ */
+
+// normal-speed clocks between sync points (one scanline)
+#define LINK_SYNC_CLOCKS 456
+
+// the most normal-speed clocks either end may run ahead of the other (about 4 ms)
+#define LINK_MAX_SKEW 16384
+
+typedef struct gameboy gameboy;
+
+typedef struct gb_link gb_link;
+typedef struct gb_socket_link gb_socket_link;
+
+// one Game Boy's end of a link cable
+typedef struct gb_link_port {
+    // in this process, or NULL if the cable goes to a socket
+    gb_link *link;
+    int end; // 0 or 1
+
+    gb_socket_link *socket; // NULL unless the cable goes to a socket
+
+    uint64_t next_sync; // master clock of the next sync point
+
+    // running forward again after a rollback (see socklink.h)
+    bool replaying;
+} gb_link_port;
+
+/* Run two Game Boys connected by a link cable until both are turned
+ * off, each on a thread of its own (see run_gameboys())
+ */
+void run_linked_gameboys(gameboy *first, gameboy *second);
+
+/* Hand the byte shifted out by a transfer this Game Boy started
+ * clocking to the other end, with the master clock it completes at
+ */
+void start_link_transfer(gameboy *gb, uint8_t value, uint64_t completion_time);
+
+/* The transfer this Game Boy was clocking has been stopped */
+void cancel_link_transfer(gameboy *gb);
+
+/* The transfer this Game Boy was clocking has completed. Waits for the
+ * byte the other end shifted out in exchange, and returns it, or 0xff
+ * if the other end has been disconnected.
+ */
+uint8_t finish_link_transfer(gameboy *gb);
+
+/* Called between instructions as this Game Boy runs, to reply to
+ * transfers clocked by the other end and keep from running too far
+ * ahead of it. May roll the Game Boy back if linked over a socket.
+ */
+void run_link(gameboy *gb);
+
+#endif /* GB_LINK_H */
@@ -0,0 +1,66 @@
+#ifndef GB_MAILBOX_H
+#define GB_MAILBOX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <SDL_events.h>
+
+/* Mailboxes
+ * ~~~~~~~~~
+ * SDL only lets the main thread present frames and read input, so
+ * each Game Boy runs on a thread of its own while the main thread
+ * does both for it, through the Game Boy's mailbox:
+ *
+ *  - At the end of each frame, the Game Boy's thread posts it and
+ *    waits for the main thread to present it and read the input that
+ *    came in meanwhile, as it used to once per frame on its own.
+ *  - The main thread reads input as soon as it comes in, and queues
+ *    each event for the Game Boy whose window it's for, along with the
+ *    host time it was read at. The queue is lock-free, with the main
+ *    thread as its only writer and the Game Boy's thread its only
+ *    reader.
+ *  - Host time is matched to emulated time whenever the Game Boy has
+ *    caught up with the host: when a frame it posted is presented, or
+ *    when it's done waiting on the audio device. An event is taken
+ *    once the Game Boy's master clock reaches the time it was read at
+ *    (see take_input_event()), rather than at the end of the frame,
+ *    or earlier if the game reads JOYP (see process_input()).
+ *
+ * Closing the window (or quitting) closes the Game Boy's mailbox, and
+ * its thread turns it off.
+ */
+
+typedef struct gameboy gameboy;
+
+// frames and input passed between a Game Boy's thread and the main thread
+typedef struct gb_mailbox gb_mailbox;
+
+/* Run the Game Boys, each on a thread of its own, until all are
+ * turned off, while this (the main) thread presents their frames and
+ * reads their input. finished, if not NULL, is called on each Game
+ * Boy's thread once it's been turned off.
+ */
+void run_gameboys(gameboy *gbs[], int num_gbs, void (*finished)(gameboy *gb));
+
+/* Called on a Game Boy's thread to post a frame, and wait for the
+ * main thread to present it (unless the mailbox has been closed)
+ */
+void post_frame(gameboy *gb, const uint16_t *frame_buffer);
+
+/* Called on a Game Boy's thread when it's caught up with the host
+ * (after waiting for it), to match the host time to its master clock
+ */
+void sync_input_time(gameboy *gb);
+
+/* Called on a Game Boy's thread to take the next input event for it,
+ * once its master clock has reached the time the event was read at,
+ * or straight away if ignore_time is set. Returns false if there are
+ * none to take, setting *due to the master clock the next is due at
+ * (UINT64_MAX if there are none).
+ */
+bool take_input_event(gameboy *gb, bool ignore_time, SDL_Event *event, uint64_t *due);
+
+/* Whether the Game Boy's window has been closed */
+bool mailbox_closed(gb_mailbox *mailbox);
+
+#endif /* GB_MAILBOX_H */
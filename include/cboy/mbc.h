@@ -57,6 +57,9 @@ typedef struct cartridge_mbc5 {
     uint8_t ram_bankno;
 } cartridge_mbc5;
 
+typedef struct gameboy gameboy;
+typedef struct gb_cartridge gb_cartridge;
+
 typedef struct cartridge_mbc {
     MBC_TYPE mbc_type;
     union
@@ -65,6 +68,20 @@ typedef struct cartridge_mbc {
         cartridge_mbc3 mbc3;
         cartridge_mbc5 mbc5;
     };
+
+    /* Handlers for cartridge RAM reads (0xa000-0xbfff) and
+     * all writes, installed by init_mbc for the MBC type.
+     */
+    uint8_t (*read)(gameboy *gb, uint16_t address);
+    void (*write)(gameboy *gb, uint16_t address, uint8_t value);
+
+    /* The banks currently mapped at 0x0000-0x3fff and 0x4000-0x7fff,
+     * and at 0xa000-0xbfff (NULL if cartridge RAM is disabled or no
+     * RAM bank is selected). Only updated when a bank register is
+     * written; see map_cartridge_banks.
+     */
+    const uint8_t *current_rom_bank_ptr[2];
+    uint8_t *current_ram_bank_ptr;
 } cartridge_mbc;
 
 /* Initialize a memory bank controller with the
@@ -75,11 +92,19 @@ void init_mbc(MBC_TYPE mbc_type, cartridge_mbc *mbc);
 // check if the given MBC type is supported
 bool mbc_supported(MBC_TYPE mbc_type);
 
+/* human-readable name of the MBC type */
+const char *mbc_type_name(MBC_TYPE mbc_type);
+
 /* utility function for printing out the cartridge MBC type */
 void print_mbc_type(MBC_TYPE mbc_type);
 
-/* forward declaration needed for handle_mbc_writes() */
-typedef struct gameboy gameboy;
+/* Point the MBC's current bank pointers at the banks its registers
+ * select. Must be called once the cartridge's banks are loaded.
+ */
+void map_cartridge_banks(gb_cartridge *cart);
+
+/* The ROM bank currently mapped at the given address (0x0000-0x7fff) */
+const uint8_t *cartridge_rom_bank(gameboy *gb, uint16_t address);
 
 /* Handle reads from cartridge ROM/RAM */
 uint8_t cartridge_read(gameboy *gb, uint16_t address);
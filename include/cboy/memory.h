@@ -8,8 +8,29 @@
 #define OAM_SIZE 160
 #define HRAM_SIZE 127
 
+/* the CPU's page table splits the address space into 4KB pages */
+#define MEMORY_PAGE_SIZE (4 * KB)
+#define NUM_MEMORY_PAGES 16
+
+/* I/O registers 0xff00-0xff7f (IE is handled separately) */
+#define NUM_IO_REGISTERS 128
+
 typedef struct gameboy gameboy;
 
+typedef uint8_t (*io_read_handler)(gameboy *gb, uint16_t address);
+typedef void (*io_write_handler)(gameboy *gb, uint16_t address, uint8_t value);
+
+/* How the CPU accesses an I/O register. Bits set in read_mask
+ * always read as 1, and bits clear in write_mask are dropped
+ * before the value reaches the write handler.
+ */
+typedef struct gb_io_register {
+    io_read_handler read;
+    io_write_handler write;
+    uint8_t read_mask;
+    uint8_t write_mask;
+} gb_io_register;
+
 // the Game Boy's internal RAM
 typedef struct gb_memory {
     // two VRAM banks - second one only used in CGB mode
@@ -20,11 +41,43 @@ typedef struct gb_memory {
 
     uint8_t oam[OAM_SIZE];
     uint8_t hram[HRAM_SIZE];
+
+    // I/O register handlers, indexed by the low 7 bits of the address
+    gb_io_register io_registers[NUM_IO_REGISTERS];
+
+    // storage for the I/O registers which have no other home
+    uint8_t io[NUM_IO_REGISTERS];
+
+    /* What the page table maps outside of the last page during an
+     * OAM DMA transfer: reads of 0xff, and writes that go nowhere
+     */
+    uint8_t dma_read_page[MEMORY_PAGE_SIZE];
+    uint8_t dma_write_page[MEMORY_PAGE_SIZE];
 } gb_memory;
 
-// Utility functions for reading and writing to memory
+/* Utility functions for reading and writing to memory. The _dmg
+ * and _cgb variants are those of the specialized cores.
+ */
 uint8_t read_byte(gameboy *gb, uint16_t address);
 void write_byte(gameboy *gb, uint16_t address, uint8_t value);
+uint8_t read_byte_dmg(gameboy *gb, uint16_t address);
+void write_byte_dmg(gameboy *gb, uint16_t address, uint8_t value);
+uint8_t read_byte_cgb(gameboy *gb, uint16_t address);
+void write_byte_cgb(gameboy *gb, uint16_t address, uint8_t value);
+
+// read the byte/little-endian word at PC and advance PC past it
+uint8_t fetch_byte(gameboy *gb);
+uint16_t fetch_word(gameboy *gb);
+
+/* Rebuild the CPU's page table and drop the fetch page. Must be
+ * called whenever what's mapped into the address space changes:
+ * ROM, VRAM, and WRAM bank switches, unmapping the boot ROM, and
+ * the start and end of an OAM DMA transfer.
+ */
+void remap_memory(gameboy *gb);
+
+// host pointer to the 4KB page of plain memory at address, or NULL
+const uint8_t *memory_page(gameboy *gb, uint16_t address);
 
  // read data from a RAM address
  uint8_t ram_read(gameboy *gb, uint16_t address);
@@ -35,6 +88,13 @@ void write_byte(gameboy *gb, uint16_t address, uint8_t value);
 // Initialize the memory struct
 gb_memory *init_memory_map(void);
 
+/* Fill in the I/O register table for gb->run_mode. The _dmg and
+ * _cgb variants install the handlers of the specialized cores.
+ */
+void init_io_registers(gameboy *gb);
+void init_io_registers_dmg(gameboy *gb);
+void init_io_registers_cgb(gameboy *gb);
+
 // Free the memory struct
 void free_memory_map(gb_memory *memory);
 
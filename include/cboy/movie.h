@@ -0,0 +1,52 @@
+#ifndef GB_MOVIE_H
+#define GB_MOVIE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "cboy/common.h"
+
+enum MOVIE_MODE {
+    MOVIE_OFF,
+    MOVIE_RECORD, // save the joypad state of every frame
+    MOVIE_REPLAY, // drive the joypad from a saved movie
+};
+
+/* An input movie: the joypad state for each frame of a run.
+ *
+ * Movie file layout
+ * -----------------
+ * 8 bytes: magic ("CBOYMV01")
+ * 8 bytes: little-endian hash of the game ROM
+ * 1 byte:  run mode (GAMEBOY_MODE)
+ * then one byte per frame: action buttons in the upper
+ * nibble, D-pad in the lower nibble (0=pressed, as in JOYP)
+ */
+typedef struct gb_movie {
+    enum MOVIE_MODE mode;
+    FILE *movie_file;
+
+    // number of frames recorded or replayed so far
+    uint64_t frame_count;
+} gb_movie;
+
+typedef struct gameboy gameboy;
+
+/* Open the given movie file for recording or replay. The ROM
+ * hash and run mode are written to (or checked against)
+ * the movie header, so a movie can only be replayed with the
+ * game and mode it was recorded with.
+ *
+ * Returns NULL if the movie can't be used.
+ */
+gb_movie *init_movie(gameboy *gb, enum MOVIE_MODE mode, const char *filename);
+
+void free_movie(gb_movie *movie);
+
+/* Record or replay the joypad state for the current frame.
+ * Should be called once per frame, after polling for input.
+ * Emulation is stopped once a replayed movie runs out.
+ */
+void process_movie_frame(gameboy *gb);
+
+#endif /* GB_MOVIE_H */
@@ -0,0 +1,58 @@
+#ifndef GB_PACER_H
+#define GB_PACER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* How emulation is kept at the Game Boy's speed */
+enum SYNC_MODE {
+    SYNC_AUDIO, // wait for the audio device to play what's been emulated
+    SYNC_CLOCK, // present each frame at its deadline on the host's clock
+    SYNC_VSYNC, // present each frame at the host display's vertical sync
+};
+
+/* Frame pacer
+ * ~~~~~~~~~~~
+ * Paces emulation by the wall clock in SYNC_CLOCK mode: before each
+ * frame is presented, it sleeps until the frame's deadline, a whole
+ * number of Game Boy frames (70224 clocks, about 59.7275 Hz) after
+ * pacing started. It sleeps on an absolute deadline so oversleeping
+ * doesn't add up, and wakes slightly early to spin for the last
+ * fraction of a millisecond, which the host's scheduler can't be
+ * trusted with.
+ * While fast-forwarding, deadlines come speed times as often.
+ */
+typedef struct gb_frame_pacer {
+    int64_t start_ns;    // host time (CLOCK_MONOTONIC) pacing started
+    uint64_t num_frames; // frames paced since start_ns
+    uint8_t speed;       // multiple of the Game Boy's speed to pace at
+
+    // how late each frame was presented, in ns
+    uint64_t frames_timed;
+    int64_t total_late_ns, max_late_ns;
+    uint64_t frames_missed; // presented a millisecond or more late
+
+    // times the host fell a frame behind and pacing started over
+    uint64_t resyncs;
+} gb_frame_pacer;
+
+gb_frame_pacer *init_frame_pacer(void);
+
+void free_frame_pacer(gb_frame_pacer *pacer);
+
+/* Pace at the given multiple of the Game Boy's speed, from now */
+void set_pacer_speed(gb_frame_pacer *pacer, uint8_t speed);
+
+/* Wait until it's time to present the next frame */
+void pace_frame(gb_frame_pacer *pacer);
+
+/* Start pacing over from now, e.g. after running unthrottled */
+void reset_frame_pacer(gb_frame_pacer *pacer);
+
+/* The host's monotonic clock, in ns */
+int64_t host_time_ns(void);
+
+/* Report how closely frames kept to their deadlines */
+void print_pacer_stats(gb_frame_pacer *pacer);
+
+#endif /* GB_PACER_H */
@@ -14,6 +14,23 @@
 
 typedef struct gameboy gameboy;
 
+enum RENDER_MODE {
+    RENDER_SCANLINE, // draw each scanline as the PPU reaches it
+    RENDER_FRAME,    // log what each scanline is drawn from, and draw them all at VBLANK
+    RENDER_THREAD,   // as RENDER_FRAME, but drawn on another thread during the next frame
+};
+
+// writes to memory scanlines are drawn from, when rendering a frame at a time
+enum FRAME_LOG_TARGET {
+    FRAME_LOG_VRAM0,
+    FRAME_LOG_VRAM1,
+    FRAME_LOG_OAM,
+    FRAME_LOG_BG_PRAM,
+    FRAME_LOG_OBJ_PRAM,
+};
+
+typedef struct gb_frame_log gb_frame_log;
+
 /* Sprite rendering data */
 typedef struct gb_sprite {
         uint8_t ypos, // sprite vertical pos + 16
@@ -73,6 +90,9 @@ typedef struct gb_ppu {
 
     bool curr_scanline_rendered, curr_frame_displayed;
 
+    // the current frame is being skipped while fast-forwarding
+    bool skip_render;
+
     /* The mode 0-2 and LY=LYC STAT mode interrupt
      * sources are ORed together for purposes
      * of requesting STAT interrupts. This
@@ -93,6 +113,9 @@ typedef struct gb_ppu {
 
     // CGB only: whether to apply correction to emulate LCD color output
     bool lcd_filter;
+
+    // NULL unless rendering a frame at a time, see frame_log.c
+    gb_frame_log *frame_log;
 } gb_ppu;
 
 void ppu_write(gameboy *gb, uint16_t address, uint8_t value);
@@ -101,12 +124,12 @@ uint8_t ppu_read(gameboy *gb, uint16_t address);
 
 void dma_transfer(gameboy *gb);
 
+void vram_dma_transfer(gameboy *gb, uint16_t length);
+
 void display_frame(gameboy *gb);
 
 uint16_t tile_addr_from_index(bool tile_data_area_bit, uint8_t tile_index);
 
-void load_sprites(gameboy *gb);
-
 void run_ppu(gameboy *gb, uint8_t num_clocks);
 
 void cycle_display_colors(display_colors *colors, bool cycle_forward);
@@ -117,4 +140,52 @@ void free_ppu(gb_ppu *ppu);
 
 void reset_ppu(gameboy *gb);
 
+/* Frame log
+ * ~~~~~~~~~
+ * Rendering a frame at a time (RENDER_FRAME), the PPU logs each
+ * scanline's registers as it reaches it instead of drawing it, along
+ * with every write to VRAM, OAM, and palette RAM in between. At
+ * VBLANK the whole frame is drawn in one pass, from copies of that
+ * memory brought up to date by the writes logged before each line,
+ * so it's drawn just as it would have been line by line.
+ *
+ * With a render thread (RENDER_THREAD), the frame is handed to it at
+ * VBLANK instead, and drawn while the next one's emulated. The PPU's
+ * frame buffer then holds the frame before, so that's what's shown.
+ */
+
+/* Start logging from the Game Boy's current memory, drawing on a
+ * render thread of its own if threaded is set.
+ * Returns NULL on failure.
+ */
+gb_frame_log *init_frame_log(gameboy *gb, bool threaded);
+
+void free_frame_log(gb_frame_log *log);
+
+void log_frame_write(gb_frame_log *log, enum FRAME_LOG_TARGET target, uint16_t offset, uint8_t value);
+
+// log writes of length bytes from data, from offset on
+void log_frame_copy(gb_frame_log *log, enum FRAME_LOG_TARGET target, uint16_t offset,
+                    const uint8_t *data, uint16_t length);
+
+/* Draw the scanlines logged so far into the frame buffer. Done at
+ * VBLANK. With a render thread, they're handed to it to draw, and
+ * the frame buffer gets the last frame it completed.
+ */
+void flush_frame_log(gb_frame_log *log);
+
+/* Draw the scanlines logged so far, mid-frame, and wait until the
+ * frame buffer has them (to save it with a state). With a render
+ * thread, what's shown at the next VBLANK is still a whole frame.
+ */
+void sync_frame_log(gb_frame_log *log);
+
+/* Drop what's been logged and start over from the Game Boy's current
+ * memory and frame buffer. Needed whenever they're replaced wholesale,
+ * like by loading a saved state. With a render thread, the frame
+ * buffer's only shown if frame_complete is set; otherwise the last
+ * frame completed is still shown until the next is.
+ */
+void restart_frame_log(gb_frame_log *log, gameboy *gb, bool frame_complete);
+
 #endif
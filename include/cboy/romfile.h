@@ -0,0 +1,73 @@
+#ifndef GB_ROMFILE_H
+#define GB_ROMFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "cboy/inflate.h"
+
+/* ROM files
+ * ~~~~~~~~~
+ * ROMs can be loaded as they are, gzip-compressed (.gz), or from
+ * a ZIP archive (.zip), in which case the first .gb or .gbc file
+ * in the archive is used (or the first file, if there are none).
+ * The format is recognized from the file's contents, not its name.
+ *
+ * Compressed ROMs are inflated as they're read, straight into the
+ * caller's buffer, so no temporary file or whole-file buffer is
+ * needed and the header in bank 0 can be checked before the rest
+ * of the ROM has been inflated. Their CRC-32 is computed along
+ * the way, to be checked against the archive's once they've been
+ * read (see finish_rom_file).
+ */
+
+enum ROM_FILE_FORMAT {
+    ROM_FILE_PLAIN,
+    ROM_FILE_GZIP,
+    ROM_FILE_ZIP,
+};
+
+typedef struct gb_rom_file {
+    FILE *file;
+    enum ROM_FILE_FORMAT format;
+
+    // only for compressed data, NULL if the ROM (or ZIP member) is stored
+    gb_inflater *inflater;
+
+    // bytes left in a stored ZIP member
+    uint32_t stored_left;
+
+    // CRC-32 and size of the ROM data read so far, and (once known)
+    // those the archive says it has, modulo 2^32 for gzip's size
+    uint32_t crc, size;
+    uint32_t archived_crc, archived_size;
+
+    // set if the file can't be read (io_error), or ends or is corrupt
+    // before the requested data (malformed)
+    bool io_error, malformed;
+} gb_rom_file;
+
+/* Open a ROM file of any of the supported formats, positioned at the
+ * start of the ROM. Returns NULL if the file can't be opened. A
+ * malformed or unsupported archive is opened with malformed set,
+ * so reading from it fails like reading a truncated ROM.
+ */
+gb_rom_file *open_rom_file(const char *path);
+
+void close_rom_file(gb_rom_file *rom_file);
+
+/* Read up to len bytes of the ROM into buffer. Returns the number
+ * of bytes read, which is less than len at the end of the ROM or
+ * if an error occurred.
+ */
+size_t read_rom_file(gb_rom_file *rom_file, uint8_t *buffer, size_t len);
+
+/* Read the rest of a compressed ROM, past what's been read, and check
+ * it against the CRC-32 and size in the archive. Returns false, with
+ * malformed or io_error set, if it doesn't match or can't be read.
+ * Plain ROM files have nothing to check.
+ */
+bool finish_rom_file(gb_rom_file *rom_file);
+
+#endif /* GB_ROMFILE_H */
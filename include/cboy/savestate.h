@@ -0,0 +1,111 @@
+#ifndef GB_SAVESTATE_H
+#define GB_SAVESTATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Save states
+ * ~~~~~~~~~~~
+ * Copies of the whole emulation state in memory, which emulation can
+ * be rolled back to. Like the boot snapshots they're built from, they
+ * leave out what's up to the host rather than the game: the audio
+ * device and sample ring, the display and its colors, the buttons
+ * held down, and how fast emulation runs.
+ */
+
+/* Applies FIELD to each part of the machine's state, other than the
+ * cartridge's MBC and RAM, and stops at the first it returns false for
+ */
+#define MACHINE_STATE_FIELDS(gb, FIELD) (             \
+    FIELD((gb)->cpu)                                  \
+    && FIELD((gb)->memory->vram)                      \
+    && FIELD((gb)->memory->wram)                      \
+    && FIELD((gb)->memory->oam)                       \
+    && FIELD((gb)->memory->hram)                      \
+    && FIELD((gb)->memory->io)                        \
+    && FIELD((gb)->ppu->frame_buffer)                 \
+    && FIELD((gb)->ppu->dot_clock)                    \
+    && FIELD((gb)->ppu->frames_rendered)              \
+    && FIELD((gb)->ppu->bg_pram)                      \
+    && FIELD((gb)->ppu->obj_pram)                     \
+    && FIELD((gb)->ppu->window_line_counter)          \
+    && FIELD((gb)->ppu->wy_trigger)                   \
+    && FIELD((gb)->ppu->curr_scanline_rendered)       \
+    && FIELD((gb)->ppu->curr_frame_displayed)         \
+    && FIELD((gb)->ppu->lyc_stat_line)                \
+    && FIELD((gb)->ppu->hblank_stat_line)             \
+    && FIELD((gb)->ppu->vblank_stat_line)             \
+    && FIELD((gb)->ppu->oam_stat_line)                \
+    && FIELD((gb)->ppu->lcdc)                         \
+    && FIELD((gb)->ppu->stat)                         \
+    && FIELD((gb)->ppu->scy)                          \
+    && FIELD((gb)->ppu->scx)                          \
+    && FIELD((gb)->ppu->ly)                           \
+    && FIELD((gb)->ppu->lyc)                          \
+    && FIELD((gb)->ppu->dma)                          \
+    && FIELD((gb)->ppu->bgp)                          \
+    && FIELD((gb)->ppu->obp0)                         \
+    && FIELD((gb)->ppu->obp1)                         \
+    && FIELD((gb)->ppu->wx)                           \
+    && FIELD((gb)->ppu->wy)                           \
+    && FIELD((gb)->ppu->bcps)                         \
+    && FIELD((gb)->ppu->ocps)                         \
+    && FIELD((gb)->ppu->opri)                         \
+    && FIELD((gb)->apu->enabled)                      \
+    && FIELD((gb)->apu->panning_info)                 \
+    && FIELD((gb)->apu->sample_timer)                 \
+    && FIELD((gb)->apu->left_volume)                  \
+    && FIELD((gb)->apu->right_volume)                 \
+    && FIELD((gb)->apu->mix_vin_left)                 \
+    && FIELD((gb)->apu->mix_vin_right)                \
+    && FIELD((gb)->apu->curr_channel_samples)         \
+    && FIELD((gb)->apu->frame_seq_pos)                \
+    && FIELD((gb)->apu->clock)                        \
+    && FIELD((gb)->apu->channel_one)                  \
+    && FIELD((gb)->apu->channel_two)                  \
+    && FIELD((gb)->apu->channel_three)                \
+    && FIELD((gb)->apu->channel_four)                 \
+    && FIELD((gb)->joypad->dpad_selected)             \
+    && FIELD((gb)->joypad->action_selected)           \
+    && FIELD((gb)->boot_rom_disabled)                 \
+    && FIELD((gb)->is_stopped)                        \
+    && FIELD((gb)->dma_requested)                     \
+    && FIELD((gb)->clock_counter)                     \
+    && FIELD((gb)->master_clock)                      \
+    && FIELD((gb)->tima)                              \
+    && FIELD((gb)->tma)                               \
+    && FIELD((gb)->tac)                               \
+    && FIELD((gb)->key0)                              \
+    && FIELD((gb)->vbk)                               \
+    && FIELD((gb)->svbk)                              \
+    && FIELD((gb)->double_speed)                      \
+    && FIELD((gb)->speed_switch_armed)                \
+    && FIELD((gb)->vram_dma_source)                   \
+    && FIELD((gb)->vram_dma_dest)                     \
+    && FIELD((gb)->vram_dma_length)                   \
+    && FIELD((gb)->hdma_running)                      \
+    && FIELD((gb)->vram_dma_stall)                    \
+    && FIELD((gb)->dma_counter)                       \
+    && FIELD((gb)->cart->time_source.elapsed_clocks))
+
+typedef struct gameboy gameboy;
+
+typedef struct gb_savestate {
+    uint64_t master_clock; // when it was saved
+    uint8_t *data;
+} gb_savestate;
+
+/* Allocate room for the given Game Boy's state. Returns false if
+ * there isn't enough memory.
+ */
+bool init_savestate(gameboy *gb, gb_savestate *state);
+
+void free_savestate(gb_savestate *state);
+
+void save_state(gameboy *gb, gb_savestate *state);
+
+/* Roll back to a state saved from the same Game Boy */
+void load_state(gameboy *gb, const gb_savestate *state);
+
+#endif /* GB_SAVESTATE_H */
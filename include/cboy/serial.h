@@ -0,0 +1,44 @@
+#ifndef GB_SERIAL_H
+#define GB_SERIAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Serial transfers
+ * ~~~~~~~~~~~~~~~~
+ * Writing SC with bit 7 set starts a transfer of the byte in SB.
+ * With bit 0 set, this Game Boy clocks the transfer: 8192 bits a
+ * second, or 32 times that with CGB bit 1 set, and both doubled in
+ * double speed mode. When its eight bits are done, SB holds the byte
+ * the other Game Boy shifted out (0xff if no link cable is connected),
+ * SC bit 7 is cleared, and a serial interrupt is requested.
+ *
+ * With bit 0 clear, the other Game Boy clocks the transfer, so it
+ * completes whenever a byte arrives over the link cable (see
+ * receive_serial_byte()).
+ *
+ * The bits are exchanged all at once, when the transfer completes.
+ */
+
+// CPU clocks per bit at the normal and CGB fast serial clock speeds
+#define SERIAL_CLOCKS_PER_BIT      512
+#define FAST_SERIAL_CLOCKS_PER_BIT 16
+
+typedef struct gameboy gameboy;
+
+uint8_t serial_read(gameboy *gb, uint16_t address);
+void serial_write(gameboy *gb, uint16_t address, uint8_t value);
+
+/* Advance a transfer this Game Boy clocks by the given number of CPU clocks */
+void run_serial(gameboy *gb, uint16_t num_clocks);
+
+/* Whether a transfer is waiting for the other Game Boy to clock it */
+bool awaiting_serial_clock(gameboy *gb);
+
+/* The other Game Boy clocked the given byte over the link cable.
+ * Returns the byte this one shifted out in exchange, which is 0xff
+ * unless it was waiting on a transfer clocked by the other one.
+ */
+uint8_t receive_serial_byte(gameboy *gb, uint8_t value);
+
+#endif /* GB_SERIAL_H */
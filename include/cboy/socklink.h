@@ -0,0 +1,68 @@
+#ifndef GB_SOCKLINK_H
+#define GB_SOCKLINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Link cable over a socket
+ * ~~~~~~~~~~~~~~~~~~~~~~~~
+ * Connects this Game Boy's serial port to one run by another process
+ * on the same host, over a UNIX domain socket. The first process to
+ * use the socket's path waits for the second to connect, and both
+ * count link time in normal-speed clocks from then on.
+ *
+ * Neither process waits on the other for each byte. Instead:
+ *
+ *  - When one of them starts clocking a transfer, it sends its byte
+ *    and the link time the transfer completes at. The other delivers
+ *    it then (see receive_serial_byte()) and sends back the byte it
+ *    shifted out.
+ *  - If that reply hasn't arrived when the transfer completes, the
+ *    clocking end predicts it from the other's SB and SC, which it's
+ *    told about whenever they change, saves its state, and runs on.
+ *    If the prediction was wrong, it rolls back to the saved state,
+ *    takes the real byte, and runs forward again.
+ *  - While waiting on the other end to clock a transfer, a Game Boy
+ *    saves its state every so often. If a byte turns up for a time it
+ *    has already run past, it rolls back to the last state saved
+ *    before then and runs forward again with the byte delivered on
+ *    time.
+ *
+ * Each end keeps the other told how far it's got with anything that
+ * can't be rolled back: it never starts a transfer while it might
+ * still roll back to before then, nor runs more than
+ * LINK_MAX_SPECULATION clocks past the earliest time it might roll
+ * back to. It waits for the other end instead, which is when a link
+ * stalls.
+ *
+ * While running forward again after a rollback, frames aren't
+ * presented, audio isn't played, and input isn't read: the buttons
+ * held down at the time are held throughout.
+ */
+
+// the most normal-speed clocks run past the earliest rollback point (one frame)
+#define LINK_MAX_SPECULATION 70224
+
+// normal-speed clocks between states saved while waiting on the other end (a quarter frame)
+#define LINK_SNAPSHOT_CLOCKS 17556
+
+typedef struct gameboy gameboy;
+
+typedef struct gb_socket_link gb_socket_link;
+
+/* Connect the Game Boy's serial port to the UNIX domain socket at the
+ * given path, waiting for another process to connect if there's none
+ * listening there yet. Returns false on failure.
+ */
+bool open_socket_link(gameboy *gb, const char *path);
+
+/* Disconnect the Game Boy and report the link's latency and rollbacks */
+void close_socket_link(gameboy *gb);
+
+// see start_link_transfer(), cancel_link_transfer(), and so on in link.h
+void start_socket_transfer(gameboy *gb, uint8_t value, uint64_t completion_time);
+void cancel_socket_transfer(gameboy *gb);
+uint8_t finish_socket_transfer(gameboy *gb);
+void run_socket_link(gameboy *gb);
+
+#endif /* GB_SOCKLINK_H */
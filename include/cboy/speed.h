@@ -0,0 +1,59 @@
+#ifndef GB_SPEED_H
+#define GB_SPEED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Fast-forward
+ * ~~~~~~~~~~~~
+ * TAB switches between the Game Boy's speed and the fast-forward
+ * speed: 2x, 4x, 8x, or as fast as the host can go (uncapped).
+ *
+ * At a multiple of the Game Boy's speed, audio and clock sync work
+ * as they do at 1x. The APU averages every speed samples into one,
+ * so the audio device plays the emulated audio that many times as
+ * fast, and the frame pacer's deadlines come that many times as
+ * often. Uncapped, nothing waits, and the APU averages over as many
+ * samples as the measured speed calls for instead, so the sample
+ * ring doesn't overflow and drop audio.
+ *
+ * While fast-forwarding, frames are only drawn about as often as
+ * the Game Boy's display would show them. The others are emulated
+ * as usual but none of their scanlines are rendered. Frame and
+ * state hashes need every frame drawn, so there's no frame-skip
+ * with either of them.
+ */
+
+#define UNCAPPED_SPEED 0
+
+typedef struct gameboy gameboy;
+
+typedef struct gb_speed_control {
+    uint8_t speed;              // multiple of the Game Boy's speed, or UNCAPPED_SPEED
+    uint8_t fast_forward_speed; // the speed TAB switches to
+    bool frame_skip_allowed;
+
+    // host time (CLOCK_MONOTONIC) of the last VBlank, and the last drawn one
+    int64_t last_vblank_ns, last_drawn_ns;
+
+    // host time an emulated frame takes, averaged over the last few
+    int64_t frame_ns;
+
+    // frames skipped since the last drawn one
+    uint8_t frames_skipped;
+} gb_speed_control;
+
+/* Run at the given multiple of the Game Boy's speed,
+ * or as fast as possible if it's UNCAPPED_SPEED
+ */
+void set_emulation_speed(gameboy *gb, uint8_t speed);
+
+/* Switch between normal speed and the fast-forward speed */
+void toggle_fast_forward(gameboy *gb);
+
+/* Called at each VBlank, after pacing. Decides
+ * whether the next frame is drawn or skipped.
+ */
+void update_frame_skip(gameboy *gb);
+
+#endif /* GB_SPEED_H */
@@ -0,0 +1,58 @@
+#ifndef GB_STATEHASH_H
+#define GB_STATEHASH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The parts of the emulator that are hashed separately,
+ * so that a divergence can be traced to a component.
+ */
+enum STATE_COMPONENT {
+    STATE_CPU,
+    STATE_TIMER,
+    STATE_WRAM,
+    STATE_VRAM,
+    STATE_OAM,
+    STATE_HRAM,
+    STATE_PPU,
+    STATE_APU,
+    STATE_CART,
+    STATE_SYSTEM, // CGB, VRAM DMA, joypad, and misc. I/O register state
+    NUM_STATE_COMPONENTS,
+};
+
+/* Records a hash of each component of the emulation
+ * state once per frame, upon VBlank.
+ *
+ * State hash file layout
+ * ----------------------
+ * A text line: "CBOYSH01" followed by the space-separated
+ * component names, then for every frame one little-endian
+ * 64-bit hash per component, in that order.
+ */
+typedef struct gb_state_hasher {
+    FILE *hash_file;
+
+    // number of frames hashed so far
+    uint64_t frame_count;
+} gb_state_hasher;
+
+typedef struct gameboy gameboy;
+
+// per-component hash of the full emulation state
+void hash_emulator_state(gameboy *gb, uint64_t hashes[NUM_STATE_COMPONENTS]);
+
+/* Creates the state hash file and writes its header.
+ * Returns NULL if the file can't be created.
+ */
+gb_state_hasher *init_state_hasher(const char *filename);
+
+void free_state_hasher(gb_state_hasher *hasher);
+
+/* Hash the emulation state and append it to the state hash
+ * file. Returns false if the hashes couldn't be written.
+ */
+bool record_state_hash(gameboy *gb);
+
+#endif /* GB_STATEHASH_H */
@@ -1,3 +1,5 @@
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -5,9 +7,74 @@
 #include "cboy/common.h"
 #include "cboy/gameboy.h"
 #include "cboy/apu.h"
+#include "cboy/link.h"
 #include "cboy/log.h"
 #include "cboy/mbc.h"
 
+/* events a worker can be behind by (a power of 2) */
+#define APU_QUEUE_SIZE 8192
+
+/* clocks the emulation thread runs (about 11 samples' worth) between
+ * telling the worker the time and checking how full the audio buffer is
+ */
+#define APU_EVENT_CLOCKS 1024
+
+/* with a worker, emulation waits for audio this many frames short of
+ * a full buffer, since it only checks every APU_EVENT_CLOCKS
+ */
+#define APU_SYNC_MARGIN 32
+
+/* Where the APU's output goes, and how it's mixed. Running inline,
+ * that's read from the Game Boy as it runs; a worker gets it with
+ * each event instead.
+ */
+typedef struct apu_output {
+    gb_apu *ring;          // whose buffer the audio device plays from
+    uint8_t volume_slider;
+    bool replaying;        // running forward again after a rollback (see socklink.h)
+    bool *sync_signal;     // set once the buffer fills, if not NULL
+} apu_output;
+
+/* A register write for the worker, or just the time. Everything up
+ * to the given clock is mixed with the output settings it carries.
+ */
+typedef struct apu_event {
+    uint64_t time;     // clocks run since the worker started
+    uint16_t address;  // register written, or 0 if none
+    uint8_t value;
+
+    uint8_t volume_slider;
+    uint8_t decimation;
+    bool replaying;
+} apu_event;
+
+struct gb_apu_worker {
+    // the worker's own copy of the APU, that it synthesizes with
+    gb_apu synth;
+
+    // the emulation thread's, whose buffer the output goes to
+    gb_apu *apu;
+
+    // events from head to just before tail are waiting for the worker
+    apu_event queue[APU_QUEUE_SIZE];
+    _Atomic uint32_t head, tail;
+
+    // the worker's run up to this clock
+    _Atomic uint64_t synth_time;
+
+    // only used on the emulation thread: the clocks run, when
+    // the audio buffer was last checked, and the last event
+    // queued (with the current settings)
+    uint64_t time, checked_time;
+    apu_event last;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed; // an event was queued or handled
+    _Atomic int num_waiting;
+    _Atomic bool quit;
+};
+
 static const uint8_t duty_cycles[4*8] = {
     0, 0, 0, 0, 0, 0, 0, 1, // 12.5%
     1, 0, 0, 0, 0, 0, 0, 1, // 25%
@@ -18,7 +85,7 @@ static const uint8_t duty_cycles[4*8] = {
 static void init_pulse_channel(apu_pulse_channel *chan, APU_CHANNELS channelno);
 static void init_wave_channel(apu_wave_channel *chan);
 static void init_noise_channel(apu_noise_channel *chan);
-static void sample_audio(gameboy *gb);
+static void sample_audio(gb_apu *apu, const apu_output *out);
 static void tick_frame_sequencer(gb_apu *apu);
 static void trigger_channel(gb_apu *apu, APU_CHANNELS channel);
 
@@ -45,6 +112,11 @@ gb_apu *init_apu(void)
     for (uint8_t i = 0; i < 4; ++i)
         apu->curr_channel_samples[i] = 0;
 
+    apu->decimation = 1;
+    apu->decimated_left = 0;
+    apu->decimated_right = 0;
+    apu->num_decimated = 0;
+
     // sample buffer initialized full of silence
     for (uint16_t i = 0; i < AUDIO_BUFFER_SAMPLE_SIZE; ++i)
         apu->sample_buffer[i] = 0;
@@ -58,6 +130,8 @@ gb_apu *init_apu(void)
     init_wave_channel(&apu->channel_three);
     init_noise_channel(&apu->channel_four);
 
+    apu->worker = NULL;
+
     if (SDL_Init(SDL_INIT_AUDIO) < 0)
         goto init_error;
 
@@ -90,21 +164,25 @@ init_error:
     exit(1);
 }
 
+static void stop_apu_worker(gb_apu_worker *worker);
+
 void deinit_apu(gb_apu *apu)
 {
     if (apu == NULL)
         return;
 
+    // the worker writes to the audio buffer, so it's stopped first
+    if (apu->worker)
+        stop_apu_worker(apu->worker);
+
     if (apu->audio_dev)
         SDL_CloseAudioDevice(apu->audio_dev);
 
     free(apu);
 }
 
-void apu_write(gameboy *gb, uint16_t address, uint8_t value)
+static void write_register(gb_apu *apu, uint16_t address, uint8_t value)
 {
-    gb_apu *apu = gb->apu;
-
     // write to channel 3 wave RAM
     if (address >= 0xff30 && address <= 0xff3f)
     {
@@ -279,6 +357,21 @@ void apu_write(gameboy *gb, uint16_t address, uint8_t value)
     }
 }
 
+static void update_output_settings(gameboy *gb);
+static void queue_event(gb_apu_worker *worker, uint16_t address, uint8_t value);
+
+void apu_write(gameboy *gb, uint16_t address, uint8_t value)
+{
+    write_register(gb->apu, address, value);
+
+    // the worker makes the same write at the same clock
+    if (gb->apu->worker)
+    {
+        update_output_settings(gb);
+        queue_event(gb->apu->worker, address, value);
+    }
+}
+
 uint8_t apu_read(gameboy *gb, uint16_t address)
 {
     gb_apu *apu = gb->apu;
@@ -414,30 +507,65 @@ uint8_t apu_read(gameboy *gb, uint16_t address)
     return value;
 }
 
-void run_apu(gameboy *gb, uint8_t num_clocks)
+static void run_clocks(gb_apu *apu, const apu_output *out, uint32_t num_clocks)
 {
     for (; num_clocks; --num_clocks)
     {
         // we only update channel states when the APU is on
-        if (gb->apu->enabled)
+        if (apu->enabled)
         {
-            ++gb->apu->clock;
-            tick_channels(gb->apu);
+            ++apu->clock;
+            tick_channels(apu);
 
             // frame sequencer is ticked every 8192 T-cycles (512 Hz)
-            if (!(gb->apu->clock & 0x1fff))
+            if (!(apu->clock & 0x1fff))
             {
-                gb->apu->clock = 0;
-                tick_frame_sequencer(gb->apu);
+                apu->clock = 0;
+                tick_frame_sequencer(apu);
             }
         }
 
         // gather samples even when the APU is off because
         // we need this to throttle emulation correctly
-        sample_audio(gb);
+        sample_audio(apu, out);
     }
 }
 
+static void run_registers(gameboy *gb, uint8_t num_clocks);
+
+void run_apu(gameboy *gb, uint8_t num_clocks)
+{
+    if (gb->apu->worker)
+    {
+        run_registers(gb, num_clocks);
+        return;
+    }
+
+    apu_output out = {
+        .ring = gb->apu,
+        .volume_slider = gb->volume_slider,
+        .replaying = gb->link && gb->link->replaying,
+        .sync_signal = &gb->audio_sync_signal,
+    };
+    run_clocks(gb->apu, &out, num_clocks);
+}
+
+uint32_t buffered_audio_frames(gb_apu *apu)
+{
+    SDL_LockAudioDevice(apu->audio_dev);
+    uint32_t num_frames = apu->num_frames;
+    SDL_UnlockAudioDevice(apu->audio_dev);
+
+    gb_apu_worker *worker = apu->worker;
+    if (worker)
+    {
+        uint64_t behind = worker->time - atomic_load(&worker->synth_time);
+        num_frames += behind / (T_CYCLES_PER_SAMPLE * apu->decimation);
+    }
+
+    return num_frames;
+}
+
 static void init_pulse_channel(apu_pulse_channel *chan, APU_CHANNELS channelno)
 {
     switch (channelno)
@@ -1032,9 +1160,8 @@ static void tick_frame_sequencer(gb_apu *apu)
 }
 
 // Push an LR stereo sample frame to the internal audio buffer
-static void push_audio_frame(gameboy *gb)
+static void push_audio_frame(gb_apu *apu, const apu_output *out)
 {
-    gb_apu *apu = gb->apu;
     float left_amplitude = 0, right_amplitude = 0;
 
     if (apu->enabled)
@@ -1078,26 +1205,47 @@ static void push_audio_frame(gameboy *gb)
 
     // APU samples are scaled by the Game Boy's volume
     // slider and by our base volume scaledown factor
-    left_sample  *= BASE_VOLUME_SCALEDOWN_FACTOR * gb->volume_slider / 100.;
-    right_sample *= BASE_VOLUME_SCALEDOWN_FACTOR * gb->volume_slider / 100.;
+    left_sample  *= BASE_VOLUME_SCALEDOWN_FACTOR * out->volume_slider / 100.;
+    right_sample *= BASE_VOLUME_SCALEDOWN_FACTOR * out->volume_slider / 100.;
 
-    SDL_LockAudioDevice(apu->audio_dev);
+    // running forward again after a rollback (see socklink.h), so it's been played already
+    if (out->replaying)
+        return;
+
+    // fast-forwarding, so average samples to keep up with the audio device
+    if (apu->decimation > 1)
+    {
+        apu->decimated_left += left_sample;
+        apu->decimated_right += right_sample;
+        if (++apu->num_decimated < apu->decimation)
+            return;
+
+        left_sample = apu->decimated_left / apu->num_decimated;
+        right_sample = apu->decimated_right / apu->num_decimated;
+        apu->decimated_left = 0;
+        apu->decimated_right = 0;
+        apu->num_decimated = 0;
+    }
+
+    gb_apu *ring = out->ring;
+    SDL_LockAudioDevice(ring->audio_dev);
 
     // drop samples when the audio buffer is full
-    // (only needed when the FPS limiter is off)
-    if (apu->num_frames < AUDIO_BUFFER_FRAME_SIZE)
+    // (only needed when running uncapped)
+    if (ring->num_frames < AUDIO_BUFFER_FRAME_SIZE)
     {
-        apu->sample_buffer[NUM_CHANNELS*apu->frame_end] = left_sample;
-        apu->sample_buffer[NUM_CHANNELS*apu->frame_end + 1] = right_sample;
-        ++apu->frame_end;
-        apu->frame_end %= AUDIO_BUFFER_FRAME_SIZE;
-        ++apu->num_frames;
+        ring->sample_buffer[NUM_CHANNELS*ring->frame_end] = left_sample;
+        ring->sample_buffer[NUM_CHANNELS*ring->frame_end + 1] = right_sample;
+        ++ring->frame_end;
+        ring->frame_end %= AUDIO_BUFFER_FRAME_SIZE;
+        ++ring->num_frames;
     }
 
     // audio buffer is full, signal to throttle emulation
-    gb->audio_sync_signal = apu->num_frames == AUDIO_BUFFER_FRAME_SIZE;
+    if (out->sync_signal)
+        *out->sync_signal = ring->num_frames == AUDIO_BUFFER_FRAME_SIZE;
 
-    SDL_UnlockAudioDevice(apu->audio_dev);
+    SDL_UnlockAudioDevice(ring->audio_dev);
 }
 
 // Single-pole infinite impulse response low-pass filter.
@@ -1109,14 +1257,13 @@ static inline float low_pass_filter(float in, float prev_out)
 
 // sample at APU native rate so we can apply a low-pass filter
 // before downsampling to the audio device native rate
-static void sample_audio(gameboy *gb)
+static void sample_audio(gb_apu *apu, const apu_output *out)
 {
-    gb_apu *apu = gb->apu;
     --apu->sample_timer;
 
     // we write silence to the audio buffer when the APU is off
     float amplitudes[4] = {0};
-    if (gb->apu->enabled)
+    if (apu->enabled)
     {
         for (uint8_t i = 0; i < 4; ++i)
             amplitudes[i] = get_channel_amplitude(apu, i);
@@ -1133,6 +1280,269 @@ static void sample_audio(gameboy *gb)
     if (!apu->sample_timer)
     {
         apu->sample_timer = T_CYCLES_PER_SAMPLE;
-        push_audio_frame(gb);
+        push_audio_frame(apu, out);
     }
 }
+
+/* Copy the state that's saved (see savestate.h) from one APU to
+ * another. The registers are the same on both ends of a worker, but
+ * the rest is only kept up to date on the worker's.
+ */
+static void copy_apu_state(gb_apu *dest, const gb_apu *src)
+{
+    dest->enabled = src->enabled;
+    dest->panning_info = src->panning_info;
+    dest->sample_timer = src->sample_timer;
+    dest->left_volume = src->left_volume;
+    dest->right_volume = src->right_volume;
+    dest->mix_vin_left = src->mix_vin_left;
+    dest->mix_vin_right = src->mix_vin_right;
+    memcpy(dest->curr_channel_samples, src->curr_channel_samples, sizeof dest->curr_channel_samples);
+    dest->frame_seq_pos = src->frame_seq_pos;
+    dest->clock = src->clock;
+    dest->channel_one = src->channel_one;
+    dest->channel_two = src->channel_two;
+    dest->channel_three = src->channel_three;
+    dest->channel_four = src->channel_four;
+}
+
+static bool queue_has_room(gb_apu_worker *worker)
+{
+    return atomic_load(&worker->tail) - atomic_load(&worker->head) < APU_QUEUE_SIZE;
+}
+
+static bool queue_is_empty(gb_apu_worker *worker)
+{
+    return atomic_load(&worker->head) == atomic_load(&worker->tail);
+}
+
+static bool worker_has_work(gb_apu_worker *worker)
+{
+    return !queue_is_empty(worker) || atomic_load(&worker->quit);
+}
+
+/* Wait for the given condition, which the other thread makes true.
+ * The queue itself is lock-free; the lock is only taken to sleep
+ * while waiting, and to wake a thread that's sleeping.
+ */
+static void wait_for(gb_apu_worker *worker, bool (*condition)(gb_apu_worker *))
+{
+    if (condition(worker))
+        return;
+
+    pthread_mutex_lock(&worker->lock);
+    atomic_fetch_add(&worker->num_waiting, 1);
+    while (!condition(worker))
+        pthread_cond_wait(&worker->changed, &worker->lock);
+    atomic_fetch_sub(&worker->num_waiting, 1);
+    pthread_mutex_unlock(&worker->lock);
+}
+
+// Wake the other thread, if it's waiting on what just changed
+static void notify(gb_apu_worker *worker)
+{
+    if (!atomic_load(&worker->num_waiting))
+        return;
+
+    pthread_mutex_lock(&worker->lock);
+    pthread_cond_broadcast(&worker->changed);
+    pthread_mutex_unlock(&worker->lock);
+}
+
+// Queue the given write (or just the time, with an address of 0) for the worker
+static void queue_event(gb_apu_worker *worker, uint16_t address, uint8_t value)
+{
+    wait_for(worker, queue_has_room);
+
+    apu_event event = worker->last;
+    event.time = worker->time;
+    event.address = address;
+    event.value = value;
+
+    uint32_t tail = atomic_load_explicit(&worker->tail, memory_order_relaxed);
+    worker->queue[tail & (APU_QUEUE_SIZE - 1)] = event;
+    atomic_store(&worker->tail, tail + 1);
+    notify(worker);
+
+    worker->last = event;
+}
+
+/* The output settings apply to all the clocks up to each event, so
+ * when they change, the worker's told the time before they do.
+ */
+static void update_output_settings(gameboy *gb)
+{
+    gb_apu_worker *worker = gb->apu->worker;
+    uint8_t volume_slider = gb->volume_slider,
+            decimation = gb->apu->decimation;
+    bool replaying = gb->link && gb->link->replaying;
+
+    if (volume_slider == worker->last.volume_slider
+        && decimation == worker->last.decimation
+        && replaying == worker->last.replaying)
+    {
+        return;
+    }
+
+    if (worker->time != worker->last.time)
+        queue_event(worker, 0, 0);
+
+    worker->last.volume_slider = volume_slider;
+    worker->last.decimation = decimation;
+    worker->last.replaying = replaying;
+}
+
+/* Run the APU for the given number of clocks, with a worker to
+ * synthesize the audio. That leaves only the frame sequencer, which
+ * turns channels off as their length counters and sweep run out.
+ */
+static void run_registers(gameboy *gb, uint8_t num_clocks)
+{
+    gb_apu *apu = gb->apu;
+    gb_apu_worker *worker = apu->worker;
+    update_output_settings(gb);
+
+    // frame sequencer is ticked every 8192 T-cycles (512 Hz)
+    if (apu->enabled)
+    {
+        apu->clock += num_clocks;
+        if (apu->clock >= 0x2000)
+        {
+            apu->clock -= 0x2000;
+            tick_frame_sequencer(apu);
+        }
+    }
+
+    worker->time += num_clocks;
+    if (worker->time - worker->checked_time < APU_EVENT_CLOCKS)
+        return;
+
+    worker->checked_time = worker->time;
+    if (worker->time != worker->last.time)
+        queue_event(worker, 0, 0);
+
+    // the worker's output, and what it's yet to synthesize, fill the audio buffer
+    if (buffered_audio_frames(apu) >= AUDIO_BUFFER_FRAME_SIZE - APU_SYNC_MARGIN)
+        gb->audio_sync_signal = true;
+}
+
+static void *apu_worker_thread(void *arg)
+{
+    gb_apu_worker *worker = arg;
+    gb_apu *synth = &worker->synth;
+
+    for (;;)
+    {
+        wait_for(worker, worker_has_work);
+
+        // once it's quitting, the worker still finishes what's queued
+        uint32_t head = atomic_load(&worker->head);
+        if (head == atomic_load(&worker->tail))
+            break;
+
+        apu_event event = worker->queue[head & (APU_QUEUE_SIZE - 1)];
+
+        // started or stopped fast-forwarding (see speed.h)
+        if (event.decimation != synth->decimation)
+        {
+            synth->decimation = event.decimation;
+            synth->decimated_left = 0;
+            synth->decimated_right = 0;
+            synth->num_decimated = 0;
+        }
+
+        apu_output out = {
+            .ring = worker->apu,
+            .volume_slider = event.volume_slider,
+            .replaying = event.replaying,
+            .sync_signal = NULL,
+        };
+        uint64_t time = atomic_load_explicit(&worker->synth_time, memory_order_relaxed);
+        run_clocks(synth, &out, event.time - time);
+
+        if (event.address)
+            write_register(synth, event.address, event.value);
+
+        atomic_store(&worker->synth_time, event.time);
+        atomic_store(&worker->head, head + 1);
+        notify(worker);
+    }
+
+    return NULL;
+}
+
+bool start_apu_worker(gameboy *gb)
+{
+    gb_apu_worker *worker = malloc(sizeof(gb_apu_worker));
+    if (worker == NULL)
+        return false;
+
+    worker->synth = *gb->apu;
+    worker->apu = gb->apu;
+    atomic_init(&worker->head, 0);
+    atomic_init(&worker->tail, 0);
+    atomic_init(&worker->synth_time, 0);
+    worker->time = 0;
+    worker->checked_time = 0;
+    worker->last = (apu_event){
+        .time = 0,
+        .volume_slider = gb->volume_slider,
+        .decimation = gb->apu->decimation,
+        .replaying = gb->link && gb->link->replaying,
+    };
+    atomic_init(&worker->num_waiting, 0);
+    atomic_init(&worker->quit, false);
+
+    pthread_mutex_init(&worker->lock, NULL);
+    pthread_cond_init(&worker->changed, NULL);
+
+    if (pthread_create(&worker->thread, NULL, apu_worker_thread, worker))
+    {
+        LOG_ERROR("Failed to start the audio worker thread\n");
+        pthread_cond_destroy(&worker->changed);
+        pthread_mutex_destroy(&worker->lock);
+        free(worker);
+        return false;
+    }
+
+    gb->apu->worker = worker;
+    return true;
+}
+
+static void stop_apu_worker(gb_apu_worker *worker)
+{
+    atomic_store(&worker->quit, true);
+    notify(worker);
+
+    pthread_join(worker->thread, NULL);
+    pthread_cond_destroy(&worker->changed);
+    pthread_mutex_destroy(&worker->lock);
+    free(worker);
+}
+
+// Wait for the worker to run up to the emulation thread's clock
+static void drain_apu_worker(gb_apu_worker *worker)
+{
+    if (worker->time != worker->last.time)
+        queue_event(worker, 0, 0);
+
+    wait_for(worker, queue_is_empty);
+}
+
+void sync_apu(gb_apu *apu)
+{
+    if (apu->worker == NULL)
+        return;
+
+    drain_apu_worker(apu->worker);
+    copy_apu_state(apu, &apu->worker->synth);
+}
+
+void restart_apu(gb_apu *apu)
+{
+    if (apu->worker == NULL)
+        return;
+
+    drain_apu_worker(apu->worker);
+    copy_apu_state(&apu->worker->synth, apu);
+}
@@ -0,0 +1,240 @@
+#define _POSIX_C_SOURCE 200809L // getpid
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/bootcache.h"
+#include "cboy/savestate.h"
+#include "cboy/cartridge.h"
+#include "cboy/mbc.h"
+#include "cboy/memory.h"
+#include "cboy/framehash.h"
+#include "cboy/log.h"
+
+// set by the makefile from the sources built (see bootcache.h)
+#ifndef BUILD_ID
+#define BUILD_ID 0
+#endif
+
+/* Snapshot file layout
+ * --------------------
+ * 8 bytes:  magic ("CBOYBS02")
+ * the key:
+ *   8 bytes:  the ID of the build that saved it
+ *   8 bytes:  hash of the boot ROM
+ *   80 bytes: the cartridge header (0x100-0x14f of ROM bank 0)
+ *   1 byte:   whether monochrome mode was forced
+ *   the sizes of the structs stored below, as size_t
+ * then the state: SNAPSHOT_FIELDS, in order
+ */
+static const char boot_snapshot_magic[8] = {'C', 'B', 'O', 'Y', 'B', 'S', '0', '2'};
+
+#define HEADER_START 0x100
+#define HEADER_SIZE  0x50
+
+typedef struct snapshot_key {
+    uint64_t build_id;
+    uint64_t boot_rom_hash;
+    uint8_t header[HEADER_SIZE];
+    uint8_t force_dmg;
+    size_t struct_sizes[4];
+} snapshot_key;
+
+struct gb_boot_snapshot {
+    char *path;
+    snapshot_key key;
+};
+
+static void make_key(gameboy *gb, bool force_dmg, snapshot_key *key)
+{
+    size_t boot_rom_size = gb->run_mode == GB_CGB_MODE ? CGB_BOOT_ROM_SIZE : DMG_BOOT_ROM_SIZE;
+
+    memset(key, 0, sizeof *key);
+    key->build_id = BUILD_ID;
+    key->boot_rom_hash = hash_bytes(gb->boot_rom, boot_rom_size, 0);
+    memcpy(key->header, gb->cart->rom_banks[0] + HEADER_START, HEADER_SIZE);
+    key->force_dmg = force_dmg;
+    key->struct_sizes[0] = sizeof(gb_cpu);
+    key->struct_sizes[1] = sizeof(gb_ppu);
+    key->struct_sizes[2] = sizeof(gb_apu);
+    key->struct_sizes[3] = sizeof(gb_memory);
+}
+
+static bool write_key(FILE *file, const snapshot_key *key)
+{
+    return fwrite(&key->build_id, sizeof key->build_id, 1, file) == 1
+           && fwrite(&key->boot_rom_hash, sizeof key->boot_rom_hash, 1, file) == 1
+           && fwrite(key->header, 1, HEADER_SIZE, file) == HEADER_SIZE
+           && fwrite(&key->force_dmg, 1, 1, file) == 1
+           && fwrite(key->struct_sizes, sizeof key->struct_sizes, 1, file) == 1;
+}
+
+static bool key_matches(FILE *file, const snapshot_key *key)
+{
+    snapshot_key file_key;
+    memset(&file_key, 0, sizeof file_key);
+
+    return fread(&file_key.build_id, sizeof file_key.build_id, 1, file) == 1
+           && fread(&file_key.boot_rom_hash, sizeof file_key.boot_rom_hash, 1, file) == 1
+           && fread(file_key.header, 1, HEADER_SIZE, file) == HEADER_SIZE
+           && fread(&file_key.force_dmg, 1, 1, file) == 1
+           && fread(file_key.struct_sizes, sizeof file_key.struct_sizes, 1, file) == 1
+           && !memcmp(&file_key, key, sizeof file_key);
+}
+
+#define WRITE_FIELD(file, field) (fwrite(&(field), sizeof (field), 1, (file)) == 1)
+
+/* Everything the boot ROM can change, other than what's reset when
+ * the game starts: the machine's state, except for the cartridge
+ */
+#define SNAPSHOT_FIELDS(gb, FIELD) MACHINE_STATE_FIELDS(gb, FIELD)
+
+#define WRITE_SNAPSHOT_FIELD(field) WRITE_FIELD(file, field)
+#define COUNT_SNAPSHOT_FIELD(field) ((size += sizeof (field)), true)
+#define LOAD_SNAPSHOT_FIELD(field) \
+    ((memcpy(&(field), state, sizeof (field)), state += sizeof (field)), true)
+
+/* Read the state in a snapshot file, after its key. The state is only
+ * loaded once it's all been read, so a truncated snapshot is just a
+ * miss rather than leaving the machine half-restored.
+ */
+static bool read_state(FILE *file, gameboy *gb)
+{
+    size_t size = 0;
+    (void)SNAPSHOT_FIELDS(gb, COUNT_SNAPSHOT_FIELD);
+
+    uint8_t *buffer = malloc(size);
+    if (buffer == NULL)
+        return false;
+
+    bool ok = fread(buffer, 1, size, file) == size && fgetc(file) == EOF;
+    if (ok)
+    {
+        const uint8_t *state = buffer;
+        (void)SNAPSHOT_FIELDS(gb, LOAD_SNAPSHOT_FIELD);
+    }
+
+    free(buffer);
+    return ok;
+}
+
+static char *snapshot_path(const char *cache_dir, const snapshot_key *key)
+{
+    uint64_t key_hash = hash_bytes(key->header, HEADER_SIZE, key->boot_rom_hash ^ key->force_dmg);
+
+    char *path = malloc(strlen(cache_dir) + sizeof "/boot-0123456789abcdef.cboysnap");
+    if (path != NULL)
+        sprintf(path, "%s/boot-%016" PRIx64 ".cboysnap", cache_dir, key_hash);
+
+    return path;
+}
+
+bool restore_boot_snapshot(gameboy *gb, const char *cache_dir, bool force_dmg)
+{
+    gb_boot_snapshot *snapshot = calloc(1, sizeof(gb_boot_snapshot));
+    if (snapshot == NULL)
+        return false;
+
+    make_key(gb, force_dmg, &snapshot->key);
+    snapshot->path = snapshot_path(cache_dir, &snapshot->key);
+    if (snapshot->path == NULL)
+    {
+        free_boot_snapshot(snapshot);
+        return false;
+    }
+
+    FILE *file = fopen(snapshot->path, "rb");
+    if (file != NULL)
+    {
+        char magic[sizeof boot_snapshot_magic];
+        bool restored = fread(magic, 1, sizeof magic, file) == sizeof magic
+                        && !memcmp(magic, boot_snapshot_magic, sizeof magic)
+                        && key_matches(file, &snapshot->key)
+                        && read_state(file, gb);
+        fclose(file);
+
+        if (restored)
+        {
+            /* The RTC kept time while the boot ROM ran. It's the
+             * only cartridge state the boot ROM affects, and the
+             * key's header tells whether there is one.
+             */
+            if (gb->cart->has_rtc)
+                for (uint64_t clocks = gb->cart->time_source.elapsed_clocks; clocks; )
+                {
+                    uint8_t step = clocks < UINT8_MAX ? clocks : UINT8_MAX;
+                    tick_rtc(gb, step);
+                    clocks -= step;
+                }
+
+            LOG_INFO("Started from the boot snapshot %s\n", snapshot->path);
+            free_boot_snapshot(snapshot);
+            return true;
+        }
+
+        // replaced once the boot ROM finishes
+        LOG_INFO("Ignoring the outdated boot snapshot %s\n", snapshot->path);
+    }
+
+    gb->boot_snapshot = snapshot;
+    return false;
+}
+
+void save_boot_snapshot(gameboy *gb)
+{
+    gb_boot_snapshot *snapshot = gb->boot_snapshot;
+    if (snapshot == NULL)
+        return;
+
+    gb->boot_snapshot = NULL;
+
+    // the frame buffer is saved with the rest
+    if (gb->ppu->frame_log)
+        sync_frame_log(gb->ppu->frame_log);
+    sync_apu(gb->apu);
+
+    // written to a temporary file first, in case another process (or
+    // a Game Boy linked to this one) is reading or writing it
+    char *tmp_path = malloc(strlen(snapshot->path) + 64);
+    if (tmp_path == NULL)
+    {
+        free_boot_snapshot(snapshot);
+        return;
+    }
+    sprintf(tmp_path, "%s.%ld.%p.tmp", snapshot->path, (long)getpid(), (void *)gb);
+
+    FILE *file = fopen(tmp_path, "wb");
+    bool ok = file != NULL
+              && fwrite(boot_snapshot_magic, 1, sizeof boot_snapshot_magic, file)
+                 == sizeof boot_snapshot_magic
+              && write_key(file, &snapshot->key)
+              && SNAPSHOT_FIELDS(gb, WRITE_SNAPSHOT_FIELD);
+
+    if (file != NULL)
+        ok = !fclose(file) && ok;
+    ok = ok && !rename(tmp_path, snapshot->path);
+
+    if (!ok)
+    {
+        LOG_ERROR("\nWarning: Failed to save the boot snapshot %s\n", snapshot->path);
+        remove(tmp_path);
+    }
+
+    free(tmp_path);
+    free_boot_snapshot(snapshot);
+}
+
+void free_boot_snapshot(gb_boot_snapshot *snapshot)
+{
+    if (snapshot == NULL)
+        return;
+
+    free(snapshot->path);
+    free(snapshot);
+}
@@ -8,6 +8,7 @@
 #include "cboy/gameboy.h"
 #include "cboy/cartridge.h"
 #include "cboy/mbc.h"
+#include "cboy/framehash.h"
 #include "cboy/log.h"
 
 // minimum number of bits needed to store the given value
@@ -53,14 +54,14 @@ void unload_cartridge(gb_cartridge *cart)
  * Returns a status code indicating whether
  * the bank was loaded successfully.
  */
-static ROM_LOAD_STATUS load_rom_bank(uint8_t *buffer, FILE *rom_file)
+static ROM_LOAD_STATUS load_rom_bank(uint8_t *buffer, gb_rom_file *rom_file)
 {
-    /* try to load a ROM bank from the ROM file */
-    if (ROM_BANK_SIZE != fread(buffer, sizeof(uint8_t), ROM_BANK_SIZE, rom_file))
+    /* try to load (or inflate) a ROM bank from the ROM file */
+    if (ROM_BANK_SIZE != read_rom_file(rom_file, buffer, ROM_BANK_SIZE))
     {
         // either an I/O error occurred, or the ROM is malformed
         // since there weren't enough bytes to make up the ROM bank
-        if (ferror(rom_file)) /* I/O error */
+        if (rom_file->io_error) /* I/O error */
         {
             return ROM_LOAD_ERROR;
         }
@@ -71,6 +72,19 @@ static ROM_LOAD_STATUS load_rom_bank(uint8_t *buffer, FILE *rom_file)
     return ROM_LOAD_SUCCESS;
 }
 
+/* Helper function for finishing loading the ROM.
+ * A compressed ROM is read to the end and checked
+ * against the archive's CRC-32 and size, so that
+ * a corrupt archive isn't loaded as a bad ROM.
+ */
+static ROM_LOAD_STATUS finish_rom(gb_rom_file *rom_file)
+{
+    if (finish_rom_file(rom_file))
+        return ROM_LOAD_SUCCESS;
+
+    return rom_file->io_error ? ROM_LOAD_ERROR : MALFORMED_ROM;
+}
+
 /* Allocates memory for the cartridge, its ROM banks
  * array, and the ROM banks themselves. Since there
  * are a max of 512 banks, we allocate this max number.
@@ -98,7 +112,7 @@ gb_cartridge *init_cartridge(void)
 }
 
 /* determine the number of banks in the ROM given the zeroth ROM bank */
-static uint16_t get_num_rom_banks(uint8_t *rom0)
+static uint16_t get_num_rom_banks(const uint8_t *rom0)
 {
     uint16_t num_rom_banks;
     switch (rom0[0x148])
@@ -147,7 +161,7 @@ static uint16_t get_num_rom_banks(uint8_t *rom0)
 }
 
 /* determine the MBC type given the zeroth ROM bank */
-static MBC_TYPE get_mbc_type(uint8_t *rom0)
+static MBC_TYPE get_mbc_type(const uint8_t *rom0)
 {
     MBC_TYPE mbc;
     switch (rom0[0x147])
@@ -210,7 +224,7 @@ static MBC_TYPE get_mbc_type(uint8_t *rom0)
 }
 
 /* determine the external RAM size */
-static int get_ext_ram_size(uint8_t *rom0)
+static int get_ext_ram_size(const uint8_t *rom0)
 {
     int ram_size;
     switch (rom0[0x149])
@@ -252,7 +266,7 @@ static uint16_t get_num_ram_banks(int ext_ram_size)
 
 // Use byte 0x147 of the cartridge header to see if
 // the loaded cartridge has a Real Time Clock.
-static bool detect_rtc_support(uint8_t *rom0)
+static bool detect_rtc_support(const uint8_t *rom0)
 {
     bool has_rtc;
     switch (rom0[0x147])
@@ -317,6 +331,48 @@ static ROM_LOAD_STATUS init_banks(gb_cartridge *cart, int n_rombanks, int n_ramb
     return ROM_LOAD_SUCCESS;
 }
 
+bool parse_rom_header(const uint8_t *rom0, gb_rom_header *header)
+{
+    // newer games use the end of the title area for other fields
+    memset(header->title, 0, sizeof header->title);
+    for (int i = 0; i < 16 && rom0[0x134 + i] >= 0x20 && rom0[0x134 + i] < 0x7f; ++i)
+        header->title[i] = rom0[0x134 + i];
+
+    header->cgb_flag = rom0[0x143];
+    header->mbc_type = get_mbc_type(rom0);
+    header->num_rom_banks = get_num_rom_banks(rom0);
+    header->ext_ram_size = get_ext_ram_size(rom0);
+
+    return header->num_rom_banks
+           && header->ext_ram_size != -1
+           && header->mbc_type != UNKNOWN_MBC;
+}
+
+ROM_LOAD_STATUS hash_rom_file(gb_rom_file *rom_file, gb_rom_header *header, uint64_t *hash)
+{
+    uint8_t rom_bank_buffer[ROM_BANK_SIZE];
+
+    ROM_LOAD_STATUS bank_load_status = load_rom_bank(rom_bank_buffer, rom_file);
+    if (bank_load_status != ROM_LOAD_SUCCESS)
+        return bank_load_status;
+
+    if (!parse_rom_header(rom_bank_buffer, header))
+        return MALFORMED_ROM;
+
+    // the same chain of bank hashes as hash_rom()
+    *hash = hash_bytes(rom_bank_buffer, ROM_BANK_SIZE, 0);
+    for (uint16_t i = 1; i < header->num_rom_banks; ++i)
+    {
+        bank_load_status = load_rom_bank(rom_bank_buffer, rom_file);
+        if (bank_load_status != ROM_LOAD_SUCCESS)
+            return bank_load_status;
+
+        *hash = hash_bytes(rom_bank_buffer, ROM_BANK_SIZE, *hash);
+    }
+
+    return finish_rom(rom_file);
+}
+
 /* Loads the ROM file into the cartridge passed in.
  * Assumes the cartridge has already been initialized
  * by init_cartridge.
@@ -324,14 +380,15 @@ static ROM_LOAD_STATUS init_banks(gb_cartridge *cart, int n_rombanks, int n_ramb
  * Returns a status code indicating whether the ROM
  * was loaded successfully.
  */
-ROM_LOAD_STATUS load_rom(gb_cartridge *cart, FILE *rom_file)
+ROM_LOAD_STATUS load_rom(gb_cartridge *cart, gb_rom_file *rom_file)
 {
     uint8_t rom_bank_buffer[ROM_BANK_SIZE] = {0};
 
     /* The first 16 KB (2^14 bytes) are guaranteed
      * to be present in the ROM. The cartridge header
      * is located here and we use its information to
-     * finish cartridge initialization.
+     * finish cartridge initialization, before any more
+     * of a compressed ROM is inflated.
      */
     ROM_LOAD_STATUS bank_load_status = load_rom_bank(rom_bank_buffer, rom_file);
 
@@ -368,6 +425,11 @@ ROM_LOAD_STATUS load_rom(gb_cartridge *cart, FILE *rom_file)
         memcpy(cart->rom_banks[i], rom_bank_buffer, ROM_BANK_SIZE);
     }
 
+    bank_load_status = finish_rom(rom_file);
+    if (bank_load_status != ROM_LOAD_SUCCESS)
+        return bank_load_status;
+
+    map_cartridge_banks(cart);
     return ROM_LOAD_SUCCESS;
 }
 
@@ -381,6 +443,31 @@ void print_rom_title(gb_cartridge *cart)
     LOG_INFO("Title: %s\n", title);
 }
 
+uint64_t hash_rom(gb_cartridge *cart)
+{
+    // chain the hash across banks by seeding with the previous bank's hash
+    uint64_t hash = 0;
+    for (int i = 0; i < cart->num_rom_banks; ++i)
+        hash = hash_bytes(cart->rom_banks[i], ROM_BANK_SIZE, hash);
+
+    return hash;
+}
+
+uint64_t current_time(gb_time_source *time_source)
+{
+    switch (time_source->type)
+    {
+        case TIME_SOURCE_FIXED:
+            return time_source->epoch;
+
+        case TIME_SOURCE_EMULATED:
+            return time_source->epoch + time_source->elapsed_clocks / GB_CPU_FREQUENCY;
+
+        default:
+            return (uint64_t)time(NULL);
+    }
+}
+
 static char *get_ramsav_filename(const char *romfile)
 {
     const char *ext = "cboysav";
@@ -449,10 +536,16 @@ void maybe_import_cartridge_ram(gb_cartridge *cart, const char *romfile)
 
         // timestamp
         for (uint8_t i = 0; i < 8; ++i)
-            snapshot_time |= rtc_data[40 + i] << (8 * i);
+            snapshot_time |= (uint64_t)rtc_data[40 + i] << (8 * i);
+
+        // emulated time picks up where the save left off
+        if (cart->time_source.type == TIME_SOURCE_EMULATED)
+            cart->time_source.epoch = snapshot_time;
 
         // tick the RTC registers to get them up to date
-        uint64_t seconds_elapsed = (uint64_t)time(NULL) - snapshot_time;
+        // (a save from the "future" doesn't rewind the RTC)
+        uint64_t now = current_time(&cart->time_source);
+        uint64_t seconds_elapsed = now > snapshot_time ? now - snapshot_time : 0;
         fast_forward_rtc(mbc, seconds_elapsed);
     }
 
@@ -470,7 +563,10 @@ mem_error:
 
     // we didn't fully read the RTC data, so reset the MBC
     if (cart->has_rtc)
+    {
         init_mbc(cart->mbc_type, cart->mbc);
+        map_cartridge_banks(cart);
+    }
 }
 
 void save_cartridge_ram(gb_cartridge *cart, const char *romfile)
@@ -505,7 +601,7 @@ void save_cartridge_ram(gb_cartridge *cart, const char *romfile)
     if (cart->has_rtc)
     {
         cartridge_mbc3 *mbc = &cart->mbc->mbc3;
-        uint64_t curr_time = time(NULL);
+        uint64_t curr_time = current_time(&cart->time_source);
         uint8_t rtc_data[48] = {0};
 
         // internal RTC registers
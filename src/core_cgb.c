@@ -0,0 +1,4 @@
+/* The emulator core specialized for CGB mode. See core_template.h */
+#define GB_CORE_MODE GB_CGB_MODE
+#define CORE_SYMBOL(name) name##_cgb
+#include "core_template.h"
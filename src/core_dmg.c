@@ -0,0 +1,4 @@
+/* The emulator core specialized for DMG mode. See core_template.h */
+#define GB_CORE_MODE GB_DMG_MODE
+#define CORE_SYMBOL(name) name##_dmg
+#include "core_template.h"
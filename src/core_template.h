@@ -0,0 +1,128 @@
+/* Template for the mode-specialized builds of the emulator core
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * The core is everything run on each step of the game loop: the
+ * loop itself, instruction execution, memory and I/O accesses,
+ * interrupts, and the PPU. Its sources are included below so that
+ * they're compiled as one translation unit with GB_CORE_MODE
+ * defined, making every IS_CGB_MODE() check a constant.
+ *
+ * To instantiate, define GB_CORE_MODE and CORE_SYMBOL(name), which
+ * gives each function and global defined by the core a unique name
+ * per mode (e.g. read_byte -> read_byte_dmg), then include this file.
+ * See core_dmg.c and core_cgb.c.
+ *
+ * The same sources are also compiled on their own, checking the mode
+ * at runtime, for use by code outside of the game loop.
+ */
+#if !defined(GB_CORE_MODE) || !defined(CORE_SYMBOL)
+#error "GB_CORE_MODE and CORE_SYMBOL must be defined to instantiate the core"
+#endif
+
+// system headers go first so that the renames below can't touch them
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+// memory.c
+#define ram_read             CORE_SYMBOL(ram_read)
+#define ram_write            CORE_SYMBOL(ram_write)
+#define read_byte            CORE_SYMBOL(read_byte)
+#define write_byte           CORE_SYMBOL(write_byte)
+#define fetch_byte           CORE_SYMBOL(fetch_byte)
+#define fetch_word           CORE_SYMBOL(fetch_word)
+#define memory_page          CORE_SYMBOL(memory_page)
+#define remap_memory         CORE_SYMBOL(remap_memory)
+#define stack_push           CORE_SYMBOL(stack_push)
+#define stack_pop            CORE_SYMBOL(stack_pop)
+#define init_memory_map      CORE_SYMBOL(init_memory_map)
+#define init_io_registers    CORE_SYMBOL(init_io_registers)
+#define free_memory_map      CORE_SYMBOL(free_memory_map)
+
+// interrupts.c
+#define request_interrupt    CORE_SYMBOL(request_interrupt)
+#define enable_interrupt     CORE_SYMBOL(enable_interrupt)
+#define pending_interrupts   CORE_SYMBOL(pending_interrupts)
+#define service_interrupt    CORE_SYMBOL(service_interrupt)
+
+// ppu/ppu.c
+#define byte_reverse_lookup  CORE_SYMBOL(byte_reverse_lookup)
+#define reverse_byte         CORE_SYMBOL(reverse_byte)
+#define init_ppu             CORE_SYMBOL(init_ppu)
+#define free_ppu             CORE_SYMBOL(free_ppu)
+#define ppu_read             CORE_SYMBOL(ppu_read)
+#define ppu_write            CORE_SYMBOL(ppu_write)
+#define dma_transfer         CORE_SYMBOL(dma_transfer)
+#define vram_dma_transfer    CORE_SYMBOL(vram_dma_transfer)
+#define reset_ppu            CORE_SYMBOL(reset_ppu)
+#define tile_addr_from_index CORE_SYMBOL(tile_addr_from_index)
+#define load_sprites         CORE_SYMBOL(load_sprites)
+#define draw_scanline        CORE_SYMBOL(draw_scanline)
+#define display_frame        CORE_SYMBOL(display_frame)
+#define run_ppu              CORE_SYMBOL(run_ppu)
+
+// run_loop.c
+#define run_gameboy          CORE_SYMBOL(run_gameboy)
+
+// instructions/
+#define operand_strs         CORE_SYMBOL(operand_strs)
+#define execute_instruction  CORE_SYMBOL(execute_instruction)
+#define run_superinstruction CORE_SYMBOL(run_superinstruction)
+#define superinstruction_starts CORE_SYMBOL(superinstruction_starts)
+#define ld                   CORE_SYMBOL(ld)
+#define ldh                  CORE_SYMBOL(ldh)
+#define inc                  CORE_SYMBOL(inc)
+#define dec                  CORE_SYMBOL(dec)
+#define add                  CORE_SYMBOL(add)
+#define adc                  CORE_SYMBOL(adc)
+#define sub                  CORE_SYMBOL(sub)
+#define sbc                  CORE_SYMBOL(sbc)
+#define cp                   CORE_SYMBOL(cp)
+#define and                  CORE_SYMBOL(and)
+#define or                   CORE_SYMBOL(or)
+#define xor                  CORE_SYMBOL(xor)
+#define jp                   CORE_SYMBOL(jp)
+#define jr                   CORE_SYMBOL(jr)
+#define call                 CORE_SYMBOL(call)
+#define rst                  CORE_SYMBOL(rst)
+#define ret                  CORE_SYMBOL(ret)
+#define reti                 CORE_SYMBOL(reti)
+#define rrca                 CORE_SYMBOL(rrca)
+#define rlca                 CORE_SYMBOL(rlca)
+#define rra                  CORE_SYMBOL(rra)
+#define rla                  CORE_SYMBOL(rla)
+#define rlc                  CORE_SYMBOL(rlc)
+#define rrc                  CORE_SYMBOL(rrc)
+#define rl                   CORE_SYMBOL(rl)
+#define rr                   CORE_SYMBOL(rr)
+#define sla                  CORE_SYMBOL(sla)
+#define sra                  CORE_SYMBOL(sra)
+#define srl                  CORE_SYMBOL(srl)
+#define swap                 CORE_SYMBOL(swap)
+#define bit                  CORE_SYMBOL(bit)
+#define res                  CORE_SYMBOL(res)
+#define set                  CORE_SYMBOL(set)
+#define ei                   CORE_SYMBOL(ei)
+#define di                   CORE_SYMBOL(di)
+#define push                 CORE_SYMBOL(push)
+#define pop                  CORE_SYMBOL(pop)
+#define daa                  CORE_SYMBOL(daa)
+#define scf                  CORE_SYMBOL(scf)
+#define ccf                  CORE_SYMBOL(ccf)
+#define cpl                  CORE_SYMBOL(cpl)
+#define stop                 CORE_SYMBOL(stop)
+#define halt                 CORE_SYMBOL(halt)
+
+#include "memory.c"
+#include "interrupts.c"
+#include "ppu/ppu.c"
+#include "run_loop.c"
+#include "instructions/execute.c"
+#include "instructions/load.c"
+#include "instructions/arithmetic.c"
+#include "instructions/bit.c"
+#include "instructions/misc.c"
+#include "instructions/subroutine.c"
+#include "instructions/fused.c"
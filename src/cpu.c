@@ -6,58 +6,82 @@
 #include "cboy/cpu.h"
 #include "cboy/log.h"
 
-/* bc register contains the b register in the
- * high byte and the c register in the low byte
- */
-uint16_t read_bc(gb_registers *reg)
-{
-    return ((uint16_t)reg->b << 8) | ((uint16_t)reg->c);
-}
-
-/* extract b register from the high byte and the
- * c register from the low byte of the bc register
- */
-void write_bc(gb_registers *reg, uint16_t value)
-{
-    reg->b = (uint8_t)((value & 0xFF00) >> 8);
-    reg->c = (uint8_t)(value & 0xFF);
-}
-
-/* Similar implementations for the af, de, and hl registers
- * --------------------------------------------------------
+/* AF is special: F has to be worked out from the lazy flags
+ * first, and only the top 4 bits of F are writable.
  */
 uint16_t read_af(gb_registers *reg)
 {
-    return ((uint16_t)reg->a << 8) | ((uint16_t)reg->f);
+    evaluate_flags(reg);
+    return reg->af;
 }
 
 void write_af(gb_registers *reg, uint16_t value)
 {
     reg->a = (uint8_t)((value & 0xFF00) >> 8);
     // the bottom 4 bits of F are unused
-    reg->f = (uint8_t)(value & 0xF0);
+    set_flags(reg, (value >> 7) & 1, (value >> 6) & 1, (value >> 5) & 1, (value >> 4) & 1);
 }
 
-uint16_t read_de(gb_registers *reg)
-{
-    return ((uint16_t)reg->d << 8) | ((uint16_t)reg->e);
-}
+/* Fields of the lazy flags state (see gb_registers) */
+#define LAZY_RESULT(lazy) ((lazy) & 0x1ff)
+#define LAZY_XY(lazy)     (((lazy) >> 16) & 0xff)
+#define LAZY_OP(lazy)     ((lazy) >> 24)
 
-void write_de(gb_registers *reg, uint16_t value)
+void set_lazy_flags(gb_registers *reg, enum LAZY_FLAGS op,
+                    uint8_t x, uint8_t y, uint16_t result)
 {
-    reg->d = (uint8_t)((value & 0xFF00) >> 8);
-    reg->e = (uint8_t)(value & 0xFF);
-}
+    // carry out is whatever it was before the operation
+    if (op == LAZY_INC || op == LAZY_DEC || op == LAZY_BIT)
+        result = (result & 0xff) | (reg->lazy_flags & 0x100);
 
-uint16_t read_hl(gb_registers *reg)
-{
-    return ((uint16_t)reg->h << 8) | ((uint16_t)reg->l);
+    reg->lazy_flags = (uint32_t)op << 24 | (uint32_t)(x ^ y) << 16 | (result & 0x1ff);
 }
 
-void write_hl(gb_registers *reg, uint16_t value)
+void evaluate_flags(gb_registers *reg)
 {
-    reg->h = (uint8_t)((value & 0xFF00) >> 8);
-    reg->l = (uint8_t)(value & 0xFF);
+    uint32_t lazy = reg->lazy_flags;
+    if (LAZY_OP(lazy) == FLAGS_EVALUATED)
+        return;
+
+    uint16_t result = LAZY_RESULT(lazy);
+    bool subtract, half_carry;
+
+    switch (LAZY_OP(lazy))
+    {
+        // bit 4 of the operands and result differ if bit 3 carried or borrowed
+        case LAZY_ADD:
+            subtract = false;
+            half_carry = (LAZY_XY(lazy) ^ result) & 0x10;
+            break;
+
+        case LAZY_SUB:
+            subtract = true;
+            half_carry = (LAZY_XY(lazy) ^ result) & 0x10;
+            break;
+
+        case LAZY_AND:
+        case LAZY_BIT:
+            subtract = false;
+            half_carry = true;
+            break;
+
+        case LAZY_INC:
+            subtract = false;
+            half_carry = (result & 0xf) == 0;
+            break;
+
+        case LAZY_DEC:
+            subtract = true;
+            half_carry = (result & 0xf) == 0xf;
+            break;
+
+        default: // LAZY_LOGIC
+            subtract = false;
+            half_carry = false;
+            break;
+    }
+
+    set_flags(reg, (result & 0xff) == 0, subtract, half_carry, (result >> 8) & 1);
 }
 
 // set all flags at once
@@ -70,54 +94,72 @@ void set_flags(gb_registers *reg, bool zero, bool subtract,
                         | carry << 4;
 
     // NOTE: flags are stored in upper nibble of flags register
-    // clear the flags then set the new flag values
-    reg->f = (reg->f & ~0xf0) | (new_flags & 0xf0);
+    // and the lower nibble is always zero
+    reg->f = new_flags;
+
+    // keep Z and C readable from the lazy state
+    reg->lazy_flags = (uint32_t)FLAGS_EVALUATED << 24 | (zero ? 0 : 1) | carry << 8;
 }
 
 // set individual flags
 void set_zero_flag(gb_registers *reg, bool value)
 {
+    evaluate_flags(reg);
     uint8_t mask = 1 << 7;
     reg->f = (reg->f & ~mask) | (value << 7);
+    reg->lazy_flags = (reg->lazy_flags & ~0xffu) | !value;
 }
 
 void set_subtract_flag(gb_registers *reg, bool value)
 {
+    evaluate_flags(reg);
     uint8_t mask = 1 << 6;
     reg->f = (reg->f & ~mask) | (value << 6);
 }
 
 void set_half_carry_flag(gb_registers *reg, bool value)
 {
+    evaluate_flags(reg);
     uint8_t mask = 1 << 5;
     reg->f = (reg->f & ~mask) | (value << 5);
 }
 
 void set_carry_flag(gb_registers *reg, bool value)
 {
+    evaluate_flags(reg);
     uint8_t mask = 1 << 4;
     reg->f = (reg->f & ~mask) | (value << 4);
+    reg->lazy_flags = (reg->lazy_flags & ~0x100u) | value << 8;
 }
 
 // read individual flags
 bool read_zero_flag(gb_registers *reg)
 {
-    return (reg->f >> 7) & 1;
+    return (reg->lazy_flags & 0xff) == 0;
 }
 
 bool read_subtract_flag(gb_registers *reg)
 {
+    evaluate_flags(reg);
     return (reg->f >> 6) & 1;
 }
 
 bool read_half_carry_flag(gb_registers *reg)
 {
+    evaluate_flags(reg);
     return (reg->f >> 5) & 1;
 }
 
 bool read_carry_flag(gb_registers *reg)
 {
-    return (reg->f >> 4) & 1;
+    return (reg->lazy_flags >> 8) & 1;
+}
+
+void update_interrupt_state(gb_cpu *cpu)
+{
+    // NOTE: top three bits are unused and always set, so need to mask out
+    cpu->interrupts_pending = cpu->if_register & cpu->ie_register & 0x1f;
+    cpu->interrupt_serviceable = cpu->ime_flag && cpu->interrupts_pending;
 }
 
 void interrupt_register_write(gb_cpu *cpu, uint16_t address, uint8_t value)
@@ -140,6 +182,8 @@ void interrupt_register_write(gb_cpu *cpu, uint16_t address, uint8_t value)
                       address);
             exit(1);
     }
+
+    update_interrupt_state(cpu);
 }
 
 uint8_t interrupt_register_read(gb_cpu *cpu, uint16_t address)
@@ -165,8 +209,7 @@ uint8_t interrupt_register_read(gb_cpu *cpu, uint16_t address)
     return value;
 }
 
-/* Allocate memory for the CPU struct
- * and initialize its components.
+/* Initialize the CPU's components.
  *
  * CPU register initial values
  * ---------------------------
@@ -176,18 +219,9 @@ uint8_t interrupt_register_read(gb_cpu *cpu, uint16_t address)
  *  HL:    0x014d
  *  SP:    0xfffe
  *  PC:    0x0100
- *
- * Returns NULL if the allocation fails.
  */
-gb_cpu *init_cpu(enum GAMEBOY_MODE gb_mode)
+void init_cpu(gb_cpu *cpu, enum GAMEBOY_MODE gb_mode)
 {
-    gb_cpu *cpu = malloc(sizeof(gb_cpu));
-
-    if (cpu == NULL)
-    {
-        return NULL;
-    }
-
     cpu->is_halted = false;
     cpu->halt_bug = false;
 
@@ -200,44 +234,27 @@ gb_cpu *init_cpu(enum GAMEBOY_MODE gb_mode)
     // bit mapping for IF and IE: 111BBBBB
     cpu->if_register = 0xe1;
     cpu->ie_register = 0xe0;
+    update_interrupt_state(cpu);
 
     // only true when a EI instruction is executed
     cpu->ime_delayed_set = false;
 
-    cpu->reg = malloc(sizeof(gb_registers));
-
-    if (cpu->reg == NULL)
-    {
-        free(cpu);
-        return NULL;
-    }
-
     // set the initial register values
     if (gb_mode == GB_DMG_MODE)
     {
-        write_af(cpu->reg, 0x01b0);
-        write_bc(cpu->reg, 0x0013);
-        write_de(cpu->reg, 0x00d8);
-        write_hl(cpu->reg, 0x014d);
+        write_af(&cpu->reg, 0x01b0);
+        cpu->reg.bc = 0x0013;
+        cpu->reg.de = 0x00d8;
+        cpu->reg.hl = 0x014d;
     }
     else
     {
-        write_af(cpu->reg, 0x1180);
-        write_bc(cpu->reg, 0x0000);
-        write_de(cpu->reg, 0xff56);
-        write_hl(cpu->reg, 0x000d);
+        write_af(&cpu->reg, 0x1180);
+        cpu->reg.bc = 0x0000;
+        cpu->reg.de = 0xff56;
+        cpu->reg.hl = 0x000d;
     }
 
-    cpu->reg->sp = 0xfffe;
-    cpu->reg->pc = 0x0100;
-
-    return cpu;
-}
-
-/* Free the allocated memory for the CPU struct */
-void free_cpu(gb_cpu *cpu)
-{
-    if (cpu)
-        free(cpu->reg);
-    free(cpu);
+    cpu->reg.sp = 0xfffe;
+    cpu->reg.pc = 0x0100;
 }
@@ -0,0 +1,277 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "cboy/framehash.h"
+#include "cboy/ppu.h"
+#include "cboy/log.h"
+
+/* Every hash file starts with this 8-byte header, followed
+ * by one little-endian 64-bit hash per frame.
+ */
+static const char hash_file_magic[8] = {'C', 'B', 'O', 'Y', 'F', 'H', '0', '1'};
+
+/* XXH64 constants
+ *
+ * See: https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+ */
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read_le64(const uint8_t *p)
+{
+    return (uint64_t)p[0]       | (uint64_t)p[1] << 8
+           | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24
+           | (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40
+           | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+static inline uint32_t read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8
+           | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t lane)
+{
+    acc += lane * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge_round(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh64_round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed)
+{
+    const uint8_t *p = data;
+    const uint8_t *end = p + len;
+    uint64_t h;
+
+    if (len >= 32)
+    {
+        // four independent accumulators over 32-byte stripes
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2,
+                 v2 = seed + PRIME64_2,
+                 v3 = seed,
+                 v4 = seed - PRIME64_1;
+
+        const uint8_t *limit = end - 32;
+        do
+        {
+            v1 = xxh64_round(v1, read_le64(p));
+            v2 = xxh64_round(v2, read_le64(p + 8));
+            v3 = xxh64_round(v3, read_le64(p + 16));
+            v4 = xxh64_round(v4, read_le64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh64_merge_round(h, v1);
+        h = xxh64_merge_round(h, v2);
+        h = xxh64_merge_round(h, v3);
+        h = xxh64_merge_round(h, v4);
+    }
+    else
+    {
+        h = seed + PRIME64_5;
+    }
+
+    h += (uint64_t)len;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= xxh64_round(0, read_le64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+    }
+
+    if (p + 4 <= end)
+    {
+        h ^= (uint64_t)read_le32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+
+    for (; p < end; ++p)
+    {
+        h ^= *p * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+    }
+
+    // final avalanche
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+gb_frame_hasher *init_frame_hasher(enum FRAME_HASH_MODE mode, const char *filename)
+{
+    gb_frame_hasher *hasher = calloc(1, sizeof(gb_frame_hasher));
+
+    if (hasher == NULL)
+        return NULL;
+
+    hasher->mode = mode;
+    hasher->hash_filename = malloc(strlen(filename) + 1);
+
+    if (hasher->hash_filename == NULL)
+        goto init_error;
+
+    strcpy(hasher->hash_filename, filename);
+
+    if (mode == FRAME_HASH_RECORD)
+    {
+        hasher->hash_file = fopen(filename, "wb");
+        if (hasher->hash_file == NULL)
+        {
+            LOG_ERROR("Error: Unable to create frame hash file: %s\n", strerror(errno));
+            goto init_error;
+        }
+
+        if (fwrite(hash_file_magic, 1, sizeof hash_file_magic, hasher->hash_file) != sizeof hash_file_magic)
+        {
+            LOG_ERROR("Error: Failed to write frame hash file header\n");
+            goto init_error;
+        }
+    }
+    else
+    {
+        hasher->hash_file = fopen(filename, "rb");
+        if (hasher->hash_file == NULL)
+        {
+            LOG_ERROR("Error: Unable to open golden frame hash file: %s\n", strerror(errno));
+            goto init_error;
+        }
+
+        char magic[sizeof hash_file_magic];
+        if (fread(magic, 1, sizeof magic, hasher->hash_file) != sizeof magic
+            || memcmp(magic, hash_file_magic, sizeof magic))
+        {
+            LOG_ERROR("Error: %s is not a frame hash file\n", filename);
+            goto init_error;
+        }
+    }
+
+    return hasher;
+
+init_error:
+    free_frame_hasher(hasher);
+    return NULL;
+}
+
+void free_frame_hasher(gb_frame_hasher *hasher)
+{
+    if (hasher == NULL)
+        return;
+
+    if (hasher->hash_file)
+        fclose(hasher->hash_file);
+
+    free(hasher->hash_filename);
+    free(hasher);
+}
+
+/* Save the frame buffer as a binary PPM image.
+ * Frame buffer pixels are in XBGR1555 format.
+ */
+static void save_frame_ppm(const char *filename, const uint16_t *frame_buffer)
+{
+    FILE *ppm = fopen(filename, "wb");
+    if (ppm == NULL)
+    {
+        LOG_ERROR("Error: Unable to save frame image: %s\n", strerror(errno));
+        return;
+    }
+
+    fprintf(ppm, "P6\n%d %d\n255\n", FRAME_WIDTH, FRAME_HEIGHT);
+
+    uint8_t rgb[3 * FRAME_WIDTH * FRAME_HEIGHT];
+    for (int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; ++i)
+    {
+        uint16_t pixel = frame_buffer[i];
+        uint8_t r = pixel & 0x1f,
+                g = (pixel >> 5) & 0x1f,
+                b = (pixel >> 10) & 0x1f;
+
+        // expand 5-bit channels to 8 bits
+        rgb[3*i]     = (r << 3) | (r >> 2);
+        rgb[3*i + 1] = (g << 3) | (g >> 2);
+        rgb[3*i + 2] = (b << 3) | (b >> 2);
+    }
+
+    if (fwrite(rgb, 1, sizeof rgb, ppm) != sizeof rgb)
+        LOG_ERROR("Error: Failed to fully write frame image %s\n", filename);
+    else
+        LOG_INFO("Mismatched frame saved to %s\n", filename);
+
+    fclose(ppm);
+}
+
+bool process_frame_hash(gb_frame_hasher *hasher, const uint16_t *frame_buffer)
+{
+    uint64_t hash = hash_bytes(frame_buffer, FRAME_WIDTH * FRAME_HEIGHT * sizeof frame_buffer[0], 0);
+    uint8_t bytes[8];
+
+    if (hasher->mode == FRAME_HASH_RECORD)
+    {
+        for (int i = 0; i < 8; ++i)
+            bytes[i] = hash >> (8 * i);
+
+        if (fwrite(bytes, 1, sizeof bytes, hasher->hash_file) != sizeof bytes)
+        {
+            LOG_ERROR("\nError: Failed to write frame hash: %s\n", strerror(errno));
+            return false;
+        }
+
+        ++hasher->frame_count;
+        return true;
+    }
+
+    if (fread(bytes, 1, sizeof bytes, hasher->hash_file) != sizeof bytes)
+    {
+        LOG_INFO("\nAll %" PRIu64 " frames match the golden frame hashes\n", hasher->frame_count);
+        return false;
+    }
+
+    uint64_t golden_hash = read_le64(bytes);
+    if (hash != golden_hash)
+    {
+        hasher->mismatch_found = true;
+        LOG_ERROR("\nFrame %" PRIu64 " does not match the golden file\n"
+                  "Expected hash: %016" PRIx64 "\n"
+                  "Actual hash:   %016" PRIx64 "\n",
+                  hasher->frame_count, golden_hash, hash);
+
+        // e.g. golden.fh.frame123.ppm
+        char *ppm_filename = malloc(strlen(hasher->hash_filename) + 32);
+        if (ppm_filename != NULL)
+        {
+            sprintf(ppm_filename, "%s.frame%" PRIu64 ".ppm", hasher->hash_filename, hasher->frame_count);
+            save_frame_ppm(ppm_filename, frame_buffer);
+            free(ppm_filename);
+        }
+
+        return false;
+    }
+
+    ++hasher->frame_count;
+    return true;
+}
@@ -5,8 +5,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <SDL_events.h>
-#include <SDL_audio.h>
 #include <SDL_pixels.h>
 #include "cboy/common.h"
 #include "cboy/gameboy.h"
@@ -18,6 +16,7 @@
 #include "cboy/instructions.h"
 #include "cboy/joypad.h"
 #include "cboy/apu.h"
+#include "cboy/movie.h"
 #include "cboy/log.h"
 
 /* Bit masks to select a bit out of the internal clock
@@ -27,6 +26,9 @@
  */
 static const uint16_t timer_circuit_bitmasks[4] = {1 << 9, 1 << 3, 1 << 5, 1 << 7};
 
+// Game Boys initialized and not yet freed, so SDL is only shut down after the last
+static int num_gameboys;
+
 void report_volume_level(gameboy *gb, bool add_newline)
 {
     const char *fmt = "%s\rCurrent volume:%*s%d/100";
@@ -43,39 +45,6 @@ void report_volume_level(gameboy *gb, bool add_newline)
     fflush(stdout);
 }
 
-// Stack pop and push operations
-void stack_push(gameboy *gb, uint16_t value)
-{
-    /* NOTE: The stack grows downward (decreasing address).
-     *
-     * The push operation can be thought of as performing
-     * the following imaginary instructions:
-     *
-     *  DEC SP
-     *  LD [SP], HIGH_BYTE(value) ; little-endian, so hi byte first
-     *  DEC SP
-     *  LD [SP], LOW_BYTE(value)
-     */
-    write_byte(gb, --(gb->cpu->reg->sp), (uint8_t)(value >> 8));
-    write_byte(gb, --(gb->cpu->reg->sp), (uint8_t)(value & 0xff));
-}
-
-uint16_t stack_pop(gameboy *gb)
-{
-    /* The pop operation can be thought of as performing
-     * the inverse of the push's imaginary operations:
-     *
-     *  LD LOW_BYTE(value), [SP] ; little-endian
-     *  INC SP
-     *  LD HIGH_BYTE(value), [SP]
-     *  INC SP
-     */
-    uint8_t lo = read_byte(gb, (gb->cpu->reg->sp)++);
-    uint8_t hi = read_byte(gb, (gb->cpu->reg->sp)++);
-
-    return (uint16_t)(hi << 8) | (uint16_t)lo;
-}
-
 /* Verifies the Nintendo logo bitmap located in the
  * ROM file. If this bitmap is incorrect, an error
  * is printed out indicating this game wouldn't
@@ -171,7 +140,8 @@ static bool init_screen(gameboy *gb, int window_scale)
         return false;
     }
 
-    gb->renderer = SDL_CreateRenderer(gb->window, -1, 0);
+    uint32_t renderer_flags = gb->sync_mode == SYNC_VSYNC ? SDL_RENDERER_PRESENTVSYNC : 0;
+    gb->renderer = SDL_CreateRenderer(gb->window, -1, renderer_flags);
 
     if (gb->renderer == NULL)
     {
@@ -251,7 +221,7 @@ static void maybe_load_bootrom(gameboy *gb, const char *bootrom)
 
     fclose(bootrom_file);
     gb->run_boot_rom = true;
-    gb->cpu->reg->pc = 0x0000; // beginning of boot ROM
+    gb->cpu.reg.pc = 0x0000; // beginning of boot ROM
     return;
 
 failed_load:
@@ -300,10 +270,11 @@ gameboy *init_gameboy(struct gb_init_args *args)
         return NULL;
     }
 
+    ++num_gameboys;
+
     gb->is_on = true;
     gb->audio_sync_signal = true;
     gb->volume_slider = 100;
-    gb->throttle_fps = true;
     gb->run_mode = GB_DMG_MODE; // updated once game ROM is read in
     gb->tac = 0xf8;
 
@@ -319,7 +290,7 @@ gameboy *init_gameboy(struct gb_init_args *args)
     if (!all_alloc)
         goto init_error;
 
-    FILE *rom_file = fopen(args->romfile, "rb");
+    gb_rom_file *rom_file = open_rom_file(args->romfile);
 
     if (rom_file == NULL)
     {
@@ -328,7 +299,7 @@ gameboy *init_gameboy(struct gb_init_args *args)
     }
 
     ROM_LOAD_STATUS load_status = load_rom(gb->cart, rom_file);
-    fclose(rom_file);
+    close_rom_file(rom_file);
 
     if (load_status != ROM_LOAD_SUCCESS)
     {
@@ -342,14 +313,61 @@ gameboy *init_gameboy(struct gb_init_args *args)
 
     determine_and_report_run_mode(gb, args->force_dmg);
 
-    gb->cpu = init_cpu(gb->run_mode);
+    // use the game loop and I/O handlers specialized for the mode
+    if (gb->run_mode == GB_CGB_MODE)
+    {
+        gb->run = run_gameboy_cgb;
+        init_io_registers_cgb(gb);
+    }
+    else
+    {
+        gb->run = run_gameboy_dmg;
+        init_io_registers_dmg(gb);
+    }
+
+    init_cpu(&gb->cpu, gb->run_mode);
     gb->ppu = init_ppu(gb->run_mode);
 
-    if (!gb->cpu || !gb->ppu)
+    if (!gb->ppu)
         goto init_error;
 
+    gb->cart->time_source.type = args->time_source;
+    gb->cart->time_source.epoch = args->time_epoch;
     maybe_import_cartridge_ram(gb->cart, args->romfile);
 
+    if (args->frame_hash_mode != FRAME_HASH_OFF)
+    {
+        gb->frame_hasher = init_frame_hasher(args->frame_hash_mode, args->frame_hash_file);
+        if (!gb->frame_hasher)
+            goto init_error;
+    }
+
+    if (args->state_hash_file != NULL)
+    {
+        gb->state_hasher = init_state_hasher(args->state_hash_file);
+        if (!gb->state_hasher)
+            goto init_error;
+    }
+
+    gb->sync_mode = args->sync_mode;
+    if (gb->sync_mode == SYNC_CLOCK)
+    {
+        gb->pacer = init_frame_pacer();
+        if (!gb->pacer)
+            goto init_error;
+    }
+
+    gb->speed.fast_forward_speed = args->fast_forward_speed;
+    gb->speed.frame_skip_allowed = !gb->frame_hasher && !gb->state_hasher;
+    set_emulation_speed(gb, 1);
+
+    if (args->movie_mode != MOVIE_OFF)
+    {
+        gb->movie = init_movie(gb, args->movie_mode, args->movie_file);
+        if (!gb->movie)
+            goto init_error;
+    }
+
     // finish initializing I/O registers
     if (gb->run_mode == GB_CGB_MODE)
     {
@@ -360,8 +378,8 @@ gameboy *init_gameboy(struct gb_init_args *args)
         gb->vbk = 0xfe;
         gb->vram_dma_source = gb->vram_dma_dest = 0xffff;
         gb->vram_dma_length = 0;
-        gb->gdma_running = false;
         gb->hdma_running = false;
+        gb->vram_dma_stall = 0;
     }
 
     /* Load the boot ROM into the emulator if it was passed in.
@@ -375,6 +393,42 @@ gameboy *init_gameboy(struct gb_init_args *args)
     else
         gb->boot_rom_disabled = true;
 
+    /* Frame hashes and movies count the frames the boot ROM shows,
+     * so they'd differ depending on whether there was a snapshot.
+     */
+    bool per_frame_output = gb->frame_hasher || gb->state_hasher || gb->movie;
+    if (args->boot_cache_dir != NULL && gb->run_boot_rom && per_frame_output)
+        LOG_INFO("Note: Boot snapshots aren't used while hashing frames or with a movie.\n");
+    else if (args->boot_cache_dir != NULL && gb->run_boot_rom)
+        restore_boot_snapshot(gb, args->boot_cache_dir, args->force_dmg);
+
+    /* Logging starts from memory as the boot ROM or snapshot leaves it.
+     * Hashes need each frame drawn by the time it ends, so there's no
+     * render thread to draw it during the next one while hashing.
+     */
+    bool threaded = args->render_mode == RENDER_THREAD;
+    if (threaded && (gb->frame_hasher || gb->state_hasher))
+    {
+        LOG_INFO("Note: Frames aren't drawn on a render thread while hashing them.\n");
+        threaded = false;
+    }
+
+    if (args->render_mode != RENDER_SCANLINE)
+    {
+        gb->ppu->frame_log = init_frame_log(gb, threaded);
+        if (!gb->ppu->frame_log)
+            goto init_error;
+    }
+
+    // state hashes cover what only the worker would keep up to date
+    if (args->audio_mode == AUDIO_THREAD && gb->state_hasher)
+        LOG_INFO("Note: Audio isn't synthesized on a worker thread while hashing state.\n");
+    else if (args->audio_mode == AUDIO_THREAD && !start_apu_worker(gb))
+        goto init_error;
+
+    // the cartridge, mode, and boot ROM determine what's mapped
+    remap_memory(gb);
+
     // screen must be initialized after the PPU
     if (!init_screen(gb, args->window_scale))
         goto init_error;
@@ -393,11 +447,15 @@ init_error:
 void free_gameboy(gameboy *gb)
 {
     free_memory_map(gb->memory);
-    free_cpu(gb->cpu);
     unload_cartridge(gb->cart);
     free_ppu(gb->ppu);
     free_joypad(gb->joypad);
     deinit_apu(gb->apu);
+    free_frame_hasher(gb->frame_hasher);
+    free_state_hasher(gb->state_hasher);
+    free_movie(gb->movie);
+    free_boot_snapshot(gb->boot_snapshot);
+    free_frame_pacer(gb->pacer);
 
     if (gb->screen)
         SDL_DestroyTexture(gb->screen);
@@ -408,7 +466,10 @@ void free_gameboy(gameboy *gb)
     if (gb->window)
         SDL_DestroyWindow(gb->window);
 
-    SDL_Quit();
+    // linked Game Boys share SDL
+    if (!--num_gameboys)
+        SDL_Quit();
+
     free(gb);
 }
 
@@ -426,55 +487,6 @@ bool maybe_switch_speed(gameboy *gb)
     return true;
 }
 
-/*
- * Check whether VRAM DMA should occur.
- * On hardware this check is performed
- * by the CPU during each opcode fetch.
- *
- * General-Purpose VRAM DMA is triggered
- * on write to HDMA5.
- *
- * HBLANK VRAM DMA is triggered on the
- * rising edge of the HBLANK mode signal.
- */
-static bool check_vram_dma_condition(gameboy *gb)
-{
-    bool prev_hblank_signal = gb->hblank_signal;
-    gb->hblank_signal = !(gb->ppu->stat & 0x3);
-    bool do_hdma = gb->hdma_running && !prev_hblank_signal && gb->hblank_signal;
-
-    return gb->gdma_running || do_hdma;
-}
-
-// Transfer 0x10 bytes of data as part of VRAM DMA
-static void vram_dma_transfer_chunk(gameboy *gb)
-{
-    uint8_t value;
-    // transfer length is always a multiple of 0x10
-    for (int i = 0; i < 0x10; ++i)
-    {
-        if (gb->vram_dma_source <= 0x7fff || (gb->vram_dma_source >= 0xa000 && gb->vram_dma_source <= 0xbfff))
-            value = cartridge_read(gb, gb->vram_dma_source);
-        else if (gb->vram_dma_source >= 0xc000 && gb->vram_dma_source <= 0xdfff)
-            value = ram_read(gb, gb->vram_dma_source);
-        else // reading VRAM during vram_dma writes garbage to VRAM
-            value = 0xa5; // 0b1010_0101
-
-        ram_write(gb, gb->vram_dma_dest, value);
-
-        ++gb->vram_dma_dest;
-        ++gb->vram_dma_source;
-    }
-
-    gb->vram_dma_length -= 0x10;
-
-    if (!gb->vram_dma_length)
-    {
-        gb->hdma_running = false;
-        gb->gdma_running = false;
-    }
-}
-
 /*
  * Handle writes to the following I/O registers:
  * KEY0, KEY1, VBK, SVBK, HDMA[1-5]
@@ -489,10 +501,12 @@ void cgb_core_io_write(gameboy *gb, uint16_t address, uint8_t value)
 
         case VBK_REGISTER:
             gb->vbk = 0xfe | (value & 1);
+            remap_memory(gb);
             break;
 
         case SVBK_REGISTER:
             gb->svbk = 0xf8 | (value & 0x7);
+            remap_memory(gb);
             break;
 
         case HDMA1_REGISTER:
@@ -519,16 +533,24 @@ void cgb_core_io_write(gameboy *gb, uint16_t address, uint8_t value)
             break;
 
         case HDMA5_REGISTER:
+        {
+            bool start_gdma = false;
+
             // HBLANK DMA can be canceled before completion
             if (gb->hdma_running)
                 gb->hdma_running = value & 0x80;
             else if (value & 0x80)
                 gb->hdma_running = true;
             else
-                gb->gdma_running = true;
+                start_gdma = true;
 
             gb->vram_dma_length = ((value & 0x7f) + 1) << 4;
+
+            // general-purpose DMA copies everything at once
+            if (start_gdma)
+                vram_dma_transfer(gb, gb->vram_dma_length);
             break;
+        }
 
         default:
             break;
@@ -558,11 +580,13 @@ uint8_t cgb_core_io_read(gameboy *gb, uint16_t address)
 
         case HDMA5_REGISTER:
             // only time this register can be read from while
-            // HDMA is still active is if it's an HBLANK DMA
+            // HDMA is still active is if it's an HBLANK DMA:
+            // bit 7 is clear while it's active, and set once it's
+            // finished or been cancelled
             if (!gb->vram_dma_length)
                 value = 0xff;
             else
-                value = gb->hdma_running << 7 | ((gb->vram_dma_length >> 4) - 1);
+                value = (gb->hdma_running ? 0x00 : 0x80) | ((gb->vram_dma_length >> 4) - 1);
             break;
 
         default:
@@ -795,147 +819,3 @@ uint8_t timing_related_read(gameboy *gb, uint16_t address)
 
     return value;
 }
-
-/* Check if a DMA transfer needs to be performed
- * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
- * To emulate the DMA transfer timing, we wait until the
- * number of clocks that a DMA transfer takes has elapsed
- * since the DMA register was written to, then we perform
- * the DMA transfer all at once. This works because the
- * CPU only has access to HRAM while the DMA process is
- * supposed to be occurring.
- *
- * The transfer takes 160 m-cycles (640 clocks)
- */
-static void dma_transfer_check(gameboy *gb, uint8_t num_clocks)
-{
-    if (gb->dma_requested)
-    {
-        gb->dma_counter += num_clocks;
-        if (gb->dma_counter >= 640)
-        {
-            LOG_DEBUG("Performing DMA Transfer\n");
-            dma_transfer(gb);
-            gb->dma_requested = false;
-            gb->dma_counter = 0;
-        }
-    }
-
-}
-
-// check if we can exit the HALT instruction
-static void check_halt_wakeup(gameboy *gb)
-{
-    // we exit if an interrupt is pending
-    if (pending_interrupts(gb))
-    {
-        LOG_DEBUG("Exiting HALTed state\n");
-        gb->cpu->is_halted = false;
-    }
-}
-
-/* Poll emulator input.
- * Should be called once per frame.
- */
-static inline void poll_input(gameboy *gb)
-{
-    SDL_Event event;
-    while(SDL_PollEvent(&event))
-    {
-        switch (event.type)
-        {
-            case SDL_QUIT:
-                gb->is_on = false;
-                break;
-
-            case SDL_KEYDOWN:
-            case SDL_KEYUP:
-                handle_keypress(gb, &event.key);
-                break;
-
-            default:
-                break;
-        }
-    }
-}
-
-// wait for half the audio buffer to be
-// consumed before resuming emulation
-static inline void throttle_emulation(gameboy *gb)
-{
-    bool wait = true;
-    do
-    {
-        SDL_Delay(1);
-        SDL_LockAudioDevice(gb->apu->audio_dev);
-        wait = gb->apu->num_frames > AUDIO_BUFFER_FRAME_SIZE / 2;
-        SDL_UnlockAudioDevice(gb->apu->audio_dev);
-    } while (wait);
-}
-
-// run the emulator
-void run_gameboy(gameboy *gb)
-{
-    int num_clocks;
-    while (gb->is_on)
-    {
-#ifdef DEBUG
-        // print CPU register contents before each instruction
-        if (!gb->cpu->is_halted)
-            print_registers(gb);
-#endif
-
-        // number of CPU clock ticks this iteration of the event loop
-        num_clocks = 0;
-
-        if (gb->run_mode == GB_CGB_MODE && check_vram_dma_condition(gb))
-        {
-            // HDMA transfers 0x10 bytes in 8 normal-speed m-cycles
-            vram_dma_transfer_chunk(gb);
-            if (gb->double_speed)
-                num_clocks += 8 * 8;
-            else
-                num_clocks += 4 * 8;
-        }
-        else if (gb->cpu->is_halted)
-        {
-            // same number of CPU clock ticks as a NOP
-            // See: https://gbdev.io/pandocs/CPU_Instruction_Set.html#cpu-control-instructions
-            num_clocks += 4;
-            check_halt_wakeup(gb);
-        }
-        else
-        {
-            // number of CPU clock ticks, given number of m-cycles
-            num_clocks += 4 * execute_instruction(gb);
-        }
-
-        increment_clock_counter(gb, num_clocks);
-
-        dma_transfer_check(gb, num_clocks);
-
-        // PPU and APU always run at normal speed (RTC as well)
-        if (gb->run_mode == GB_CGB_MODE && gb->double_speed)
-            num_clocks /= 2;
-
-        if (gb->cart->has_rtc)
-            tick_rtc(gb, num_clocks);
-
-        run_apu(gb, num_clocks);
-
-        run_ppu(gb, num_clocks);
-
-        if (gb->frame_presented_signal)
-        {
-            gb->frame_presented_signal = false;
-            poll_input(gb);
-        }
-
-        if (gb->audio_sync_signal)
-        {
-            gb->audio_sync_signal = false;
-            if (gb->throttle_fps)
-                throttle_emulation(gb);
-        }
-    }
-}
@@ -0,0 +1,393 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "cboy/inflate.h"
+
+#define MAX_CODE_BITS 15
+#define NUM_LENGTH_CODES 286 // literal/length codes, not counting the two unused ones
+#define NUM_DIST_CODES 30
+
+// base values and extra bits for length codes 257..285
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// base values and extra bits for distance codes 0..29
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// order in which code length code lengths are stored in a dynamic block header
+static const uint8_t code_length_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+void init_inflater(gb_inflater *inflater, FILE *in)
+{
+    memset(inflater, 0, sizeof *inflater);
+    inflater->in = in;
+    inflater->state = INFLATE_BLOCK_START;
+}
+
+/* Next byte of compressed input. Running out of input
+ * before the end of the stream means it's truncated.
+ */
+static int next_byte(gb_inflater *inflater)
+{
+    if (inflater->in_pos == inflater->in_len)
+    {
+        inflater->in_len = fread(inflater->in_buf, 1, sizeof inflater->in_buf, inflater->in);
+        inflater->in_pos = 0;
+
+        if (inflater->in_len == 0)
+        {
+            if (ferror(inflater->in))
+                inflater->io_error = true;
+            inflater->error = true;
+            return 0;
+        }
+    }
+
+    return inflater->in_buf[inflater->in_pos++];
+}
+
+/* Take the next count (at most 16) bits from the input, least
+ * significant first. Once an error occurs the bits are all 0,
+ * so callers only need to check for it once they're done.
+ */
+static uint32_t get_bits(gb_inflater *inflater, int count)
+{
+    while (inflater->bit_count < count)
+    {
+        inflater->bit_buf |= (uint32_t)next_byte(inflater) << inflater->bit_count;
+        inflater->bit_count += 8;
+    }
+
+    uint32_t bits = inflater->bit_buf & ((1u << count) - 1);
+    inflater->bit_buf >>= count;
+    inflater->bit_count -= count;
+    return bits;
+}
+
+/* Decode a symbol with the given code. Huffman codes are stored
+ * most significant bit first, so they're read a bit at a time.
+ * Returns -1 if the bits don't make up a code.
+ */
+static int decode_symbol(gb_inflater *inflater, const gb_huffman *code)
+{
+    int bits = 0;  // the bits read so far
+    int first = 0; // first code of the current length
+    int index = 0; // index of the first code of the current length in symbol[]
+
+    for (int len = 1; len <= MAX_CODE_BITS; ++len)
+    {
+        bits |= get_bits(inflater, 1);
+        int count = code->count[len];
+        if (bits - first < count)
+            return code->symbol[index + bits - first];
+
+        index += count;
+        first = (first + count) << 1;
+        bits <<= 1;
+    }
+
+    return -1;
+}
+
+/* Build a canonical Huffman code from each symbol's code length.
+ * Returns false if the lengths describe an over-subscribed code. An
+ * incomplete code is allowed, since a block may use a single distance
+ * code; decode_symbol() rejects the missing codes.
+ */
+static bool build_huffman(gb_huffman *code, const uint8_t *lengths, int num_symbols)
+{
+    memset(code->count, 0, sizeof code->count);
+    for (int symbol = 0; symbol < num_symbols; ++symbol)
+        ++code->count[lengths[symbol]];
+
+    if (code->count[0] == num_symbols)
+        return true; // no codes at all
+
+    int left = 1; // codes of the current length still unused
+    for (int len = 1; len <= MAX_CODE_BITS; ++len)
+    {
+        left = (left << 1) - code->count[len];
+        if (left < 0)
+            return false;
+    }
+
+    // the first index in symbol[] for each length
+    uint16_t offsets[MAX_CODE_BITS + 1];
+    offsets[1] = 0;
+    for (int len = 1; len < MAX_CODE_BITS; ++len)
+        offsets[len + 1] = offsets[len] + code->count[len];
+
+    // symbols of each length, in increasing order
+    for (int symbol = 0; symbol < num_symbols; ++symbol)
+        if (lengths[symbol])
+            code->symbol[offsets[lengths[symbol]]++] = symbol;
+
+    return true;
+}
+
+static void build_fixed_codes(gb_inflater *inflater)
+{
+    uint8_t lengths[288];
+    int symbol = 0;
+
+    for (; symbol < 144; ++symbol)
+        lengths[symbol] = 8;
+    for (; symbol < 256; ++symbol)
+        lengths[symbol] = 9;
+    for (; symbol < 280; ++symbol)
+        lengths[symbol] = 7;
+    for (; symbol < 288; ++symbol)
+        lengths[symbol] = 8;
+    build_huffman(&inflater->lencode, lengths, 288);
+
+    for (symbol = 0; symbol < NUM_DIST_CODES; ++symbol)
+        lengths[symbol] = 5;
+    build_huffman(&inflater->distcode, lengths, NUM_DIST_CODES);
+}
+
+/* Read the code lengths at the start of a dynamic block and build its
+ * codes. Returns false if they're malformed.
+ */
+static bool build_dynamic_codes(gb_inflater *inflater)
+{
+    uint8_t lengths[NUM_LENGTH_CODES + NUM_DIST_CODES];
+
+    int num_length_codes = get_bits(inflater, 5) + 257;
+    int num_dist_codes = get_bits(inflater, 5) + 1;
+    int num_code_length_codes = get_bits(inflater, 4) + 4;
+    if (num_length_codes > NUM_LENGTH_CODES || num_dist_codes > NUM_DIST_CODES)
+        return false;
+
+    // the code used to compress the code lengths themselves
+    memset(lengths, 0, 19);
+    for (int i = 0; i < num_code_length_codes; ++i)
+        lengths[code_length_order[i]] = get_bits(inflater, 3);
+
+    gb_huffman *lencode = &inflater->lencode;
+    if (!build_huffman(lencode, lengths, 19))
+        return false;
+
+    int index = 0;
+    while (index < num_length_codes + num_dist_codes)
+    {
+        int symbol = decode_symbol(inflater, lencode);
+        if (symbol < 0 || inflater->error)
+            return false;
+
+        if (symbol < 16)
+        {
+            lengths[index++] = symbol;
+            continue;
+        }
+
+        // a run of repeated lengths
+        uint8_t length = 0;
+        int repeat;
+        if (symbol == 16)
+        {
+            if (index == 0)
+                return false; // nothing to repeat
+            length = lengths[index - 1];
+            repeat = 3 + get_bits(inflater, 2);
+        }
+        else if (symbol == 17)
+            repeat = 3 + get_bits(inflater, 3);
+        else
+            repeat = 11 + get_bits(inflater, 7);
+
+        if (index + repeat > num_length_codes + num_dist_codes)
+            return false;
+        while (repeat--)
+            lengths[index++] = length;
+    }
+
+    // a block has to be able to end
+    if (lengths[256] == 0)
+        return false;
+
+    return build_huffman(&inflater->lencode, lengths, num_length_codes)
+           && build_huffman(&inflater->distcode, lengths + num_length_codes, num_dist_codes);
+}
+
+// read the header of the next block
+static void start_block(gb_inflater *inflater)
+{
+    inflater->final_block = get_bits(inflater, 1);
+
+    switch (get_bits(inflater, 2))
+    {
+        case 0: // stored
+        {
+            // the length starts at the next byte boundary
+            inflater->bit_buf = 0;
+            inflater->bit_count = 0;
+
+            uint16_t len = next_byte(inflater);
+            len |= next_byte(inflater) << 8;
+            uint16_t nlen = next_byte(inflater);
+            nlen |= next_byte(inflater) << 8;
+            if ((len ^ nlen) != 0xffff) // NLEN is the complement of LEN
+                inflater->error = true;
+
+            inflater->stored_left = len;
+            inflater->state = INFLATE_STORED;
+            break;
+        }
+        case 1:
+            build_fixed_codes(inflater);
+            inflater->state = INFLATE_HUFFMAN;
+            break;
+        case 2:
+            if (!build_dynamic_codes(inflater))
+                inflater->error = true;
+            inflater->state = INFLATE_HUFFMAN;
+            break;
+        default:
+            inflater->error = true;
+            break;
+    }
+}
+
+// end of a block
+static void end_block(gb_inflater *inflater)
+{
+    inflater->state = inflater->final_block ? INFLATE_DONE : INFLATE_BLOCK_START;
+}
+
+/* Decode the next symbol of a Huffman block. Returns the literal
+ * byte, or -1 if it was a back-reference or the end of the block.
+ */
+static int decode_huffman(gb_inflater *inflater)
+{
+    int symbol = decode_symbol(inflater, &inflater->lencode);
+    if (symbol < 256)
+    {
+        if (symbol < 0)
+            inflater->error = true;
+        return symbol;
+    }
+
+    if (symbol == 256)
+    {
+        end_block(inflater);
+        return -1;
+    }
+
+    symbol -= 257;
+    if (symbol >= 29)
+    {
+        inflater->error = true;
+        return -1;
+    }
+    uint16_t len = length_base[symbol] + get_bits(inflater, length_extra[symbol]);
+
+    symbol = decode_symbol(inflater, &inflater->distcode);
+    if (symbol < 0 || symbol >= NUM_DIST_CODES)
+    {
+        inflater->error = true;
+        return -1;
+    }
+    uint16_t dist = dist_base[symbol] + get_bits(inflater, dist_extra[symbol]);
+
+    // can't refer back past the start of the output
+    if (!inflater->window_full && dist > inflater->window_pos)
+    {
+        inflater->error = true;
+        return -1;
+    }
+
+    inflater->copy_len = len;
+    inflater->copy_dist = dist;
+    return -1;
+}
+
+size_t inflate_read(gb_inflater *inflater, uint8_t *buffer, size_t len)
+{
+    size_t n = 0;
+    uint32_t mask = INFLATE_WINDOW_SIZE - 1;
+
+    while (n < len && !inflater->error)
+    {
+        int byte;
+
+        if (inflater->copy_len)
+        {
+            byte = inflater->window[(inflater->window_pos - inflater->copy_dist) & mask];
+            --inflater->copy_len;
+        }
+        else
+        {
+            switch (inflater->state)
+            {
+                case INFLATE_BLOCK_START:
+                    start_block(inflater);
+                    continue;
+
+                case INFLATE_STORED:
+                    if (inflater->stored_left == 0)
+                    {
+                        end_block(inflater);
+                        continue;
+                    }
+                    byte = next_byte(inflater);
+                    --inflater->stored_left;
+                    break;
+
+                case INFLATE_HUFFMAN:
+                    byte = decode_huffman(inflater);
+                    if (byte < 0)
+                        continue;
+                    break;
+
+                case INFLATE_DONE:
+                default:
+                    return n;
+            }
+
+            if (inflater->error)
+                break;
+        }
+
+        buffer[n++] = byte;
+        inflater->window[inflater->window_pos] = byte;
+        inflater->window_pos = (inflater->window_pos + 1) & mask;
+        if (inflater->window_pos == 0)
+            inflater->window_full = true;
+    }
+
+    return n;
+}
+
+size_t inflate_read_trailer(gb_inflater *inflater, uint8_t *buffer, size_t len)
+{
+    if (inflater->state != INFLATE_DONE || inflater->copy_len || inflater->error)
+        return 0;
+
+    // fewer than 8 bits are left over, from the byte the stream ends in
+    inflater->bit_buf = 0;
+    inflater->bit_count = 0;
+
+    size_t n = 0;
+    while (n < len)
+    {
+        int byte = next_byte(inflater);
+        if (inflater->error)
+            break;
+
+        buffer[n++] = byte;
+    }
+
+    return n;
+}
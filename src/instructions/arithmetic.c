@@ -21,103 +21,63 @@ void inc(gameboy *gb, gb_instruction *inst)
     switch (inst->op1)
     {
         case REG_A:
-        {
-            // store old value for half carry flag check
-            uint8_t old_a = (gb->cpu->reg->a)++;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->a == 0);
-            set_subtract_flag(gb->cpu->reg, 0);
-            set_half_carry_flag(gb->cpu->reg, (old_a & 0xf) + 1 > 0xf);
+            ++(gb->cpu.reg.a);
+            set_lazy_flags(&gb->cpu.reg, LAZY_INC, 0, 0, gb->cpu.reg.a);
             break;
-        }
 
         case REG_B:
-        {
-            uint8_t old_b = (gb->cpu->reg->b)++;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->b == 0);
-            set_subtract_flag(gb->cpu->reg, 0);
-            set_half_carry_flag(gb->cpu->reg, (old_b & 0xf) + 1 > 0xf);
+            ++(gb->cpu.reg.b);
+            set_lazy_flags(&gb->cpu.reg, LAZY_INC, 0, 0, gb->cpu.reg.b);
             break;
-        }
 
         case REG_C:
-        {
-            uint8_t old_c = (gb->cpu->reg->c)++;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->c == 0);
-            set_subtract_flag(gb->cpu->reg, 0);
-            set_half_carry_flag(gb->cpu->reg, (old_c & 0xf) + 1 > 0xf);
+            ++(gb->cpu.reg.c);
+            set_lazy_flags(&gb->cpu.reg, LAZY_INC, 0, 0, gb->cpu.reg.c);
             break;
-        }
 
         case REG_D:
-        {
-            uint8_t old_d = (gb->cpu->reg->d)++;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->d == 0);
-            set_subtract_flag(gb->cpu->reg, 0);
-            set_half_carry_flag(gb->cpu->reg, (old_d & 0xf) + 1 > 0xf);
+            ++(gb->cpu.reg.d);
+            set_lazy_flags(&gb->cpu.reg, LAZY_INC, 0, 0, gb->cpu.reg.d);
             break;
-        }
 
         case REG_E:
-        {
-            uint8_t old_e = (gb->cpu->reg->e)++;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->e == 0);
-            set_subtract_flag(gb->cpu->reg, 0);
-            set_half_carry_flag(gb->cpu->reg, (old_e & 0xf) + 1 > 0xf);
+            ++(gb->cpu.reg.e);
+            set_lazy_flags(&gb->cpu.reg, LAZY_INC, 0, 0, gb->cpu.reg.e);
             break;
-        }
 
         case REG_H:
-        {
-            uint8_t old_h = (gb->cpu->reg->h)++;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->h == 0);
-            set_subtract_flag(gb->cpu->reg, 0);
-            set_half_carry_flag(gb->cpu->reg, (old_h & 0xf) + 1 > 0xf);
+            ++(gb->cpu.reg.h);
+            set_lazy_flags(&gb->cpu.reg, LAZY_INC, 0, 0, gb->cpu.reg.h);
             break;
-        }
 
         case REG_L:
-        {
-            uint8_t old_l = (gb->cpu->reg->l)++;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->l == 0);
-            set_subtract_flag(gb->cpu->reg, 0);
-            set_half_carry_flag(gb->cpu->reg, (old_l & 0xf) + 1 > 0xf);
+            ++(gb->cpu.reg.l);
+            set_lazy_flags(&gb->cpu.reg, LAZY_INC, 0, 0, gb->cpu.reg.l);
             break;
-        }
 
         case PTR_HL:
         {
-            uint16_t addr = read_hl(gb->cpu->reg);
+            uint16_t addr = gb->cpu.reg.hl;
             uint8_t old_val = read_byte(gb, addr);
             write_byte(gb, addr, old_val + 1);
-
-            // account for implicit integer promotion
-            set_zero_flag(gb->cpu->reg, ((old_val + 1) & 0xff) == 0);
-            set_subtract_flag(gb->cpu->reg, 0);
-            set_half_carry_flag(gb->cpu->reg, (old_val & 0xf) + 1 > 0xf);
+            set_lazy_flags(&gb->cpu.reg, LAZY_INC, 0, 0, (uint8_t)(old_val + 1));
             break;
         }
 
         case REG_BC:
-            write_bc(gb->cpu->reg, read_bc(gb->cpu->reg) + 1);
+            gb->cpu.reg.bc = gb->cpu.reg.bc + 1;
             break;
 
         case REG_DE:
-            write_de(gb->cpu->reg, read_de(gb->cpu->reg) + 1);
+            gb->cpu.reg.de = gb->cpu.reg.de + 1;
             break;
 
         case REG_HL:
-            write_hl(gb->cpu->reg, read_hl(gb->cpu->reg) + 1);
+            gb->cpu.reg.hl = gb->cpu.reg.hl + 1;
             break;
 
         case REG_SP:
-            ++(gb->cpu->reg->sp);
+            ++(gb->cpu.reg.sp);
             break;
 
         default: // shouldn't get here
@@ -139,103 +99,63 @@ void dec(gameboy *gb, gb_instruction *inst)
     switch (inst->op1)
     {
         case REG_A:
-        {
-            // store old value for half-carry flag check
-            uint8_t old_a = (gb->cpu->reg->a)--;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->a == 0);
-            set_subtract_flag(gb->cpu->reg, 1);
-            // borrow from bit 4 occurs if lower nibble is < 1 (i.e. 0)
-            set_half_carry_flag(gb->cpu->reg, (old_a & 0xf) == 0);
+            --(gb->cpu.reg.a);
+            set_lazy_flags(&gb->cpu.reg, LAZY_DEC, 0, 0, gb->cpu.reg.a);
             break;
-        }
 
         case REG_B:
-        {
-            uint8_t old_b = (gb->cpu->reg->b)--;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->b == 0);
-            set_subtract_flag(gb->cpu->reg, 1);
-            set_half_carry_flag(gb->cpu->reg, (old_b & 0xf) == 0);
+            --(gb->cpu.reg.b);
+            set_lazy_flags(&gb->cpu.reg, LAZY_DEC, 0, 0, gb->cpu.reg.b);
             break;
-        }
 
         case REG_C:
-        {
-            uint8_t old_c = (gb->cpu->reg->c)--;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->c == 0);
-            set_subtract_flag(gb->cpu->reg, 1);
-            set_half_carry_flag(gb->cpu->reg, (old_c & 0xf) == 0);
+            --(gb->cpu.reg.c);
+            set_lazy_flags(&gb->cpu.reg, LAZY_DEC, 0, 0, gb->cpu.reg.c);
             break;
-        }
 
         case REG_D:
-        {
-            uint8_t old_d = (gb->cpu->reg->d)--;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->d == 0);
-            set_subtract_flag(gb->cpu->reg, 1);
-            set_half_carry_flag(gb->cpu->reg, (old_d & 0xf) == 0);
+            --(gb->cpu.reg.d);
+            set_lazy_flags(&gb->cpu.reg, LAZY_DEC, 0, 0, gb->cpu.reg.d);
             break;
-        }
 
         case REG_E:
-        {
-            uint8_t old_e = (gb->cpu->reg->e)--;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->e == 0);
-            set_subtract_flag(gb->cpu->reg, 1);
-            set_half_carry_flag(gb->cpu->reg, (old_e & 0xf) == 0);
+            --(gb->cpu.reg.e);
+            set_lazy_flags(&gb->cpu.reg, LAZY_DEC, 0, 0, gb->cpu.reg.e);
             break;
-        }
 
         case REG_H:
-        {
-            uint8_t old_h = (gb->cpu->reg->h)--;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->h == 0);
-            set_subtract_flag(gb->cpu->reg, 1);
-            set_half_carry_flag(gb->cpu->reg, (old_h & 0xf) == 0);
+            --(gb->cpu.reg.h);
+            set_lazy_flags(&gb->cpu.reg, LAZY_DEC, 0, 0, gb->cpu.reg.h);
             break;
-        }
 
         case REG_L:
-        {
-            uint8_t old_l = (gb->cpu->reg->l)--;
-
-            set_zero_flag(gb->cpu->reg, gb->cpu->reg->l == 0);
-            set_subtract_flag(gb->cpu->reg, 1);
-            set_half_carry_flag(gb->cpu->reg, (old_l & 0xf) == 0);
+            --(gb->cpu.reg.l);
+            set_lazy_flags(&gb->cpu.reg, LAZY_DEC, 0, 0, gb->cpu.reg.l);
             break;
-        }
 
         case PTR_HL:
         {
-            uint16_t addr = read_hl(gb->cpu->reg);
+            uint16_t addr = gb->cpu.reg.hl;
             uint8_t old_val = read_byte(gb, addr);
             write_byte(gb, addr, old_val - 1);
-
-            set_zero_flag(gb->cpu->reg, old_val - 1 == 0);
-            set_subtract_flag(gb->cpu->reg, 1);
-            set_half_carry_flag(gb->cpu->reg, (old_val & 0xf) == 0);
+            set_lazy_flags(&gb->cpu.reg, LAZY_DEC, 0, 0, (uint8_t)(old_val - 1));
             break;
         }
 
         case REG_BC:
-            write_bc(gb->cpu->reg, read_bc(gb->cpu->reg) - 1);
+            gb->cpu.reg.bc = gb->cpu.reg.bc - 1;
             break;
 
         case REG_DE:
-            write_de(gb->cpu->reg, read_de(gb->cpu->reg) - 1);
+            gb->cpu.reg.de = gb->cpu.reg.de - 1;
             break;
 
         case REG_HL:
-            write_hl(gb->cpu->reg, read_hl(gb->cpu->reg) - 1);
+            gb->cpu.reg.hl = gb->cpu.reg.hl - 1;
             break;
 
         case REG_SP:
-            --(gb->cpu->reg->sp);
+            --(gb->cpu.reg.sp);
             break;
 
         default: // shouldn't get here
@@ -279,52 +199,48 @@ void add(gameboy *gb, gb_instruction *inst)
             switch (inst->op2)
             {
                 case REG_A:
-                    to_add = gb->cpu->reg->a;
+                    to_add = gb->cpu.reg.a;
                     break;
 
                 case REG_B:
-                    to_add = gb->cpu->reg->b;
+                    to_add = gb->cpu.reg.b;
                     break;
 
                 case REG_C:
-                    to_add = gb->cpu->reg->c;
+                    to_add = gb->cpu.reg.c;
                     break;
 
                 case REG_D:
-                    to_add = gb->cpu->reg->d;
+                    to_add = gb->cpu.reg.d;
                     break;
 
                 case REG_E:
-                    to_add = gb->cpu->reg->e;
+                    to_add = gb->cpu.reg.e;
                     break;
 
                 case REG_H:
-                    to_add = gb->cpu->reg->h;
+                    to_add = gb->cpu.reg.h;
                     break;
 
                 case REG_L:
-                    to_add = gb->cpu->reg->l;
+                    to_add = gb->cpu.reg.l;
                     break;
 
                 case PTR_HL:
-                    to_add = read_byte(gb, read_hl(gb->cpu->reg));
+                    to_add = read_byte(gb, gb->cpu.reg.hl);
                     break;
 
                 case IMM_8:
-                    to_add = read_byte(gb, (gb->cpu->reg->pc)++);
+                    to_add = fetch_byte(gb);
                     break;
 
                 default: // shouldn't get here
                     LOG_ERROR("Illegal argument in %s A, r8 encountered. Exiting...\n", inst->inst_str);
                     exit(1);
             }
-            uint8_t old_a = gb->cpu->reg->a;
-            gb->cpu->reg->a += to_add;
-            set_flags(gb->cpu->reg,
-                      gb->cpu->reg->a == 0,                       // zero
-                      0,                                          // subtract
-                      (old_a & 0xf) + (to_add & 0xf) > 0xf,       // half carry
-                      (uint16_t)old_a + (uint16_t)to_add > 0xff); // carry
+            uint8_t old_a = gb->cpu.reg.a;
+            gb->cpu.reg.a += to_add;
+            set_lazy_flags(&gb->cpu.reg, LAZY_ADD, old_a, to_add, (uint16_t)old_a + to_add);
 
             if (inst->op2 == IMM_8)
                 LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], to_add);
@@ -339,30 +255,32 @@ void add(gameboy *gb, gb_instruction *inst)
             switch (inst->op2)
             {
                 case REG_BC:
-                    to_add = read_bc(gb->cpu->reg);
+                    to_add = gb->cpu.reg.bc;
                     break;
 
                 case REG_DE:
-                    to_add = read_de(gb->cpu->reg);
+                    to_add = gb->cpu.reg.de;
                     break;
 
                 case REG_HL:
-                    to_add = read_hl(gb->cpu->reg);
+                    to_add = gb->cpu.reg.hl;
                     break;
 
                 case REG_SP:
-                    to_add = gb->cpu->reg->sp;
+                    to_add = gb->cpu.reg.sp;
                     break;
 
                 default: // shouldn't get here
                     LOG_ERROR("Illegal argument in %s HL, r16 encountered. Exiting...\n", inst->inst_str);
                     exit(1);
             }
-            uint16_t old_hl = read_hl(gb->cpu->reg);
-            write_hl(gb->cpu->reg, old_hl + to_add);
-            set_subtract_flag(gb->cpu->reg, 0);
-            set_half_carry_flag(gb->cpu->reg, (old_hl & 0xfff) + (to_add & 0xfff) > 0xfff);
-            set_carry_flag(gb->cpu->reg, (uint32_t)old_hl + (uint32_t)to_add > 0xffff);
+            uint16_t old_hl = gb->cpu.reg.hl;
+            gb->cpu.reg.hl = old_hl + to_add;
+            set_flags(&gb->cpu.reg,
+                      read_zero_flag(&gb->cpu.reg),                         // zero (unaffected)
+                      0,                                                    // subtract
+                      (old_hl & 0xfff) + (to_add & 0xfff) > 0xfff,          // half carry
+                      (uint32_t)old_hl + (uint32_t)to_add > 0xffff);        // carry
 
             LOG_DEBUG("%s %s, %s\n", inst->inst_str, operand_strs[inst->op1], operand_strs[inst->op2]);
             break;
@@ -370,17 +288,17 @@ void add(gameboy *gb, gb_instruction *inst)
 
         case REG_SP: // single case, add signed 8-bit offset
         {
-            uint8_t offset = read_byte(gb, (gb->cpu->reg->pc)++);
+            uint8_t offset = fetch_byte(gb);
             bool sign_bit = (offset >> 7) & 1;
 
             // flags are set based on unsigned value of offset
-            bool half_carry = (gb->cpu->reg->sp & 0xf) + (offset & 0xf) > 0xf,
-                 carry      = (gb->cpu->reg->sp & 0xff) + offset > 0xff;
+            bool half_carry = (gb->cpu.reg.sp & 0xf) + (offset & 0xf) > 0xf,
+                 carry      = (gb->cpu.reg.sp & 0xff) + offset > 0xff;
 
             // SP is 16 bits, so we need to sign extend the offset before adding
-            gb->cpu->reg->sp += sign_bit ? 0xff00 | (uint16_t)offset : offset;
+            gb->cpu.reg.sp += sign_bit ? 0xff00 | (uint16_t)offset : offset;
 
-            set_flags(gb->cpu->reg, 0, 0, half_carry, carry);
+            set_flags(&gb->cpu.reg, 0, 0, half_carry, carry);
 
             LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], offset);
             break;
@@ -413,57 +331,53 @@ void adc(gameboy *gb, gb_instruction *inst)
      *  Carry Flag:        set if overflow from bit 7
      */
 
-    bool carry = read_carry_flag(gb->cpu->reg);
+    bool carry = read_carry_flag(&gb->cpu.reg);
     uint8_t to_add;
     switch (inst->op2)
     {
         case REG_A:
-            to_add = gb->cpu->reg->a;
+            to_add = gb->cpu.reg.a;
             break;
 
         case REG_B:
-            to_add = gb->cpu->reg->b;
+            to_add = gb->cpu.reg.b;
             break;
 
         case REG_C:
-            to_add = gb->cpu->reg->c;
+            to_add = gb->cpu.reg.c;
             break;
 
         case REG_D:
-            to_add = gb->cpu->reg->d;
+            to_add = gb->cpu.reg.d;
             break;
 
         case REG_E:
-            to_add = gb->cpu->reg->e;
+            to_add = gb->cpu.reg.e;
             break;
 
         case REG_H:
-            to_add = gb->cpu->reg->h;
+            to_add = gb->cpu.reg.h;
             break;
 
         case REG_L:
-            to_add = gb->cpu->reg->l;
+            to_add = gb->cpu.reg.l;
             break;
 
         case PTR_HL:
-            to_add = read_byte(gb, read_hl(gb->cpu->reg));
+            to_add = read_byte(gb, gb->cpu.reg.hl);
             break;
 
         case IMM_8:
-            to_add = read_byte(gb, (gb->cpu->reg->pc)++);
+            to_add = fetch_byte(gb);
             break;
 
         default: // shouldn't get here
             LOG_ERROR("Illegal argument in %s encountered. Exiting...\n", inst->inst_str);
             exit(1);
     }
-    uint8_t old_a = gb->cpu->reg->a;
-    gb->cpu->reg->a += to_add + carry;
-    set_flags(gb->cpu->reg,
-              gb->cpu->reg->a == 0,                               // zero
-              0,                                                  // subtract
-              (old_a & 0xf) + (to_add & 0xf) + carry > 0xf,       // half carry
-              (uint16_t)old_a + (uint16_t)to_add + carry > 0xff); // carry
+    uint8_t old_a = gb->cpu.reg.a;
+    gb->cpu.reg.a += to_add + carry;
+    set_lazy_flags(&gb->cpu.reg, LAZY_ADD, old_a, to_add, (uint16_t)old_a + to_add + carry);
 
     if (inst->op2 == IMM_8)
         LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], to_add);
@@ -498,12 +412,8 @@ static void sub_from_reg_a(gb_registers *reg, uint8_t to_sub, bool store_result)
         reg->a -= to_sub;
     }
 
-    // set flags accordingly
-    set_flags(reg,
-              old_a - to_sub == 0,            // zero
-              1,                              // subtract
-              (old_a & 0xf) < (to_sub & 0xf), // half carry
-              old_a < to_sub);                // carry
+    // set flags accordingly (a borrow wraps around into bit 8)
+    set_lazy_flags(reg, LAZY_SUB, old_a, to_sub, (uint16_t)(old_a - to_sub));
 }
 
 // the subtract instruction
@@ -525,39 +435,39 @@ void sub(gameboy *gb, gb_instruction *inst)
     switch (inst->op2)
     {
         case REG_A:
-            to_sub = gb->cpu->reg->a;
+            to_sub = gb->cpu.reg.a;
             break;
 
         case REG_B:
-            to_sub = gb->cpu->reg->b;
+            to_sub = gb->cpu.reg.b;
             break;
 
         case REG_C:
-            to_sub = gb->cpu->reg->c;
+            to_sub = gb->cpu.reg.c;
             break;
 
         case REG_D:
-            to_sub = gb->cpu->reg->d;
+            to_sub = gb->cpu.reg.d;
             break;
 
         case REG_E:
-            to_sub = gb->cpu->reg->e;
+            to_sub = gb->cpu.reg.e;
             break;
 
         case REG_H:
-            to_sub = gb->cpu->reg->h;
+            to_sub = gb->cpu.reg.h;
             break;
 
         case REG_L:
-            to_sub = gb->cpu->reg->l;
+            to_sub = gb->cpu.reg.l;
             break;
 
         case PTR_HL:
-            to_sub = read_byte(gb, read_hl(gb->cpu->reg));
+            to_sub = read_byte(gb, gb->cpu.reg.hl);
             break;
 
         case IMM_8:
-            to_sub = read_byte(gb, (gb->cpu->reg->pc)++);
+            to_sub = fetch_byte(gb);
             break;
 
         default: // shouldn't get here
@@ -566,7 +476,7 @@ void sub(gameboy *gb, gb_instruction *inst)
     }
 
     // calculate and store the difference and set flags
-    sub_from_reg_a(gb->cpu->reg, to_sub, 1);
+    sub_from_reg_a(&gb->cpu.reg, to_sub, 1);
 
     if (inst->op2 == IMM_8)
         LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], to_sub);
@@ -591,44 +501,44 @@ void sbc(gameboy *gb, gb_instruction *inst)
      * Carry Flag:        set if borrow (set if op2 + carry > A)
      */
 
-    bool carry = read_carry_flag(gb->cpu->reg);
+    bool carry = read_carry_flag(&gb->cpu.reg);
     uint8_t to_sub;
     switch (inst->op2)
     {
         case REG_A:
-            to_sub = gb->cpu->reg->a;
+            to_sub = gb->cpu.reg.a;
             break;
 
         case REG_B:
-            to_sub = gb->cpu->reg->b;
+            to_sub = gb->cpu.reg.b;
             break;
 
         case REG_C:
-            to_sub = gb->cpu->reg->c;
+            to_sub = gb->cpu.reg.c;
             break;
 
         case REG_D:
-            to_sub = gb->cpu->reg->d;
+            to_sub = gb->cpu.reg.d;
             break;
 
         case REG_E:
-            to_sub = gb->cpu->reg->e;
+            to_sub = gb->cpu.reg.e;
             break;
 
         case REG_H:
-            to_sub = gb->cpu->reg->h;
+            to_sub = gb->cpu.reg.h;
             break;
 
         case REG_L:
-            to_sub = gb->cpu->reg->l;
+            to_sub = gb->cpu.reg.l;
             break;
 
         case PTR_HL:
-            to_sub = read_byte(gb, read_hl(gb->cpu->reg));
+            to_sub = read_byte(gb, gb->cpu.reg.hl);
             break;
 
         case IMM_8:
-            to_sub = read_byte(gb, (gb->cpu->reg->pc)++);
+            to_sub = fetch_byte(gb);
             break;
 
         default: // shouldn't get here
@@ -636,13 +546,9 @@ void sbc(gameboy *gb, gb_instruction *inst)
             exit(1);
     }
 
-    uint8_t old_a = gb->cpu->reg->a;
-    gb->cpu->reg->a -= to_sub + carry;
-    set_flags(gb->cpu->reg,
-              gb->cpu->reg->a == 0,                   // zero
-              1,                                      // subtract
-              (old_a & 0xf) < (to_sub & 0xf) + carry, // half carry
-              old_a < (uint16_t)to_sub + carry);      // carry
+    uint8_t old_a = gb->cpu.reg.a;
+    gb->cpu.reg.a -= to_sub + carry;
+    set_lazy_flags(&gb->cpu.reg, LAZY_SUB, old_a, to_sub, (uint16_t)(old_a - to_sub - carry));
 
     if (inst->op2 == IMM_8)
         LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], to_sub);
@@ -669,39 +575,39 @@ void cp(gameboy *gb, gb_instruction *inst)
     switch (inst->op2)
     {
         case REG_A:
-            to_sub = gb->cpu->reg->a;
+            to_sub = gb->cpu.reg.a;
             break;
 
         case REG_B:
-            to_sub = gb->cpu->reg->b;
+            to_sub = gb->cpu.reg.b;
             break;
 
         case REG_C:
-            to_sub = gb->cpu->reg->c;
+            to_sub = gb->cpu.reg.c;
             break;
 
         case REG_D:
-            to_sub = gb->cpu->reg->d;
+            to_sub = gb->cpu.reg.d;
             break;
 
         case REG_E:
-            to_sub = gb->cpu->reg->e;
+            to_sub = gb->cpu.reg.e;
             break;
 
         case REG_H:
-            to_sub = gb->cpu->reg->h;
+            to_sub = gb->cpu.reg.h;
             break;
 
         case REG_L:
-            to_sub = gb->cpu->reg->l;
+            to_sub = gb->cpu.reg.l;
             break;
 
         case PTR_HL:
-            to_sub = read_byte(gb, read_hl(gb->cpu->reg));
+            to_sub = read_byte(gb, gb->cpu.reg.hl);
             break;
 
         case IMM_8:
-            to_sub = read_byte(gb, (gb->cpu->reg->pc)++);
+            to_sub = fetch_byte(gb);
             break;
 
         default: // shouldn't get here
@@ -710,7 +616,7 @@ void cp(gameboy *gb, gb_instruction *inst)
     }
 
     // calculate the difference (without storing the result) and set flags
-    sub_from_reg_a(gb->cpu->reg, to_sub, 0);
+    sub_from_reg_a(&gb->cpu.reg, to_sub, 0);
 
     if (inst->op2 == IMM_8)
         LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], to_sub);
@@ -735,47 +641,47 @@ void and(gameboy *gb, gb_instruction *inst)
     switch (inst->op2)
     {
         case REG_A:
-            to_and = gb->cpu->reg->a;
+            to_and = gb->cpu.reg.a;
             break;
 
         case REG_B:
-            to_and = gb->cpu->reg->b;
+            to_and = gb->cpu.reg.b;
             break;
 
         case REG_C:
-            to_and = gb->cpu->reg->c;
+            to_and = gb->cpu.reg.c;
             break;
 
         case REG_D:
-            to_and = gb->cpu->reg->d;
+            to_and = gb->cpu.reg.d;
             break;
 
         case REG_E:
-            to_and = gb->cpu->reg->e;
+            to_and = gb->cpu.reg.e;
             break;
 
         case REG_H:
-            to_and = gb->cpu->reg->h;
+            to_and = gb->cpu.reg.h;
             break;
 
         case REG_L:
-            to_and = gb->cpu->reg->l;
+            to_and = gb->cpu.reg.l;
             break;
 
         case PTR_HL:
-            to_and = read_byte(gb, read_hl(gb->cpu->reg));
+            to_and = read_byte(gb, gb->cpu.reg.hl);
             break;
 
         case IMM_8:
-            to_and = read_byte(gb, (gb->cpu->reg->pc)++);
+            to_and = fetch_byte(gb);
             break;
 
         default: // shouldn't get here
             LOG_ERROR("Illegal argument in %s encountered. Exiting...\n", inst->inst_str);
             exit(1);
     }
-    gb->cpu->reg->a &= to_and;
-    set_flags(gb->cpu->reg, gb->cpu->reg->a == 0, 0, 1, 0);
+    gb->cpu.reg.a &= to_and;
+    set_lazy_flags(&gb->cpu.reg, LAZY_AND, 0, 0, gb->cpu.reg.a);
 
     if (inst->op2 == IMM_8)
         LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], to_and);
@@ -800,47 +706,47 @@ void or(gameboy *gb, gb_instruction *inst)
     switch (inst->op2)
     {
         case REG_A:
-            to_or = gb->cpu->reg->a;
+            to_or = gb->cpu.reg.a;
             break;
 
         case REG_B:
-            to_or = gb->cpu->reg->b;
+            to_or = gb->cpu.reg.b;
             break;
 
         case REG_C:
-            to_or = gb->cpu->reg->c;
+            to_or = gb->cpu.reg.c;
             break;
 
         case REG_D:
-            to_or = gb->cpu->reg->d;
+            to_or = gb->cpu.reg.d;
             break;
 
         case REG_E:
-            to_or = gb->cpu->reg->e;
+            to_or = gb->cpu.reg.e;
             break;
 
         case REG_H:
-            to_or = gb->cpu->reg->h;
+            to_or = gb->cpu.reg.h;
             break;
 
         case REG_L:
-            to_or = gb->cpu->reg->l;
+            to_or = gb->cpu.reg.l;
             break;
 
         case PTR_HL:
-            to_or = read_byte(gb, read_hl(gb->cpu->reg));
+            to_or = read_byte(gb, gb->cpu.reg.hl);
             break;
 
         case IMM_8:
-            to_or = read_byte(gb, (gb->cpu->reg->pc)++);
+            to_or = fetch_byte(gb);
             break;
 
         default: // shouldn't get here
             LOG_ERROR("Illegal argument in %s encountered. Exiting...\n", inst->inst_str);
             exit(1);
     }
-    gb->cpu->reg->a |= to_or;
-    set_flags(gb->cpu->reg, gb->cpu->reg->a == 0, 0, 0, 0);
+    gb->cpu.reg.a |= to_or;
+    set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, gb->cpu.reg.a);
 
     if (inst->op2 == IMM_8)
         LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], to_or);
@@ -866,47 +772,47 @@ void xor(gameboy *gb, gb_instruction *inst)
     switch (inst->op2)
     {
         case REG_A:
-            to_xor = gb->cpu->reg->a;
+            to_xor = gb->cpu.reg.a;
             break;
 
         case REG_B:
-            to_xor = gb->cpu->reg->b;
+            to_xor = gb->cpu.reg.b;
             break;
 
         case REG_C:
-            to_xor = gb->cpu->reg->c;
+            to_xor = gb->cpu.reg.c;
             break;
 
         case REG_D:
-            to_xor = gb->cpu->reg->d;
+            to_xor = gb->cpu.reg.d;
             break;
 
         case REG_E:
-            to_xor = gb->cpu->reg->e;
+            to_xor = gb->cpu.reg.e;
             break;
 
         case REG_H:
-            to_xor = gb->cpu->reg->h;
+            to_xor = gb->cpu.reg.h;
             break;
 
         case REG_L:
-            to_xor = gb->cpu->reg->l;
+            to_xor = gb->cpu.reg.l;
             break;
 
         case PTR_HL:
-            to_xor = read_byte(gb, read_hl(gb->cpu->reg));
+            to_xor = read_byte(gb, gb->cpu.reg.hl);
             break;
 
         case IMM_8:
-            to_xor = read_byte(gb, (gb->cpu->reg->pc)++);
+            to_xor = fetch_byte(gb);
             break;
 
         default: // shouldn't get here
             LOG_ERROR("Illegal argument in %s encountered. Exiting...\n", inst->inst_str);
             exit(1);
     }
-    gb->cpu->reg->a ^= to_xor;
-    set_flags(gb->cpu->reg, gb->cpu->reg->a == 0, 0, 0, 0);
+    gb->cpu.reg.a ^= to_xor;
+    set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, gb->cpu.reg.a);
 
     if (inst->op2 == IMM_8)
         LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], to_xor);
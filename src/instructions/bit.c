@@ -22,9 +22,9 @@
  */
 void rlca(gameboy *gb)
 {
-    uint8_t bit_seven = (gb->cpu->reg->a >> 7) & 1;
-    gb->cpu->reg->a = (gb->cpu->reg->a << 1) | bit_seven;
-    set_flags(gb->cpu->reg, 0, 0, 0, bit_seven);
+    uint8_t bit_seven = (gb->cpu.reg.a >> 7) & 1;
+    gb->cpu.reg.a = (gb->cpu.reg.a << 1) | bit_seven;
+    set_flags(&gb->cpu.reg, 0, 0, 0, bit_seven);
 
     LOG_DEBUG("RLCA\n");
 }
@@ -44,9 +44,9 @@ void rlca(gameboy *gb)
  */
 void rla(gameboy *gb)
 {
-    uint8_t bit_seven = (gb->cpu->reg->a >> 7) & 1;
-    gb->cpu->reg->a = (gb->cpu->reg->a << 1) | read_carry_flag(gb->cpu->reg);
-    set_flags(gb->cpu->reg, 0, 0, 0, bit_seven);
+    uint8_t bit_seven = (gb->cpu.reg.a >> 7) & 1;
+    gb->cpu.reg.a = (gb->cpu.reg.a << 1) | read_carry_flag(&gb->cpu.reg);
+    set_flags(&gb->cpu.reg, 0, 0, 0, bit_seven);
 
     LOG_DEBUG("RLA\n");
 }
@@ -65,9 +65,9 @@ void rla(gameboy *gb)
  */
 void rrca(gameboy *gb)
 {
-    uint8_t bit_zero = gb->cpu->reg->a & 1;
-    gb->cpu->reg->a = (bit_zero << 7) | (gb->cpu->reg->a >> 1);
-    set_flags(gb->cpu->reg, 0, 0, 0, bit_zero);
+    uint8_t bit_zero = gb->cpu.reg.a & 1;
+    gb->cpu.reg.a = (bit_zero << 7) | (gb->cpu.reg.a >> 1);
+    set_flags(&gb->cpu.reg, 0, 0, 0, bit_zero);
 
     LOG_DEBUG("RRCA\n");
 }
@@ -87,9 +87,9 @@ void rrca(gameboy *gb)
  */
 void rra(gameboy *gb)
 {
-    uint8_t bit_zero = gb->cpu->reg->a & 1;
-    gb->cpu->reg->a = (read_carry_flag(gb->cpu->reg) << 7) | (gb->cpu->reg->a >> 1);
-    set_flags(gb->cpu->reg, 0, 0, 0, bit_zero);
+    uint8_t bit_zero = gb->cpu.reg.a & 1;
+    gb->cpu.reg.a = (read_carry_flag(&gb->cpu.reg) << 7) | (gb->cpu.reg.a >> 1);
+    set_flags(&gb->cpu.reg, 0, 0, 0, bit_zero);
 
     LOG_DEBUG("RRA\n");
 }
@@ -105,31 +105,31 @@ static uint8_t *fetch_register(gameboy *gb, enum operands op, const char *inst_s
     switch (op)
     {
         case REG_A:
-            reg = &(gb->cpu->reg->a);
+            reg = &(gb->cpu.reg.a);
             break;
 
         case REG_B:
-            reg = &(gb->cpu->reg->b);
+            reg = &(gb->cpu.reg.b);
             break;
 
         case REG_C:
-            reg = &(gb->cpu->reg->c);
+            reg = &(gb->cpu.reg.c);
             break;
 
         case REG_D:
-            reg = &(gb->cpu->reg->d);
+            reg = &(gb->cpu.reg.d);
             break;
 
         case REG_E:
-            reg = &(gb->cpu->reg->e);
+            reg = &(gb->cpu.reg.e);
             break;
 
         case REG_H:
-            reg = &(gb->cpu->reg->h);
+            reg = &(gb->cpu.reg.h);
             break;
 
         case REG_L:
-            reg = &(gb->cpu->reg->l);
+            reg = &(gb->cpu.reg.l);
             break;
 
         default: // shouldn't get here
@@ -167,13 +167,14 @@ void rlc(gameboy *gb, gb_instruction *inst)
     if (inst->op1 == PTR_HL)
     {
         // value to rotate from memory
-        uint16_t addr = read_hl(gb->cpu->reg);
+        uint16_t addr = gb->cpu.reg.hl;
         uint8_t val = read_byte(gb, addr);
 
         // rotate and set flags
         bit_seven = (val >> 7) & 1;
-        write_byte(gb, addr, (val << 1) | bit_seven);
-        set_flags(gb->cpu->reg, ((val << 1) | bit_seven) == 0, 0, 0, bit_seven);
+        uint8_t new_val = (val << 1) | bit_seven;
+        write_byte(gb, addr, new_val);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, new_val | bit_seven << 8);
     }
     else
     {
@@ -182,7 +183,7 @@ void rlc(gameboy *gb, gb_instruction *inst)
         // perform the rotation and set flags
         bit_seven = (*reg >> 7) & 1;
         *reg = (*reg << 1) | bit_seven;
-        set_flags(gb->cpu->reg, *reg == 0, 0, 0, bit_seven);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, *reg | bit_seven << 8);
     }
 
     LOG_DEBUG("%s %s\n", inst->inst_str, operand_strs[inst->op1]);
@@ -216,13 +217,14 @@ void rrc(gameboy *gb, gb_instruction *inst)
     if (inst->op1 == PTR_HL)
     {
         // value to rotate from memory
-        uint16_t addr = read_hl(gb->cpu->reg);
+        uint16_t addr = gb->cpu.reg.hl;
         uint8_t val = read_byte(gb, addr);
 
         // rotate and set flags
         bit_zero = val & 1;
-        write_byte(gb, addr, (bit_zero << 7) | (val >> 1));
-        set_flags(gb->cpu->reg, ((bit_zero << 7) | (val >> 1)) == 0, 0, 0, bit_zero);
+        uint8_t new_val = (bit_zero << 7) | (val >> 1);
+        write_byte(gb, addr, new_val);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, new_val | bit_zero << 8);
     }
     else
     {
@@ -231,7 +233,7 @@ void rrc(gameboy *gb, gb_instruction *inst)
         // perform the rotation and set flags
         bit_zero = *reg & 1;
         *reg = (bit_zero << 7) | (*reg >> 1);
-        set_flags(gb->cpu->reg, *reg == 0, 0, 0, bit_zero);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, *reg | bit_zero << 8);
     }
 
     LOG_DEBUG("%s %s\n", inst->inst_str, operand_strs[inst->op1]);
@@ -262,20 +264,20 @@ void rrc(gameboy *gb, gb_instruction *inst)
 void rl(gameboy *gb, gb_instruction *inst)
 {
     uint8_t bit_seven,
-            carry = read_carry_flag(gb->cpu->reg);
+            carry = read_carry_flag(&gb->cpu.reg);
 
     // handle PTR_HL separately, since we need to read from memory
     if (inst->op1 == PTR_HL)
     {
         // value to rotate from memory
-        uint16_t addr = read_hl(gb->cpu->reg);
+        uint16_t addr = gb->cpu.reg.hl;
         uint8_t val = read_byte(gb, addr);
 
         // rotate and set flags
         uint8_t new_val = (val << 1) | carry;
         bit_seven = (val >> 7) & 1;
         write_byte(gb, addr, new_val);
-        set_flags(gb->cpu->reg, new_val == 0, 0, 0, bit_seven);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, new_val | bit_seven << 8);
     }
     else
     {
@@ -284,7 +286,7 @@ void rl(gameboy *gb, gb_instruction *inst)
         // perform the rotation and set flags
         bit_seven = (*reg >> 7) & 1;
         *reg = (*reg << 1) | carry;
-        set_flags(gb->cpu->reg, *reg == 0, 0, 0, bit_seven);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, *reg | bit_seven << 8);
     }
 
     LOG_DEBUG("%s %s\n", inst->inst_str, operand_strs[inst->op1]);
@@ -315,19 +317,20 @@ void rl(gameboy *gb, gb_instruction *inst)
 void rr(gameboy *gb, gb_instruction *inst)
 {
     uint8_t bit_zero,
-            carry = read_carry_flag(gb->cpu->reg);
+            carry = read_carry_flag(&gb->cpu.reg);
 
     // handle PTR_HL separately, since we need to read from memory
     if (inst->op1 == PTR_HL)
     {
         // value to rotate from memory
-        uint16_t addr = read_hl(gb->cpu->reg);
+        uint16_t addr = gb->cpu.reg.hl;
         uint8_t val = read_byte(gb, addr);
 
         // rotate and set flags
         bit_zero = val & 1;
-        write_byte(gb, addr, (carry << 7) | (val >> 1));
-        set_flags(gb->cpu->reg, ((carry << 7) | (val >> 1)) == 0, 0, 0, bit_zero);
+        uint8_t new_val = (carry << 7) | (val >> 1);
+        write_byte(gb, addr, new_val);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, new_val | bit_zero << 8);
     }
     else
     {
@@ -336,7 +339,7 @@ void rr(gameboy *gb, gb_instruction *inst)
         // perform the rotation and set flags
         bit_zero = *reg & 1;
         *reg = (carry << 7) | (*reg >> 1);
-        set_flags(gb->cpu->reg, *reg == 0, 0, 0, bit_zero);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, *reg | bit_zero << 8);
     }
 
     LOG_DEBUG("%s %s\n", inst->inst_str, operand_strs[inst->op1]);
@@ -370,14 +373,14 @@ void sla(gameboy *gb, gb_instruction *inst)
     if (inst->op1 == PTR_HL)
     {
         // value to shift from memory
-        uint16_t addr = read_hl(gb->cpu->reg);
+        uint16_t addr = gb->cpu.reg.hl;
         uint8_t val = read_byte(gb, addr);
 
         // Shift and set flags. Note that bit zero is reset by the left shift
         uint8_t new_val = val << 1;
         bit_seven = (val >> 7) & 1;
         write_byte(gb, addr, new_val);
-        set_flags(gb->cpu->reg, new_val == 0, 0, 0, bit_seven);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, new_val | bit_seven << 8);
     }
     else
     {
@@ -387,7 +390,7 @@ void sla(gameboy *gb, gb_instruction *inst)
         // Note that bit zero is reset by the left shift
         bit_seven = (*reg >> 7) & 1;
         *reg <<= 1;
-        set_flags(gb->cpu->reg, *reg == 0, 0, 0, bit_seven);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, *reg | bit_seven << 8);
     }
 
     LOG_DEBUG("%s %s\n", inst->inst_str, operand_strs[inst->op1]);
@@ -422,13 +425,14 @@ void sra(gameboy *gb, gb_instruction *inst)
     if (inst->op1 == PTR_HL)
     {
         // value to shift from memory
-        uint16_t addr = read_hl(gb->cpu->reg);
+        uint16_t addr = gb->cpu.reg.hl;
         uint8_t val = read_byte(gb, addr);
 
         // Shift and set flags.
         bit_zero = val & 1;
-        write_byte(gb, addr, (val & 0x80) | (val >> 1));
-        set_flags(gb->cpu->reg, ((val & 0x80) | (val >> 1)) == 0, 0, 0, bit_zero);
+        uint8_t new_val = (val & 0x80) | (val >> 1);
+        write_byte(gb, addr, new_val);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, new_val | bit_zero << 8);
     }
     else
     {
@@ -437,7 +441,7 @@ void sra(gameboy *gb, gb_instruction *inst)
         // Perform the shift and set flags.
         bit_zero = *reg & 1;
         *reg = (*reg & 0x80) | (*reg >> 1);
-        set_flags(gb->cpu->reg, *reg == 0, 0, 0, bit_zero);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, *reg | bit_zero << 8);
     }
 
     LOG_DEBUG("%s %s\n", inst->inst_str, operand_strs[inst->op1]);
@@ -471,13 +475,14 @@ void srl(gameboy *gb, gb_instruction *inst)
     if (inst->op1 == PTR_HL)
     {
         // value to shift from memory
-        uint16_t addr = read_hl(gb->cpu->reg);
+        uint16_t addr = gb->cpu.reg.hl;
         uint8_t val = read_byte(gb, addr);
 
         // Shift and set flags. Bit seven reset by the shift
         bit_zero = val & 1;
-        write_byte(gb, addr, val >> 1);
-        set_flags(gb->cpu->reg, val >> 1 == 0, 0, 0, bit_zero);
+        uint8_t new_val = val >> 1;
+        write_byte(gb, addr, new_val);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, new_val | bit_zero << 8);
     }
     else
     {
@@ -487,7 +492,7 @@ void srl(gameboy *gb, gb_instruction *inst)
         // Bit seven is reset by the shift.
         bit_zero = *reg & 1;
         *reg >>= 1;
-        set_flags(gb->cpu->reg, *reg == 0, 0, 0, bit_zero);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, *reg | bit_zero << 8);
     }
 
     LOG_DEBUG("%s %s\n", inst->inst_str, operand_strs[inst->op1]);
@@ -519,13 +524,13 @@ void swap(gameboy *gb, gb_instruction *inst)
     if (inst->op1 == PTR_HL)
     {
         // value to swap from memory
-        uint16_t addr = read_hl(gb->cpu->reg);
+        uint16_t addr = gb->cpu.reg.hl;
         uint8_t val = read_byte(gb, addr);
 
         // swap nibbles
         uint8_t result = (val << 4) | (val >> 4);
         write_byte(gb, addr, result);
-        set_flags(gb->cpu->reg, result == 0, 0, 0, 0);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, result);
     }
     else
     {
@@ -533,7 +538,7 @@ void swap(gameboy *gb, gb_instruction *inst)
 
         // swap nibbles
         *reg = (*reg << 4) | (*reg >> 4);
-        set_flags(gb->cpu->reg, *reg == 0, 0, 0, 0);
+        set_lazy_flags(&gb->cpu.reg, LAZY_LOGIC, 0, 0, *reg);
     }
 
     LOG_DEBUG("%s %s\n", inst->inst_str, operand_strs[inst->op1]);
@@ -570,38 +575,38 @@ void bit(gameboy *gb, gb_instruction *inst)
     // handle PTR_HL separately, since we need to read from memory
     if (inst->op2 == PTR_HL)
     {
-        value = read_byte(gb, read_hl(gb->cpu->reg));
+        value = read_byte(gb, gb->cpu.reg.hl);
     }
     else
     {
         switch (inst->op2)
         {
             case REG_A:
-                value = gb->cpu->reg->a;
+                value = gb->cpu.reg.a;
                 break;
 
             case REG_B:
-                value = gb->cpu->reg->b;
+                value = gb->cpu.reg.b;
                 break;
 
             case REG_C:
-                value = gb->cpu->reg->c;
+                value = gb->cpu.reg.c;
                 break;
 
             case REG_D:
-                value = gb->cpu->reg->d;
+                value = gb->cpu.reg.d;
                 break;
 
             case REG_E:
-                value = gb->cpu->reg->e;
+                value = gb->cpu.reg.e;
                 break;
 
             case REG_H:
-                value = gb->cpu->reg->h;
+                value = gb->cpu.reg.h;
                 break;
 
             case REG_L:
-                value = gb->cpu->reg->l;
+                value = gb->cpu.reg.l;
                 break;
 
             default: // shouldn't get here
@@ -610,9 +615,7 @@ void bit(gameboy *gb, gb_instruction *inst)
         }
     }
 
-    set_zero_flag(gb->cpu->reg, (value & (1 << bit_number)) == 0);
-    set_subtract_flag(gb->cpu->reg, 0);
-    set_half_carry_flag(gb->cpu->reg, 1);
+    set_lazy_flags(&gb->cpu.reg, LAZY_BIT, 0, 0, value & (1 << bit_number));
 
     LOG_DEBUG("%s %s, %s\n", inst->inst_str, operand_strs[inst->op1], operand_strs[inst->op2]);
 }
@@ -640,7 +643,7 @@ void res(gameboy *gb, gb_instruction *inst)
     // handle PTR_HL separately, since we read from memory
     if (inst->op2 == PTR_HL)
     {
-        uint16_t addr = read_hl(gb->cpu->reg);
+        uint16_t addr = gb->cpu.reg.hl;
         uint8_t value = read_byte(gb, addr);
         write_byte(gb, addr, value & ~(1 << bit_number));
     }
@@ -676,7 +679,7 @@ void set(gameboy *gb, gb_instruction *inst)
     // handle PTR_HL separately, since we read from memory
     if (inst->op2 == PTR_HL)
     {
-        uint16_t addr = read_hl(gb->cpu->reg);
+        uint16_t addr = gb->cpu.reg.hl;
         uint8_t value = read_byte(gb, addr);
         write_byte(gb, addr, value | (1 << bit_number));
     }
@@ -597,19 +597,25 @@ uint8_t execute_instruction(gameboy *gb)
 
     // if an interrupt is pending, service it
     // instead of executing the next instruction
-    curr_inst_duration = service_interrupt(gb);
-    if (curr_inst_duration)
-        goto interrupt_serviced;
+    if (gb->cpu.interrupt_serviceable)
+    {
+        curr_inst_duration = service_interrupt(gb);
+        goto instruction_done;
+    }
 
     uint8_t inst_code;
-    if (!gb->cpu->halt_bug)
+    if (!gb->cpu.halt_bug)
     {
-        inst_code = read_byte(gb, (gb->cpu->reg->pc)++);
+        inst_code = fetch_byte(gb);
+
+        if (superinstruction_starts[inst_code]
+            && run_superinstruction(gb, inst_code, &curr_inst_duration))
+            goto instruction_done;
     }
     else // HALT bug. PC fails to be incremented once
     {
-        inst_code = read_byte(gb, gb->cpu->reg->pc);
-        gb->cpu->halt_bug = false;
+        inst_code = read_byte(gb, gb->cpu.reg.pc);
+        gb->cpu.halt_bug = false;
     }
 
     gb_instruction inst = instruction_table[inst_code];
@@ -627,7 +633,7 @@ uint8_t execute_instruction(gameboy *gb)
     if (inst.opcode == PREFIX)
     {
         // read the prefixed instruction code and access instruction
-        inst_code = read_byte(gb, (gb->cpu->reg->pc)++);
+        inst_code = fetch_byte(gb);
         inst = instruction_table[0x100 + inst_code];
     }
 
@@ -866,15 +872,16 @@ uint8_t execute_instruction(gameboy *gb)
             exit(1);
     }
 
-interrupt_serviced:
+instruction_done:
     /* Check if the IME flag needs to be set after
      * an EI instruction. The IME is set after the
      * instruction following the EI.
      */
-    if (gb->cpu->ime_delayed_set)
+    if (gb->cpu.ime_delayed_set)
     {
-        gb->cpu->ime_flag = true;
-        gb->cpu->ime_delayed_set = false;
+        gb->cpu.ime_flag = true;
+        gb->cpu.ime_delayed_set = false;
+        update_interrupt_state(&gb->cpu);
     }
 
     return curr_inst_duration;
@@ -1,6 +1,7 @@
 #ifndef INSTRUCTIONS_EXECUTE_H
 #define INSTRUCTIONS_EXECUTE_H
 
+#include <stdbool.h>
 #include "cboy/gameboy.h"
 #include "cboy/instructions.h"
 
@@ -47,6 +48,16 @@ void bit(gameboy *gb, gb_instruction *inst);
 void res(gameboy *gb, gb_instruction *inst);
 void set(gameboy *gb, gb_instruction *inst);
 
+/* Superinstructions (see fused.c). Given the opcode just fetched,
+ * runs it along with the instructions after it as one, setting
+ * duration to their combined m-cycles. Returns false if they
+ * can't be fused, in which case nothing has been executed.
+ */
+bool run_superinstruction(gameboy *gb, uint8_t opcode, uint8_t *duration);
+
+// the superinstruction starting with each opcode (0 if none)
+extern const uint8_t superinstruction_starts[256];
+
 // miscellaneous instructions
 void ei(gameboy *gb);
 void di(gameboy *gb);
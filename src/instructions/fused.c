@@ -0,0 +1,221 @@
+/* Superinstructions
+ * ~~~~~~~~~~~~~~~~~
+ * A few short instruction sequences make up most of the time spent
+ * in common loops, such as copying memory or counting down. When the
+ * decoder fetches the first opcode of one of these sequences and the
+ * rest of the sequence follows it, the whole sequence is run by one
+ * handler and its combined duration is returned, so the game loop
+ * only steps the rest of the emulator once for all of it.
+ *
+ * That's only the same as running the instructions one at a time if
+ * nothing could have happened between them, so a sequence is only
+ * fused when, for its whole duration:
+ *  - the PPU doesn't change modes or lines and the timer doesn't
+ *    overflow, so no interrupt can be requested (or serviced), no
+ *    scanline is rendered, and no HBLANK DMA is copied partway through,
+ *  - no OAM DMA is in progress and no EI takes effect,
+ *  - it only accesses memory whose contents don't depend on exactly
+ *    when it's accessed: ROM, VRAM, WRAM, OAM, and HRAM, and it
+ *    doesn't overwrite itself.
+ * Otherwise its instructions are executed one at a time as usual.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "cboy/instructions.h"
+#include "cboy/gameboy.h"
+#include "cboy/cpu.h"
+#include "cboy/memory.h"
+#include "cboy/log.h"
+#include "execute.h"
+
+/* Read a byte of code without side effects. Only possible
+ * within the page instructions are being fetched from.
+ */
+static bool peek_code(gameboy *gb, uint16_t address, uint8_t *value)
+{
+    uint16_t offset = address - gb->fetch_start;
+    if (offset >= gb->fetch_size)
+        return false;
+
+    *value = gb->fetch_page[offset];
+    return true;
+}
+
+// memory which reads the same no matter when it's read during the sequence
+static bool is_quiet_read(uint16_t address)
+{
+    return address <= 0x9fff                           // ROM, VRAM
+           || (address >= 0xc000 && address <= 0xfe9f)  // WRAM, ECHO RAM, OAM
+           || (address >= 0xff80 && address <= 0xfffe); // HRAM
+}
+
+// memory which nothing else looks at during the sequence
+static bool is_quiet_write(uint16_t address)
+{
+    return (address >= 0x8000 && address <= 0x9fff)    // VRAM
+           || (address >= 0xc000 && address <= 0xdfff) // WRAM
+           || (address >= 0xfe00 && address <= 0xfe9f) // OAM
+           || (address >= 0xff80 && address <= 0xfffe); // HRAM
+}
+
+/* Whether nothing outside of the CPU can happen in the next given
+ * number of m-cycles: the PPU only changes modes or lines (possibly
+ * requesting an interrupt, rendering a scanline, or presenting a
+ * frame) when its scanline clock reaches 0, 1 (where the new line's
+ * mode takes effect), 81, or 169, TIMA can only request an
+ * interrupt when it overflows, at most once every 16 clocks, and
+ * a serial transfer this Game Boy clocks only when it completes.
+ */
+static bool is_quiet_for(gameboy *gb, uint8_t m_cycles)
+{
+    uint16_t clocks = 4 * m_cycles;
+    if ((gb->tac & 0x4) && gb->tima + (clocks + 15) / 16 > 0xff)
+        return false;
+
+    if (gb->serial_clocks && gb->serial_clocks <= clocks)
+        return false;
+
+    if (!((gb->ppu->lcdc >> 7) & 1))
+        return true;
+
+    uint16_t dots = IS_CGB_MODE(gb) && gb->double_speed ? clocks / 2 : clocks;
+    uint16_t scanline_clock = gb->ppu->dot_clock % 456;
+    if (scanline_clock < 81)
+        return scanline_clock > 0 && scanline_clock + dots < 81;
+    else if (scanline_clock < 169)
+        return scanline_clock + dots < 169;
+    else
+        return scanline_clock + dots < 456;
+}
+
+/* LD A, [HL+]
+ * LD [DE], A
+ * INC DE
+ */
+static uint8_t copy_hl_to_de(gameboy *gb)
+{
+    uint16_t start = gb->cpu.reg.pc - 1;
+    uint16_t hl = gb->cpu.reg.hl;
+    uint16_t de = gb->cpu.reg.de;
+
+    // the write can't land on the sequence's own code
+    if (!is_quiet_read(hl) || !is_quiet_write(de) || (uint16_t)(de - start) < 3)
+        return 0;
+
+    gb->cpu.reg.pc += 2;
+    gb->cpu.reg.a = read_byte(gb, hl);
+    gb->cpu.reg.hl = hl + 1;
+    write_byte(gb, de, gb->cpu.reg.a);
+    gb->cpu.reg.de = de + 1;
+
+    LOG_DEBUG("LD A, [HL+]; LD [DE], A; INC DE\n");
+    return 2 + 2 + 2;
+}
+
+/* DEC r8
+ * JR NZ, e8
+ */
+static uint8_t count_down(gameboy *gb, uint8_t *reg)
+{
+    ++gb->cpu.reg.pc; // JR NZ
+    int8_t offset = (int8_t)fetch_byte(gb);
+
+    --(*reg);
+    set_lazy_flags(&gb->cpu.reg, LAZY_DEC, 0, 0, *reg);
+
+    LOG_DEBUG("DEC r8; JR NZ, 0x%02x\n", (uint8_t)offset);
+    if (*reg)
+    {
+        gb->cpu.reg.pc = (int32_t)gb->cpu.reg.pc + (int32_t)offset;
+        return 1 + 3;
+    }
+
+    return 1 + 2;
+}
+
+static uint8_t count_down_b(gameboy *gb)
+{
+    return count_down(gb, &gb->cpu.reg.b);
+}
+
+static uint8_t count_down_c(gameboy *gb)
+{
+    return count_down(gb, &gb->cpu.reg.c);
+}
+
+/* LD A, [n16]
+ * AND n8
+ */
+static uint8_t load_and_mask(gameboy *gb)
+{
+    uint16_t pc = gb->cpu.reg.pc;
+    uint8_t lo, hi, mask;
+
+    if (!peek_code(gb, pc, &lo) || !peek_code(gb, pc + 1, &hi) || !peek_code(gb, pc + 3, &mask))
+        return 0;
+
+    uint16_t addr = (uint16_t)(hi << 8) | lo;
+    if (!is_quiet_read(addr))
+        return 0;
+
+    gb->cpu.reg.pc = pc + 4;
+    gb->cpu.reg.a = read_byte(gb, addr) & mask;
+    set_lazy_flags(&gb->cpu.reg, LAZY_AND, 0, 0, gb->cpu.reg.a);
+
+    LOG_DEBUG("LD A, [0x%04x]; AND A, 0x%02x\n", addr, mask);
+    return 4 + 2;
+}
+
+#define MAX_SUPERINSTRUCTION_LENGTH 3
+
+typedef struct gb_superinstruction {
+    uint8_t length; // in instructions
+    uint8_t opcodes[MAX_SUPERINSTRUCTION_LENGTH];
+    // address of each opcode relative to the first
+    uint8_t offsets[MAX_SUPERINSTRUCTION_LENGTH];
+
+    // the longest the sequence can take, in m-cycles
+    uint8_t max_duration;
+
+    /* Runs the sequence, with PC just past the first opcode.
+     * Returns its duration in m-cycles, or 0 (before doing
+     * anything) if it can't be fused.
+     */
+    uint8_t (*run)(gameboy *gb);
+} gb_superinstruction;
+
+// index 0 is reserved to mean no superinstruction
+static const gb_superinstruction superinstructions[] = {
+    [1] = {3, {0x2a, 0x12, 0x13}, {0, 1, 2}, 6, copy_hl_to_de},
+    [2] = {2, {0x05, 0x20}, {0, 1}, 4, count_down_b},
+    [3] = {2, {0x0d, 0x20}, {0, 1}, 4, count_down_c},
+    [4] = {2, {0xfa, 0xe6}, {0, 3}, 6, load_and_mask},
+};
+
+const uint8_t superinstruction_starts[256] = {
+    [0x2a] = 1,
+    [0x05] = 2,
+    [0x0d] = 3,
+    [0xfa] = 4,
+};
+
+bool run_superinstruction(gameboy *gb, uint8_t opcode, uint8_t *duration)
+{
+    const gb_superinstruction *super = &superinstructions[superinstruction_starts[opcode]];
+
+    if (gb->cpu.ime_delayed_set || gb->dma_requested
+        || !is_quiet_for(gb, super->max_duration))
+        return false;
+
+    uint16_t start = gb->cpu.reg.pc - 1; // the opcode was just fetched
+
+    for (uint8_t i = 1; i < super->length; ++i)
+    {
+        uint8_t next;
+        if (!peek_code(gb, start + super->offsets[i], &next) || next != super->opcodes[i])
+            return false;
+    }
+
+    *duration = super->run(gb);
+    return *duration != 0;
+}
@@ -19,7 +19,7 @@ void ld(gameboy *gb, gb_instruction *inst)
             switch (inst->op2)
             {
                 case REG_A:
-                    gb->cpu->reg->a = gb->cpu->reg->a;
+                    gb->cpu.reg.a = gb->cpu.reg.a;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -27,7 +27,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_B:
-                    gb->cpu->reg->a = gb->cpu->reg->b;
+                    gb->cpu.reg.a = gb->cpu.reg.b;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -35,7 +35,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_C:
-                    gb->cpu->reg->a = gb->cpu->reg->c;
+                    gb->cpu.reg.a = gb->cpu.reg.c;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -43,7 +43,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_D:
-                    gb->cpu->reg->a = gb->cpu->reg->d;
+                    gb->cpu.reg.a = gb->cpu.reg.d;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -51,7 +51,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_E:
-                    gb->cpu->reg->a = gb->cpu->reg->e;
+                    gb->cpu.reg.a = gb->cpu.reg.e;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -59,7 +59,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_H:
-                    gb->cpu->reg->a = gb->cpu->reg->h;
+                    gb->cpu.reg.a = gb->cpu.reg.h;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -67,7 +67,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_L:
-                    gb->cpu->reg->a = gb->cpu->reg->l;
+                    gb->cpu.reg.a = gb->cpu.reg.l;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -75,7 +75,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case PTR_BC:
-                    gb->cpu->reg->a = read_byte(gb, read_bc(gb->cpu->reg));
+                    gb->cpu.reg.a = read_byte(gb, gb->cpu.reg.bc);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -83,7 +83,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case PTR_DE:
-                    gb->cpu->reg->a = read_byte(gb, read_de(gb->cpu->reg));
+                    gb->cpu.reg.a = read_byte(gb, gb->cpu.reg.de);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -91,7 +91,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case PTR_HL:
-                    gb->cpu->reg->a = read_byte(gb, read_hl(gb->cpu->reg));
+                    gb->cpu.reg.a = read_byte(gb, gb->cpu.reg.hl);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -100,10 +100,10 @@ void ld(gameboy *gb, gb_instruction *inst)
 
                 case PTR_HL_INC:
                 {
-                    uint16_t hl = read_hl(gb->cpu->reg);
-                    gb->cpu->reg->a = read_byte(gb, hl);
+                    uint16_t hl = gb->cpu.reg.hl;
+                    gb->cpu.reg.a = read_byte(gb, hl);
                     // increment HL register after loading value it points to
-                    write_hl(gb->cpu->reg, hl + 1);
+                    gb->cpu.reg.hl = hl + 1;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -113,10 +113,10 @@ void ld(gameboy *gb, gb_instruction *inst)
 
                 case PTR_HL_DEC:
                 {
-                    uint16_t hl = read_hl(gb->cpu->reg);
-                    gb->cpu->reg->a = read_byte(gb, hl);
+                    uint16_t hl = gb->cpu.reg.hl;
+                    gb->cpu.reg.a = read_byte(gb, hl);
                     // decrement HL register after loading value it points to
-                    write_hl(gb->cpu->reg, hl - 1);
+                    gb->cpu.reg.hl = hl - 1;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -127,8 +127,8 @@ void ld(gameboy *gb, gb_instruction *inst)
                 case IMM_8:
                 {
                     // load immediate value
-                    uint8_t val = read_byte(gb, (gb->cpu->reg->pc)++);
-                    gb->cpu->reg->a = val;
+                    uint8_t val = fetch_byte(gb);
+                    gb->cpu.reg.a = val;
 
                     LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], val);
                     break;
@@ -136,14 +136,9 @@ void ld(gameboy *gb, gb_instruction *inst)
 
                 case PTR_16:
                 {
-                    // load 16-bit immediate value
-                    // NOTE: little-endian
-                    uint8_t lo = read_byte(gb, (gb->cpu->reg->pc)++);
-                    uint8_t hi = read_byte(gb, (gb->cpu->reg->pc)++);
-
-                    // use this value as a pointer
-                    uint16_t addr = ((uint16_t)hi << 8) | ((uint16_t)lo);
-                    gb->cpu->reg->a = read_byte(gb, addr);
+                    // load 16-bit immediate value and use it as a pointer
+                    uint16_t addr = fetch_word(gb);
+                    gb->cpu.reg.a = read_byte(gb, addr);
 
                     LOG_DEBUG("%s %s, [0x%04x]\n", inst->inst_str, operand_strs[inst->op1], addr);
                     break;
@@ -159,7 +154,7 @@ void ld(gameboy *gb, gb_instruction *inst)
             switch (inst->op2)
             {
                 case REG_A:
-                    gb->cpu->reg->b = gb->cpu->reg->a;
+                    gb->cpu.reg.b = gb->cpu.reg.a;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -167,7 +162,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_B:
-                    gb->cpu->reg->b = gb->cpu->reg->b;
+                    gb->cpu.reg.b = gb->cpu.reg.b;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -175,7 +170,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_C:
-                    gb->cpu->reg->b = gb->cpu->reg->c;
+                    gb->cpu.reg.b = gb->cpu.reg.c;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -183,7 +178,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_D:
-                    gb->cpu->reg->b = gb->cpu->reg->d;
+                    gb->cpu.reg.b = gb->cpu.reg.d;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -191,7 +186,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_E:
-                    gb->cpu->reg->b = gb->cpu->reg->e;
+                    gb->cpu.reg.b = gb->cpu.reg.e;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -199,7 +194,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_H:
-                    gb->cpu->reg->b = gb->cpu->reg->h;
+                    gb->cpu.reg.b = gb->cpu.reg.h;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -207,7 +202,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_L:
-                    gb->cpu->reg->b = gb->cpu->reg->l;
+                    gb->cpu.reg.b = gb->cpu.reg.l;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -215,7 +210,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case PTR_HL:
-                    gb->cpu->reg->b = read_byte(gb, read_hl(gb->cpu->reg));
+                    gb->cpu.reg.b = read_byte(gb, gb->cpu.reg.hl);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -224,8 +219,8 @@ void ld(gameboy *gb, gb_instruction *inst)
 
                 case IMM_8:
                 {
-                    uint8_t val = read_byte(gb, (gb->cpu->reg->pc)++);
-                    gb->cpu->reg->b = val;
+                    uint8_t val = fetch_byte(gb);
+                    gb->cpu.reg.b = val;
 
                     LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], val);
                     break;
@@ -241,7 +236,7 @@ void ld(gameboy *gb, gb_instruction *inst)
             switch (inst->op2)
             {
                 case REG_A:
-                    gb->cpu->reg->c = gb->cpu->reg->a;
+                    gb->cpu.reg.c = gb->cpu.reg.a;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -249,7 +244,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_B:
-                    gb->cpu->reg->c = gb->cpu->reg->b;
+                    gb->cpu.reg.c = gb->cpu.reg.b;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -257,7 +252,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_C:
-                    gb->cpu->reg->c = gb->cpu->reg->c;
+                    gb->cpu.reg.c = gb->cpu.reg.c;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -265,7 +260,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_D:
-                    gb->cpu->reg->c = gb->cpu->reg->d;
+                    gb->cpu.reg.c = gb->cpu.reg.d;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -273,7 +268,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_E:
-                    gb->cpu->reg->c = gb->cpu->reg->e;
+                    gb->cpu.reg.c = gb->cpu.reg.e;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -281,7 +276,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_H:
-                    gb->cpu->reg->c = gb->cpu->reg->h;
+                    gb->cpu.reg.c = gb->cpu.reg.h;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -289,7 +284,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_L:
-                    gb->cpu->reg->c = gb->cpu->reg->l;
+                    gb->cpu.reg.c = gb->cpu.reg.l;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -297,7 +292,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case PTR_HL:
-                    gb->cpu->reg->c = read_byte(gb, read_hl(gb->cpu->reg));
+                    gb->cpu.reg.c = read_byte(gb, gb->cpu.reg.hl);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -306,8 +301,8 @@ void ld(gameboy *gb, gb_instruction *inst)
 
                 case IMM_8:
                 {
-                    uint8_t val = read_byte(gb, (gb->cpu->reg->pc)++);
-                    gb->cpu->reg->c = val;
+                    uint8_t val = fetch_byte(gb);
+                    gb->cpu.reg.c = val;
 
                     LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], val);
                     break;
@@ -323,7 +318,7 @@ void ld(gameboy *gb, gb_instruction *inst)
             switch (inst->op2)
             {
                 case REG_A:
-                    gb->cpu->reg->d = gb->cpu->reg->a;
+                    gb->cpu.reg.d = gb->cpu.reg.a;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -331,7 +326,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_B:
-                    gb->cpu->reg->d = gb->cpu->reg->b;
+                    gb->cpu.reg.d = gb->cpu.reg.b;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -339,7 +334,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_C:
-                    gb->cpu->reg->d = gb->cpu->reg->c;
+                    gb->cpu.reg.d = gb->cpu.reg.c;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -347,7 +342,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_D:
-                    gb->cpu->reg->d = gb->cpu->reg->d;
+                    gb->cpu.reg.d = gb->cpu.reg.d;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -355,7 +350,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_E:
-                    gb->cpu->reg->d = gb->cpu->reg->e;
+                    gb->cpu.reg.d = gb->cpu.reg.e;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -363,7 +358,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_H:
-                    gb->cpu->reg->d = gb->cpu->reg->h;
+                    gb->cpu.reg.d = gb->cpu.reg.h;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -371,7 +366,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_L:
-                    gb->cpu->reg->d = gb->cpu->reg->l;
+                    gb->cpu.reg.d = gb->cpu.reg.l;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -379,7 +374,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case PTR_HL:
-                    gb->cpu->reg->d = read_byte(gb, read_hl(gb->cpu->reg));
+                    gb->cpu.reg.d = read_byte(gb, gb->cpu.reg.hl);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -388,8 +383,8 @@ void ld(gameboy *gb, gb_instruction *inst)
 
                 case IMM_8:
                 {
-                    uint8_t val = read_byte(gb, (gb->cpu->reg->pc)++);
-                    gb->cpu->reg->d = val;
+                    uint8_t val = fetch_byte(gb);
+                    gb->cpu.reg.d = val;
 
                     LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], val);
                     break;
@@ -405,7 +400,7 @@ void ld(gameboy *gb, gb_instruction *inst)
             switch (inst->op2)
             {
                 case REG_A:
-                    gb->cpu->reg->e = gb->cpu->reg->a;
+                    gb->cpu.reg.e = gb->cpu.reg.a;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -413,7 +408,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_B:
-                    gb->cpu->reg->e = gb->cpu->reg->b;
+                    gb->cpu.reg.e = gb->cpu.reg.b;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -421,7 +416,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_C:
-                    gb->cpu->reg->e = gb->cpu->reg->c;
+                    gb->cpu.reg.e = gb->cpu.reg.c;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -429,7 +424,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_D:
-                    gb->cpu->reg->e = gb->cpu->reg->d;
+                    gb->cpu.reg.e = gb->cpu.reg.d;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -437,7 +432,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_E:
-                    gb->cpu->reg->e = gb->cpu->reg->e;
+                    gb->cpu.reg.e = gb->cpu.reg.e;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -445,7 +440,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_H:
-                    gb->cpu->reg->e = gb->cpu->reg->h;
+                    gb->cpu.reg.e = gb->cpu.reg.h;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -453,7 +448,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_L:
-                    gb->cpu->reg->e = gb->cpu->reg->l;
+                    gb->cpu.reg.e = gb->cpu.reg.l;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -461,7 +456,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case PTR_HL:
-                    gb->cpu->reg->e = read_byte(gb, read_hl(gb->cpu->reg));
+                    gb->cpu.reg.e = read_byte(gb, gb->cpu.reg.hl);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -470,8 +465,8 @@ void ld(gameboy *gb, gb_instruction *inst)
 
                 case IMM_8:
                 {
-                    uint8_t val = read_byte(gb, (gb->cpu->reg->pc)++);
-                    gb->cpu->reg->e = val;
+                    uint8_t val = fetch_byte(gb);
+                    gb->cpu.reg.e = val;
 
                     LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], val);
                     break;
@@ -487,7 +482,7 @@ void ld(gameboy *gb, gb_instruction *inst)
             switch (inst->op2)
             {
                 case REG_A:
-                    gb->cpu->reg->h = gb->cpu->reg->a;
+                    gb->cpu.reg.h = gb->cpu.reg.a;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -495,7 +490,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_B:
-                    gb->cpu->reg->h = gb->cpu->reg->b;
+                    gb->cpu.reg.h = gb->cpu.reg.b;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -503,7 +498,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_C:
-                    gb->cpu->reg->h = gb->cpu->reg->c;
+                    gb->cpu.reg.h = gb->cpu.reg.c;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -511,7 +506,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_D:
-                    gb->cpu->reg->h = gb->cpu->reg->d;
+                    gb->cpu.reg.h = gb->cpu.reg.d;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -519,7 +514,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_E:
-                    gb->cpu->reg->h = gb->cpu->reg->e;
+                    gb->cpu.reg.h = gb->cpu.reg.e;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -527,7 +522,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_H:
-                    gb->cpu->reg->h = gb->cpu->reg->h;
+                    gb->cpu.reg.h = gb->cpu.reg.h;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -535,7 +530,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_L:
-                    gb->cpu->reg->h = gb->cpu->reg->l;
+                    gb->cpu.reg.h = gb->cpu.reg.l;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -543,7 +538,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case PTR_HL:
-                    gb->cpu->reg->h = read_byte(gb, read_hl(gb->cpu->reg));
+                    gb->cpu.reg.h = read_byte(gb, gb->cpu.reg.hl);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -552,8 +547,8 @@ void ld(gameboy *gb, gb_instruction *inst)
 
                 case IMM_8:
                 {
-                    uint8_t val = read_byte(gb, (gb->cpu->reg->pc)++);
-                    gb->cpu->reg->h = val;
+                    uint8_t val = fetch_byte(gb);
+                    gb->cpu.reg.h = val;
 
                     LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], val);
                     break;
@@ -569,7 +564,7 @@ void ld(gameboy *gb, gb_instruction *inst)
             switch (inst->op2)
             {
                 case REG_A:
-                    gb->cpu->reg->l = gb->cpu->reg->a;
+                    gb->cpu.reg.l = gb->cpu.reg.a;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -577,7 +572,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_B:
-                    gb->cpu->reg->l = gb->cpu->reg->b;
+                    gb->cpu.reg.l = gb->cpu.reg.b;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -585,7 +580,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_C:
-                    gb->cpu->reg->l = gb->cpu->reg->c;
+                    gb->cpu.reg.l = gb->cpu.reg.c;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -593,7 +588,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_D:
-                    gb->cpu->reg->l = gb->cpu->reg->d;
+                    gb->cpu.reg.l = gb->cpu.reg.d;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -601,7 +596,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_E:
-                    gb->cpu->reg->l = gb->cpu->reg->e;
+                    gb->cpu.reg.l = gb->cpu.reg.e;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -609,7 +604,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_H:
-                    gb->cpu->reg->l = gb->cpu->reg->h;
+                    gb->cpu.reg.l = gb->cpu.reg.h;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -617,7 +612,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_L:
-                    gb->cpu->reg->l = gb->cpu->reg->l;
+                    gb->cpu.reg.l = gb->cpu.reg.l;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -625,7 +620,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case PTR_HL:
-                    gb->cpu->reg->l = read_byte(gb, read_hl(gb->cpu->reg));
+                    gb->cpu.reg.l = read_byte(gb, gb->cpu.reg.hl);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -634,8 +629,8 @@ void ld(gameboy *gb, gb_instruction *inst)
 
                 case IMM_8:
                 {
-                    uint8_t val = read_byte(gb, (gb->cpu->reg->pc)++);
-                    gb->cpu->reg->l = val;
+                    uint8_t val = fetch_byte(gb);
+                    gb->cpu.reg.l = val;
 
                     LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], val);
                     break;
@@ -651,7 +646,7 @@ void ld(gameboy *gb, gb_instruction *inst)
             switch (inst->op2)
             {
                 case REG_A:
-                    write_byte(gb, read_hl(gb->cpu->reg), gb->cpu->reg->a);
+                    write_byte(gb, gb->cpu.reg.hl, gb->cpu.reg.a);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -659,7 +654,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_B:
-                    write_byte(gb, read_hl(gb->cpu->reg), gb->cpu->reg->b);
+                    write_byte(gb, gb->cpu.reg.hl, gb->cpu.reg.b);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -667,7 +662,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_C:
-                    write_byte(gb, read_hl(gb->cpu->reg), gb->cpu->reg->c);
+                    write_byte(gb, gb->cpu.reg.hl, gb->cpu.reg.c);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -675,7 +670,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_D:
-                    write_byte(gb, read_hl(gb->cpu->reg), gb->cpu->reg->d);
+                    write_byte(gb, gb->cpu.reg.hl, gb->cpu.reg.d);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -683,7 +678,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_E:
-                    write_byte(gb, read_hl(gb->cpu->reg), gb->cpu->reg->e);
+                    write_byte(gb, gb->cpu.reg.hl, gb->cpu.reg.e);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -691,7 +686,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_H:
-                    write_byte(gb, read_hl(gb->cpu->reg), gb->cpu->reg->h);
+                    write_byte(gb, gb->cpu.reg.hl, gb->cpu.reg.h);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -699,7 +694,7 @@ void ld(gameboy *gb, gb_instruction *inst)
                     break;
 
                 case REG_L:
-                    write_byte(gb, read_hl(gb->cpu->reg), gb->cpu->reg->l);
+                    write_byte(gb, gb->cpu.reg.hl, gb->cpu.reg.l);
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -709,8 +704,8 @@ void ld(gameboy *gb, gb_instruction *inst)
                 case IMM_8:
                 {
                     // store immediate value into byte pointed to by HL
-                    uint8_t value = read_byte(gb, (gb->cpu->reg->pc)++);
-                    write_byte(gb, read_hl(gb->cpu->reg), value);
+                    uint8_t value = fetch_byte(gb);
+                    write_byte(gb, gb->cpu.reg.hl, value);
 
                     LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], value);
                     break;
@@ -725,9 +720,9 @@ void ld(gameboy *gb, gb_instruction *inst)
         case PTR_HL_INC:
         {
             // store register A's value into [HL] then increment HL
-            uint16_t hl = read_hl(gb->cpu->reg);
-            write_byte(gb, hl, gb->cpu->reg->a);
-            write_hl(gb->cpu->reg, hl + 1);
+            uint16_t hl = gb->cpu.reg.hl;
+            write_byte(gb, hl, gb->cpu.reg.a);
+            gb->cpu.reg.hl = hl + 1;
 
             LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                       operand_strs[inst->op1],
@@ -738,9 +733,9 @@ void ld(gameboy *gb, gb_instruction *inst)
         case PTR_HL_DEC:
         {
             // store register A's value into [HL] then decrement HL
-            uint16_t hl = read_hl(gb->cpu->reg);
-            write_byte(gb, hl, gb->cpu->reg->a);
-            write_hl(gb->cpu->reg, hl - 1);
+            uint16_t hl = gb->cpu.reg.hl;
+            write_byte(gb, hl, gb->cpu.reg.a);
+            gb->cpu.reg.hl = hl - 1;
 
             LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                       operand_strs[inst->op1],
@@ -749,7 +744,7 @@ void ld(gameboy *gb, gb_instruction *inst)
         }
 
         case PTR_BC:
-            write_byte(gb, read_bc(gb->cpu->reg), gb->cpu->reg->a);
+            write_byte(gb, gb->cpu.reg.bc, gb->cpu.reg.a);
 
             LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                       operand_strs[inst->op1],
@@ -757,7 +752,7 @@ void ld(gameboy *gb, gb_instruction *inst)
             break;
 
         case PTR_DE:
-            write_byte(gb, read_de(gb->cpu->reg), gb->cpu->reg->a);
+            write_byte(gb, gb->cpu.reg.de, gb->cpu.reg.a);
 
             LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                       operand_strs[inst->op1],
@@ -767,10 +762,8 @@ void ld(gameboy *gb, gb_instruction *inst)
         case REG_BC: // only instruction is LD BC, IMM_16
         {
             // little endian
-            uint8_t lo = read_byte(gb, (gb->cpu->reg->pc)++);
-            uint8_t hi = read_byte(gb, (gb->cpu->reg->pc)++);
-            uint16_t value = ((uint16_t)hi << 8) | ((uint16_t)lo);
-            write_bc(gb->cpu->reg, value);
+            uint16_t value = fetch_word(gb);
+            gb->cpu.reg.bc = value;
 
             LOG_DEBUG("%s %s, 0x%04x\n", inst->inst_str, operand_strs[inst->op1], value);
             break;
@@ -779,10 +772,8 @@ void ld(gameboy *gb, gb_instruction *inst)
         case REG_DE: // only instruction is LD DE, IMM_16
         {
             // little endian
-            uint8_t lo = read_byte(gb, (gb->cpu->reg->pc)++);
-            uint8_t hi = read_byte(gb, (gb->cpu->reg->pc)++);
-            uint16_t value = ((uint16_t)hi << 8) | ((uint16_t)lo);
-            write_de(gb->cpu->reg, value);
+            uint16_t value = fetch_word(gb);
+            gb->cpu.reg.de = value;
 
             LOG_DEBUG("%s %s, 0x%04x\n", inst->inst_str, operand_strs[inst->op1], value);
             break;
@@ -794,10 +785,8 @@ void ld(gameboy *gb, gb_instruction *inst)
                 case IMM_16:
                 {
                     // little endian
-                    uint8_t lo = read_byte(gb, (gb->cpu->reg->pc)++);
-                    uint8_t hi = read_byte(gb, (gb->cpu->reg->pc)++);
-                    uint16_t value = ((uint16_t)hi << 8) | ((uint16_t)lo);
-                    write_hl(gb->cpu->reg, value);
+                    uint16_t value = fetch_word(gb);
+                    gb->cpu.reg.hl = value;
 
                     LOG_DEBUG("%s %s, 0x%04x\n", inst->inst_str, operand_strs[inst->op1], value);
                     break;
@@ -805,13 +794,13 @@ void ld(gameboy *gb, gb_instruction *inst)
 
                 case IMM_8: // immediate value as signed offset
                 {
-                    uint8_t offset = read_byte(gb, (gb->cpu->reg->pc)++);
+                    uint8_t offset = fetch_byte(gb);
                     bool sign_bit = (offset >> 7) & 1;
 
                     // HL and SP are 16 bits, so we need to sign extend the offset before adding
                     uint16_t signed_offset = sign_bit ? 0xff00 | (uint16_t)offset : offset;
 
-                    write_hl(gb->cpu->reg, gb->cpu->reg->sp + signed_offset);
+                    gb->cpu.reg.hl = gb->cpu.reg.sp + signed_offset;
 
                     /* Flags to set:
                      * zero flag: 0
@@ -822,12 +811,12 @@ void ld(gameboy *gb, gb_instruction *inst)
                      * NOTE: flags are set based on unsigned value of offset
                      */
                     // lowest nibbles must add to value bigger than 0xf to overflow
-                    bool half_carry = (gb->cpu->reg->sp & 0xf) + (offset & 0xf) > 0xf;
+                    bool half_carry = (gb->cpu.reg.sp & 0xf) + (offset & 0xf) > 0xf;
 
                     // sum of lowest bytes must be greater than 0xff to overflow
-                    bool carry = (gb->cpu->reg->sp & 0xff) + offset > 0xff;
+                    bool carry = (gb->cpu.reg.sp & 0xff) + offset > 0xff;
 
-                    set_flags(gb->cpu->reg, 0, 0, half_carry, carry);
+                    set_flags(&gb->cpu.reg, 0, 0, half_carry, carry);
 
                     LOG_DEBUG("%s %s, 0x%02x\n", inst->inst_str, operand_strs[inst->op1], offset);
                     break;
@@ -844,17 +833,15 @@ void ld(gameboy *gb, gb_instruction *inst)
             {
                 case IMM_16:
                 {
-                    uint8_t lo = read_byte(gb, (gb->cpu->reg->pc)++);
-                    uint8_t hi = read_byte(gb, (gb->cpu->reg->pc)++);
-                    uint16_t value = ((uint16_t)hi << 8) | ((uint16_t)lo);
-                    gb->cpu->reg->sp = value;
+                    uint16_t value = fetch_word(gb);
+                    gb->cpu.reg.sp = value;
 
                     LOG_DEBUG("%s %s, 0x%04x\n", inst->inst_str, operand_strs[inst->op1], value);
                     break;
                 }
 
                 case REG_HL:
-                    gb->cpu->reg->sp = read_hl(gb->cpu->reg);
+                    gb->cpu.reg.sp = gb->cpu.reg.hl;
 
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
@@ -870,21 +857,19 @@ void ld(gameboy *gb, gb_instruction *inst)
         case PTR_16:
         {
             // load the immediate address
-            uint8_t lo = read_byte(gb, (gb->cpu->reg->pc)++);
-            uint8_t hi = read_byte(gb, (gb->cpu->reg->pc)++);
-            uint16_t addr = ((uint16_t)hi << 8) | (uint16_t)lo;
+            uint16_t addr = fetch_word(gb);
 
             switch (inst->op2)
             {
                 case REG_A:
-                    write_byte(gb, addr, gb->cpu->reg->a);
+                    write_byte(gb, addr, gb->cpu.reg.a);
                     break;
 
                 case REG_SP:
                     // write SP into the two bytes pointed to by the immediate address
                     // NOTE: little endian. write lo byte at addr and hi byte at addr + 1
-                    write_byte(gb, addr, (uint8_t)(gb->cpu->reg->sp & 0xff));
-                    write_byte(gb, addr + 1, (uint8_t)(gb->cpu->reg->sp >> 8));
+                    write_byte(gb, addr, (uint8_t)(gb->cpu.reg.sp & 0xff));
+                    write_byte(gb, addr + 1, (uint8_t)(gb->cpu.reg.sp >> 8));
                     break;
 
                 default: // shouldn't get here
@@ -915,7 +900,7 @@ void ldh(gameboy *gb, gb_instruction *inst)
             {
                 case PTR_C:
                     // 0xff00 + register C gives address to read from
-                    addr = 0xff00 + (uint16_t)gb->cpu->reg->c;
+                    addr = 0xff00 + (uint16_t)gb->cpu.reg.c;
                     LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                               operand_strs[inst->op1],
                               operand_strs[inst->op2]);
@@ -925,7 +910,7 @@ void ldh(gameboy *gb, gb_instruction *inst)
                 {
                     // immediate value is low byte of address
                     // low byte + 0xff00 gives full address
-                    uint8_t lo = read_byte(gb, (gb->cpu->reg->pc)++);
+                    uint8_t lo = fetch_byte(gb);
                     addr = 0xff00 + (uint16_t)lo;
                     LOG_DEBUG("%s %s, [0x%02x]\n", inst->inst_str, operand_strs[inst->op1], lo);
                     break;
@@ -935,13 +920,13 @@ void ldh(gameboy *gb, gb_instruction *inst)
                     LOG_ERROR("Illegal argument in %s A encountered. Exiting...\n", inst->inst_str);
                     exit(1);
             }
-            gb->cpu->reg->a = read_byte(gb, addr);
+            gb->cpu.reg.a = read_byte(gb, addr);
             break;
 
         case PTR_C:
             // address to write to is given by adding C register to 0xff00
-            addr = 0xff00 + (uint16_t)gb->cpu->reg->c;
-            write_byte(gb, addr, gb->cpu->reg->a);
+            addr = 0xff00 + (uint16_t)gb->cpu.reg.c;
+            write_byte(gb, addr, gb->cpu.reg.a);
             LOG_DEBUG("%s %s, %s\n", inst->inst_str,
                       operand_strs[inst->op1],
                       operand_strs[inst->op2]);
@@ -951,9 +936,9 @@ void ldh(gameboy *gb, gb_instruction *inst)
         {
             // immediate value is the low byte of the address to read from
             // the low byte added to 0xff00 gives the full 16-bit address
-            uint8_t lo = read_byte(gb, (gb->cpu->reg->pc)++);
+            uint8_t lo = fetch_byte(gb);
             addr = 0xff00 + (uint16_t)lo;
-            write_byte(gb, addr, gb->cpu->reg->a);
+            write_byte(gb, addr, gb->cpu.reg.a);
             LOG_DEBUG("%s [0x%02x], %s\n", inst->inst_str, lo, operand_strs[inst->op2]);
             break;
         }
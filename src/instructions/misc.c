@@ -21,7 +21,7 @@ void ei(gameboy *gb)
 {
     // set the delayed IME set indicator so we know
     // to set the IME after the next instruction
-    gb->cpu->ime_delayed_set = true;
+    gb->cpu.ime_delayed_set = true;
 
     LOG_DEBUG("EI\n");
 }
@@ -32,7 +32,8 @@ void ei(gameboy *gb)
  */
 void di(gameboy *gb)
 {
-    gb->cpu->ime_flag = false;
+    gb->cpu.ime_flag = false;
+    update_interrupt_state(&gb->cpu);
 
     LOG_DEBUG("DI\n");
 }
@@ -47,19 +48,19 @@ void push(gameboy *gb, gb_instruction *inst)
     switch (inst->op1)
     {
         case REG_BC:
-            to_push = read_bc(gb->cpu->reg);
+            to_push = gb->cpu.reg.bc;
             break;
 
         case REG_DE:
-            to_push = read_de(gb->cpu->reg);
+            to_push = gb->cpu.reg.de;
             break;
 
         case REG_HL:
-            to_push = read_hl(gb->cpu->reg);
+            to_push = gb->cpu.reg.hl;
             break;
 
         case REG_AF:
-            to_push = read_af(gb->cpu->reg);
+            to_push = read_af(&gb->cpu.reg);
             break;
 
         default: // shouldn't get here
@@ -90,24 +91,24 @@ void pop(gameboy *gb, gb_instruction *inst)
     switch (inst->op1)
     {
         case REG_BC:
-            write_bc(gb->cpu->reg, popped);
+            gb->cpu.reg.bc = popped;
             break;
 
         case REG_DE:
-            write_de(gb->cpu->reg, popped);
+            gb->cpu.reg.de = popped;
             break;
 
         case REG_HL:
-            write_hl(gb->cpu->reg, popped);
+            gb->cpu.reg.hl = popped;
             break;
 
         case REG_AF:
         {
-            write_af(gb->cpu->reg, popped);
+            write_af(&gb->cpu.reg, popped);
 
             // also need to set flags
             uint8_t lo = (uint8_t)popped;
-            set_flags(gb->cpu->reg,
+            set_flags(&gb->cpu.reg,
                       (lo >> 7) & 1,   // Zero
                       (lo >> 6) & 1,   // Subtract
                       (lo >> 5) & 1,   // Half Carry
@@ -219,9 +220,9 @@ void pop(gameboy *gb, gb_instruction *inst)
  */
 void daa(gameboy *gb)
 {
-    bool carry = read_carry_flag(gb->cpu->reg),
-         subtract = read_subtract_flag(gb->cpu->reg),
-         half_carry = read_half_carry_flag(gb->cpu->reg);
+    bool carry = read_carry_flag(&gb->cpu.reg),
+         subtract = read_subtract_flag(&gb->cpu.reg),
+         half_carry = read_half_carry_flag(&gb->cpu.reg);
 
     if (!subtract) // previous instruction was addition
     {
@@ -236,19 +237,19 @@ void daa(gameboy *gb)
          * lower nibble first we would have to deal with wrap around
          * if A is in 0xfa-0xff.
          */
-        if (carry || gb->cpu->reg->a > 0x99)
+        if (carry || gb->cpu.reg.a > 0x99)
         {
-            gb->cpu->reg->a += 0x60;
-            set_carry_flag(gb->cpu->reg, 1);
+            gb->cpu.reg.a += 0x60;
+            set_carry_flag(&gb->cpu.reg, 1);
         }
 
         /* Correct the lower nibble if needed. This may carry
          * into the upper nibble, but this is okay because we've
          * already checked if the upper nibble needed adjustment.
          */
-        if (half_carry || (gb->cpu->reg->a & 0xf) > 0x9)
+        if (half_carry || (gb->cpu.reg.a & 0xf) > 0x9)
         {
-            gb->cpu->reg->a += 0x6;
+            gb->cpu.reg.a += 0x6;
         }
     }
     else // previous instruction was subtraction
@@ -259,18 +260,18 @@ void daa(gameboy *gb)
          */
         if (carry)
         {
-            gb->cpu->reg->a -= 0x60;
+            gb->cpu.reg.a -= 0x60;
         }
 
         if (half_carry)
         {
-            gb->cpu->reg->a -= 0x6;
+            gb->cpu.reg.a -= 0x6;
         }
     }
 
     // half carry and zero flag are always updated
-    set_zero_flag(gb->cpu->reg, gb->cpu->reg->a == 0);
-    set_half_carry_flag(gb->cpu->reg, 0);
+    set_zero_flag(&gb->cpu.reg, gb->cpu.reg.a == 0);
+    set_half_carry_flag(&gb->cpu.reg, 0);
 
     LOG_DEBUG("DAA\n");
 }
@@ -287,9 +288,9 @@ void daa(gameboy *gb)
 void scf(gameboy *gb)
 {
     // set the required flags
-    set_subtract_flag(gb->cpu->reg, 0);
-    set_half_carry_flag(gb->cpu->reg, 0);
-    set_carry_flag(gb->cpu->reg, 1);
+    set_subtract_flag(&gb->cpu.reg, 0);
+    set_half_carry_flag(&gb->cpu.reg, 0);
+    set_carry_flag(&gb->cpu.reg, 1);
 
     LOG_DEBUG("SCF\n");
 }
@@ -305,11 +306,11 @@ void scf(gameboy *gb)
  */
 void ccf(gameboy *gb)
 {
-    set_carry_flag(gb->cpu->reg, read_carry_flag(gb->cpu->reg) ^ 1);
+    set_carry_flag(&gb->cpu.reg, read_carry_flag(&gb->cpu.reg) ^ 1);
 
     // set the remaining flags
-    set_subtract_flag(gb->cpu->reg, 0);
-    set_half_carry_flag(gb->cpu->reg, 0);
+    set_subtract_flag(&gb->cpu.reg, 0);
+    set_half_carry_flag(&gb->cpu.reg, 0);
 
     LOG_DEBUG("CCF\n");
 }
@@ -324,11 +325,11 @@ void ccf(gameboy *gb)
  */
 void cpl(gameboy *gb)
 {
-    gb->cpu->reg->a ^= 0xff;
+    gb->cpu.reg.a ^= 0xff;
 
     // set flags
-    set_subtract_flag(gb->cpu->reg, 1);
-    set_half_carry_flag(gb->cpu->reg, 1);
+    set_subtract_flag(&gb->cpu.reg, 1);
+    set_half_carry_flag(&gb->cpu.reg, 1);
 
     LOG_DEBUG("CPL\n");
 }
@@ -349,9 +350,9 @@ void cpl(gameboy *gb)
 void stop(gameboy *gb)
 {
     // ignore the second byte of the instruction
-    ++(gb->cpu->reg->pc);
+    ++(gb->cpu.reg.pc);
 
-    if (gb->run_mode == GB_DMG_MODE || !maybe_switch_speed(gb))
+    if (!IS_CGB_MODE(gb) || !maybe_switch_speed(gb))
         gb->is_stopped = true;
 
     LOG_DEBUG("STOP\n");
@@ -378,14 +379,14 @@ void halt(gameboy *gb)
     // IME not set and an interrupt is pending so
     // we never actually enter the HALTed state
     // and instead trigger the HALT bug
-    if (!gb->cpu->ime_flag && pending_interrupts(gb))
+    if (!gb->cpu.ime_flag && gb->cpu.interrupts_pending)
     {
-        gb->cpu->halt_bug = true;
+        gb->cpu.halt_bug = true;
         LOG_DEBUG("HALT bug\n");
     }
     else
     {
-        gb->cpu->is_halted = true;
+        gb->cpu.is_halted = true;
         LOG_DEBUG("HALT\n");
     }
 }
@@ -31,20 +31,15 @@ uint8_t jp(gameboy *gb, gb_instruction *inst)
                 // jump to address specified by immediate value
                 case IMM_16:
                 {
-                    // little-endian
-                    uint8_t lo = read_byte(gb, (gb->cpu->reg->pc)++);
-                    // no need to increment PC here since we're going to jump anyway
-                    uint8_t hi = read_byte(gb, gb->cpu->reg->pc);
-
-                    uint16_t addr = ((uint16_t)hi << 8) | ((uint16_t)lo);
-                    gb->cpu->reg->pc = addr;
+                    uint16_t addr = fetch_word(gb);
+                    gb->cpu.reg.pc = addr;
                     LOG_DEBUG("%s 0x%04x\n", inst->inst_str, addr);
                     break;
                 }
 
                 // jump to address in HL register
                 case REG_HL:
-                    gb->cpu->reg->pc = read_hl(gb->cpu->reg);
+                    gb->cpu.reg.pc = gb->cpu.reg.hl;
                     LOG_DEBUG("%s %s\n", inst->inst_str, operand_strs[inst->op1]);
                     break;
 
@@ -56,32 +51,27 @@ uint8_t jp(gameboy *gb, gb_instruction *inst)
 
         case IMM_16:
         {
-            uint8_t lo = read_byte(gb, (gb->cpu->reg->pc)++);
-            // increment the PC after reading the hi byte of the
-            // address because we might not be jumping, in which
-            // case we need the PC to be pointing to the instruction
-            // immediately after this one.
-            uint8_t hi = read_byte(gb, (gb->cpu->reg->pc)++);
-
-            uint16_t addr = ((uint16_t)hi << 8) | ((uint16_t)lo);
+            // PC is left pointing at the next instruction
+            // in case we don't jump
+            uint16_t addr = fetch_word(gb);
 
             bool will_jump = 0; // the condition for the jump
             switch (inst->op1)
             {
                 case CC_C:
-                    will_jump = read_carry_flag(gb->cpu->reg);
+                    will_jump = read_carry_flag(&gb->cpu.reg);
                     break;
 
                 case CC_NC:
-                    will_jump = !read_carry_flag(gb->cpu->reg);
+                    will_jump = !read_carry_flag(&gb->cpu.reg);
                     break;
 
                 case CC_Z:
-                    will_jump = read_zero_flag(gb->cpu->reg);
+                    will_jump = read_zero_flag(&gb->cpu.reg);
                     break;
 
                 case CC_NZ:
-                    will_jump = !read_zero_flag(gb->cpu->reg);
+                    will_jump = !read_zero_flag(&gb->cpu.reg);
                     break;
 
                 default: // shouldn't get here
@@ -91,7 +81,7 @@ uint8_t jp(gameboy *gb, gb_instruction *inst)
 
             if (will_jump)
             {
-                gb->cpu->reg->pc = addr;
+                gb->cpu.reg.pc = addr;
                 duration = inst->duration;
             }
             else
@@ -119,7 +109,7 @@ uint8_t jr(gameboy *gb, gb_instruction *inst)
 {
     uint8_t duration = 0;
     // the offset for the jump
-    int8_t offset = (int8_t)read_byte(gb, (gb->cpu->reg->pc)++);
+    int8_t offset = (int8_t)fetch_byte(gb);
 
     // check the second operand first. If it's NONE, we have
     // the only unconditional jump out of the 5 instructions
@@ -138,7 +128,7 @@ uint8_t jr(gameboy *gb, gb_instruction *inst)
              * avoid possible bugs due to implicit integer
              * conversions.
              */
-            gb->cpu->reg->pc = (int32_t)gb->cpu->reg->pc + (int32_t)offset;
+            gb->cpu.reg.pc = (int32_t)gb->cpu.reg.pc + (int32_t)offset;
 
             LOG_DEBUG("%s 0x%02x\n", inst->inst_str, (uint8_t)offset);
             break;
@@ -151,19 +141,19 @@ uint8_t jr(gameboy *gb, gb_instruction *inst)
             switch (inst->op1)
             {
                 case CC_C:
-                    will_jump = read_carry_flag(gb->cpu->reg);
+                    will_jump = read_carry_flag(&gb->cpu.reg);
                     break;
 
                 case CC_NC:
-                    will_jump = !read_carry_flag(gb->cpu->reg);
+                    will_jump = !read_carry_flag(&gb->cpu.reg);
                     break;
 
                 case CC_Z:
-                    will_jump = read_zero_flag(gb->cpu->reg);
+                    will_jump = read_zero_flag(&gb->cpu.reg);
                     break;
 
                 case CC_NZ:
-                    will_jump = !read_zero_flag(gb->cpu->reg);
+                    will_jump = !read_zero_flag(&gb->cpu.reg);
                     break;
 
                 default: // shouldn't get here
@@ -173,7 +163,7 @@ uint8_t jr(gameboy *gb, gb_instruction *inst)
 
             if (will_jump)
             {
-                gb->cpu->reg->pc = (int32_t)gb->cpu->reg->pc + (int32_t)offset;
+                gb->cpu.reg.pc = (int32_t)gb->cpu.reg.pc + (int32_t)offset;
                 duration = inst->duration;
             }
             else
@@ -203,9 +193,7 @@ uint8_t call(gameboy *gb, gb_instruction *inst)
     uint8_t duration = 0;
 
     // get the address to call
-    uint8_t lo = read_byte(gb, (gb->cpu->reg->pc)++);
-    uint8_t hi = read_byte(gb, (gb->cpu->reg->pc)++);
-    uint16_t addr = ((uint16_t)hi << 8) | ((uint16_t)lo);
+    uint16_t addr = fetch_word(gb);
 
     // check the second operand first. If it's NONE, we have
     // the unconditional CALL, else a conditional CALL
@@ -216,10 +204,10 @@ uint8_t call(gameboy *gb, gb_instruction *inst)
 
             // push next instruction address onto the stack
             // so that a RET instruction can pop it later
-            stack_push(gb, gb->cpu->reg->pc);
+            stack_push(gb, gb->cpu.reg.pc);
 
             // implicit jump instruction to the target address
-            gb->cpu->reg->pc = addr;
+            gb->cpu.reg.pc = addr;
 
             LOG_DEBUG("%s 0x%04x\n", inst->inst_str, addr);
             break;
@@ -230,19 +218,19 @@ uint8_t call(gameboy *gb, gb_instruction *inst)
             switch (inst->op1)
             {
                 case CC_C:
-                    will_jump = read_carry_flag(gb->cpu->reg);
+                    will_jump = read_carry_flag(&gb->cpu.reg);
                     break;
 
                 case CC_NC:
-                    will_jump = !read_carry_flag(gb->cpu->reg);
+                    will_jump = !read_carry_flag(&gb->cpu.reg);
                     break;
 
                 case CC_Z:
-                    will_jump = read_zero_flag(gb->cpu->reg);
+                    will_jump = read_zero_flag(&gb->cpu.reg);
                     break;
 
                 case CC_NZ:
-                    will_jump = !read_zero_flag(gb->cpu->reg);
+                    will_jump = !read_zero_flag(&gb->cpu.reg);
                     break;
 
                 default: // shouldn't get here
@@ -253,10 +241,10 @@ uint8_t call(gameboy *gb, gb_instruction *inst)
             if (will_jump)
             {
                 // push next instruction address onto the stack
-                stack_push(gb, gb->cpu->reg->pc);
+                stack_push(gb, gb->cpu.reg.pc);
 
                 // implicit jump to the target address
-                gb->cpu->reg->pc = addr;
+                gb->cpu.reg.pc = addr;
 
                 duration = inst->duration;
             }
@@ -328,8 +316,8 @@ void rst(gameboy *gb, gb_instruction *inst)
     }
 
     // perform the call
-    stack_push(gb, gb->cpu->reg->pc);
-    gb->cpu->reg->pc = addr;
+    stack_push(gb, gb->cpu.reg.pc);
+    gb->cpu.reg.pc = addr;
 
     LOG_DEBUG("%s %s\n", inst->inst_str, operand_strs[inst->op1]);
 }
@@ -353,19 +341,19 @@ uint8_t ret(gameboy *gb, gb_instruction *inst)
             break;
 
         case CC_C:
-            will_ret = read_carry_flag(gb->cpu->reg);
+            will_ret = read_carry_flag(&gb->cpu.reg);
             break;
 
         case CC_NC:
-            will_ret = !read_carry_flag(gb->cpu->reg);
+            will_ret = !read_carry_flag(&gb->cpu.reg);
             break;
 
         case CC_Z:
-            will_ret = read_zero_flag(gb->cpu->reg);
+            will_ret = read_zero_flag(&gb->cpu.reg);
             break;
 
         case CC_NZ:
-            will_ret = !read_zero_flag(gb->cpu->reg);
+            will_ret = !read_zero_flag(&gb->cpu.reg);
             break;
 
         default: // shouldn't get here
@@ -375,7 +363,7 @@ uint8_t ret(gameboy *gb, gb_instruction *inst)
 
     if (will_ret)
     {
-        gb->cpu->reg->pc = stack_pop(gb);
+        gb->cpu.reg.pc = stack_pop(gb);
         duration = inst->duration;
     }
     else
@@ -395,8 +383,9 @@ uint8_t ret(gameboy *gb, gb_instruction *inst)
  */
 void reti(gameboy *gb)
 {
-    gb->cpu->reg->pc = stack_pop(gb);
-    gb->cpu->ime_flag = true;
+    gb->cpu.reg.pc = stack_pop(gb);
+    gb->cpu.ime_flag = true;
+    update_interrupt_state(&gb->cpu);
 
     LOG_DEBUG("RETI\n");
 }
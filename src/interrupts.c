@@ -9,19 +9,20 @@
 // request an interrupt by setting the appropriate bit in the IF register
 void request_interrupt(gameboy *gb, INTERRUPT_TYPE interrupt)
 {
-    gb->cpu->if_register |= 1 << interrupt;
+    gb->cpu.if_register |= 1 << interrupt;
+    update_interrupt_state(&gb->cpu);
 }
 
 // set the appropriate bit in the IE register to enable the given interrupt
 void enable_interrupt(gameboy *gb, INTERRUPT_TYPE interrupt)
 {
-    gb->cpu->ie_register |= 1 << interrupt;
+    gb->cpu.ie_register |= 1 << interrupt;
+    update_interrupt_state(&gb->cpu);
 }
 
 uint8_t pending_interrupts(gameboy *gb)
 {
-    // NOTE: top three bits are unused and always set, so need to mask out
-    return gb->cpu->if_register & gb->cpu->ie_register & 0x1f;
+    return gb->cpu.interrupts_pending;
 }
 
 /* Service an interrupt, if any needs to be serviced.
@@ -53,10 +54,10 @@ uint8_t service_interrupt(gameboy *gb)
 
     uint8_t interrupts_to_service = pending_interrupts(gb);
 
-    if (gb->cpu->ime_flag && interrupts_to_service)
+    if (gb->cpu.ime_flag && interrupts_to_service)
     {
         // push the current PC onto the stack
-        stack_push(gb, gb->cpu->reg->pc);
+        stack_push(gb, gb->cpu.reg.pc);
 
         /* Get the address of the interrupt handler for the
          * highest-priority interrupt that can be executed.
@@ -71,31 +72,31 @@ uint8_t service_interrupt(gameboy *gb)
          */
         if (interrupts_to_service & vblank_mask)        // VBLANK
         {
-            gb->cpu->if_register &= ~vblank_mask;
+            gb->cpu.if_register &= ~vblank_mask;
             handler_addr = 0x40;
             LOG_DEBUG("Servicing VBlank IRQ\n");
         }
         else if (interrupts_to_service & lcd_stat_mask) // LCD_STAT
         {
-            gb->cpu->if_register &= ~lcd_stat_mask;
+            gb->cpu.if_register &= ~lcd_stat_mask;
             handler_addr = 0x48;
             LOG_DEBUG("Servicing STAT IRQ\n");
         }
         else if (interrupts_to_service & timer_mask)    // TIMER
         {
-            gb->cpu->if_register &= ~timer_mask;
+            gb->cpu.if_register &= ~timer_mask;
             handler_addr = 0x50;
             LOG_DEBUG("Servicing Timer IRQ\n");
         }
         else if (interrupts_to_service & serial_mask)   // SERIAL
         {
-            gb->cpu->if_register &= ~serial_mask;
+            gb->cpu.if_register &= ~serial_mask;
             handler_addr = 0x58;
             LOG_DEBUG("Servicing Serial IRQ\n");
         }
         else if (interrupts_to_service & joypad_mask)   // JOYPAD
         {
-            gb->cpu->if_register &= ~joypad_mask;
+            gb->cpu.if_register &= ~joypad_mask;
             handler_addr = 0x60;
             LOG_DEBUG("Servicing Joypad IRQ\n");
         }
@@ -103,16 +104,17 @@ uint8_t service_interrupt(gameboy *gb)
         {
             LOG_ERROR("Invalid interrupt service request."
                       " IF: 0x%02x, IE: 0x%02x\n",
-                      gb->cpu->if_register,
-                      gb->cpu->ie_register);
+                      gb->cpu.if_register,
+                      gb->cpu.ie_register);
             exit(1);
         }
 
-        gb->cpu->reg->pc = (uint16_t)handler_addr;
+        gb->cpu.reg.pc = (uint16_t)handler_addr;
 
         // disable interrupts in preparation for this
         // interrupt handler to be executed
-        gb->cpu->ime_flag = false;
+        gb->cpu.ime_flag = false;
+        update_interrupt_state(&gb->cpu);
 
         // servicing the interrupt takes 5 M-cycles
         duration += 5;
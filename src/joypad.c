@@ -5,6 +5,10 @@
 #include "cboy/interrupts.h"
 #include "cboy/joypad.h"
 #include "cboy/memory.h"
+#include "cboy/mailbox.h"
+#include "cboy/link.h"
+#include "cboy/movie.h"
+#include "cboy/speed.h"
 #include "cboy/log.h"
 #include "cboy/ppu.h"
 
@@ -71,6 +75,24 @@ void update_button_set(gameboy *gb, uint8_t value)
     gb->joypad->action_selected = !(value & 0x20);
 }
 
+void set_button_states(gameboy *gb, uint8_t direction_state, uint8_t action_state)
+{
+    gb_joypad *joypad = gb->joypad;
+
+    // buttons going from High to Low
+    uint8_t newly_pressed = 0;
+    if (joypad->dpad_selected)
+        newly_pressed |= joypad->direction_state & ~direction_state;
+    if (joypad->action_selected)
+        newly_pressed |= joypad->action_state & ~action_state;
+
+    joypad->direction_state = direction_state & 0x0f;
+    joypad->action_state = action_state & 0x0f;
+
+    if (newly_pressed & 0x0f)
+        request_interrupt(gb, JOYPAD);
+}
+
 // handle Game Boy key presses
 void handle_keypress(gameboy *gb, SDL_KeyboardEvent *key)
 {
@@ -116,12 +138,16 @@ void handle_keypress(gameboy *gb, SDL_KeyboardEvent *key)
         report_volume_level(gb, false);
         return;
     }
-    else if (keycode == SDLK_TAB && key_pressed) // toggle FPS throttle
+    else if (keycode == SDLK_TAB && key_pressed) // toggle fast-forward
     {
-        gb->throttle_fps = !gb->throttle_fps;
+        toggle_fast_forward(gb);
         return;
     }
 
+    // a replayed movie has sole control of the buttons
+    if (gb->movie && gb->movie->mode == MOVIE_REPLAY)
+        return;
+
     // determine bit mask and new bit value
     uint8_t mask, bit;
     switch(keycode)
@@ -151,31 +177,75 @@ void handle_keypress(gameboy *gb, SDL_KeyboardEvent *key)
             return;
     }
 
-    // handle button state change and Joypad interrupt (button selected and pressed)
-    // NOTE: we have to update the button states before reading JOYP
-    uint8_t joyp;
+    // set_button_states() only requests a Joypad interrupt for a button
+    // that's newly pressed, so held keys repeating don't request more
+    uint8_t direction_state = gb->joypad->direction_state;
+    uint8_t action_state = gb->joypad->action_state;
     switch (keycode)
     {
         case SDLK_s:
         case SDLK_w:
         case SDLK_a:
         case SDLK_d:
-            gb->joypad->direction_state = (gb->joypad->direction_state & ~mask) | bit;
-            joyp = report_button_states(gb);
-            if (!(joyp & 0x10) && key_pressed)
-                request_interrupt(gb, JOYPAD);
+            direction_state = (direction_state & ~mask) | bit;
             break;
 
         case SDLK_RETURN:
         case SDLK_SPACE:
         case SDLK_j:
         case SDLK_k:
-            gb->joypad->action_state = (gb->joypad->action_state & ~mask) | bit;
-            joyp = report_button_states(gb);
-            if (!(joyp & 0x20) && key_pressed)
-                request_interrupt(gb, JOYPAD);
+            action_state = (action_state & ~mask) | bit;
             break;
     }
+
+    set_button_states(gb, direction_state, action_state);
+}
+
+void process_input(gameboy *gb, enum INPUT_TIMING timing)
+{
+    if (gb->mailbox == NULL)
+    {
+        gb->next_input_check = UINT64_MAX;
+        return;
+    }
+
+    if (mailbox_closed(gb->mailbox))
+        gb->is_on = false;
+
+    bool once_per_frame = gb->movie && gb->movie->mode == MOVIE_RECORD;
+    gb->next_input_check = once_per_frame ? UINT64_MAX : gb->master_clock + INPUT_CHECK_CLOCKS;
+
+    // a rerun after a rollback keeps the buttons as they were (see socklink.h)
+    bool replaying = gb->link && gb->link->replaying;
+    if (replaying || (once_per_frame && timing != INPUT_FRAME_END))
+        return;
+
+    bool ignore_time = timing == INPUT_JOYP_READ || once_per_frame;
+
+    SDL_Event event;
+    uint64_t due;
+    while (take_input_event(gb, ignore_time, &event, &due))
+    {
+        if (event.type != SDL_KEYDOWN && event.type != SDL_KEYUP)
+            continue;
+
+        uint8_t direction_state = gb->joypad->direction_state;
+        uint8_t action_state = gb->joypad->action_state;
+        handle_keypress(gb, &event.key);
+
+        /* A read of JOYP sees input that came in before it, even if
+         * the Game Boy's running ahead of the host, but one change of
+         * the buttons at a time, each taking effect (and requesting a
+         * Joypad interrupt) as of this read.
+         */
+        if (timing == INPUT_JOYP_READ
+            && (direction_state != gb->joypad->direction_state
+                || action_state != gb->joypad->action_state))
+            return;
+    }
+
+    if (!once_per_frame && due < gb->next_input_check)
+        gb->next_input_check = due;
 }
 
 void print_button_mappings(enum GAMEBOY_MODE gb_mode)
@@ -190,7 +260,7 @@ void print_button_mappings(enum GAMEBOY_MODE gb_mode)
         color_msg = "Cycle display palettes: <c>/<Shift-c>";
 
     const char *base_msg = "Volume up/down: <Equals>/<Minus>\n"
-                           "Toggle FPS throttle: <Tab>\n"
+                           "Toggle fast-forward: <Tab>\n"
                            "B:      <j>\n"
                            "A:      <k>\n"
                            "Up:     <w>\n"
@@ -0,0 +1,486 @@
+#define _XOPEN_SOURCE 700 // nftw, strdup, strcasecmp, sysconf
+
+#include <errno.h>
+#include <ftw.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cboy/common.h"
+#include "cboy/cartridge.h"
+#include "cboy/mbc.h"
+#include "cboy/library.h"
+#include "cboy/log.h"
+
+/* Index file layout
+ * -----------------
+ * 8 bytes: magic ("CBOYLB01")
+ * then one record per ROM file, with little-endian integers:
+ * 8 bytes:  file size
+ * 8 bytes:  file modification time (UNIX time)
+ * 8 bytes:  ROM hash
+ * 16 bytes: title, NUL-padded
+ * 1 byte:   CGB flag
+ * 1 byte:   MBC type (MBC_TYPE)
+ * 2 bytes:  number of ROM banks (0 if the file isn't a valid ROM)
+ * 4 bytes:  external RAM size
+ * 2 bytes:  path length
+ * then the path, relative to the library directory
+ */
+static const char library_index_magic[8] = {'C', 'B', 'O', 'Y', 'L', 'B', '0', '1'};
+
+#define INDEX_RECORD_SIZE 50 /* bytes, not counting the path */
+
+#define MAX_SCAN_THREADS 64
+
+static void put_le(uint8_t *buf, uint64_t value, int num_bytes)
+{
+    for (int i = 0; i < num_bytes; ++i)
+        buf[i] = value >> (8 * i);
+}
+
+static uint64_t get_le(const uint8_t *buf, int num_bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < num_bytes; ++i)
+        value |= (uint64_t)buf[i] << (8 * i);
+
+    return value;
+}
+
+// a growable array of library entries
+typedef struct entry_list {
+    gb_library_entry *entries;
+    size_t num_entries, capacity;
+} entry_list;
+
+static bool append_entry(entry_list *list, const gb_library_entry *entry)
+{
+    if (list->num_entries == list->capacity)
+    {
+        size_t capacity = list->capacity ? 2 * list->capacity : 64;
+        gb_library_entry *entries = realloc(list->entries, capacity * sizeof *entries);
+        if (entries == NULL)
+            return false;
+
+        list->entries = entries;
+        list->capacity = capacity;
+    }
+
+    list->entries[list->num_entries++] = *entry;
+    return true;
+}
+
+static void free_entry_list(entry_list *list)
+{
+    for (size_t i = 0; i < list->num_entries; ++i)
+        free(list->entries[i].path);
+
+    free(list->entries);
+}
+
+static bool is_valid_rom(const gb_library_entry *entry)
+{
+    return entry->header.num_rom_banks != 0;
+}
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(((const gb_library_entry *)a)->path, ((const gb_library_entry *)b)->path);
+}
+
+static int compare_titles(const void *a, const void *b)
+{
+    const gb_library_entry *entry_a = a, *entry_b = b;
+    int order = strcasecmp(entry_a->header.title, entry_b->header.title);
+    return order ? order : strcmp(entry_a->path, entry_b->path);
+}
+
+/* Length of the root and separator which start each path under it.
+ * Paths are stored in the index without them. The root has no
+ * trailing slashes, unless it's "/" itself.
+ */
+static size_t root_prefix_len(const char *root)
+{
+    size_t root_len = strlen(root);
+    return root_len && root[root_len - 1] == '/' ? root_len : root_len + 1;
+}
+
+/* Read the saved index of the library at root, if there is one.
+ * Whatever can't be read is simply indexed again.
+ */
+static void read_index(const char *index_path, const char *root, entry_list *list)
+{
+    FILE *index_file = fopen(index_path, "rb");
+    if (index_file == NULL)
+        return;
+
+    uint8_t magic[sizeof library_index_magic];
+    if (fread(magic, 1, sizeof magic, index_file) != sizeof magic
+        || memcmp(magic, library_index_magic, sizeof magic))
+    {
+        LOG_ERROR("Ignoring invalid ROM library index %s\n", index_path);
+        fclose(index_file);
+        return;
+    }
+
+    size_t root_len = strlen(root), prefix_len = root_prefix_len(root);
+    uint8_t record[INDEX_RECORD_SIZE];
+    while (fread(record, 1, sizeof record, index_file) == sizeof record)
+    {
+        gb_library_entry entry = {
+            .file_size = get_le(record, 8),
+            .mtime = (int64_t)get_le(record + 8, 8),
+            .rom_hash = get_le(record + 16, 8),
+        };
+
+        memcpy(entry.header.title, record + 24, 16);
+        entry.header.title[16] = '\0';
+        entry.header.cgb_flag = record[40];
+        entry.header.mbc_type = record[41];
+        entry.header.num_rom_banks = get_le(record + 42, 2);
+        entry.header.ext_ram_size = get_le(record + 44, 4);
+
+        size_t path_len = get_le(record + 48, 2);
+        entry.path = malloc(prefix_len + path_len + 1);
+        if (entry.path == NULL)
+            break;
+
+        memcpy(entry.path, root, root_len);
+        entry.path[prefix_len - 1] = '/';
+        entry.path[prefix_len + path_len] = '\0';
+
+        if (fread(entry.path + prefix_len, 1, path_len, index_file) != path_len
+            || !append_entry(list, &entry))
+        {
+            free(entry.path);
+            break;
+        }
+    }
+
+    fclose(index_file);
+}
+
+/* Save the index of the library at root. It's written to a
+ * temporary file first, so an interrupted write can't leave
+ * a broken index behind.
+ */
+static bool write_index(const char *index_path, const char *root, const entry_list *list)
+{
+    size_t prefix_len = root_prefix_len(root);
+    char *tmp_path = malloc(strlen(index_path) + sizeof ".tmp");
+    if (tmp_path == NULL)
+        return false;
+
+    sprintf(tmp_path, "%s.tmp", index_path);
+    FILE *index_file = fopen(tmp_path, "wb");
+    if (index_file == NULL)
+    {
+        free(tmp_path);
+        return false;
+    }
+
+    bool ok = fwrite(library_index_magic, 1, sizeof library_index_magic, index_file)
+              == sizeof library_index_magic;
+
+    for (size_t i = 0; ok && i < list->num_entries; ++i)
+    {
+        const gb_library_entry *entry = &list->entries[i];
+        const char *path = entry->path + prefix_len;
+        size_t path_len = strlen(path);
+        if (path_len > UINT16_MAX || entry->unreadable)
+            continue;
+
+        uint8_t record[INDEX_RECORD_SIZE] = {0};
+        put_le(record, entry->file_size, 8);
+        put_le(record + 8, (uint64_t)entry->mtime, 8);
+        put_le(record + 16, entry->rom_hash, 8);
+        memcpy(record + 24, entry->header.title, strlen(entry->header.title));
+        record[40] = entry->header.cgb_flag;
+        record[41] = entry->header.mbc_type;
+        put_le(record + 42, entry->header.num_rom_banks, 2);
+        put_le(record + 44, (uint32_t)entry->header.ext_ram_size, 4);
+        put_le(record + 48, path_len, 2);
+
+        ok = fwrite(record, 1, sizeof record, index_file) == sizeof record
+             && fwrite(path, 1, path_len, index_file) == path_len;
+    }
+
+    ok = !fclose(index_file) && ok;
+    ok = ok && !rename(tmp_path, index_path);
+    if (!ok)
+        remove(tmp_path);
+
+    free(tmp_path);
+    return ok;
+}
+
+static bool is_rom_file(const char *path)
+{
+    const char *ext = strrchr(path, '.');
+    return ext && (!strcasecmp(ext, ".gb") || !strcasecmp(ext, ".gbc")
+                   || !strcasecmp(ext, ".gz") || !strcasecmp(ext, ".zip"));
+}
+
+// nftw() has no way to pass context to its callback
+static entry_list *found_roms;
+
+static int add_rom_file(const char *path, const struct stat *sb, int type, struct FTW *ftw)
+{
+    (void)ftw;
+    if (type != FTW_F || !is_rom_file(path))
+        return 0;
+
+    gb_library_entry entry = {
+        .path = strdup(path),
+        .file_size = sb->st_size,
+        .mtime = sb->st_mtime,
+    };
+
+    if (entry.path == NULL || !append_entry(found_roms, &entry))
+    {
+        free(entry.path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Read the header and hash of a ROM file. Files which can't be
+ * loaded as a ROM are left with no ROM banks, and marked unreadable
+ * too if that's down to failing to open or read them.
+ */
+static void scan_rom(gb_library_entry *entry)
+{
+    memset(&entry->header, 0, sizeof entry->header);
+    entry->rom_hash = 0;
+    entry->unreadable = true;
+
+    gb_rom_file *rom_file = open_rom_file(entry->path);
+    if (rom_file == NULL)
+        return;
+
+    gb_rom_header header;
+    uint64_t rom_hash;
+
+    ROM_LOAD_STATUS status = hash_rom_file(rom_file, &header, &rom_hash);
+    if (status == ROM_LOAD_SUCCESS)
+    {
+        entry->header = header;
+        entry->rom_hash = rom_hash;
+    }
+    entry->unreadable = status == ROM_LOAD_ERROR;
+
+    close_rom_file(rom_file);
+}
+
+// the ROMs left to scan, shared by the scanning threads
+typedef struct scan_queue {
+    gb_library_entry **entries;
+    size_t num_entries;
+    atomic_size_t next;
+} scan_queue;
+
+static void *scan_worker(void *arg)
+{
+    scan_queue *queue = arg;
+
+    size_t i;
+    while ((i = atomic_fetch_add(&queue->next, 1)) < queue->num_entries)
+        scan_rom(queue->entries[i]);
+
+    return NULL;
+}
+
+// scan the queued ROMs with one thread per CPU
+static void scan_roms(scan_queue *queue)
+{
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t num_threads = num_cpus > 0 ? (size_t)num_cpus : 1;
+    if (num_threads > MAX_SCAN_THREADS)
+        num_threads = MAX_SCAN_THREADS;
+    if (num_threads > queue->num_entries)
+        num_threads = queue->num_entries;
+
+    // this thread scans too, so the work gets done even if no threads start
+    pthread_t threads[MAX_SCAN_THREADS];
+    size_t num_started = 0;
+    while (num_started + 1 < num_threads
+           && !pthread_create(&threads[num_started], NULL, scan_worker, queue))
+        ++num_started;
+
+    scan_worker(queue);
+
+    for (size_t i = 0; i < num_started; ++i)
+        pthread_join(threads[i], NULL);
+}
+
+gb_library *open_library(const char *dir)
+{
+    gb_library *library = calloc(1, sizeof(gb_library));
+    entry_list indexed = {0}, found = {0};
+    gb_library_entry **stale = NULL;
+    char *index_path = NULL;
+
+    // the library directory, without trailing slashes
+    size_t root_len = strlen(dir);
+    while (root_len > 1 && dir[root_len - 1] == '/')
+        --root_len;
+
+    char *root = strndup(dir, root_len);
+    if (library == NULL || root == NULL)
+        goto mem_error;
+
+    size_t prefix_len = root_prefix_len(root);
+    index_path = malloc(prefix_len + sizeof LIBRARY_INDEX_NAME);
+    if (index_path == NULL)
+        goto mem_error;
+
+    sprintf(index_path, "%s%s%s", root, prefix_len > root_len ? "/" : "", LIBRARY_INDEX_NAME);
+    read_index(index_path, root, &indexed);
+    qsort(indexed.entries, indexed.num_entries, sizeof *indexed.entries, compare_paths);
+
+    found_roms = &found;
+    if (nftw(root, add_rom_file, 16, 0))
+    {
+        LOG_ERROR("Error: Unable to scan the ROM library %s: %s\n", root, strerror(errno));
+        goto error;
+    }
+
+    // reuse what's indexed for files that haven't changed
+    stale = malloc((found.num_entries + 1) * sizeof *stale);
+    if (stale == NULL)
+        goto mem_error;
+
+    size_t num_stale = 0;
+    for (size_t i = 0; i < found.num_entries; ++i)
+    {
+        gb_library_entry *entry = &found.entries[i];
+        gb_library_entry *old = bsearch(entry, indexed.entries, indexed.num_entries,
+                                        sizeof *indexed.entries, compare_paths);
+
+        if (old && old->file_size == entry->file_size && old->mtime == entry->mtime)
+        {
+            entry->rom_hash = old->rom_hash;
+            entry->header = old->header;
+        }
+        else
+        {
+            stale[num_stale++] = entry;
+        }
+    }
+
+    scan_queue queue = {.entries = stale, .num_entries = num_stale};
+    atomic_init(&queue.next, 0);
+    scan_roms(&queue);
+
+    bool changed = num_stale || found.num_entries != indexed.num_entries;
+    if (changed && !write_index(index_path, root, &found))
+        LOG_ERROR("Note: Unable to save the ROM library index %s\n", index_path);
+
+    // only valid ROMs are listed
+    for (size_t i = 0; i < found.num_entries; ++i)
+    {
+        if (is_valid_rom(&found.entries[i]))
+            found.entries[library->num_entries++] = found.entries[i];
+        else
+            free(found.entries[i].path);
+    }
+
+    library->entries = found.entries;
+    qsort(library->entries, library->num_entries, sizeof *library->entries, compare_titles);
+
+    LOG_INFO("ROM library %s: %zu ROMs (%zu files read)\n\n", root, library->num_entries, num_stale);
+
+    free_entry_list(&indexed);
+    free(stale);
+    free(index_path);
+    free(root);
+    return library;
+
+mem_error:
+    LOG_ERROR("Not enough memory to open the ROM library\n");
+error:
+    free_entry_list(&indexed);
+    free_entry_list(&found);
+    free(stale);
+    free(index_path);
+    free(root);
+    free(library);
+    return NULL;
+}
+
+void free_library(gb_library *library)
+{
+    if (library == NULL)
+        return;
+
+    for (size_t i = 0; i < library->num_entries; ++i)
+        free(library->entries[i].path);
+
+    free(library->entries);
+    free(library);
+}
+
+static bool contains_ignoring_case(const char *str, const char *substr)
+{
+    size_t len = strlen(substr);
+    for (; *str; ++str)
+        if (!strncasecmp(str, substr, len))
+            return true;
+
+    return len == 0;
+}
+
+static bool entry_matches(const gb_library_entry *entry, const char *query)
+{
+    char hash[17];
+    sprintf(hash, "%016" PRIx64, entry->rom_hash);
+    return !strcasecmp(hash, query) || contains_ignoring_case(entry->header.title, query);
+}
+
+size_t find_in_library(gb_library *library, const char *query, gb_library_entry **match)
+{
+    size_t num_matches = 0;
+    for (size_t i = 0; i < library->num_entries; ++i)
+    {
+        if (!entry_matches(&library->entries[i], query))
+            continue;
+
+        if (!num_matches)
+            *match = &library->entries[i];
+        ++num_matches;
+    }
+
+    return num_matches;
+}
+
+void print_library(gb_library *library, const char *query)
+{
+    LOG_INFO("%-16s  %-4s %-12s %8s %7s  %-16s  %s\n",
+             "Hash", "Mode", "MBC", "ROM", "RAM", "Title", "Path");
+
+    for (size_t i = 0; i < library->num_entries; ++i)
+    {
+        const gb_library_entry *entry = &library->entries[i];
+        if (query && !entry_matches(entry, query))
+            continue;
+
+        const gb_rom_header *header = &entry->header;
+        LOG_INFO("%016" PRIx64 "  %-4s %-12s %5u KB %4d KB  %-16s  %s\n",
+                 entry->rom_hash,
+                 header->cgb_flag & 0x80 ? "CGB" : "DMG",
+                 mbc_type_name(header->mbc_type),
+                 header->num_rom_banks * (ROM_BANK_SIZE / KB),
+                 header->ext_ram_size / KB,
+                 header->title,
+                 entry->path);
+    }
+}
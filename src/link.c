@@ -0,0 +1,210 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/link.h"
+#include "cboy/mailbox.h"
+#include "cboy/socklink.h"
+#include "cboy/serial.h"
+
+// each end of the cable, as seen from the other
+struct link_end {
+    gameboy *gb;
+    uint64_t time; // its master clock at its last sync point
+
+    // the shortest transfer it can clock, in normal-speed clocks
+    uint64_t min_transfer_clocks;
+
+    // a byte it's clocking out, and the master clock the transfer
+    // completes at (UINT64_MAX if none), read without the lock
+    bool offering;
+    uint8_t offer;
+    _Atomic uint64_t offer_time;
+
+    bool replied;
+    uint8_t reply;
+};
+
+struct gb_link {
+    pthread_mutex_t lock;
+    pthread_cond_t changed; // an end's time or transfer changed
+    bool connected;         // until either Game Boy is turned off
+    struct link_end ends[2];
+};
+
+/* Reply to the transfer the other end is clocking, if this end has
+ * reached the time it completes at. Called with the link's lock held.
+ */
+static void reply_to_peer(gb_link *link, int end, uint64_t now)
+{
+    struct link_end *peer = &link->ends[!end];
+    if (!peer->offering || peer->replied || now < peer->offer_time)
+        return;
+
+    peer->reply = receive_serial_byte(link->ends[end].gb, peer->offer);
+    peer->replied = true;
+    pthread_cond_broadcast(&link->changed);
+}
+
+void start_link_transfer(gameboy *gb, uint8_t value, uint64_t completion_time)
+{
+    if (gb->link->socket)
+    {
+        start_socket_transfer(gb, value, completion_time);
+        return;
+    }
+
+    gb_link *link = gb->link->link;
+    struct link_end *self = &link->ends[gb->link->end];
+
+    pthread_mutex_lock(&link->lock);
+    self->time = gb->master_clock;
+    self->offering = true;
+    self->offer = value;
+    self->replied = false;
+    atomic_store_explicit(&self->offer_time, completion_time, memory_order_release);
+    pthread_cond_broadcast(&link->changed);
+    pthread_mutex_unlock(&link->lock);
+}
+
+void cancel_link_transfer(gameboy *gb)
+{
+    if (gb->link->socket)
+    {
+        cancel_socket_transfer(gb);
+        return;
+    }
+
+    gb_link *link = gb->link->link;
+    struct link_end *self = &link->ends[gb->link->end];
+
+    // if the other end has replied already, its byte is lost
+    pthread_mutex_lock(&link->lock);
+    self->offering = false;
+    atomic_store_explicit(&self->offer_time, UINT64_MAX, memory_order_relaxed);
+    pthread_mutex_unlock(&link->lock);
+}
+
+uint8_t finish_link_transfer(gameboy *gb)
+{
+    if (gb->link->socket)
+        return finish_socket_transfer(gb);
+
+    gb_link *link = gb->link->link;
+    int end = gb->link->end;
+    struct link_end *self = &link->ends[end];
+
+    pthread_mutex_lock(&link->lock);
+
+    self->time = gb->master_clock;
+    pthread_cond_broadcast(&link->changed);
+
+    while (link->connected && self->offering && !self->replied)
+    {
+        // if both ends clock a transfer at once, neither shifts anything in
+        reply_to_peer(link, end, UINT64_MAX);
+        pthread_cond_wait(&link->changed, &link->lock);
+    }
+
+    uint8_t received = self->offering && self->replied ? self->reply : 0xff;
+    self->offering = false;
+    atomic_store_explicit(&self->offer_time, UINT64_MAX, memory_order_relaxed);
+
+    pthread_mutex_unlock(&link->lock);
+    return received;
+}
+
+void run_link(gameboy *gb)
+{
+    gb_link_port *port = gb->link;
+    if (port->socket)
+    {
+        run_socket_link(gb);
+        return;
+    }
+
+    gb_link *link = port->link;
+    struct link_end *self = &link->ends[port->end];
+    struct link_end *peer = &link->ends[!port->end];
+
+    uint64_t now = gb->master_clock;
+    if (now < port->next_sync
+        && now < atomic_load_explicit(&peer->offer_time, memory_order_acquire))
+        return;
+
+    /* Waiting on the other end to clock a transfer, this end syncs
+     * often enough and stays close enough behind it to see the
+     * transfer start before it completes. Between sync points it runs
+     * sync_clocks, so it stays at most max_skew + sync_clocks (the
+     * shortest transfer the other end can clock) ahead.
+     */
+    uint64_t sync_clocks = LINK_SYNC_CLOCKS;
+    uint64_t max_skew = LINK_MAX_SKEW;
+    if (awaiting_serial_clock(gb))
+    {
+        if (sync_clocks > peer->min_transfer_clocks / 2)
+            sync_clocks = peer->min_transfer_clocks / 2;
+        max_skew = peer->min_transfer_clocks - sync_clocks;
+    }
+
+    port->next_sync = now + sync_clocks;
+
+    pthread_mutex_lock(&link->lock);
+
+    self->time = now;
+    pthread_cond_broadcast(&link->changed);
+
+    reply_to_peer(link, port->end, now);
+
+    while (link->connected && self->time > peer->time + max_skew)
+    {
+        reply_to_peer(link, port->end, now);
+        pthread_cond_wait(&link->changed, &link->lock);
+    }
+
+    pthread_mutex_unlock(&link->lock);
+}
+
+static void disconnect_link(gb_link *link)
+{
+    pthread_mutex_lock(&link->lock);
+    link->connected = false;
+    pthread_cond_broadcast(&link->changed);
+    pthread_mutex_unlock(&link->lock);
+}
+
+// the other Game Boy keeps running with nothing connected
+static void unplug_link(gameboy *gb)
+{
+    disconnect_link(gb->link->link);
+}
+
+void run_linked_gameboys(gameboy *first, gameboy *second)
+{
+    gameboy *gbs[2] = {first, second};
+    gb_link link = {.connected = true};
+    gb_link_port ports[2];
+
+    pthread_mutex_init(&link.lock, NULL);
+    pthread_cond_init(&link.changed, NULL);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        link.ends[i].gb = gbs[i];
+        link.ends[i].offer_time = UINT64_MAX;
+        link.ends[i].min_transfer_clocks =
+            8 * (IS_CGB_MODE(gbs[i]) ? FAST_SERIAL_CLOCKS_PER_BIT / 2 : SERIAL_CLOCKS_PER_BIT);
+        ports[i] = (gb_link_port){.link = &link, .end = i};
+        gbs[i]->link = &ports[i];
+    }
+
+    run_gameboys(gbs, 2, unplug_link);
+
+    for (int i = 0; i < 2; ++i)
+        gbs[i]->link = NULL;
+
+    pthread_cond_destroy(&link.changed);
+    pthread_mutex_destroy(&link.lock);
+}
@@ -21,19 +21,19 @@ void print_registers(gameboy *gb)
                       "SP: %04X PC: 00:%04X (%02X %02X %02X %02X)\n";
 
     LOG_DEBUG(fmt,
-             gb->cpu->reg->a,
-             gb->cpu->reg->f,
-             gb->cpu->reg->b,
-             gb->cpu->reg->c,
-             gb->cpu->reg->d,
-             gb->cpu->reg->e,
-             gb->cpu->reg->h,
-             gb->cpu->reg->l,
-             gb->cpu->reg->sp,
-             gb->cpu->reg->pc,
-             read_byte(gb, gb->cpu->reg->pc),
-             read_byte(gb, gb->cpu->reg->pc + 1),
-             read_byte(gb, gb->cpu->reg->pc + 2),
-             read_byte(gb, gb->cpu->reg->pc + 3));
+             gb->cpu.reg.a,
+             read_af(&gb->cpu.reg) & 0xff,
+             gb->cpu.reg.b,
+             gb->cpu.reg.c,
+             gb->cpu.reg.d,
+             gb->cpu.reg.e,
+             gb->cpu.reg.h,
+             gb->cpu.reg.l,
+             gb->cpu.reg.sp,
+             gb->cpu.reg.pc,
+             read_byte(gb, gb->cpu.reg.pc),
+             read_byte(gb, gb->cpu.reg.pc + 1),
+             read_byte(gb, gb->cpu.reg.pc + 2),
+             read_byte(gb, gb->cpu.reg.pc + 3));
 }
 #endif /* DEBUG */
@@ -0,0 +1,376 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/mailbox.h"
+#include "cboy/pacer.h"
+#include "cboy/speed.h"
+#include "cboy/ppu.h"
+#include "cboy/log.h"
+
+// input events queued for a Game Boy at most (a power of two)
+#define INPUT_QUEUE_SIZE 64
+
+#define NS_PER_SECOND 1000000000LL
+
+// host time a Game Boy frame (70224 clocks) takes, in ns
+#define FRAME_NS (70224 * NS_PER_SECOND / GB_CPU_FREQUENCY)
+
+typedef struct input_event {
+    SDL_Event event;
+    int64_t host_ns; // when the main thread read it (see host_time_ns())
+} input_event;
+
+struct gb_mailbox {
+    pthread_mutex_t lock;
+    pthread_cond_t presented; // the posted frame was presented, or the mailbox closed
+
+    // the frame posted, and whether the main thread has presented it yet
+    uint16_t frame_buffer[FRAME_WIDTH * FRAME_HEIGHT];
+    bool frame_ready, frame_presented;
+
+    // the Game Boy's thread has finished
+    bool finished;
+
+    /* Input events, oldest first. The main thread adds them at tail,
+     * and the Game Boy's thread takes them from head.
+     */
+    input_event events[INPUT_QUEUE_SIZE];
+    _Atomic uint32_t head, tail;
+
+    atomic_bool closed;
+
+    // only used on the Game Boy's thread: a host time and
+    // the master clock it was matched to (see sync_input_time())
+    int64_t sync_ns;
+    uint64_t sync_clock;
+};
+
+// what each Game Boy's thread runs
+typedef struct gameboy_thread {
+    pthread_t thread;
+    gameboy *gb;
+    void (*finished)(gameboy *gb);
+} gameboy_thread;
+
+// pushed to wake the main thread when a frame's posted, or UINT32_MAX if none could be registered
+static uint32_t frame_posted_event = UINT32_MAX;
+
+static void wake_main_thread(void)
+{
+    if (frame_posted_event != UINT32_MAX)
+        SDL_PushEvent(&(SDL_Event){.type = frame_posted_event});
+}
+
+void post_frame(gameboy *gb, const uint16_t *frame_buffer)
+{
+    gb_mailbox *mailbox = gb->mailbox;
+
+    pthread_mutex_lock(&mailbox->lock);
+    memcpy(mailbox->frame_buffer, frame_buffer, sizeof mailbox->frame_buffer);
+    mailbox->frame_ready = true;
+    pthread_mutex_unlock(&mailbox->lock);
+
+    wake_main_thread();
+
+    pthread_mutex_lock(&mailbox->lock);
+    while (mailbox->frame_ready && !atomic_load_explicit(&mailbox->closed, memory_order_relaxed))
+        pthread_cond_wait(&mailbox->presented, &mailbox->lock);
+
+    mailbox->frame_ready = false;
+    mailbox->frame_presented = false;
+    pthread_mutex_unlock(&mailbox->lock);
+
+    sync_input_time(gb);
+}
+
+void sync_input_time(gameboy *gb)
+{
+    if (gb->mailbox == NULL)
+        return;
+
+    gb->mailbox->sync_ns = host_time_ns();
+    gb->mailbox->sync_clock = gb->master_clock;
+}
+
+/* The master clock matching a host time, going by when they were last
+ * matched. An event read over a frame after then (if the Game Boy's
+ * fallen behind) is due a frame after, so it's never held for long.
+ */
+static uint64_t input_event_clock(gameboy *gb, int64_t host_ns)
+{
+    gb_mailbox *mailbox = gb->mailbox;
+    uint8_t speed = gb->speed.speed;
+
+    int64_t elapsed_ns = host_ns - mailbox->sync_ns;
+    if (speed == UNCAPPED_SPEED || elapsed_ns <= 0)
+        return mailbox->sync_clock;
+
+    if (elapsed_ns > FRAME_NS)
+        elapsed_ns = FRAME_NS;
+
+    return mailbox->sync_clock + (uint64_t)elapsed_ns * GB_CPU_FREQUENCY * speed / NS_PER_SECOND;
+}
+
+bool take_input_event(gameboy *gb, bool ignore_time, SDL_Event *event, uint64_t *due)
+{
+    gb_mailbox *mailbox = gb->mailbox;
+    uint32_t head = atomic_load_explicit(&mailbox->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&mailbox->tail, memory_order_acquire);
+
+    if (head == tail)
+    {
+        *due = UINT64_MAX;
+        return false;
+    }
+
+    const input_event *next = &mailbox->events[head % INPUT_QUEUE_SIZE];
+    if (!ignore_time)
+    {
+        uint64_t clock = input_event_clock(gb, next->host_ns);
+        if (clock > gb->master_clock)
+        {
+            *due = clock;
+            return false;
+        }
+    }
+
+    *event = next->event;
+    atomic_store_explicit(&mailbox->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool mailbox_closed(gb_mailbox *mailbox)
+{
+    return atomic_load_explicit(&mailbox->closed, memory_order_relaxed);
+}
+
+static void close_mailbox(gb_mailbox *mailbox)
+{
+    pthread_mutex_lock(&mailbox->lock);
+    atomic_store_explicit(&mailbox->closed, true, memory_order_relaxed);
+    pthread_cond_broadcast(&mailbox->presented);
+    pthread_mutex_unlock(&mailbox->lock);
+}
+
+// events which don't fit are dropped
+static void queue_input_event(gb_mailbox *mailbox, const SDL_Event *event)
+{
+    uint32_t tail = atomic_load_explicit(&mailbox->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&mailbox->head, memory_order_acquire);
+    if (tail - head == INPUT_QUEUE_SIZE)
+        return;
+
+    mailbox->events[tail % INPUT_QUEUE_SIZE] = (input_event){
+        .event = *event,
+        .host_ns = host_time_ns(),
+    };
+    atomic_store_explicit(&mailbox->tail, tail + 1, memory_order_release);
+}
+
+/* Pass an event to the Game Boy whose window it's for. Keyboard
+ * events without a window go to the first. Closing a window turns
+ * that Game Boy off, and quitting turns them all off.
+ */
+static void route_input_event(gameboy *gbs[], int num_gbs, SDL_Event *event)
+{
+    uint32_t window_id;
+    switch (event->type)
+    {
+        case SDL_QUIT:
+            for (int i = 0; i < num_gbs; ++i)
+                close_mailbox(gbs[i]->mailbox);
+            return;
+
+        case SDL_WINDOWEVENT:
+            if (event->window.event != SDL_WINDOWEVENT_CLOSE)
+                return;
+
+            window_id = event->window.windowID;
+            break;
+
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            window_id = event->key.windowID;
+            break;
+
+        default:
+            return;
+    }
+
+    gameboy *gb = gbs[0];
+    for (int i = 1; i < num_gbs; ++i)
+        if (window_id == SDL_GetWindowID(gbs[i]->window))
+            gb = gbs[i];
+
+    if (event->type == SDL_WINDOWEVENT)
+        close_mailbox(gb->mailbox);
+    else
+        queue_input_event(gb->mailbox, event);
+}
+
+static void read_input(gameboy *gbs[], int num_gbs)
+{
+    SDL_Event event;
+    while (SDL_PollEvent(&event))
+        route_input_event(gbs, num_gbs, &event);
+}
+
+static void present_posted_frame(gameboy *gb)
+{
+    gb_mailbox *mailbox = gb->mailbox;
+    pthread_mutex_lock(&mailbox->lock);
+
+    bool present = mailbox->frame_ready && !mailbox->frame_presented && !mailbox_closed(mailbox);
+    if (present)
+    {
+        SDL_UpdateTexture(gb->screen,
+                          NULL,
+                          mailbox->frame_buffer,
+                          FRAME_WIDTH * sizeof mailbox->frame_buffer[0]);
+        mailbox->frame_presented = true;
+    }
+
+    pthread_mutex_unlock(&mailbox->lock);
+
+    if (present)
+    {
+        SDL_RenderClear(gb->renderer);
+        SDL_RenderCopy(gb->renderer, gb->screen, NULL, NULL);
+        SDL_RenderPresent(gb->renderer);
+    }
+}
+
+// let a Game Boy whose frame has been presented carry on
+static void release_presented_frame(gb_mailbox *mailbox)
+{
+    pthread_mutex_lock(&mailbox->lock);
+    if (mailbox->frame_presented)
+    {
+        mailbox->frame_ready = false;
+        mailbox->frame_presented = false;
+        pthread_cond_broadcast(&mailbox->presented);
+    }
+    pthread_mutex_unlock(&mailbox->lock);
+}
+
+static void mark_finished(gb_mailbox *mailbox)
+{
+    pthread_mutex_lock(&mailbox->lock);
+    mailbox->finished = true;
+    pthread_mutex_unlock(&mailbox->lock);
+}
+
+static bool all_finished(gb_mailbox *mailboxes, int num_gbs)
+{
+    bool finished = true;
+    for (int i = 0; i < num_gbs; ++i)
+    {
+        pthread_mutex_lock(&mailboxes[i].lock);
+        finished = finished && mailboxes[i].finished;
+        pthread_mutex_unlock(&mailboxes[i].lock);
+    }
+
+    return finished;
+}
+
+static void *run_gameboy_thread(void *arg)
+{
+    gameboy_thread *thread = arg;
+    gameboy *gb = thread->gb;
+    gb->run(gb);
+
+    if (thread->finished)
+        thread->finished(gb);
+
+    mark_finished(gb->mailbox);
+    wake_main_thread();
+    return NULL;
+}
+
+void run_gameboys(gameboy *gbs[], int num_gbs, void (*finished)(gameboy *gb))
+{
+    gb_mailbox *mailboxes = calloc(num_gbs, sizeof(gb_mailbox));
+    gameboy_thread *threads = calloc(num_gbs, sizeof(gameboy_thread));
+    if (mailboxes == NULL || threads == NULL)
+    {
+        LOG_ERROR("Not enough memory to run the Game Boy\n");
+        free(mailboxes);
+        free(threads);
+        return;
+    }
+
+    frame_posted_event = SDL_RegisterEvents(1);
+
+    for (int i = 0; i < num_gbs; ++i)
+    {
+        gb_mailbox *mailbox = &mailboxes[i];
+        pthread_mutex_init(&mailbox->lock, NULL);
+        pthread_cond_init(&mailbox->presented, NULL);
+        atomic_init(&mailbox->head, 0);
+        atomic_init(&mailbox->tail, 0);
+        atomic_init(&mailbox->closed, false);
+
+        threads[i] = (gameboy_thread){.gb = gbs[i], .finished = finished};
+        gbs[i]->mailbox = mailbox;
+        gbs[i]->next_input_check = 0;
+        sync_input_time(gbs[i]);
+    }
+
+    int num_started = 0;
+    while (num_started < num_gbs
+           && !pthread_create(&threads[num_started].thread, NULL, run_gameboy_thread, &threads[num_started]))
+        ++num_started;
+
+    if (num_started < num_gbs)
+    {
+        LOG_ERROR("Failed to start a thread for each Game Boy\n");
+        for (int i = 0; i < num_gbs; ++i)
+            close_mailbox(&mailboxes[i]);
+
+        for (int i = num_started; i < num_gbs; ++i)
+        {
+            if (finished)
+                finished(gbs[i]);
+            mark_finished(&mailboxes[i]);
+        }
+    }
+
+    while (!all_finished(mailboxes, num_gbs))
+    {
+        // wake up when a frame's posted, or at least once a millisecond
+        SDL_Event event;
+        if (SDL_WaitEventTimeout(&event, 1))
+            route_input_event(gbs, num_gbs, &event);
+        read_input(gbs, num_gbs);
+
+        for (int i = 0; i < num_gbs; ++i)
+            present_posted_frame(gbs[i]);
+
+        /* The Game Boys carry on once the input that came in meanwhile
+         * has been read, so they see it as soon as they would have by
+         * reading it themselves once the frame was presented
+         */
+        read_input(gbs, num_gbs);
+        for (int i = 0; i < num_gbs; ++i)
+            release_presented_frame(&mailboxes[i]);
+    }
+
+    for (int i = 0; i < num_started; ++i)
+        pthread_join(threads[i].thread, NULL);
+
+    for (int i = 0; i < num_gbs; ++i)
+    {
+        gbs[i]->mailbox = NULL;
+        pthread_cond_destroy(&mailboxes[i].presented);
+        pthread_mutex_destroy(&mailboxes[i].lock);
+    }
+
+    free(mailboxes);
+    free(threads);
+}
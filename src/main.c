@@ -1,23 +1,168 @@
+#include <errno.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include "cboy/cartridge.h"
 #include "cboy/gameboy.h"
 #include "cboy/joypad.h"
+#include "cboy/library.h"
+#include "cboy/link.h"
+#include "cboy/mailbox.h"
+#include "cboy/socklink.h"
 #include "cboy/mbc.h"
+#include "cboy/pacer.h"
+#include "cboy/speed.h"
 #include "cboy/log.h"
 
 static inline void usage(const char *progname)
 {
-    const char *usage_str = "Usage: %s [-123456m] [-b bootrom] <romfile>\n"
+    const char *usage_str = "Usage: %s [-123456m] [-b bootrom [-c cachedir]] [-f hashfile | -g hashfile] [-s statefile]\n"
+                            "          [-r movie | -p movie] [-t timesource] [-P sync] [-F speed] [-R render]\n"
+                            "          [-A audio] [-l romfile | -u socket] <romfile>\n"
+                            "       %s [options] -L libdir [title | hash]\n"
                             "Options:\n"
                             "  -123456  Scale the window by 1x through 6x, respectively.\n"
                             "             By default, the window is scaled by %dx.\n"
                             "  -m       Force the emulator to run in monochrome mode.\n"
-                            "  -b       Specify a boot ROM file to play before running the game ROM.\n";
-    LOG_ERROR(usage_str, progname, DEFAULT_WINDOW_SCALE);
+                            "  -b       Specify a boot ROM file to play before running the game ROM.\n"
+                            "  -c       Save the state after the boot ROM in the given directory, and start\n"
+                            "             from it instead of running the boot ROM when it's been saved.\n"
+                            "  -f       Record a hash of every frame to the given file.\n"
+                            "  -g       Compare every frame against the hashes in the given (golden) file,\n"
+                            "             stopping at the first mismatch.\n"
+                            "  -s       Record a hash of the full emulation state of every frame to the given file.\n"
+                            "  -r       Record the joypad input of every frame to the given movie file.\n"
+                            "  -p       Play back the joypad input from the given movie file.\n"
+                            "  -t       Where the cartridge RTC gets the current time from: 'wall' (default),\n"
+                            "             'fixed[=epoch]', or 'emulated[=epoch]'. The epoch is a UNIX time\n"
+                            "             in seconds (default 0).\n"
+                            "  -P       How to keep emulation at the Game Boy's speed: 'audio' (default) waits\n"
+                            "             for the audio to play, 'clock' presents frames at 59.7275 Hz on\n"
+                            "             the host's clock, and 'vsync' at the display's refresh rate.\n"
+                            "  -F       How fast <Tab> runs the emulator: '2', '4', or '8' times the Game Boy's\n"
+                            "             speed, or 'max' (default) for as fast as possible.\n"
+                            "  -R       When to draw the screen: 'scanline' (default) draws each line as it's\n"
+                            "             reached, and 'frame' logs what each line is drawn from and draws\n"
+                            "             them all at once at the end of the frame. 'thread' draws them on\n"
+                            "             another thread while the next frame runs, showing each a frame late.\n"
+                            "  -A       Where audio is synthesized: 'inline' (default) on the emulation thread,\n"
+                            "             or 'thread' on a worker thread of its own.\n"
+                            "  -l       Run the given game as well, in a window of its own, with a link cable\n"
+                            "             connecting the two Game Boys. Hashing and movies only apply to the\n"
+                            "             first game.\n"
+                            "  -u       Connect a link cable to another instance of the emulator through the\n"
+                            "             UNIX socket at the given path, waiting for it if it's not there yet.\n"
+                            "             Can't be used with hashing or movies.\n"
+                            "  -L       Index the ROMs in the given directory. With no other argument, list\n"
+                            "             them; otherwise run the one whose title contains the given text\n"
+                            "             or whose hash is the given hash.\n";
+    LOG_ERROR(usage_str, progname, progname, DEFAULT_WINDOW_SCALE);
+}
+
+/* Parse a time source of the form "name[=epoch]".
+ * Returns false if the time source is invalid.
+ */
+static bool parse_time_source(const char *arg, struct gb_init_args *args)
+{
+    const char *names[] = {"wall", "fixed", "emulated"};
+    const enum TIME_SOURCE sources[] = {TIME_SOURCE_WALL, TIME_SOURCE_FIXED, TIME_SOURCE_EMULATED};
+
+    for (size_t i = 0; i < sizeof names / sizeof names[0]; ++i)
+    {
+        size_t len = strlen(names[i]);
+        if (strncmp(arg, names[i], len))
+            continue;
+
+        args->time_source = sources[i];
+        args->time_epoch = 0;
+
+        if (arg[len] == '\0')
+            return true;
+        else if (arg[len] != '=' || sources[i] == TIME_SOURCE_WALL)
+            return false;
+
+        char *end;
+        errno = 0;
+        args->time_epoch = strtoull(arg + len + 1, &end, 10);
+        return !errno && *end == '\0' && end != arg + len + 1;
+    }
+
+    return false;
+}
+
+// Parse a sync mode. Returns false if it's invalid.
+static bool parse_sync_mode(const char *arg, struct gb_init_args *args)
+{
+    const char *names[] = {"audio", "clock", "vsync"};
+    const enum SYNC_MODE modes[] = {SYNC_AUDIO, SYNC_CLOCK, SYNC_VSYNC};
+
+    for (size_t i = 0; i < sizeof names / sizeof names[0]; ++i)
+    {
+        if (!strcmp(arg, names[i]))
+        {
+            args->sync_mode = modes[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Parse a render mode. Returns false if it's invalid.
+static bool parse_render_mode(const char *arg, struct gb_init_args *args)
+{
+    const char *names[] = {"scanline", "frame", "thread"};
+    const enum RENDER_MODE modes[] = {RENDER_SCANLINE, RENDER_FRAME, RENDER_THREAD};
+
+    for (size_t i = 0; i < sizeof names / sizeof names[0]; ++i)
+    {
+        if (!strcmp(arg, names[i]))
+        {
+            args->render_mode = modes[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Parse an audio mode. Returns false if it's invalid.
+static bool parse_audio_mode(const char *arg, struct gb_init_args *args)
+{
+    const char *names[] = {"inline", "thread"};
+    const enum AUDIO_MODE modes[] = {AUDIO_INLINE, AUDIO_THREAD};
+
+    for (size_t i = 0; i < sizeof names / sizeof names[0]; ++i)
+    {
+        if (!strcmp(arg, names[i]))
+        {
+            args->audio_mode = modes[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Parse a fast-forward speed. Returns false if it's invalid.
+static bool parse_fast_forward_speed(const char *arg, struct gb_init_args *args)
+{
+    const char *names[] = {"2", "4", "8", "max"};
+    const uint8_t speeds[] = {2, 4, 8, UNCAPPED_SPEED};
+
+    for (size_t i = 0; i < sizeof names / sizeof names[0]; ++i)
+    {
+        if (!strcmp(arg, names[i]))
+        {
+            args->fast_forward_speed = speeds[i];
+            return true;
+        }
+    }
+
+    return false;
 }
 
 int main(int argc, char *argv[])
@@ -34,14 +179,29 @@ int main(int argc, char *argv[])
     opterr = false;
     int opt;
     const char *progname = argv[0];
+    const char *library_dir = NULL;
+    char *linked_romfile = NULL;
+    const char *link_socket = NULL;
     struct gb_init_args init_args = {
         .bootrom = NULL,
         .romfile = NULL,
         .force_dmg = false,
         .window_scale = DEFAULT_WINDOW_SCALE,
+        .frame_hash_mode = FRAME_HASH_OFF,
+        .frame_hash_file = NULL,
+        .state_hash_file = NULL,
+        .movie_mode = MOVIE_OFF,
+        .movie_file = NULL,
+        .time_source = TIME_SOURCE_WALL,
+        .time_epoch = 0,
+        .boot_cache_dir = NULL,
+        .sync_mode = SYNC_AUDIO,
+        .render_mode = RENDER_SCANLINE,
+        .audio_mode = AUDIO_INLINE,
+        .fast_forward_speed = UNCAPPED_SPEED,
     };
 
-    while ((opt = getopt(argc, argv, "123456mb:")) != -1)
+    while ((opt = getopt(argc, argv, "123456mb:c:f:g:s:r:p:t:P:F:R:A:l:u:L:")) != -1)
     {
         switch (opt)
         {
@@ -54,6 +214,83 @@ int main(int argc, char *argv[])
                 init_args.force_dmg = true;
                 break;
 
+            case 'c':
+                init_args.boot_cache_dir = optarg;
+                break;
+
+            case 'f':
+            case 'g':
+                init_args.frame_hash_mode = opt == 'f' ? FRAME_HASH_RECORD : FRAME_HASH_VERIFY;
+                init_args.frame_hash_file = optarg;
+                break;
+
+            case 's':
+                init_args.state_hash_file = optarg;
+                break;
+
+            case 'r':
+            case 'p':
+                init_args.movie_mode = opt == 'r' ? MOVIE_RECORD : MOVIE_REPLAY;
+                init_args.movie_file = optarg;
+                break;
+
+            case 't':
+                if (!parse_time_source(optarg, &init_args))
+                {
+                    LOG_ERROR("Invalid time source: %s\n", optarg);
+                    usage(progname);
+                    return 2;
+                }
+                break;
+
+            case 'P':
+                if (!parse_sync_mode(optarg, &init_args))
+                {
+                    LOG_ERROR("Invalid sync mode: %s\n", optarg);
+                    usage(progname);
+                    return 2;
+                }
+                break;
+
+            case 'F':
+                if (!parse_fast_forward_speed(optarg, &init_args))
+                {
+                    LOG_ERROR("Invalid fast-forward speed: %s\n", optarg);
+                    usage(progname);
+                    return 2;
+                }
+                break;
+
+            case 'R':
+                if (!parse_render_mode(optarg, &init_args))
+                {
+                    LOG_ERROR("Invalid render mode: %s\n", optarg);
+                    usage(progname);
+                    return 2;
+                }
+                break;
+
+            case 'A':
+                if (!parse_audio_mode(optarg, &init_args))
+                {
+                    LOG_ERROR("Invalid audio mode: %s\n", optarg);
+                    usage(progname);
+                    return 2;
+                }
+                break;
+
+            case 'l':
+                linked_romfile = optarg;
+                break;
+
+            case 'u':
+                link_socket = optarg;
+                break;
+
+            case 'L':
+                library_dir = optarg;
+                break;
+
             case '1':
             case '2':
             case '3':
@@ -66,6 +303,30 @@ int main(int argc, char *argv[])
             case '?':
                 if (optopt == 'b')
                     LOG_ERROR("Option '%c' specified but no boot ROM was given\n", optopt);
+                else if (optopt == 'c')
+                    LOG_ERROR("Option '%c' specified but no boot snapshot directory was given\n", optopt);
+                else if (optopt == 'f' || optopt == 'g')
+                    LOG_ERROR("Option '%c' specified but no frame hash file was given\n", optopt);
+                else if (optopt == 's')
+                    LOG_ERROR("Option '%c' specified but no state hash file was given\n", optopt);
+                else if (optopt == 'r' || optopt == 'p')
+                    LOG_ERROR("Option '%c' specified but no movie file was given\n", optopt);
+                else if (optopt == 't')
+                    LOG_ERROR("Option '%c' specified but no time source was given\n", optopt);
+                else if (optopt == 'P')
+                    LOG_ERROR("Option '%c' specified but no sync mode was given\n", optopt);
+                else if (optopt == 'F')
+                    LOG_ERROR("Option '%c' specified but no fast-forward speed was given\n", optopt);
+                else if (optopt == 'R')
+                    LOG_ERROR("Option '%c' specified but no render mode was given\n", optopt);
+                else if (optopt == 'A')
+                    LOG_ERROR("Option '%c' specified but no audio mode was given\n", optopt);
+                else if (optopt == 'l')
+                    LOG_ERROR("Option '%c' specified but no linked ROM was given\n", optopt);
+                else if (optopt == 'u')
+                    LOG_ERROR("Option '%c' specified but no socket path was given\n", optopt);
+                else if (optopt == 'L')
+                    LOG_ERROR("Option '%c' specified but no ROM library directory was given\n", optopt);
                 else
                     LOG_ERROR("Unrecognized option: '%c'\n", optopt);
                 // fallthrough
@@ -77,20 +338,74 @@ int main(int argc, char *argv[])
     }
 
     // we don't allow extraneous non-option arguments
-    if (optind != argc - 1)
+    if (optind != argc - 1 && !(library_dir && optind == argc))
     {
         usage(progname);
         return 1;
     }
+
+    // a rollback can't be undone in a hash file or movie, and -l links the game to another one already
+    if (link_socket && (linked_romfile
+                        || init_args.frame_hash_mode != FRAME_HASH_OFF
+                        || init_args.state_hash_file
+                        || init_args.movie_mode != MOVIE_OFF))
+    {
+        LOG_ERROR("Option 'u' can't be used with '-l', '-f', '-g', '-s', '-r', or '-p'\n");
+        return 1;
+    }
+
+    gb_library *library = NULL;
+    if (library_dir)
+    {
+        library = open_library(library_dir);
+        if (library == NULL)
+            return 1;
+
+        // no game given, so just list the library
+        if (optind == argc)
+        {
+            print_library(library, NULL);
+            free_library(library);
+            return 0;
+        }
+
+        gb_library_entry *entry;
+        size_t num_matches = find_in_library(library, argv[optind], &entry);
+        if (num_matches != 1)
+        {
+            if (!num_matches)
+            {
+                LOG_ERROR("No ROM in the library matches '%s'\n", argv[optind]);
+            }
+            else
+            {
+                LOG_ERROR("%zu ROMs in the library match '%s':\n", num_matches, argv[optind]);
+                print_library(library, argv[optind]);
+            }
+
+            free_library(library);
+            return 1;
+        }
+
+        init_args.romfile = entry->path;
+    }
     else // only one non-option argument -- the romfile
     {
         init_args.romfile = argv[optind];
     }
 
+    // linked Game Boys' frames are presented by the main thread, which can't wait on both displays
+    if (linked_romfile && init_args.sync_mode == SYNC_VSYNC)
+    {
+        LOG_INFO("Note: Linked Game Boys can't sync to the display, so they sync to audio.\n");
+        init_args.sync_mode = SYNC_AUDIO;
+    }
+
     gameboy *gb = init_gameboy(&init_args);
 
     if (gb == NULL)
     {
+        free_library(library);
         return 1;
     }
 
@@ -103,16 +418,69 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
+    gameboy *linked_gb = NULL;
+    struct gb_init_args linked_args = init_args;
+    if (linked_romfile)
+    {
+        linked_args.romfile = linked_romfile;
+        linked_args.frame_hash_mode = FRAME_HASH_OFF;
+        linked_args.state_hash_file = NULL;
+        linked_args.movie_mode = MOVIE_OFF;
+
+        linked_gb = init_gameboy(&linked_args);
+        if (linked_gb == NULL)
+        {
+            free_gameboy(gb);
+            free_library(library);
+            return 1;
+        }
+
+        LOG_INFO("Linked game:\n");
+        print_rom_title(linked_gb->cart);
+        print_mbc_type(linked_gb->cart->mbc_type);
+
+        if (!mbc_supported(linked_gb->cart->mbc_type))
+        {
+            LOG_ERROR("Note: This MBC is not supported yet. Exiting...\n");
+            exit(1);
+        }
+
+        if (!strcmp(linked_romfile, init_args.romfile))
+            LOG_INFO("Note: Both games save to the same file, so only the first one's RAM is saved.\n");
+    }
+
+    if (link_socket && !open_socket_link(gb, link_socket))
+    {
+        free_gameboy(gb);
+        free_library(library);
+        return 1;
+    }
+
     print_button_mappings(gb->run_mode);
 
     report_volume_level(gb, true);
 
-    run_gameboy(gb);
+    if (linked_gb)
+        run_linked_gameboys(gb, linked_gb);
+    else
+        run_gameboys(&gb, 1, NULL);
+
+    if (link_socket)
+        close_socket_link(gb);
 
     save_cartridge_ram(gb->cart, init_args.romfile);
+    if (linked_gb && strcmp(linked_romfile, init_args.romfile))
+        save_cartridge_ram(linked_gb->cart, linked_romfile);
 
     LOG_INFO("\n\nFrames rendered: %" PRIu64 "\n", gb->ppu->frames_rendered);
+    if (gb->pacer)
+        print_pacer_stats(gb->pacer);
+
+    int status = gb->frame_hasher && gb->frame_hasher->mismatch_found ? 3 : 0;
 
+    if (linked_gb)
+        free_gameboy(linked_gb);
     free_gameboy(gb);
-    return 0;
+    free_library(library);
+    return status;
 }
@@ -12,8 +12,7 @@
               "This is a bug.\n"); \
     exit(1);
 
-/* print out the cartridge MBC type */
-void print_mbc_type(MBC_TYPE mbc_type)
+const char *mbc_type_name(MBC_TYPE mbc_type)
 {
     const char *mbc_type_c;
 
@@ -65,7 +64,13 @@ void print_mbc_type(MBC_TYPE mbc_type)
             break;
     }
 
-    LOG_INFO("MBC Type: %s\n", mbc_type_c);
+    return mbc_type_c;
+}
+
+/* print out the cartridge MBC type */
+void print_mbc_type(MBC_TYPE mbc_type)
+{
+    LOG_INFO("MBC Type: %s\n", mbc_type_name(mbc_type));
 }
 
 bool mbc_supported(MBC_TYPE mbc_type)
@@ -88,13 +93,38 @@ bool mbc_supported(MBC_TYPE mbc_type)
     return supported;
 }
 
+// unsupported MBCs - should never be called
+static uint8_t unsupported_mbc_read(gameboy *gb, uint16_t address)
+{
+    (void)gb;
+    (void)address;
+    EXIT_INCONSISTENT_STATE();
+}
+
+static void unsupported_mbc_write(gameboy *gb, uint16_t address, uint8_t value)
+{
+    (void)gb;
+    (void)address;
+    (void)value;
+    EXIT_INCONSISTENT_STATE();
+}
+
 void init_mbc(MBC_TYPE mbc_type, cartridge_mbc *mbc)
 {
     mbc->mbc_type = mbc_type;
+    mbc->current_rom_bank_ptr[0] = mbc->current_rom_bank_ptr[1] = NULL;
+    mbc->current_ram_bank_ptr = NULL;
 
     switch (mbc_type)
     {
+        case NO_MBC:
+            mbc->read = no_mbc_read;
+            mbc->write = no_mbc_write;
+            break;
+
         case MBC1:
+            mbc->read = mbc1_read;
+            mbc->write = mbc1_write;
             mbc->mbc1.ram_enabled = false;
             mbc->mbc1.rom_bankno = 0;
             mbc->mbc1.ram_bankno = 0;
@@ -102,6 +132,8 @@ void init_mbc(MBC_TYPE mbc_type, cartridge_mbc *mbc)
             break;
 
         case MBC3:
+            mbc->read = mbc3_read;
+            mbc->write = mbc3_write;
             mbc->mbc3.ram_and_rtc_enabled = false;
             mbc->mbc3.rom_bankno = 0;
             mbc->mbc3.ram_or_rtc_select = 0;
@@ -120,72 +152,63 @@ void init_mbc(MBC_TYPE mbc_type, cartridge_mbc *mbc)
             break;
 
         case MBC5:
+            mbc->read = mbc5_read;
+            mbc->write = mbc5_write;
             mbc->mbc5.ram_enabled = false;
             mbc->mbc5.lsb_rom_bankno = 1;
             mbc->mbc5.bit9_rom_bankno = false;
             mbc->mbc5.ram_bankno = 0;
             break;
 
-        // NO_MBC or unsupported MBC, will not
-        // be used, no need to initialize
+        // unsupported MBC, will not be used
         default:
+            mbc->read = unsupported_mbc_read;
+            mbc->write = unsupported_mbc_write;
             break;
     }
 }
 
-uint8_t cartridge_read(gameboy *gb, uint16_t address)
+void map_cartridge_banks(gb_cartridge *cart)
 {
-    uint8_t value;
-    switch(gb->cart->mbc_type)
+    switch (cart->mbc_type)
     {
         case NO_MBC:
-            value = no_mbc_read(gb, address);
+            no_mbc_map_banks(cart);
             break;
 
         case MBC1:
-            value = mbc1_read(gb, address);
+            mbc1_map_banks(cart);
             break;
 
         case MBC3:
-            value = mbc3_read(gb, address);
+            mbc3_map_banks(cart);
             break;
 
         case MBC5:
-            value = mbc5_read(gb, address);
+            mbc5_map_banks(cart);
             break;
 
-        // unsupported MBCs - should not get here
+        // unsupported MBCs never have their banks accessed
         default:
-            EXIT_INCONSISTENT_STATE();
             break;
     }
-
-    return value;
 }
 
-void cartridge_write(gameboy *gb, uint16_t address, uint8_t value)
+const uint8_t *cartridge_rom_bank(gameboy *gb, uint16_t address)
 {
-    switch(gb->cart->mbc_type)
-    {
-        case NO_MBC:
-            no_mbc_write(gb, address, value);
-            break;
-
-        case MBC1:
-            mbc1_write(gb, address, value);
-            break;
+    return gb->cart->mbc->current_rom_bank_ptr[address >> 14];
+}
 
-        case MBC3:
-            mbc3_write(gb, address, value);
-            break;
+uint8_t cartridge_read(gameboy *gb, uint16_t address)
+{
+    // every MBC maps ROM the same way, given the current banks
+    if (address <= 0x7fff)
+        return gb->cart->mbc->current_rom_bank_ptr[address >> 14][address & 0x3fff];
 
-        case MBC5:
-            mbc5_write(gb, address, value);
-            break;
+    return gb->cart->mbc->read(gb, address);
+}
 
-        // unsupported MBCs - should not get here
-        default:
-            EXIT_INCONSISTENT_STATE();
-            break;
-    }
+void cartridge_write(gameboy *gb, uint16_t address, uint8_t value)
+{
+    gb->cart->mbc->write(gb, address, value);
 }
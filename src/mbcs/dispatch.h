@@ -4,6 +4,12 @@
 #include <stdint.h>
 #include "cboy/mbc.h"
 #include "cboy/gameboy.h"
+#include "cboy/cartridge.h"
+
+void no_mbc_map_banks(gb_cartridge *cart);
+void mbc1_map_banks(gb_cartridge *cart);
+void mbc3_map_banks(gb_cartridge *cart);
+void mbc5_map_banks(gb_cartridge *cart);
 
 uint8_t no_mbc_read(gameboy *gb, uint16_t address);
 uint8_t mbc1_read(gameboy *gb, uint16_t address);
@@ -125,34 +125,38 @@ static void handle_rtc_writes(cartridge_mbc3 *mbc, uint8_t value)
     }
 }
 
+void mbc3_map_banks(gb_cartridge *cart)
+{
+    cartridge_mbc3 *mbc = &cart->mbc->mbc3;
+
+    // ROM banks 0x01-0x7f, ignoring bits beyond those needed to address ROM banks
+    uint16_t rom_bitmask = (1 << cart->rom_banks_bitsize) - 1;
+    cart->mbc->current_rom_bank_ptr[0] = cart->rom_banks[0];
+    cart->mbc->current_rom_bank_ptr[1] = cart->rom_banks[mbc->rom_bankno & rom_bitmask];
+
+    // 0x00-0x03 = RAM bank select, 0x08-0x0c = RTC select
+    uint8_t bankno = mbc->ram_or_rtc_select;
+    cart->mbc->current_ram_bank_ptr = mbc->ram_and_rtc_enabled && bankno <= 0x03
+                                      && bankno < cart->num_ram_banks
+                                      ? cart->ram_banks[bankno]
+                                      : NULL;
+}
+
 uint8_t mbc3_read(gameboy *gb, uint16_t address)
 {
     cartridge_mbc3 *mbc = &gb->cart->mbc->mbc3;
 
     uint8_t value = 0xff; // open bus
-    uint8_t bankno;
-    // to ignore bits beyond those needed to address ROM banks
-    uint16_t rom_bitmask = (1 << gb->cart->rom_banks_bitsize) - 1;
 
-    if (address <= 0x3fff) // ROM bank 0
-        value = gb->cart->rom_banks[0][address];
-    else if (address <= 0x7fff) // ROM banks 0x01-0x7f
+    uint8_t *ram_bank = gb->cart->mbc->current_ram_bank_ptr;
+    if (ram_bank) // RAM
     {
-        bankno = mbc->rom_bankno & rom_bitmask;
-        value = gb->cart->rom_banks[bankno][address - 0x4000];
+        value = ram_bank[address - 0xa000];
     }
-    else if (0xa000 <= address && address <= 0xbfff && mbc->ram_and_rtc_enabled) // RAM or RTC
+    else if (mbc->ram_and_rtc_enabled
+             && 0x08 <= mbc->ram_or_rtc_select && mbc->ram_or_rtc_select <= 0x0c) // RTC
     {
-        if (mbc->ram_or_rtc_select <= 0x03) // RAM
-        {
-            uint8_t bankno = mbc->ram_or_rtc_select;
-            if (bankno < gb->cart->num_ram_banks)
-                value = gb->cart->ram_banks[bankno][address - 0xa000];
-        }
-        else if (0x08 <= mbc->ram_or_rtc_select && mbc->ram_or_rtc_select <= 0x0c) // RTC
-        {
-            value = mbc->rtc_latched_values[mbc->ram_or_rtc_select - 0x08];
-        }
+        value = mbc->rtc_latched_values[mbc->ram_or_rtc_select - 0x08];
     }
 
     return value;
@@ -168,11 +172,14 @@ void mbc3_write(gameboy *gb, uint16_t address, uint8_t value)
             mbc->ram_and_rtc_enabled = true;
         else if (!value)
             mbc->ram_and_rtc_enabled = false;
+
+        mbc3_map_banks(gb->cart);
     }
     else if (address <= 0x3fff) // ROM bank number
     {
         uint8_t register_val = value & 0x7f;
         mbc->rom_bankno = register_val ? register_val : 0x01;
+        mbc3_map_banks(gb->cart);
     }
     else if (address <= 0x5fff) // RAM bank or RTC select
     {
@@ -181,6 +188,8 @@ void mbc3_write(gameboy *gb, uint16_t address, uint8_t value)
                            || (0x08 <= value && value <= 0x0c);
         if (valid_write)
             mbc->ram_or_rtc_select = value;
+
+        mbc3_map_banks(gb->cart);
     }
     else if (address <= 0x7fff) // RTC latch
     {
@@ -190,17 +199,13 @@ void mbc3_write(gameboy *gb, uint16_t address, uint8_t value)
 
         mbc->rtc_latch = value;
     }
-    else if (0xa000 <= address && address <= 0xbfff && mbc->ram_and_rtc_enabled) // RAM or RTC
+    else if (0xa000 <= address && address <= 0xbfff) // RAM or RTC
     {
-        if (mbc->ram_or_rtc_select <= 0x03) // RAM
-        {
-            uint8_t bankno = mbc->ram_or_rtc_select;
-            if (bankno < gb->cart->num_ram_banks)
-                gb->cart->ram_banks[bankno][address - 0xa000] = value;
-        }
-        else if (0x08 <= mbc->ram_or_rtc_select && mbc->ram_or_rtc_select <= 0x0c) // RTC
-        {
+        uint8_t *ram_bank = gb->cart->mbc->current_ram_bank_ptr;
+        if (ram_bank) // RAM
+            ram_bank[address - 0xa000] = value;
+        else if (mbc->ram_and_rtc_enabled
+                 && 0x08 <= mbc->ram_or_rtc_select && mbc->ram_or_rtc_select <= 0x0c) // RTC
             handle_rtc_writes(mbc, value);
-        }
     }
 }
@@ -1,20 +1,21 @@
 #include "dispatch.h"
 #include "cboy/log.h"
 
+void no_mbc_map_banks(gb_cartridge *cart)
+{
+    // ROM banks 0 and 1, and 0 or 1 RAM banks
+    cart->mbc->current_rom_bank_ptr[0] = cart->rom_banks[0];
+    cart->mbc->current_rom_bank_ptr[1] = cart->rom_banks[1];
+    cart->mbc->current_ram_bank_ptr = cart->num_ram_banks ? cart->ram_banks[0] : NULL;
+}
+
 uint8_t no_mbc_read(gameboy *gb, uint16_t address)
 {
     uint8_t value = 0xff; // open bus value
 
-    if (address <= 0x3fff) // ROM bank 0
-        value = gb->cart->rom_banks[0][address];
-    else if (address <= 0x7fff) // ROM bank 1
-        value = gb->cart->rom_banks[1][address - 0x4000];
-    else if (0xa000 <= address && address <= 0xbfff) // RAM
-    {
-        // cartridge has 0 or 1 RAM banks
-        if (gb->cart->num_ram_banks)
-            value = gb->cart->ram_banks[0][address - 0xa000];
-    }
+    uint8_t *ram_bank = gb->cart->mbc->current_ram_bank_ptr;
+    if (ram_bank)
+        value = ram_bank[address - 0xa000];
 
     return value;
 }
@@ -24,8 +25,8 @@ void no_mbc_write(gameboy *gb, uint16_t address, uint8_t value)
     // only allow writes to RAM
     if (0xa000 <= address && address <= 0xbfff)
     {
-        // 0 or 1 RAM banks
-        if (gb->cart->num_ram_banks)
-            gb->cart->ram_banks[0][address - 0xa000] = value;
+        uint8_t *ram_bank = gb->cart->mbc->current_ram_bank_ptr;
+        if (ram_bank)
+            ram_bank[address - 0xa000] = value;
     }
 }
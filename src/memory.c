@@ -11,6 +11,7 @@
 #include "cboy/cartridge.h"
 #include "cboy/mbc.h"
 #include "cboy/ppu.h"
+#include "cboy/serial.h"
 #include "cboy/log.h"
 
 // Determine which WRAM bank to map to the given address
@@ -21,7 +22,7 @@ static int get_wram_bank(gameboy *gb, uint16_t address)
 
     // translate to which physical bank is mapped
     int bankno;
-    if (gb->run_mode == GB_CGB_MODE && mmap_bank)
+    if (IS_CGB_MODE(gb) && mmap_bank)
     {
         int svbk = gb->svbk & 0x7;
         bankno = svbk ? svbk : 1;
@@ -41,7 +42,7 @@ uint8_t ram_read(gameboy *gb, uint16_t address)
     if (address >= 0x8000 && address <= 0x9fff)
     {
         uint16_t offset = address & 0x1fff;
-        bool bankno = gb->run_mode == GB_CGB_MODE && gb->vbk & 1;
+        bool bankno = IS_CGB_MODE(gb) && gb->vbk & 1;
         value = mem->vram[bankno][offset];
     }
     else if (address >= 0xc000 && address <= 0xfdff)
@@ -75,8 +76,10 @@ void ram_write(gameboy *gb, uint16_t address, uint8_t value)
     if (address >= 0x8000 && address <= 0x9fff)
     {
         uint16_t offset = address & 0x1fff;
-        bool bankno = gb->run_mode == GB_CGB_MODE && gb->vbk & 1;
+        bool bankno = IS_CGB_MODE(gb) && gb->vbk & 1;
         mem->vram[bankno][offset] = value;
+        if (gb->ppu->frame_log)
+            log_frame_write(gb->ppu->frame_log, FRAME_LOG_VRAM0 + bankno, offset, value);
     }
     else if (address >= 0xc000 && address <= 0xfdff)
     {
@@ -87,6 +90,8 @@ void ram_write(gameboy *gb, uint16_t address, uint8_t value)
     else if (address >= 0xfe00 && address <= 0xfe9f)
     {
         mem->oam[address & 0xff] = value;
+        if (gb->ppu->frame_log)
+            log_frame_write(gb->ppu->frame_log, FRAME_LOG_OAM, address & 0xff, value);
     }
     else if (address >= 0xff80 && address <= 0xfffe)
     {
@@ -101,114 +106,164 @@ void ram_write(gameboy *gb, uint16_t address, uint8_t value)
     }
 }
 
-static uint8_t io_register_read(gameboy *gb, uint16_t address)
+/* I/O register handlers
+ * ~~~~~~~~~~~~~~~~~~~~~
+ * Most registers are handled by the component they belong to.
+ * The ones below adapt the remaining registers to the table's
+ * handler signatures.
+ */
+static uint8_t unmapped_io_read(gameboy *gb, uint16_t address)
 {
-    uint8_t value = 0xff;
-    if (address == JOYP_REGISTER)
-    {
-        value = report_button_states(gb);
-    }
-    else if (address >= DIV_REGISTER && address <= TAC_REGISTER)
-    {
-        value = timing_related_read(gb, address);
-    }
-    else if (address == IF_REGISTER)
-    {
-        value = interrupt_register_read(gb->cpu, IF_REGISTER);
-    }
-    else if (address >= NR10_REGISTER && address <= WAVE_RAM_STOP)
-    {
-        value = apu_read(gb, address);
-    }
-    else if (address >= LCDC_REGISTER && address <= WX_REGISTER)
-    {
-        value = ppu_read(gb, address);
-    }
-    else if (address == VBK_REGISTER && gb->run_mode == GB_CGB_MODE)
-    {
-        value = cgb_core_io_read(gb, VBK_REGISTER);
-    }
-    else if (address == BRD_REGISTER)
-    {
-        value = gb->boot_rom_disabled;
-    }
-    else if (address >= HDMA1_REGISTER && address <= HDMA5_REGISTER && gb->run_mode == GB_CGB_MODE)
-    {
-        cgb_core_io_read(gb, address);
-    }
-    else if (address >= BCPS_REGISTER && address <= OPRI_REGISTER && gb->run_mode == GB_CGB_MODE)
-    {
-        value = ppu_read(gb, address);
-    }
-    else if (address == SVBK_REGISTER && gb->run_mode == GB_CGB_MODE)
-    {
-        value = cgb_core_io_read(gb, SVBK_REGISTER);
-    }
-    else if (address == IE_REGISTER)
-    {
-        value = interrupt_register_read(gb->cpu, IE_REGISTER);
-    }
-    else if (address == KEY1_REGISTER && gb->run_mode == GB_CGB_MODE)
-    {
-        value = cgb_core_io_read(gb, KEY1_REGISTER);
-    }
+    (void)gb;
+    (void)address;
+    return 0xff;
+}
 
-    return value;
+static void unmapped_io_write(gameboy *gb, uint16_t address, uint8_t value)
+{
+    (void)gb;
+    (void)address;
+    (void)value;
 }
 
-static void io_register_write(gameboy *gb, uint16_t address, uint8_t value)
+// registers stored in gb->memory->io
+static uint8_t plain_io_read(gameboy *gb, uint16_t address)
 {
-    if (address == JOYP_REGISTER)
-    {
-        update_button_set(gb, value);
-    }
-    else if (address >= DIV_REGISTER && address <= TAC_REGISTER)
-    {
-        timing_related_write(gb, address, value);
-    }
-    else if (address == IF_REGISTER)
-    {
-        interrupt_register_write(gb->cpu, IF_REGISTER, value);
-    }
-    else if (address >= NR10_REGISTER && address <= WAVE_RAM_STOP)
-    {
-        apu_write(gb, address, value);
-    }
-    else if (address >= LCDC_REGISTER && address <= WX_REGISTER)
-    {
-        ppu_write(gb, address, value);
-    }
-    else if (address == VBK_REGISTER && gb->run_mode == GB_CGB_MODE)
-    {
-        cgb_core_io_write(gb, VBK_REGISTER, value);
-    }
-    else if (address == BRD_REGISTER)
-    {
-        if (!gb->boot_rom_disabled)
-            gb->boot_rom_disabled = value;
-    }
-    else if (address >= HDMA1_REGISTER && address <= HDMA5_REGISTER && gb->run_mode == GB_CGB_MODE)
-    {
-        cgb_core_io_write(gb, address, value);
-    }
-    else if (address >= BCPS_REGISTER && address <= OPRI_REGISTER && gb->run_mode == GB_CGB_MODE)
-    {
-        ppu_write(gb, address, value);
-    }
-    else if (address == SVBK_REGISTER && gb->run_mode == GB_CGB_MODE)
-    {
-        cgb_core_io_write(gb, SVBK_REGISTER, value);
-    }
-    else if (address == IE_REGISTER)
+    return gb->memory->io[address & 0x7f];
+}
+
+static void plain_io_write(gameboy *gb, uint16_t address, uint8_t value)
+{
+    gb->memory->io[address & 0x7f] = value;
+}
+
+static uint8_t joypad_io_read(gameboy *gb, uint16_t address)
+{
+    (void)address;
+    process_input(gb, INPUT_JOYP_READ);
+    return report_button_states(gb);
+}
+
+static void joypad_io_write(gameboy *gb, uint16_t address, uint8_t value)
+{
+    (void)address;
+    update_button_set(gb, value);
+}
+
+static uint8_t interrupt_io_read(gameboy *gb, uint16_t address)
+{
+    return interrupt_register_read(&gb->cpu, address);
+}
+
+static void interrupt_io_write(gameboy *gb, uint16_t address, uint8_t value)
+{
+    interrupt_register_write(&gb->cpu, address, value);
+}
+
+static uint8_t boot_rom_io_read(gameboy *gb, uint16_t address)
+{
+    (void)address;
+    return gb->boot_rom_disabled;
+}
+
+static void boot_rom_io_write(gameboy *gb, uint16_t address, uint8_t value)
+{
+    (void)address;
+    if (!gb->boot_rom_disabled)
     {
-        interrupt_register_write(gb->cpu, IE_REGISTER, value);
+        gb->boot_rom_disabled = value;
+        gb->boot_rom_finished_signal = value && gb->boot_snapshot;
+        remap_memory(gb);
     }
-    else if (address == KEY1_REGISTER && gb->run_mode == GB_CGB_MODE)
+}
+
+// PCM12/PCM34: the channels' digital outputs aren't tracked, so report silence
+static uint8_t pcm_io_read(gameboy *gb, uint16_t address)
+{
+    (void)gb;
+    (void)address;
+    return 0x00;
+}
+
+static void map_io_registers(gb_io_register *table, uint16_t first, uint16_t last,
+                             io_read_handler read, io_write_handler write)
+{
+    for (uint16_t address = first; address <= last; ++address)
     {
-        cgb_core_io_write(gb, KEY1_REGISTER, value);
+        table[address & 0x7f] = (gb_io_register){
+            .read = read,
+            .write = write,
+            .read_mask = 0x00,
+            .write_mask = 0xff,
+        };
     }
 }
 
+static void map_plain_io_register(gb_io_register *table, uint16_t address,
+                                  uint8_t read_mask, uint8_t write_mask)
+{
+    table[address & 0x7f] = (gb_io_register){
+        .read = plain_io_read,
+        .write = plain_io_write,
+        .read_mask = read_mask,
+        .write_mask = write_mask,
+    };
+}
+
+/* Build the I/O register table for the Game Boy's mode, so that
+ * an access is a single lookup instead of a chain of range and
+ * mode checks. Registers not mapped here read 0xff and ignore
+ * writes.
+ */
+void init_io_registers(gameboy *gb)
+{
+    gb_io_register *table = gb->memory->io_registers;
+
+    map_io_registers(table, 0xff00, 0xff7f, unmapped_io_read, unmapped_io_write);
+
+    map_io_registers(table, JOYP_REGISTER, JOYP_REGISTER, joypad_io_read, joypad_io_write);
+    map_io_registers(table, DIV_REGISTER, TAC_REGISTER, timing_related_read, timing_related_write);
+    map_io_registers(table, IF_REGISTER, IF_REGISTER, interrupt_io_read, interrupt_io_write);
+    map_io_registers(table, NR10_REGISTER, WAVE_RAM_STOP, apu_read, apu_write);
+    map_io_registers(table, LCDC_REGISTER, WX_REGISTER, ppu_read, ppu_write);
+    map_io_registers(table, BRD_REGISTER, BRD_REGISTER, boot_rom_io_read, boot_rom_io_write);
+
+    map_io_registers(table, SB_REGISTER, SC_REGISTER, serial_read, serial_write);
+    table[SC_REGISTER & 0x7f].read_mask = IS_CGB_MODE(gb) ? 0x7c : 0x7e;
+    table[SC_REGISTER & 0x7f].write_mask = IS_CGB_MODE(gb) ? 0x83 : 0x81;
+
+    if (!IS_CGB_MODE(gb))
+        return;
+
+    map_io_registers(table, KEY1_REGISTER, KEY1_REGISTER, cgb_core_io_read, cgb_core_io_write);
+    map_io_registers(table, VBK_REGISTER, VBK_REGISTER, cgb_core_io_read, cgb_core_io_write);
+    map_io_registers(table, HDMA1_REGISTER, HDMA5_REGISTER, cgb_core_io_read, cgb_core_io_write);
+    map_io_registers(table, BCPS_REGISTER, OPRI_REGISTER, ppu_read, ppu_write);
+    map_io_registers(table, SVBK_REGISTER, SVBK_REGISTER, cgb_core_io_read, cgb_core_io_write);
+
+    // infrared port: bit 1 set means no light is being received
+    map_plain_io_register(table, RP_REGISTER, 0x3e, 0xc1);
+
+    // undocumented registers with no known purpose
+    map_plain_io_register(table, FF72_REGISTER, 0x00, 0xff);
+    map_plain_io_register(table, FF73_REGISTER, 0x00, 0xff);
+    map_plain_io_register(table, FF74_REGISTER, 0x00, 0xff);
+    map_plain_io_register(table, FF75_REGISTER, 0x8f, 0x70);
+    map_io_registers(table, PCM12_REGISTER, PCM34_REGISTER, pcm_io_read, unmapped_io_write);
+}
+
+static inline uint8_t io_register_read(gameboy *gb, uint16_t address)
+{
+    gb_io_register *reg = &gb->memory->io_registers[address & 0x7f];
+    return reg->read(gb, address) | reg->read_mask;
+}
+
+static inline void io_register_write(gameboy *gb, uint16_t address, uint8_t value)
+{
+    gb_io_register *reg = &gb->memory->io_registers[address & 0x7f];
+    reg->write(gb, address, value & reg->write_mask);
+}
+
 /********** TODO: When PPU timing emulation improves, add back OAM and VRAM blocking **********/
 
 static bool do_access_bootrom(gameboy *gb, uint16_t address)
@@ -216,18 +271,85 @@ static bool do_access_bootrom(gameboy *gb, uint16_t address)
     bool addr_range1 = address < 0x100;
     bool addr_range2 = address >= 0x200 && address < 0x900;
     bool rom_enabled_and_used = gb->run_boot_rom && !gb->boot_rom_disabled;
-    bool rom_addr = addr_range1 || (gb->run_mode == GB_CGB_MODE && addr_range2);
+    bool rom_addr = addr_range1 || (IS_CGB_MODE(gb) && addr_range2);
 
     return rom_enabled_and_used && rom_addr;
 }
 
+/* Memory page table
+ * ~~~~~~~~~~~~~~~~~
+ * ROM, VRAM, and WRAM have no side effects when accessed by the CPU,
+ * so read_byte/write_byte access them through the page table in the
+ * gameboy struct, and only the other pages go through the checks
+ * below. During an OAM DMA transfer the CPU can only access HRAM
+ * (and the DMA register), so the page table swaps every page but
+ * the last for ones which read 0xff and drop writes. The last page
+ * holds HRAM, which 4KB pages can't map on its own, so its accesses
+ * go through the slow path, which checks for DMA on that page alone.
+ */
+const uint8_t *memory_page(gameboy *gb, uint16_t address)
+{
+    uint16_t offset = address & 0xf000;
+
+    if (address <= 0x7fff) // cartridge ROM
+    {
+        // the boot ROM is mapped over parts of the first page
+        if (address < MEMORY_PAGE_SIZE && gb->run_boot_rom && !gb->boot_rom_disabled)
+            return NULL;
+
+        return cartridge_rom_bank(gb, address) + (offset & 0x3fff);
+    }
+    else if (address <= 0x9fff) // VRAM
+    {
+        bool bankno = IS_CGB_MODE(gb) && gb->vbk & 1;
+        return gb->memory->vram[bankno] + (offset & 0x1fff);
+    }
+    else if (address >= 0xc000 && address <= 0xefff) // WRAM, first page of ECHO RAM
+    {
+        return gb->memory->wram[get_wram_bank(gb, address)];
+    }
+
+    return NULL;
+}
+
+void remap_memory(gameboy *gb)
+{
+    for (int i = 0; i < NUM_MEMORY_PAGES; ++i)
+    {
+        uint16_t address = (uint16_t)(i * MEMORY_PAGE_SIZE);
+
+        if (gb->dma_requested)
+        {
+            bool last = i == NUM_MEMORY_PAGES - 1;
+            gb->read_pages[i] = last ? NULL : gb->memory->dma_read_page;
+            gb->write_pages[i] = last ? NULL : gb->memory->dma_write_page;
+            continue;
+        }
+
+        const uint8_t *page = memory_page(gb, address);
+
+        gb->read_pages[i] = page;
+
+        // ROM writes go to the MBC, and VRAM writes to the frame log if there is one
+        bool vram = address >= 0x8000 && address <= 0x9fff;
+        gb->write_pages[i] = address <= 0x7fff || (vram && gb->ppu->frame_log) ? NULL : (uint8_t *)page;
+    }
+
+    gb->fetch_size = 0;
+}
+
 /* Read a byte from the Game Boy's memory map.
  * This function should only be used by the CPU.
  */
 uint8_t read_byte(gameboy *gb, uint16_t address)
 {
-    // during a DMA transfer we can only access HRAM and the DMA register
-    if (gb->dma_requested
+    const uint8_t *page = gb->read_pages[address >> 12];
+    if (page)
+        return page[address & (MEMORY_PAGE_SIZE - 1)];
+
+    // during a DMA transfer we can only access HRAM and the DMA register,
+    // and only the last page isn't blocked by the page table
+    if (address >= 0xf000 && gb->dma_requested
         && (address < 0xff80 || address > 0xfffe)
         && address != DMA_REGISTER)
     {
@@ -272,7 +394,7 @@ uint8_t read_byte(gameboy *gb, uint16_t address)
     }
     else // interrupt enable register
     {
-        value = io_register_read(gb, IE_REGISTER);
+        value = interrupt_register_read(&gb->cpu, IE_REGISTER);
     }
 
     return value;
@@ -283,8 +405,16 @@ uint8_t read_byte(gameboy *gb, uint16_t address)
  */
 void write_byte(gameboy *gb, uint16_t address, uint8_t value)
 {
-    // during a DMA transfer we can only access HRAM and the DMA register
-    if (gb->dma_requested
+    uint8_t *page = gb->write_pages[address >> 12];
+    if (page)
+    {
+        page[address & (MEMORY_PAGE_SIZE - 1)] = value;
+        return;
+    }
+
+    // during a DMA transfer we can only access HRAM and the DMA register,
+    // and only the last page isn't blocked by the page table
+    if (address >= 0xf000 && gb->dma_requested
         && (address < 0xff80 || address > 0xfffe)
         && address != DMA_REGISTER)
     {
@@ -293,7 +423,9 @@ void write_byte(gameboy *gb, uint16_t address, uint8_t value)
 
     if (address <= 0x7fff) // cartridge ROM
     {
+        // MBC registers, which may switch ROM banks
         cartridge_write(gb, address, value);
+        remap_memory(gb);
     }
     else if (address <= 0x9fff) // VRAM
     {
@@ -320,8 +452,128 @@ void write_byte(gameboy *gb, uint16_t address, uint8_t value)
     }
     else // interrupt enable register
     {
-        io_register_write(gb, IE_REGISTER, value);
+        interrupt_register_write(&gb->cpu, IE_REGISTER, value);
+    }
+}
+
+/* Opcode fetch
+ * ~~~~~~~~~~~~
+ * Code runs from ROM, WRAM, or HRAM, where reads have no side
+ * effects, so fetches from the page PC is in are direct loads.
+ * The page is looked up again when PC leaves it or the page is
+ * invalidated (see remap_memory). Fetches from anywhere
+ * else still go through read_byte.
+ */
+static void refill_fetch_page(gameboy *gb, uint16_t address)
+{
+    const uint8_t *page = NULL;
+    uint16_t start = 0, size = 0;
+
+    if (gb->dma_requested && (address < 0xff80 || address > 0xfffe))
+    {
+        // only HRAM can be accessed during a DMA transfer
+    }
+    else if (address <= 0x7fff) // cartridge ROM
+    {
+        const uint8_t *bank = cartridge_rom_bank(gb, address);
+        if (gb->run_boot_rom && !gb->boot_rom_disabled)
+        {
+            // the boot ROM is mapped over parts of the cartridge ROM
+            start = address & 0xff00;
+            size = 0x100;
+            page = do_access_bootrom(gb, address) ? &gb->boot_rom[start]
+                                                  : &bank[start & 0x3fff];
+        }
+        else
+        {
+            start = address & 0xc000;
+            size = ROM_BANK_SIZE;
+            page = bank;
+        }
+    }
+    else if (address >= 0xc000 && address <= 0xdfff) // WRAM
+    {
+        start = address & 0xf000;
+        size = 4 * KB;
+        page = gb->memory->wram[get_wram_bank(gb, address)];
+    }
+    else if (address >= 0xff80 && address <= 0xfffe) // HRAM
+    {
+        start = 0xff80;
+        size = HRAM_SIZE;
+        page = gb->memory->hram;
+    }
+
+    gb->fetch_page = page;
+    gb->fetch_start = start;
+    gb->fetch_size = size;
+}
+
+uint8_t fetch_byte(gameboy *gb)
+{
+    uint16_t pc = gb->cpu.reg.pc++;
+    uint16_t offset = pc - gb->fetch_start;
+
+    if (offset >= gb->fetch_size)
+    {
+        refill_fetch_page(gb, pc);
+        offset = pc - gb->fetch_start;
+        if (offset >= gb->fetch_size)
+            return read_byte(gb, pc);
+    }
+
+    return gb->fetch_page[offset];
+}
+
+uint16_t fetch_word(gameboy *gb)
+{
+    uint16_t pc = gb->cpu.reg.pc;
+    uint16_t offset = pc - gb->fetch_start;
+
+    // both bytes in the current page
+    if (offset < gb->fetch_size - 1)
+    {
+        gb->cpu.reg.pc += 2;
+        return (uint16_t)(gb->fetch_page[offset + 1] << 8) | gb->fetch_page[offset];
     }
+
+    // little-endian
+    uint8_t lo = fetch_byte(gb);
+    uint8_t hi = fetch_byte(gb);
+    return (uint16_t)(hi << 8) | lo;
+}
+
+// Stack pop and push operations
+void stack_push(gameboy *gb, uint16_t value)
+{
+    /* NOTE: The stack grows downward (decreasing address).
+     *
+     * The push operation can be thought of as performing
+     * the following imaginary instructions:
+     *
+     *  DEC SP
+     *  LD [SP], HIGH_BYTE(value) ; little-endian, so hi byte first
+     *  DEC SP
+     *  LD [SP], LOW_BYTE(value)
+     */
+    write_byte(gb, --(gb->cpu.reg.sp), (uint8_t)(value >> 8));
+    write_byte(gb, --(gb->cpu.reg.sp), (uint8_t)(value & 0xff));
+}
+
+uint16_t stack_pop(gameboy *gb)
+{
+    /* The pop operation can be thought of as performing
+     * the inverse of the push's imaginary operations:
+     *
+     *  LD LOW_BYTE(value), [SP] ; little-endian
+     *  INC SP
+     *  LD HIGH_BYTE(value), [SP]
+     *  INC SP
+     */
+    uint8_t lo = read_byte(gb, (gb->cpu.reg.sp)++);
+    uint8_t hi = read_byte(gb, (gb->cpu.reg.sp)++);
+
+    return (uint16_t)(hi << 8) | (uint16_t)lo;
 }
 
 /* Allocate memory for the Game Boy's internal RAM (see below)
@@ -341,6 +593,9 @@ void write_byte(gameboy *gb, uint16_t address, uint8_t value)
 gb_memory *init_memory_map(void)
 {
     gb_memory *memory = calloc(1, sizeof(gb_memory));
+    if (memory)
+        memset(memory->dma_read_page, 0xff, sizeof memory->dma_read_page);
+
     return memory;
 }
 
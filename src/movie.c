@@ -0,0 +1,125 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/cartridge.h"
+#include "cboy/joypad.h"
+#include "cboy/movie.h"
+#include "cboy/log.h"
+
+static const char movie_file_magic[8] = {'C', 'B', 'O', 'Y', 'M', 'V', '0', '1'};
+
+#define MOVIE_HEADER_SIZE 17 /* bytes */
+
+gb_movie *init_movie(gameboy *gb, enum MOVIE_MODE mode, const char *filename)
+{
+    gb_movie *movie = calloc(1, sizeof(gb_movie));
+
+    if (movie == NULL)
+        return NULL;
+
+    movie->mode = mode;
+
+    uint64_t rom_hash = hash_rom(gb->cart);
+    uint8_t header[MOVIE_HEADER_SIZE];
+    memcpy(header, movie_file_magic, sizeof movie_file_magic);
+    for (uint8_t i = 0; i < 8; ++i)
+        header[8 + i] = rom_hash >> (8 * i);
+    header[16] = gb->run_mode;
+
+    if (mode == MOVIE_RECORD)
+    {
+        movie->movie_file = fopen(filename, "wb");
+        if (movie->movie_file == NULL)
+        {
+            LOG_ERROR("Error: Unable to create movie file: %s\n", strerror(errno));
+            goto init_error;
+        }
+
+        if (fwrite(header, 1, sizeof header, movie->movie_file) != sizeof header)
+        {
+            LOG_ERROR("Error: Failed to write movie file header\n");
+            goto init_error;
+        }
+
+        return movie;
+    }
+
+    movie->movie_file = fopen(filename, "rb");
+    if (movie->movie_file == NULL)
+    {
+        LOG_ERROR("Error: Unable to open movie file: %s\n", strerror(errno));
+        goto init_error;
+    }
+
+    uint8_t movie_header[MOVIE_HEADER_SIZE];
+    if (fread(movie_header, 1, sizeof movie_header, movie->movie_file) != sizeof movie_header
+        || memcmp(movie_header, movie_file_magic, sizeof movie_file_magic))
+    {
+        LOG_ERROR("Error: %s is not a movie file\n", filename);
+        goto init_error;
+    }
+    else if (memcmp(movie_header + 8, header + 8, 8))
+    {
+        LOG_ERROR("Error: The movie was recorded with a different ROM\n");
+        goto init_error;
+    }
+    else if (movie_header[16] != header[16])
+    {
+        LOG_ERROR("Error: The movie was recorded in %s mode\n",
+                  movie_header[16] == GB_CGB_MODE ? "Game Boy Color" : "monochrome Game Boy");
+        goto init_error;
+    }
+
+    return movie;
+
+init_error:
+    free_movie(movie);
+    return NULL;
+}
+
+void free_movie(gb_movie *movie)
+{
+    if (movie == NULL)
+        return;
+
+    if (movie->movie_file)
+        fclose(movie->movie_file);
+
+    free(movie);
+}
+
+void process_movie_frame(gameboy *gb)
+{
+    gb_movie *movie = gb->movie;
+
+    if (movie->mode == MOVIE_RECORD)
+    {
+        uint8_t buttons = gb->joypad->action_state << 4 | gb->joypad->direction_state;
+        if (fputc(buttons, movie->movie_file) == EOF)
+        {
+            LOG_ERROR("\nError: Failed to write to the movie file: %s\n", strerror(errno));
+            gb->is_on = false;
+            return;
+        }
+
+        ++movie->frame_count;
+        return;
+    }
+
+    int buttons = fgetc(movie->movie_file);
+    if (buttons == EOF)
+    {
+        LOG_INFO("\nMovie finished after %" PRIu64 " frames\n", movie->frame_count);
+        gb->is_on = false;
+        return;
+    }
+
+    set_button_states(gb, buttons & 0x0f, buttons >> 4);
+    ++movie->frame_count;
+}
@@ -0,0 +1,119 @@
+#define _POSIX_C_SOURCE 200809L // clock_nanosleep
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cboy/common.h"
+#include "cboy/pacer.h"
+#include "cboy/log.h"
+
+#define NS_PER_SECOND 1000000000LL
+
+#define CLOCKS_PER_FRAME 70224
+
+// how long before a deadline to stop sleeping and start spinning
+#define SPIN_NS 500000
+
+// a frame presented this late is counted as missed
+#define MISSED_NS 1000000
+
+int64_t host_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NS_PER_SECOND + ts.tv_nsec;
+}
+
+/* Host time of the given frame's deadline. A frame doesn't last a
+ * whole number of nanoseconds, so this is worked out from the start
+ * each time rather than by adding up rounded frame lengths.
+ */
+static int64_t frame_deadline(gb_frame_pacer *pacer, uint64_t frame)
+{
+    uint64_t clocks_per_second = (uint64_t)GB_CPU_FREQUENCY * pacer->speed;
+    uint64_t seconds = frame * CLOCKS_PER_FRAME / clocks_per_second;
+    uint64_t clocks = frame * CLOCKS_PER_FRAME % clocks_per_second;
+    return pacer->start_ns
+           + seconds * NS_PER_SECOND
+           + clocks * NS_PER_SECOND / clocks_per_second;
+}
+
+gb_frame_pacer *init_frame_pacer(void)
+{
+    gb_frame_pacer *pacer = calloc(1, sizeof(gb_frame_pacer));
+    if (pacer == NULL)
+        return NULL;
+
+    pacer->speed = 1;
+    reset_frame_pacer(pacer);
+    return pacer;
+}
+
+void free_frame_pacer(gb_frame_pacer *pacer)
+{
+    free(pacer);
+}
+
+void reset_frame_pacer(gb_frame_pacer *pacer)
+{
+    pacer->start_ns = host_time_ns();
+    pacer->num_frames = 0;
+}
+
+void set_pacer_speed(gb_frame_pacer *pacer, uint8_t speed)
+{
+    pacer->speed = speed;
+    reset_frame_pacer(pacer);
+}
+
+void pace_frame(gb_frame_pacer *pacer)
+{
+    int64_t deadline = frame_deadline(pacer, ++pacer->num_frames);
+    int64_t now = host_time_ns();
+
+    // if the host can't keep up, catch up rather than rushing through frames
+    if (now - deadline > NS_PER_SECOND * CLOCKS_PER_FRAME / GB_CPU_FREQUENCY / pacer->speed)
+    {
+        ++pacer->resyncs;
+        reset_frame_pacer(pacer);
+        return;
+    }
+
+    if (deadline - now > SPIN_NS)
+    {
+        int64_t wake = deadline - SPIN_NS;
+        struct timespec wake_ts = {
+            .tv_sec = wake / NS_PER_SECOND,
+            .tv_nsec = wake % NS_PER_SECOND,
+        };
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_ts, NULL) == EINTR)
+            ;
+    }
+
+    while ((now = host_time_ns()) < deadline)
+        ;
+
+    int64_t late = now - deadline;
+    ++pacer->frames_timed;
+    pacer->total_late_ns += late;
+    if (late > pacer->max_late_ns)
+        pacer->max_late_ns = late;
+    if (late >= MISSED_NS)
+        ++pacer->frames_missed;
+}
+
+void print_pacer_stats(gb_frame_pacer *pacer)
+{
+    if (!pacer->frames_timed)
+        return;
+
+    LOG_INFO("Frame pacing: %.1f us late on average, %.1f us at most, "
+             "%" PRIu64 " frames missed by 1 ms or more, %" PRIu64 " resyncs\n",
+             pacer->total_late_ns / 1e3 / pacer->frames_timed,
+             pacer->max_late_ns / 1e3,
+             pacer->frames_missed,
+             pacer->resyncs);
+}
@@ -14,15 +14,16 @@ struct bg_attrs {
     uint8_t paletteno;
 };
 
-static struct bg_attrs curr_bg_attrs;
+static _Thread_local struct bg_attrs curr_bg_attrs;
 
 // track palette and color index data for the scanline
 // being rendered so we can mix the background, window,
-// and sprites into a final image
-static uint8_t scanline_palette_info[FRAME_WIDTH] = {0};
-static uint8_t scanline_coloridx_info[FRAME_WIDTH] = {0};
-static bool scanline_bg_prio_info[FRAME_WIDTH] = {false};
-static bool scanline_obj_occupancy[FRAME_WIDTH] = {false};
+// and sprites into a final image (per thread, since linked
+// Game Boys run on threads of their own)
+static _Thread_local uint8_t scanline_palette_info[FRAME_WIDTH] = {0};
+static _Thread_local uint8_t scanline_coloridx_info[FRAME_WIDTH] = {0};
+static _Thread_local bool scanline_bg_prio_info[FRAME_WIDTH] = {false};
+static _Thread_local bool scanline_obj_occupancy[FRAME_WIDTH] = {false};
 
 static inline uint16_t min(uint16_t a, uint16_t b)
 {
@@ -50,7 +51,7 @@ uint16_t apply_lcd_filter(uint16_t color)
     return ((b & 0xf8) << 7) | ((g & 0xf8) << 2) | ((r & 0xff) >> 3);
 }
 
-static uint16_t cgb_color_from_palette(gameboy *gb, int loc)
+static uint16_t cgb_color_from_palette(const gb_renderer *renderer, const gb_line_regs *line, int loc)
 {
     uint8_t palette_reg = scanline_palette_info[loc];
     uint8_t color_idx = scanline_coloridx_info[loc];
@@ -60,18 +61,18 @@ static uint16_t cgb_color_from_palette(gameboy *gb, int loc)
     uint8_t lo, hi;
     if (is_sprite)
     {
-        lo = gb->ppu->obj_pram[offset];
-        hi = gb->ppu->obj_pram[offset + 1];
+        lo = renderer->obj_pram[offset];
+        hi = renderer->obj_pram[offset + 1];
     }
     else
     {
-        lo = gb->ppu->bg_pram[offset];
-        hi = gb->ppu->bg_pram[offset + 1];
+        lo = renderer->bg_pram[offset];
+        hi = renderer->bg_pram[offset + 1];
     }
 
     uint16_t color = (uint16_t)hi << 8 | lo;
 
-    if (gb->ppu->lcd_filter)
+    if (line->lcd_filter)
         color = apply_lcd_filter(color);
 
     return color;
@@ -88,10 +89,10 @@ static void parse_bg_attrs(uint8_t attrs)
 }
 
 // load pixel color data for one line of the tile (8 pixels) into the given buffer
-static void load_tile_color_data(gameboy *gb, uint16_t tile_addr, uint8_t yoffset, uint8_t *buff)
+static void load_tile_color_data(const gb_renderer *renderer, uint16_t tile_addr, uint8_t yoffset, uint8_t *buff)
 {
     // each line of the tile is 2 bytes in VRAM
-    uint8_t *vram_bank = gb->memory->vram[curr_bg_attrs.bankno];
+    const uint8_t *vram_bank = renderer->vram[curr_bg_attrs.bankno];
 
     if (curr_bg_attrs.yflip)
         yoffset = 7 - yoffset;
@@ -125,9 +126,9 @@ static void load_tile_color_data(gameboy *gb, uint16_t tile_addr, uint8_t yoffse
 
 // determine whether a given sprite pixel will be drawn
 // See: https://gbdev.io/pandocs/Tile_Maps.html#bg-to-obj-priority-in-cgb-mode
-static bool resolve_obj_priority(gb_ppu *ppu, gb_sprite *sprite, uint8_t pixel_loc)
+static bool resolve_obj_priority(const gb_line_regs *line, gb_sprite *sprite, uint8_t pixel_loc)
 {
-    bool bg_win_prio = ppu->lcdc & 1;
+    bool bg_win_prio = line->lcdc & 1;
 
     // if the pixel is already occupied by a sprite, it will not be overwritten
     if (scanline_obj_occupancy[pixel_loc])
@@ -144,10 +145,10 @@ static bool resolve_obj_priority(gb_ppu *ppu, gb_sprite *sprite, uint8_t pixel_l
 
 // load pixel color data for the sprite line (8 bytes) to be rendered,
 // mixing the sprite's pixels with the background and window
-void cgb_render_sprite_pixels(gameboy *gb, gb_sprite *sprite)
+void cgb_render_sprite_pixels(const gb_line_regs *line, gb_sprite *sprite)
 {
     // select which line of the sprite will be rendered
-    uint8_t line_to_render = gb->ppu->ly + 16 - sprite->ypos;
+    uint8_t line_to_render = line->ly + 16 - sprite->ypos;
 
     // each line of the tile is 2 bytes
     uint8_t lo = sprite->tile_data[2*line_to_render],
@@ -172,7 +173,7 @@ void cgb_render_sprite_pixels(gameboy *gb, gb_sprite *sprite)
         // no overflow because shifted_pixel_loc >= 8
         uint8_t pixel_loc = shifted_pixel_loc - 8;
 
-        if (resolve_obj_priority(gb->ppu, sprite, pixel_loc) && color_index)
+        if (resolve_obj_priority(line, sprite, pixel_loc) && color_index)
         {
             scanline_coloridx_info[pixel_loc] = color_index;
             scanline_palette_info[pixel_loc] = sprite->palette_no;
@@ -182,19 +183,18 @@ void cgb_render_sprite_pixels(gameboy *gb, gb_sprite *sprite)
 }
 
 // load appropriate background tiles into the pixel data buffers for a single scanline
-static void cgb_load_bg_tiles(gameboy *gb)
+static void cgb_load_bg_tiles(const gb_renderer *renderer, const gb_line_regs *line)
 {
-    gb_ppu *ppu = gb->ppu;
-    bool tile_data_area_bit = ppu->lcdc & 0x10;
-    bool tile_map_area_bit  = ppu->lcdc & 0x08; // BG tile map flag
+    bool tile_data_area_bit = line->lcdc & 0x10;
+    bool tile_map_area_bit  = line->lcdc & 0x08; // BG tile map flag
 
     // get the appropriate 32x32 tile map's address in VRAM
     uint16_t base_map_addr = tile_map_area_bit ? 0x9c00 : 0x9800;
 
     // determine Y offset inside tile map based on current LY and SCY
-    uint16_t pixel_yoffset      = (ppu->scy + ppu->ly) % TILE_MAP_WIDTH,
-             tile_xoffset       = ppu->scx / TILE_WIDTH,
-             tile_pixel_xoffset = ppu->scx % TILE_WIDTH, // offset within the tile
+    uint16_t pixel_yoffset      = (line->scy + line->ly) % TILE_MAP_WIDTH,
+             tile_xoffset       = line->scx / TILE_WIDTH,
+             tile_pixel_xoffset = line->scx % TILE_WIDTH, // offset within the tile
              tile_yoffset       = pixel_yoffset / TILE_WIDTH,
              tile_pixel_yoffset = pixel_yoffset % TILE_WIDTH;
 
@@ -210,13 +210,13 @@ static void cgb_load_bg_tiles(gameboy *gb)
         tile_index_addr = base_map_addr
                           + TILE_MAP_TILE_WIDTH * tile_yoffset
                           + tileno;
-        tile_index = gb->memory->vram[0][tile_index_addr & VRAM_MASK];
+        tile_index = renderer->vram[0][tile_index_addr & VRAM_MASK];
         tile_addr = tile_addr_from_index(tile_data_area_bit, tile_index);
 
         // BG map attributes for the corresponding tile index
-        uint8_t attrs = gb->memory->vram[1][tile_index_addr & VRAM_MASK];
+        uint8_t attrs = renderer->vram[1][tile_index_addr & VRAM_MASK];
         parse_bg_attrs(attrs);
-        load_tile_color_data(gb, tile_addr, tile_pixel_yoffset, tile_color_data);
+        load_tile_color_data(renderer, tile_addr, tile_pixel_yoffset, tile_color_data);
 
         // for the first tile loaded, throw away
         // enough leading pixels to account for SCX
@@ -247,16 +247,15 @@ static void cgb_load_bg_tiles(gameboy *gb)
 }
 
 // load appropriate window tiles into the pixel data buffers for a single scanline
-static void cgb_load_window_tiles(gameboy *gb)
+static void cgb_load_window_tiles(const gb_renderer *renderer, const gb_line_regs *line)
 {
-    gb_ppu *ppu = gb->ppu;
-    bool tile_data_area_bit = ppu->lcdc & 0x10;
-    bool tile_map_area_bit  = ppu->lcdc & 0x40; // window tile map flag
+    bool tile_data_area_bit = line->lcdc & 0x10;
+    bool tile_map_area_bit  = line->lcdc & 0x40; // window tile map flag
 
     // the window is only visible if WX is in 0..166 and WY is in 0..143
-    bool window_is_visible = ppu->wx <= 166 && ppu->wy <= 143;
+    bool window_is_visible = line->wx <= 166 && line->wy <= 143;
 
-    if (!(window_is_visible && ppu->wy_trigger))
+    if (!(window_is_visible && line->wy_trigger))
         return;
 
     uint16_t base_map_addr = tile_map_area_bit ? 0x9c00 : 0x9800;
@@ -266,7 +265,7 @@ static void cgb_load_window_tiles(gameboy *gb)
      * scanlines have been rendered so far this frame.
      */
     uint16_t tile_addr, tile_index_addr;
-    uint16_t pixel_yoffset      = ppu->window_line_counter,
+    uint16_t pixel_yoffset      = line->window_line,
              tile_yoffset       = pixel_yoffset / TILE_WIDTH,
              tile_pixel_yoffset = pixel_yoffset % TILE_WIDTH;
 
@@ -283,15 +282,15 @@ static void cgb_load_window_tiles(gameboy *gb)
         tile_index_addr = base_map_addr
                           + tile_yoffset * TILE_MAP_TILE_WIDTH
                           + tile_xoffset;
-        tile_index = gb->memory->vram[0][tile_index_addr & VRAM_MASK];
+        tile_index = renderer->vram[0][tile_index_addr & VRAM_MASK];
         tile_addr = tile_addr_from_index(tile_data_area_bit, tile_index);
 
         // window map attributes for the corresponding tile index
-        uint8_t attrs = gb->memory->vram[1][tile_index_addr & VRAM_MASK];
+        uint8_t attrs = renderer->vram[1][tile_index_addr & VRAM_MASK];
         parse_bg_attrs(attrs);
 
         uint8_t offset = TILE_WIDTH * tile_xoffset;
-        load_tile_color_data(gb, tile_addr,
+        load_tile_color_data(renderer, tile_addr,
                              tile_pixel_yoffset,
                              scanline_buff + offset);
 
@@ -307,11 +306,11 @@ static void cgb_load_window_tiles(gameboy *gb)
     // right offset by that many pixels.
     uint16_t color_data_buffer_offset = 0;
     uint8_t visible_pixel_count = FRAME_WIDTH;
-    uint8_t scanline_buffer_offset = ppu->wx >= 7 ? 0 : 7 - ppu->wx;
-    if (ppu->wx > 7)
+    uint8_t scanline_buffer_offset = line->wx >= 7 ? 0 : 7 - line->wx;
+    if (line->wx > 7)
     {
-        color_data_buffer_offset += ppu->wx - 7;
-        visible_pixel_count -= ppu->wx - 7;
+        color_data_buffer_offset += line->wx - 7;
+        visible_pixel_count -= line->wx - 7;
     }
 
     // color indices
@@ -328,8 +327,6 @@ static void cgb_load_window_tiles(gameboy *gb)
     memcpy(scanline_bg_prio_info + color_data_buffer_offset,
            scanline_prio_buff + scanline_buffer_offset,
            visible_pixel_count);
-
-    ++ppu->window_line_counter;
 }
 
 static void reset_object_occupancy(void)
@@ -338,33 +335,33 @@ static void reset_object_occupancy(void)
            sizeof scanline_obj_occupancy);
 }
 
-void cgb_render_scanline(gameboy *gb)
+void cgb_render_scanline(const gb_renderer *renderer, const gb_line_regs *line)
 {
-    bool window_enable = gb->ppu->lcdc & 0x20;
-    bool obj_enable    = gb->ppu->lcdc & 0x02;
+    bool window_enable = line->lcdc & 0x20;
+    bool obj_enable    = line->lcdc & 0x02;
 
-    cgb_load_bg_tiles(gb);
+    cgb_load_bg_tiles(renderer, line);
 
     if (window_enable)
-        cgb_load_window_tiles(gb);
+        cgb_load_window_tiles(renderer, line);
 
     if (obj_enable)
-        load_sprites(gb);
+        load_sprites(renderer, line);
 }
 
 // translate the completed scanline data into
 // colors and push into the PPU's frame buffer
-void cgb_push_scanline_data(gameboy *gb)
+void cgb_push_scanline_data(const gb_renderer *renderer, const gb_line_regs *line)
 {
     // the starting index of the current scanline in the frame buffer
-    uint16_t scanline_start = gb->ppu->ly * FRAME_WIDTH;
+    uint16_t scanline_start = line->ly * FRAME_WIDTH;
 
     uint16_t color;
     for (uint16_t i = 0; i < FRAME_WIDTH; ++i)
     {
-        color = cgb_color_from_palette(gb, i);
+        color = cgb_color_from_palette(renderer, line, i);
 
-        gb->ppu->frame_buffer[scanline_start + i] = color;
+        renderer->frame_buffer[scanline_start + i] = color;
     }
 
     reset_object_occupancy();
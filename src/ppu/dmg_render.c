@@ -12,9 +12,10 @@
 
 // track palette and color index data for the scanline
 // being rendered so we can mix the background, window,
-// and sprites into a final image
-static uint16_t scanline_palette_buff[FRAME_WIDTH] = {0};
-static uint8_t scanline_coloridx_buff[FRAME_WIDTH] = {0};
+// and sprites into a final image (per thread, since linked
+// Game Boys run on threads of their own)
+static _Thread_local uint16_t scanline_palette_buff[FRAME_WIDTH] = {0};
+static _Thread_local uint8_t scanline_coloridx_buff[FRAME_WIDTH] = {0};
 
 /* colors encoded in XBGR1555 format */
 static const uint16_t display_color_palettes[4*NUM_DISPLAY_PALETTES] = {
@@ -64,7 +65,7 @@ void cycle_display_colors(display_colors *colors, bool cycle_forward)
 // and whether this color will be for a sprite tile.
 // Should be used on the completed scanline data as the final
 // step before outputting pixels.
-static uint16_t color_from_palette(gameboy *gb, uint16_t palette_reg, uint8_t color_idx)
+static uint16_t color_from_palette(const gb_line_regs *line, uint16_t palette_reg, uint8_t color_idx)
 {
     // account for the bg/window disabled sentinel value
     // to ensure all non-sprite pixels are set to white
@@ -76,15 +77,15 @@ static uint16_t color_from_palette(gameboy *gb, uint16_t palette_reg, uint8_t co
             break;
 
         case BGP_REGISTER:
-            palette = gb->ppu->bgp;
+            palette = line->bgp;
             break;
 
         case OBP0_REGISTER:
-            palette = gb->ppu->obp0;
+            palette = line->obp0;
             break;
 
         case OBP1_REGISTER:
-            palette = gb->ppu->obp1;
+            palette = line->obp1;
             break;
 
         default:
@@ -97,16 +98,16 @@ static uint16_t color_from_palette(gameboy *gb, uint16_t palette_reg, uint8_t co
     switch((palette >> (2 * color_idx)) & 0x3)
     {
         case 0x0:
-            color = gb->ppu->colors.white;
+            color = line->colors.white;
             break;
         case 0x1:
-            color = gb->ppu->colors.light_gray;
+            color = line->colors.light_gray;
             break;
         case 0x2:
-            color = gb->ppu->colors.dark_gray;
+            color = line->colors.dark_gray;
             break;
         case 0x3:
-            color = gb->ppu->colors.black;
+            color = line->colors.black;
             break;
     }
 
@@ -114,11 +115,11 @@ static uint16_t color_from_palette(gameboy *gb, uint16_t palette_reg, uint8_t co
 }
 
 // load pixel color data for one line of the tile (8 pixels) into the given buffer
-static void load_tile_color_data(gameboy *gb, uint16_t load_addr, uint8_t *buff)
+static void load_tile_color_data(const gb_renderer *renderer, uint16_t load_addr, uint8_t *buff)
 {
     // each line of the tile is 2 bytes in VRAM
-    uint8_t lo = ram_read(gb, load_addr),
-            hi = ram_read(gb, load_addr + 1);
+    uint8_t lo = renderer->vram[0][load_addr & VRAM_MASK],
+            hi = renderer->vram[0][(load_addr + 1) & VRAM_MASK];
 
     // convert these bytes into the corresponding color indices
     // See: https://gbdev.io/pandocs/Tile_Data.html
@@ -139,10 +140,10 @@ static void load_tile_color_data(gameboy *gb, uint16_t load_addr, uint8_t *buff)
 
 // load pixel color data for the sprite line (8 bytes) to be rendered,
 // mixing the sprite's pixels with the background and window
-void dmg_render_sprite_pixels(gameboy *gb, gb_sprite *sprite)
+void dmg_render_sprite_pixels(const gb_line_regs *line, gb_sprite *sprite)
 {
     // select which line of the sprite will be rendered
-    uint8_t line_to_render = gb->ppu->ly + 16 - sprite->ypos;
+    uint8_t line_to_render = line->ly + 16 - sprite->ypos;
 
     // each line of the tile is 2 bytes
     uint8_t lo = sprite->tile_data[2*line_to_render],
@@ -186,19 +187,18 @@ void dmg_render_sprite_pixels(gameboy *gb, gb_sprite *sprite)
 }
 
 // load appropriate background tiles into the pixel data buffers for a single scanline
-static void dmg_load_bg_tiles(gameboy *gb)
+static void dmg_load_bg_tiles(const gb_renderer *renderer, const gb_line_regs *line)
 {
-    gb_ppu *ppu = gb->ppu;
-    bool tile_data_area_bit = ppu->lcdc & 0x10;
-    bool tile_map_area_bit  = ppu->lcdc & 0x08; // BG tile map flag
+    bool tile_data_area_bit = line->lcdc & 0x10;
+    bool tile_map_area_bit  = line->lcdc & 0x08; // BG tile map flag
 
     // get the appropriate 32x32 tile map's address in VRAM
     uint16_t base_map_addr = tile_map_area_bit ? 0x9c00 : 0x9800;
 
     // determine Y offset inside tile map based on current LY and SCY
-    uint16_t pixel_yoffset      = (ppu->scy + ppu->ly) % TILE_MAP_WIDTH,
-             tile_xoffset       = ppu->scx / TILE_WIDTH,
-             tile_pixel_xoffset = ppu->scx % TILE_WIDTH, // offset within the tile
+    uint16_t pixel_yoffset      = (line->scy + line->ly) % TILE_MAP_WIDTH,
+             tile_xoffset       = line->scx / TILE_WIDTH,
+             tile_pixel_xoffset = line->scx % TILE_WIDTH, // offset within the tile
              tile_yoffset       = pixel_yoffset / TILE_WIDTH,
              tile_pixel_yoffset = pixel_yoffset % TILE_WIDTH;
 
@@ -214,9 +214,9 @@ static void dmg_load_bg_tiles(gameboy *gb)
         tile_index_addr = base_map_addr
                           + TILE_MAP_TILE_WIDTH * tile_yoffset
                           + tileno;
-        tile_index = ram_read(gb, tile_index_addr);
+        tile_index = renderer->vram[0][tile_index_addr & VRAM_MASK];
         tile_addr = tile_addr_from_index(tile_data_area_bit, tile_index);
-        load_tile_color_data(gb,
+        load_tile_color_data(renderer,
                              tile_addr + 2 * tile_pixel_yoffset, // two bytes per line
                              tile_color_data);
 
@@ -245,16 +245,15 @@ static void dmg_load_bg_tiles(gameboy *gb)
 }
 
 // load appropriate window tiles into the pixel data buffers for a single scanline
-static void dmg_load_window_tiles(gameboy *gb)
+static void dmg_load_window_tiles(const gb_renderer *renderer, const gb_line_regs *line)
 {
-    gb_ppu *ppu = gb->ppu;
-    bool tile_data_area_bit = ppu->lcdc & 0x10;
-    bool tile_map_area_bit  = ppu->lcdc & 0x40; // window tile map flag
+    bool tile_data_area_bit = line->lcdc & 0x10;
+    bool tile_map_area_bit  = line->lcdc & 0x40; // window tile map flag
 
     // the window is only visible if WX is in 0..166 and WY is in 0..143
-    bool window_is_visible = ppu->wx <= 166 && ppu->wy <= 143;
+    bool window_is_visible = line->wx <= 166 && line->wy <= 143;
 
-    if (!(window_is_visible && ppu->wy_trigger))
+    if (!(window_is_visible && line->wy_trigger))
         return;
 
     uint16_t base_map_addr = tile_map_area_bit ? 0x9c00 : 0x9800;
@@ -264,7 +263,7 @@ static void dmg_load_window_tiles(gameboy *gb)
      * scanlines have been rendered so far this frame.
      */
     uint16_t tile_addr, tile_index_addr;
-    uint16_t pixel_yoffset      = ppu->window_line_counter,
+    uint16_t pixel_yoffset      = line->window_line,
              tile_yoffset       = pixel_yoffset / TILE_WIDTH,
              tile_pixel_yoffset = pixel_yoffset % TILE_WIDTH;
 
@@ -279,10 +278,10 @@ static void dmg_load_window_tiles(gameboy *gb)
         tile_index_addr = base_map_addr
                           + tile_yoffset * TILE_MAP_TILE_WIDTH
                           + tile_xoffset;
-        tile_index = ram_read(gb, tile_index_addr);
+        tile_index = renderer->vram[0][tile_index_addr & VRAM_MASK];
         tile_addr = tile_addr_from_index(tile_data_area_bit, tile_index);
 
-        load_tile_color_data(gb,
+        load_tile_color_data(renderer,
                              tile_addr + 2 * tile_pixel_yoffset, // two bytes per line
                              scanline_buff + TILE_WIDTH * tile_xoffset);
     }
@@ -292,33 +291,31 @@ static void dmg_load_window_tiles(gameboy *gb)
     // right offset by that many pixels.
     uint16_t color_data_buffer_offset = 0;
     uint8_t visible_pixel_count = FRAME_WIDTH;
-    uint8_t scanline_buffer_offset = ppu->wx >= 7 ? 0 : 7 - ppu->wx;
-    if (ppu->wx > 7)
+    uint8_t scanline_buffer_offset = line->wx >= 7 ? 0 : 7 - line->wx;
+    if (line->wx > 7)
     {
-        color_data_buffer_offset += ppu->wx - 7;
-        visible_pixel_count -= ppu->wx - 7;
+        color_data_buffer_offset += line->wx - 7;
+        visible_pixel_count -= line->wx - 7;
     }
 
     memcpy(scanline_coloridx_buff + color_data_buffer_offset,
            scanline_buff + scanline_buffer_offset,
            visible_pixel_count * sizeof(uint8_t));
-
-    ++ppu->window_line_counter;
 }
 
-void dmg_render_scanline(gameboy *gb)
+void dmg_render_scanline(const gb_renderer *renderer, const gb_line_regs *line)
 {
-    uint8_t lcdc = gb->ppu->lcdc;
+    uint8_t lcdc = line->lcdc;
     bool window_enable_bit         = lcdc & 0x20,
          obj_enable_bit            = lcdc & 0x02,
          bg_and_window_enable_bit  = lcdc & 0x01;
 
     if (bg_and_window_enable_bit)
     {
-        dmg_load_bg_tiles(gb);
+        dmg_load_bg_tiles(renderer, line);
 
         if (window_enable_bit)
-            dmg_load_window_tiles(gb);
+            dmg_load_window_tiles(renderer, line);
     }
     else // background becomes blank (white)
     {
@@ -330,16 +327,16 @@ void dmg_render_scanline(gameboy *gb)
     }
 
     if (obj_enable_bit)
-        load_sprites(gb);
+        load_sprites(renderer, line);
 
 }
 
 // translate the completed scanline data into
 // colors and push into the PPU's frame buffer
-void dmg_push_scanline_data(gameboy *gb)
+void dmg_push_scanline_data(const gb_renderer *renderer, const gb_line_regs *line)
 {
     // the starting index of the current scanline in the frame buffer
-    uint16_t scanline_start = gb->ppu->ly * FRAME_WIDTH;
+    uint16_t scanline_start = line->ly * FRAME_WIDTH;
 
     uint8_t color_idx;
     uint16_t palette_reg;
@@ -348,9 +345,9 @@ void dmg_push_scanline_data(gameboy *gb)
     {
         palette_reg = scanline_palette_buff[i];
         color_idx = scanline_coloridx_buff[i];
-        color = color_from_palette(gb, palette_reg, color_idx);
+        color = color_from_palette(line, palette_reg, color_idx);
 
-        gb->ppu->frame_buffer[scanline_start + i] = color;
+        renderer->frame_buffer[scanline_start + i] = color;
     }
 
 }
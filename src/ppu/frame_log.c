@@ -0,0 +1,356 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/memory.h"
+#include "cboy/ppu.h"
+#include "cboy/log.h"
+#include "ppu_internal.h"
+
+// writes logged before the log first has to grow
+#define INITIAL_MAX_WRITES 4096
+
+typedef struct logged_write {
+    uint8_t target; // enum FRAME_LOG_TARGET
+    uint8_t value;
+    uint16_t offset;
+} logged_write;
+
+typedef struct logged_line {
+    gb_line_regs regs;
+    uint32_t num_writes; // logged before the line was reached
+} logged_line;
+
+// what's logged between one flush and the next
+typedef struct frame_batch {
+    // lines reached, in order
+    logged_line lines[FRAME_HEIGHT];
+    uint8_t num_lines;
+
+    // writes made since the first line was reached, in order
+    logged_write *writes;
+    uint32_t num_writes, max_writes;
+
+    // flushed at VBLANK, so the frame's complete once it's drawn
+    bool ends_frame;
+} frame_batch;
+
+struct gb_frame_log {
+    // copies of the memory scanlines are drawn from, as of the last one drawn
+    uint8_t vram[2][8 * KB];
+    uint8_t oam[OAM_SIZE];
+    uint8_t bg_pram[PRAM_SIZE];
+    uint8_t obj_pram[PRAM_SIZE];
+
+    gb_renderer renderer;
+
+    // the batch being logged to, and the other one the render thread draws
+    frame_batch batches[2];
+    frame_batch *logging;
+
+    /* With a render thread, it owns the copies above and draws into a
+     * frame buffer of its own. Once it's drawn a batch that ends a
+     * frame, it copies the frame to completed_frame, which is copied
+     * out to the PPU's when it's handed the next batch at VBLANK.
+     * Without one, lines are drawn straight into the PPU's frame buffer
+     * on flushing.
+     */
+    bool threaded;
+    uint16_t *ppu_frame_buffer;
+    uint16_t frame_buffer[FRAME_WIDTH * FRAME_HEIGHT];
+    uint16_t completed_frame[FRAME_WIDTH * FRAME_HEIGHT];
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed; // a batch was handed over or drawn
+    frame_batch *drawing;   // NULL while the render thread is idle
+    bool quit;
+};
+
+static void apply_write(gb_frame_log *log, const logged_write *write)
+{
+    switch (write->target)
+    {
+        case FRAME_LOG_VRAM0: log->vram[0][write->offset] = write->value; break;
+        case FRAME_LOG_VRAM1: log->vram[1][write->offset] = write->value; break;
+        case FRAME_LOG_OAM: log->oam[write->offset] = write->value; break;
+        case FRAME_LOG_BG_PRAM: log->bg_pram[write->offset] = write->value; break;
+        case FRAME_LOG_OBJ_PRAM: log->obj_pram[write->offset] = write->value; break;
+        default: break;
+    }
+}
+
+static void copy_memory(gb_frame_log *log, gameboy *gb)
+{
+    memcpy(log->vram, gb->memory->vram, sizeof log->vram);
+    memcpy(log->oam, gb->memory->oam, sizeof log->oam);
+    memcpy(log->bg_pram, gb->ppu->bg_pram, sizeof log->bg_pram);
+    memcpy(log->obj_pram, gb->ppu->obj_pram, sizeof log->obj_pram);
+}
+
+// Draw each line in the batch, after the writes made before it
+static void draw_batch(gb_frame_log *log, frame_batch *batch)
+{
+    uint32_t applied = 0;
+    for (uint8_t i = 0; i < batch->num_lines; ++i)
+    {
+        const logged_line *line = &batch->lines[i];
+        for (; applied < line->num_writes; ++applied)
+            apply_write(log, &batch->writes[applied]);
+
+        draw_scanline(&log->renderer, &line->regs);
+    }
+
+    for (; applied < batch->num_writes; ++applied)
+        apply_write(log, &batch->writes[applied]);
+
+    batch->num_lines = 0;
+    batch->num_writes = 0;
+}
+
+static void *render_thread(void *arg)
+{
+    gb_frame_log *log = arg;
+
+    pthread_mutex_lock(&log->lock);
+    for (;;)
+    {
+        while (!log->drawing && !log->quit)
+            pthread_cond_wait(&log->changed, &log->lock);
+
+        if (!log->drawing)
+            break;
+
+        frame_batch *batch = log->drawing;
+        pthread_mutex_unlock(&log->lock);
+        draw_batch(log, batch);
+        if (batch->ends_frame)
+            memcpy(log->completed_frame, log->frame_buffer, sizeof log->completed_frame);
+        pthread_mutex_lock(&log->lock);
+
+        log->drawing = NULL;
+        pthread_cond_broadcast(&log->changed);
+    }
+    pthread_mutex_unlock(&log->lock);
+
+    return NULL;
+}
+
+// Wait for the render thread to finish the batch it was handed
+static void wait_for_render_thread(gb_frame_log *log)
+{
+    pthread_mutex_lock(&log->lock);
+    while (log->drawing)
+        pthread_cond_wait(&log->changed, &log->lock);
+    pthread_mutex_unlock(&log->lock);
+}
+
+/* Hand the batch being logged to the render thread once it's finished
+ * the last one, and log to the other
+ */
+static void hand_over_batch(gb_frame_log *log, bool ends_frame)
+{
+    wait_for_render_thread(log);
+
+    log->logging->ends_frame = ends_frame;
+
+    pthread_mutex_lock(&log->lock);
+    log->drawing = log->logging;
+    pthread_cond_broadcast(&log->changed);
+    pthread_mutex_unlock(&log->lock);
+
+    log->logging = log->logging == &log->batches[0] ? &log->batches[1] : &log->batches[0];
+}
+
+// Draw the scanlines logged so far, mid-frame, without showing them
+static void drain_frame_log(gb_frame_log *log)
+{
+    if (!log->threaded)
+    {
+        draw_batch(log, log->logging);
+        return;
+    }
+
+    hand_over_batch(log, false);
+    wait_for_render_thread(log);
+}
+
+gb_frame_log *init_frame_log(gameboy *gb, bool threaded)
+{
+    gb_frame_log *log = calloc(1, sizeof(gb_frame_log));
+    if (log == NULL)
+        return NULL;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        frame_batch *batch = &log->batches[i];
+        batch->writes = malloc(INITIAL_MAX_WRITES * sizeof batch->writes[0]);
+        if (batch->writes == NULL)
+            goto init_error;
+        batch->max_writes = INITIAL_MAX_WRITES;
+    }
+    log->logging = &log->batches[0];
+
+    log->threaded = threaded;
+    log->ppu_frame_buffer = gb->ppu->frame_buffer;
+    log->renderer = (gb_renderer){
+        .cgb = IS_CGB_MODE(gb),
+        .vram = {log->vram[0], log->vram[1]},
+        .oam = log->oam,
+        .bg_pram = log->bg_pram,
+        .obj_pram = log->obj_pram,
+        .frame_buffer = threaded ? log->frame_buffer : gb->ppu->frame_buffer,
+    };
+    copy_memory(log, gb);
+    memcpy(log->frame_buffer, gb->ppu->frame_buffer, sizeof log->frame_buffer);
+    memcpy(log->completed_frame, gb->ppu->frame_buffer, sizeof log->completed_frame);
+
+    if (threaded)
+    {
+        pthread_mutex_init(&log->lock, NULL);
+        pthread_cond_init(&log->changed, NULL);
+
+        if (pthread_create(&log->thread, NULL, render_thread, log))
+        {
+            LOG_ERROR("Failed to start the render thread\n");
+            pthread_cond_destroy(&log->changed);
+            pthread_mutex_destroy(&log->lock);
+            goto init_error;
+        }
+    }
+
+    return log;
+
+init_error:
+    free(log->batches[0].writes);
+    free(log->batches[1].writes);
+    free(log);
+    return NULL;
+}
+
+void free_frame_log(gb_frame_log *log)
+{
+    if (log == NULL)
+        return;
+
+    if (log->threaded)
+    {
+        pthread_mutex_lock(&log->lock);
+        log->quit = true;
+        pthread_cond_broadcast(&log->changed);
+        pthread_mutex_unlock(&log->lock);
+
+        pthread_join(log->thread, NULL);
+        pthread_cond_destroy(&log->changed);
+        pthread_mutex_destroy(&log->lock);
+    }
+
+    free(log->batches[0].writes);
+    free(log->batches[1].writes);
+    free(log);
+}
+
+void log_scanline(gb_frame_log *log, const gb_line_regs *line)
+{
+    frame_batch *batch = log->logging;
+
+    // only reached if the LCD were turned on mid-line, but there's no room
+    if (batch->num_lines == FRAME_HEIGHT)
+    {
+        drain_frame_log(log);
+        batch = log->logging;
+    }
+
+    batch->lines[batch->num_lines++] = (logged_line){
+        .regs = *line,
+        .num_writes = batch->num_writes,
+    };
+}
+
+void log_frame_write(gb_frame_log *log, enum FRAME_LOG_TARGET target, uint16_t offset, uint8_t value)
+{
+    logged_write write = {.target = target, .value = value, .offset = offset};
+    frame_batch *batch = log->logging;
+
+    // with no lines waiting to be drawn, nothing needs what it overwrites,
+    // unless the render thread is drawing from the copy still
+    if (!batch->num_lines && !log->threaded)
+    {
+        apply_write(log, &write);
+        return;
+    }
+
+    if (batch->num_writes == batch->max_writes)
+    {
+        /* With no lines logged (the LCD's off, say) no flush may come
+         * to hand the writes over, so rather than growing the log they
+         * go straight to the copy once the render thread's caught up.
+         * Likewise if out of memory, drawing the lines so far early.
+         */
+        logged_write *writes = NULL;
+        if (batch->num_lines)
+            writes = realloc(batch->writes, 2 * batch->max_writes * sizeof writes[0]);
+
+        if (writes == NULL)
+        {
+            drain_frame_log(log);
+            apply_write(log, &write);
+            return;
+        }
+
+        batch->writes = writes;
+        batch->max_writes *= 2;
+    }
+
+    batch->writes[batch->num_writes++] = write;
+}
+
+void log_frame_copy(gb_frame_log *log, enum FRAME_LOG_TARGET target, uint16_t offset,
+                    const uint8_t *data, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; ++i)
+        log_frame_write(log, target, offset + i, data[i]);
+}
+
+void flush_frame_log(gb_frame_log *log)
+{
+    if (!log->threaded)
+    {
+        draw_batch(log, log->logging);
+        return;
+    }
+
+    // the PPU's frame buffer gets the last frame the render thread completed
+    wait_for_render_thread(log);
+    memcpy(log->ppu_frame_buffer, log->completed_frame, sizeof log->completed_frame);
+
+    hand_over_batch(log, true);
+}
+
+void sync_frame_log(gb_frame_log *log)
+{
+    drain_frame_log(log);
+
+    /* The lines drawn so far, over the rest of the frame before, as
+     * they'd be without a render thread. The frame shown at VBLANK is
+     * still the last one completed, copied over this then.
+     */
+    if (log->threaded)
+        memcpy(log->ppu_frame_buffer, log->frame_buffer, sizeof log->frame_buffer);
+}
+
+void restart_frame_log(gb_frame_log *log, gameboy *gb, bool frame_complete)
+{
+    if (log->threaded)
+        wait_for_render_thread(log);
+
+    log->logging->num_lines = 0;
+    log->logging->num_writes = 0;
+    copy_memory(log, gb);
+    memcpy(log->frame_buffer, gb->ppu->frame_buffer, sizeof log->frame_buffer);
+    if (frame_complete)
+        memcpy(log->completed_frame, gb->ppu->frame_buffer, sizeof log->completed_frame);
+}
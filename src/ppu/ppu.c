@@ -8,6 +8,12 @@
 #include "cboy/memory.h"
 #include "cboy/ppu.h"
 #include "cboy/interrupts.h"
+#include "cboy/framehash.h"
+#include "cboy/statehash.h"
+#include "cboy/link.h"
+#include "cboy/mailbox.h"
+#include "cboy/pacer.h"
+#include "cboy/speed.h"
 #include "cboy/log.h"
 #include "ppu_internal.h"
 
@@ -86,6 +92,10 @@ gb_ppu *init_ppu(enum GAMEBOY_MODE gb_mode)
 
 void free_ppu(gb_ppu *ppu)
 {
+    if (ppu == NULL)
+        return;
+
+    free_frame_log(ppu->frame_log);
     free(ppu);
 }
 
@@ -146,12 +156,17 @@ void ppu_write(gameboy *gb, uint16_t address, uint8_t value)
         case DMA_REGISTER:
             /* Begin the DMA transfer process by requesting it.
             * The written value must be between 0x00 and 0xdf,
-            * otherwise no DMA transfer will occur.
+            * otherwise no DMA transfer will occur. Until it's
+            * done, the CPU's page table maps every page but the
+            * last to the DMA pages (reads give 0xff, writes are
+            * dropped), and only the 0xf000 page, where HRAM is,
+            * goes through the DMA check.
             */
             if (value <= 0xdf && !gb->dma_requested)
             {
                 LOG_DEBUG("DMA Requested\n");
                 gb->dma_requested = true;
+                remap_memory(gb);
             }
             ppu->dma = value;
             break;
@@ -169,6 +184,8 @@ void ppu_write(gameboy *gb, uint16_t address, uint8_t value)
             bool auto_inc = (ppu->bcps >> 7) & 1;
 
             ppu->bg_pram[pram_addr] = value;
+            if (ppu->frame_log)
+                log_frame_write(ppu->frame_log, FRAME_LOG_BG_PRAM, pram_addr, value);
             if (auto_inc)
             {
                 pram_addr = (pram_addr + 1) & 0x3f;
@@ -185,6 +202,8 @@ void ppu_write(gameboy *gb, uint16_t address, uint8_t value)
             bool auto_inc = (ppu->ocps >> 7) & 1;
 
             ppu->obj_pram[pram_addr] = value;
+            if (ppu->frame_log)
+                log_frame_write(ppu->frame_log, FRAME_LOG_OBJ_PRAM, pram_addr, value);
             if (auto_inc)
             {
                 pram_addr = (pram_addr + 1) & 0x3f;
@@ -224,22 +243,88 @@ void dma_transfer(gameboy *gb)
         exit(1);
     }
 
-    uint16_t source, dest;
-    uint8_t value;
-    bool mbc_read;
-    for (uint16_t lo = 0x0000; lo <= 0x009f; ++lo)
+    uint16_t source = (uint16_t)gb->ppu->dma << 8;
+
+    // the source never crosses a page, so it can be copied all at once
+    const uint8_t *page = memory_page(gb, source);
+    if (page)
     {
-        source = ((uint16_t)gb->ppu->dma << 8) | lo;
-        dest = 0xfe00 | lo;
-        mbc_read = source <= 0x7fff || (0xa000 <= source && source <= 0xbfff);
+        memcpy(gb->memory->oam, &page[source & (MEMORY_PAGE_SIZE - 1)], OAM_SIZE);
+    }
+    else
+    {
+        // cartridge RAM, or ROM while the boot ROM is mapped over it
+        for (uint16_t lo = 0x0000; lo < OAM_SIZE; ++lo)
+            gb->memory->oam[lo] = cartridge_read(gb, source | lo);
+    }
 
-        // source may be in cartridge RAM/ROM
-        if (mbc_read)
-            value = cartridge_read(gb, source);
-        else
-            value = ram_read(gb, source);
+    if (gb->ppu->frame_log)
+        log_frame_copy(gb->ppu->frame_log, FRAME_LOG_OAM, 0, gb->memory->oam, OAM_SIZE);
+}
+
+/* Perform part of a VRAM DMA transfer (CGB only)
+ * ----------------------------------------------
+ * Copies the given number of bytes (a multiple of 0x10) from the
+ * VRAM DMA source to its destination, advancing both. Runs of ROM
+ * or WRAM are copied up to a page boundary at a time; cartridge RAM
+ * is read a byte at a time, and any other source writes garbage.
+ *
+ * The CPU is stalled for 8 normal-speed m-cycles per 0x10 bytes.
+ * That's left to the game loop, which counts down gb->vram_dma_stall.
+ */
+void vram_dma_transfer(gameboy *gb, uint16_t length)
+{
+    gb->vram_dma_length -= length;
+    if (!gb->vram_dma_length)
+        gb->hdma_running = false;
+
+    gb->vram_dma_stall += length >> 4;
+
+    while (length)
+    {
+        uint16_t source = gb->vram_dma_source,
+                 dest = gb->vram_dma_dest,
+                 source_offset = source & (MEMORY_PAGE_SIZE - 1),
+                 dest_offset = dest & (MEMORY_PAGE_SIZE - 1);
+
+        // the longest run that stays within one page on both ends
+        uint16_t run = MEMORY_PAGE_SIZE - (source_offset > dest_offset ? source_offset : dest_offset);
+        if (run > length)
+            run = length;
 
-        ram_write(gb, dest, value);
+        bool plain_source = source <= 0x7fff || (source >= 0xc000 && source <= 0xdfff);
+        const uint8_t *from = plain_source ? memory_page(gb, source) : NULL;
+        uint8_t *to = dest <= 0x9fff ? (uint8_t *)memory_page(gb, dest) : NULL;
+
+        if (from && to)
+        {
+            memcpy(&to[dest_offset], &from[source_offset], run);
+
+            // the rest go through ram_write(), which logs them itself
+            if (gb->ppu->frame_log)
+            {
+                bool bankno = IS_CGB_MODE(gb) && gb->vbk & 1;
+                log_frame_copy(gb->ppu->frame_log, FRAME_LOG_VRAM0 + bankno,
+                               dest & VRAM_MASK, &to[dest_offset], run);
+            }
+        }
+        else for (uint16_t i = 0; i < run; ++i)
+        {
+            uint16_t address = source + i;
+            uint8_t value;
+            if (address <= 0x7fff || (address >= 0xa000 && address <= 0xbfff))
+                value = cartridge_read(gb, address);
+            else if (address >= 0xc000 && address <= 0xdfff)
+                value = ram_read(gb, address);
+            else // reading VRAM during vram_dma writes garbage to VRAM
+                value = 0xa5; // 0b1010_0101
+
+            ram_write(gb, dest + i, value);
+        }
+
+        gb->vram_dma_source += run;
+        gb->vram_dma_dest += run;
+        length -= run;
     }
 }
 
@@ -255,6 +340,14 @@ void dma_transfer(gameboy *gb)
  */
 void reset_ppu(gameboy *gb)
 {
+    // dropping to mode 0 counts as entering HBLANK for HDMA
+    if (IS_CGB_MODE(gb) && gb->hdma_running && (gb->ppu->stat & 0x3))
+        vram_dma_transfer(gb, 0x10);
+
+    // the lines logged so far are blanked out below, but their writes still count
+    if (gb->ppu->frame_log)
+        sync_frame_log(gb->ppu->frame_log);
+
     gb->ppu->ly = 0;
     gb->ppu->dot_clock = 0;
     gb->ppu->stat &= 0xf8;
@@ -268,9 +361,9 @@ void reset_ppu(gameboy *gb)
 
     // in DMG mode, "white" may be a shade of green, depending on user choice
     uint16_t white;
-    if (gb->run_mode == GB_CGB_MODE && gb->ppu->lcd_filter)
+    if (IS_CGB_MODE(gb) && gb->ppu->lcd_filter)
         white = apply_lcd_filter(0xffff);
-    else if (gb->run_mode == GB_CGB_MODE)
+    else if (IS_CGB_MODE(gb))
         white = 0xffff;
     else
         white = gb->ppu->colors.white;
@@ -278,6 +371,10 @@ void reset_ppu(gameboy *gb)
     for (uint16_t i = 0; i < FRAME_WIDTH*FRAME_HEIGHT; ++i)
         gb->ppu->frame_buffer[i] = white;
     display_frame(gb);
+
+    // a render thread draws into a frame buffer of its own
+    if (gb->ppu->frame_log)
+        restart_frame_log(gb->ppu->frame_log, gb, true);
     LOG_DEBUG("PPU reset\n");
 }
 
@@ -356,12 +453,13 @@ static void perform_sprite_reflections(gb_sprite *sprite)
 }
 
 // Render the selected sprites from OAM
-static void render_loaded_sprites(gameboy *gb, gb_sprite *sprites, uint8_t n_sprites)
+static void render_loaded_sprites(const gb_renderer *renderer, const gb_line_regs *line,
+                                  gb_sprite *sprites, uint8_t n_sprites)
 {
     // Apply drawing priority then draw. Because objects are selected
     // out of OAM by scanning from start to end, they are already in
     // the correct ordering when using CGB priority
-    if (gb->run_mode == GB_DMG_MODE || gb->ppu->opri & 1)
+    if (!renderer->cgb || line->opri & 1)
         qsort(sprites, n_sprites, sizeof(gb_sprite), dmg_sprite_comp);
 
     for (uint8_t sprite_idx = 0; sprite_idx < n_sprites; ++sprite_idx)
@@ -379,32 +477,32 @@ static void render_loaded_sprites(gameboy *gb, gb_sprite *sprites, uint8_t n_spr
         for (uint16_t offset = 0; offset < curr_sprite->ysize * 2; ++offset)
         {
             uint16_t vram_offset = (base_tile_addr + offset) & VRAM_MASK;
-            bool bankno = gb->run_mode == GB_DMG_MODE ? 0 : curr_sprite->vram_bank;
-            curr_sprite->tile_data[offset] = gb->memory->vram[bankno][vram_offset];
+            bool bankno = renderer->cgb ? curr_sprite->vram_bank : 0;
+            curr_sprite->tile_data[offset] = renderer->vram[bankno][vram_offset];
         }
 
         // perform xflip and yflip before rendering by adjusting xpos and ypos
         perform_sprite_reflections(curr_sprite);
 
-        if (gb->run_mode == GB_DMG_MODE)
-            dmg_render_sprite_pixels(gb, curr_sprite);
+        if (!renderer->cgb)
+            dmg_render_sprite_pixels(line, curr_sprite);
         else
-            cgb_render_sprite_pixels(gb, curr_sprite);
+            cgb_render_sprite_pixels(line, curr_sprite);
     }
 }
 
 // Select bytes from OAM to render for the current scanline
-void load_sprites(gameboy *gb)
+void load_sprites(const gb_renderer *renderer, const gb_line_regs *line)
 {
-    bool obj_size_bit = gb->ppu->lcdc & 0x04;
-    uint16_t oam_base_addr = 0xfe00;
+    bool obj_size_bit = line->lcdc & 0x04;
+    const uint8_t *oam = renderer->oam;
     uint8_t ypos, xpos, tile_idx, flags;
     uint8_t sprite_ysize = obj_size_bit ? 16 : 8;
 
     // select the ten sprites to render for the current scan line from OAM
     gb_sprite sprites_to_render[10] = {0};
     uint8_t sprite_count = 0;
-    uint8_t shifted_ly = gb->ppu->ly + 16; // to match the +16 offset inside ypos
+    uint8_t shifted_ly = line->ly + 16; // to match the +16 offset inside ypos
 
     // NOTE: each sprite's attribute data is 4 bytes
     for (uint8_t oam_offset = 0x00; oam_offset < 0x9f; oam_offset += 4)
@@ -412,16 +510,16 @@ void load_sprites(gameboy *gb)
         if (sprite_count >= 10)
             break;
 
-        ypos = ram_read(gb, oam_base_addr + oam_offset); // sprite vertical pos + 16
+        ypos = oam[oam_offset]; // sprite vertical pos + 16
 
         // current scanline is interior to the sprite
         if (shifted_ly >= ypos && shifted_ly < ypos + sprite_ysize)
         {
             gb_sprite *curr_sprite = sprites_to_render + sprite_count;
 
-            xpos = ram_read(gb, oam_base_addr + oam_offset + 1);
-            tile_idx = ram_read(gb, oam_base_addr + oam_offset + 2);
-            flags = ram_read(gb, oam_base_addr + oam_offset + 3);
+            xpos = oam[oam_offset + 1];
+            tile_idx = oam[oam_offset + 2];
+            flags = oam[oam_offset + 3];
 
             curr_sprite->ypos       = ypos; // sprite vertical pos + 16
             curr_sprite->xpos       = xpos;
@@ -434,7 +532,7 @@ void load_sprites(gameboy *gb)
             curr_sprite->yflip       = (flags >> 6) & 1;
             curr_sprite->xflip       = (flags >> 5) & 1;
 
-            if (gb->run_mode == GB_DMG_MODE)
+            if (!renderer->cgb)
             {
                 curr_sprite->palette_no = (flags >> 4) & 1;
             }
@@ -448,30 +546,99 @@ void load_sprites(gameboy *gb)
         }
     }
 
-    render_loaded_sprites(gb, sprites_to_render, sprite_count);
+    render_loaded_sprites(renderer, line, sprites_to_render, sprite_count);
 }
 
-// Render a single scanline into the frame buffer
-static void render_scanline(gameboy *gb)
+// Draw a single scanline into the frame buffer
+void draw_scanline(const gb_renderer *renderer, const gb_line_regs *line)
 {
-    if (gb->ppu->ly == gb->ppu->wy)
-        gb->ppu->wy_trigger = true;
-
-    if (gb->run_mode == GB_DMG_MODE)
+    if (!renderer->cgb)
     {
-        dmg_render_scanline(gb);
-        dmg_push_scanline_data(gb);
+        dmg_render_scanline(renderer, line);
+        dmg_push_scanline_data(renderer, line);
     }
     else
     {
-        cgb_render_scanline(gb);
-        cgb_push_scanline_data(gb);
+        cgb_render_scanline(renderer, line);
+        cgb_push_scanline_data(renderer, line);
     }
 }
 
+// the registers the current scanline is drawn with
+static void read_line_regs(gb_ppu *ppu, gb_line_regs *line)
+{
+    line->ly = ppu->ly;
+    line->lcdc = ppu->lcdc;
+    line->scy = ppu->scy;
+    line->scx = ppu->scx;
+    line->wy = ppu->wy;
+    line->wx = ppu->wx;
+    line->bgp = ppu->bgp;
+    line->obp0 = ppu->obp0;
+    line->obp1 = ppu->obp1;
+    line->opri = ppu->opri;
+    line->wy_trigger = ppu->wy_trigger;
+    line->window_line = ppu->window_line_counter;
+    line->lcd_filter = ppu->lcd_filter;
+    line->colors = ppu->colors;
+}
+
+// Render a single scanline into the frame buffer, or log it to be drawn at VBLANK
+static void render_scanline(gameboy *gb)
+{
+    gb_ppu *ppu = gb->ppu;
+    if (ppu->ly == ppu->wy)
+        ppu->wy_trigger = true;
+
+    if (!ppu->skip_render)
+    {
+        gb_line_regs line;
+        read_line_regs(ppu, &line);
+
+        if (ppu->frame_log)
+        {
+            log_scanline(ppu->frame_log, &line);
+        }
+        else
+        {
+            gb_renderer renderer = {
+                .cgb = IS_CGB_MODE(gb),
+                .vram = {gb->memory->vram[0], gb->memory->vram[1]},
+                .oam = gb->memory->oam,
+                .bg_pram = ppu->bg_pram,
+                .obj_pram = ppu->obj_pram,
+                .frame_buffer = ppu->frame_buffer,
+            };
+            draw_scanline(&renderer, &line);
+        }
+    }
+
+    /* Drawing a scanline leaves nothing behind but the window's line
+     * counter, so it's kept in step here, drawn or not.
+     */
+    // in DMG mode LCDC bit 0 turns off the window as well
+    bool window_enabled = (ppu->lcdc & 0x20) && (IS_CGB_MODE(gb) || (ppu->lcdc & 0x01));
+    bool window_is_visible = ppu->wx <= 166 && ppu->wy <= 143;
+
+    if (window_enabled && window_is_visible && ppu->wy_trigger)
+        ++ppu->window_line_counter;
+}
+
 // Display the current frame buffer to the screen
 void display_frame(gameboy *gb)
 {
+    ++gb->ppu->frames_rendered;
+
+    if (gb->link && gb->link->replaying)
+        return;
+
+    // while the Game Boy runs, the main thread presents its frames (see mailbox.h)
+    if (gb->mailbox)
+    {
+        post_frame(gb, gb->ppu->frame_buffer);
+        return;
+    }
+
     void *texture_pixels;
     int pitch; // length of one row in bytes
 
@@ -486,8 +653,6 @@ void display_frame(gameboy *gb)
     SDL_RenderClear(gb->renderer);
     SDL_RenderCopy(gb->renderer, gb->screen, NULL, NULL);
     SDL_RenderPresent(gb->renderer);
-
-    ++gb->ppu->frames_rendered;
 }
 
 /* Compare the LY and LYC registers. If the two values
@@ -638,17 +803,41 @@ void run_ppu(gameboy *gb, uint8_t num_clocks)
         {
             render_scanline(gb);
             gb->ppu->curr_scanline_rendered = true;
+
+            // HBLANK DMA transfers 0x10 bytes on entering HBLANK
+            if (IS_CGB_MODE(gb) && gb->hdma_running)
+                vram_dma_transfer(gb, 0x10);
         }
         // we display the frame once we've reached the VBLANK period
         // we also need to request a vblank interrupt upon entering
         else if (ppu_mode == 0x01 && !gb->ppu->curr_frame_displayed)
         {
             request_interrupt(gb, VBLANK);
-            display_frame(gb);
+
+            // the lines logged this frame are drawn all at once
+            if (gb->ppu->frame_log)
+                flush_frame_log(gb->ppu->frame_log);
+
+            // frames run through again after a rollback were already presented
+            bool replaying = gb->link && gb->link->replaying;
+
+            // wait for the frame's deadline before it's presented
+            if (gb->pacer && gb->speed.speed != UNCAPPED_SPEED && !replaying)
+                pace_frame(gb->pacer);
+
+            if (!gb->ppu->skip_render)
+                display_frame(gb);
             gb->ppu->curr_frame_displayed = true;
             gb->ppu->window_line_counter = 0;
             gb->ppu->wy_trigger = false;
-            gb->frame_presented_signal = true;
+
+            gb->frame_presented_signal = !replaying;
+
+            if (gb->frame_hasher && !process_frame_hash(gb->frame_hasher, gb->ppu->frame_buffer))
+                gb->is_on = false;
+
+            if (gb->state_hasher && !record_state_hash(gb))
+                gb->is_on = false;
         }
 
         // check if we're done with the current scanline
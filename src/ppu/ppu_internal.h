@@ -12,17 +12,51 @@
 
 #define VRAM_MASK 0x1fff
 
+// the PPU registers and display settings a scanline is drawn with
+typedef struct gb_line_regs {
+    uint8_t ly, lcdc, scy, scx, wy, wx;
+    uint8_t bgp, obp0, obp1, opri;
+    bool wy_trigger;
+
+    // lines of the window drawn before this one in the current frame
+    uint8_t window_line;
+
+    bool lcd_filter;
+    display_colors colors;
+} gb_line_regs;
+
+/* The memory scanlines are drawn from, and the frame buffer they're
+ * drawn into. Drawn as the PPU reaches them, that's the Game Boy's own
+ * memory; drawn a frame at a time, it's copies kept in step with the
+ * frame log (see frame_log.c).
+ */
+typedef struct gb_renderer {
+    bool cgb;
+    const uint8_t *vram[2];
+    const uint8_t *oam;
+    const uint8_t *bg_pram, *obj_pram;
+    uint16_t *frame_buffer;
+} gb_renderer;
+
 uint8_t reverse_byte(uint8_t b);
 
 void init_display_colors(display_colors *colors);
 uint16_t apply_lcd_filter(uint16_t color);
 
-void dmg_render_sprite_pixels(gameboy *gb, gb_sprite *sprite);
-void dmg_render_scanline(gameboy *gb);
-void dmg_push_scanline_data(gameboy *gb);
+void load_sprites(const gb_renderer *renderer, const gb_line_regs *line);
+void draw_scanline(const gb_renderer *renderer, const gb_line_regs *line);
+
+void dmg_render_sprite_pixels(const gb_line_regs *line, gb_sprite *sprite);
+void dmg_render_scanline(const gb_renderer *renderer, const gb_line_regs *line);
+void dmg_push_scanline_data(const gb_renderer *renderer, const gb_line_regs *line);
+
+void cgb_render_sprite_pixels(const gb_line_regs *line, gb_sprite *sprite);
+void cgb_render_scanline(const gb_renderer *renderer, const gb_line_regs *line);
+void cgb_push_scanline_data(const gb_renderer *renderer, const gb_line_regs *line);
 
-void cgb_render_sprite_pixels(gameboy *gb, gb_sprite *sprite);
-void cgb_render_scanline(gameboy *gb);
-void cgb_push_scanline_data(gameboy *gb);
+/* Log a scanline reached while rendering a frame at a time, to be
+ * drawn with the given registers once the frame's done
+ */
+void log_scanline(gb_frame_log *log, const gb_line_regs *line);
 
 #endif /* !CBOY_PPU_INTERNAL_H */
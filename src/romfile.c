@@ -0,0 +1,367 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cboy/romfile.h"
+#include "cboy/inflate.h"
+
+#define GZIP_FHCRC    0x02
+#define GZIP_FEXTRA   0x04
+#define GZIP_FNAME    0x08
+#define GZIP_FCOMMENT 0x10
+
+#define ZIP_LOCAL_HEADER_SIG   0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG 0x02014b50
+#define ZIP_END_RECORD_SIG     0x06054b50
+
+#define ZIP_LOCAL_HEADER_SIZE   30 /* bytes, not counting the name and extra field */
+#define ZIP_CENTRAL_HEADER_SIZE 46 /* bytes, not counting the name, extra field, and comment */
+#define ZIP_END_RECORD_SIZE     22 /* bytes, not counting the comment */
+#define ZIP_MAX_COMMENT_SIZE    0xffff
+
+#define ZIP_STORED   0
+#define ZIP_DEFLATED 8
+
+#define GZIP_TRAILER_SIZE 8 /* the CRC-32 and size of the data */
+
+static uint16_t get_le16(const uint8_t *bytes)
+{
+    return bytes[0] | (bytes[1] << 8);
+}
+
+static uint32_t get_le32(const uint8_t *bytes)
+{
+    return get_le16(bytes) | ((uint32_t)get_le16(bytes + 2) << 16);
+}
+
+/* CRC-32 (as used by gzip and ZIP) of the bytes following those
+ * crc is the CRC of. Done a nibble at a time, from a small table.
+ */
+static uint32_t update_crc32(uint32_t crc, const uint8_t *bytes, size_t len)
+{
+    static const uint32_t nibble_table[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+        0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+        0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ nibble_table[crc & 0xf];
+        crc = (crc >> 4) ^ nibble_table[crc & 0xf];
+    }
+
+    return ~crc;
+}
+
+// skip a NUL-terminated string in a gzip header
+static bool skip_gzip_string(FILE *file)
+{
+    int c;
+    while ((c = fgetc(file)) != EOF)
+        if (c == 0)
+            return true;
+
+    return false;
+}
+
+/* Skip past the gzip header (RFC 1952) at the start
+ * of the file, to the start of the DEFLATE stream.
+ */
+static bool skip_gzip_header(FILE *file)
+{
+    uint8_t header[10];
+    if (fread(header, 1, sizeof header, file) != sizeof header)
+        return false;
+
+    // deflate is the only compression method
+    if (header[0] != 0x1f || header[1] != 0x8b || header[2] != 8)
+        return false;
+
+    uint8_t flags = header[3];
+    if (flags & GZIP_FEXTRA)
+    {
+        uint8_t extra_len[2];
+        if (fread(extra_len, 1, 2, file) != 2 || fseek(file, get_le16(extra_len), SEEK_CUR))
+            return false;
+    }
+
+    if ((flags & GZIP_FNAME) && !skip_gzip_string(file))
+        return false;
+    if ((flags & GZIP_FCOMMENT) && !skip_gzip_string(file))
+        return false;
+    if ((flags & GZIP_FHCRC) && fseek(file, 2, SEEK_CUR))
+        return false;
+
+    return true;
+}
+
+static bool is_rom_name(const uint8_t *name, uint16_t name_len)
+{
+    const char *extensions[] = {".gb", ".gbc"};
+    for (size_t i = 0; i < sizeof extensions / sizeof extensions[0]; ++i)
+    {
+        size_t ext_len = strlen(extensions[i]);
+        if (name_len < ext_len)
+            continue;
+
+        const uint8_t *ext = name + name_len - ext_len;
+        size_t j = 0;
+        while (j < ext_len && tolower(ext[j]) == extensions[i][j])
+            ++j;
+
+        if (j == ext_len)
+            return true;
+    }
+
+    return false;
+}
+
+/* Find the ZIP archive member to load in the central directory,
+ * which (unlike local headers) always has the members' sizes.
+ * Returns false if the archive is malformed or has no usable member.
+ */
+static bool find_zip_member(FILE *file, uint32_t *member_offset, uint16_t *method,
+                            uint32_t *compressed_size, uint32_t *crc, uint32_t *size)
+{
+    /* The end of central directory record is at the end
+     * of the file, followed only by a variable-length comment
+     */
+    if (fseek(file, 0, SEEK_END))
+        return false;
+    long file_size = ftell(file);
+    if (file_size < ZIP_END_RECORD_SIZE)
+        return false;
+
+    // holds the end of the file, then each member's name
+    long buffer_size = ZIP_END_RECORD_SIZE + ZIP_MAX_COMMENT_SIZE;
+    uint8_t *buffer = malloc(buffer_size);
+    if (!buffer)
+        return false;
+
+    bool found = false;
+    long tail_size = file_size < buffer_size ? file_size : buffer_size;
+    if (fseek(file, file_size - tail_size, SEEK_SET)
+        || fread(buffer, 1, tail_size, file) != (size_t)tail_size)
+        goto done;
+
+    const uint8_t *end_record = NULL;
+    for (long i = tail_size - ZIP_END_RECORD_SIZE; i >= 0 && !end_record; --i)
+        if (get_le32(buffer + i) == ZIP_END_RECORD_SIG)
+            end_record = buffer + i;
+
+    if (!end_record)
+        goto done;
+
+    uint16_t num_members = get_le16(end_record + 10);
+    uint32_t directory_offset = get_le32(end_record + 16);
+    if (fseek(file, directory_offset, SEEK_SET))
+        goto done;
+
+    for (uint16_t i = 0; i < num_members; ++i)
+    {
+        uint8_t header[ZIP_CENTRAL_HEADER_SIZE];
+        uint8_t *name = buffer;
+        if (fread(header, 1, sizeof header, file) != sizeof header
+            || get_le32(header) != ZIP_CENTRAL_HEADER_SIG)
+        {
+            found = false;
+            goto done;
+        }
+
+        uint16_t flags = get_le16(header + 8);
+        uint16_t name_len = get_le16(header + 28);
+        uint16_t extra_len = get_le16(header + 30);
+        uint16_t comment_len = get_le16(header + 32);
+        if (fread(name, 1, name_len, file) != name_len
+            || fseek(file, extra_len + comment_len, SEEK_CUR))
+        {
+            found = false;
+            goto done;
+        }
+
+        // skip directories and encrypted members
+        bool usable = name_len && name[name_len - 1] != '/' && !(flags & 0x1);
+        if (!usable || (found && !is_rom_name(name, name_len)))
+            continue;
+
+        *method = get_le16(header + 10);
+        *crc = get_le32(header + 16);
+        *compressed_size = get_le32(header + 20);
+        *size = get_le32(header + 24);
+        *member_offset = get_le32(header + 42);
+        found = true;
+
+        if (is_rom_name(name, name_len))
+            break;
+    }
+
+done:
+    free(buffer);
+    return found;
+}
+
+/* Move to the start of the data of the ZIP archive member to load.
+ * Returns false if the archive is malformed.
+ */
+static bool open_zip_member(gb_rom_file *rom_file, uint16_t *method)
+{
+    uint32_t member_offset, compressed_size;
+    if (!find_zip_member(rom_file->file, &member_offset, method, &compressed_size,
+                         &rom_file->archived_crc, &rom_file->archived_size))
+        return false;
+
+    uint8_t header[ZIP_LOCAL_HEADER_SIZE];
+    if (fseek(rom_file->file, member_offset, SEEK_SET)
+        || fread(header, 1, sizeof header, rom_file->file) != sizeof header
+        || get_le32(header) != ZIP_LOCAL_HEADER_SIG)
+        return false;
+
+    uint16_t name_len = get_le16(header + 26);
+    uint16_t extra_len = get_le16(header + 28);
+    if (fseek(rom_file->file, name_len + extra_len, SEEK_CUR))
+        return false;
+
+    rom_file->stored_left = compressed_size;
+    return true;
+}
+
+gb_rom_file *open_rom_file(const char *path)
+{
+    gb_rom_file *rom_file = calloc(1, sizeof(gb_rom_file));
+    if (!rom_file)
+        return NULL;
+
+    rom_file->file = fopen(path, "rb");
+    if (!rom_file->file)
+    {
+        free(rom_file);
+        return NULL;
+    }
+
+    // recognize the format by its magic number
+    uint8_t magic[4] = {0};
+    size_t magic_len = fread(magic, 1, sizeof magic, rom_file->file);
+    rewind(rom_file->file);
+
+    bool compressed = false;
+    if (magic_len >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+    {
+        rom_file->format = ROM_FILE_GZIP;
+        compressed = true;
+        rom_file->malformed = !skip_gzip_header(rom_file->file);
+    }
+    else if (magic_len == 4 && get_le32(magic) == ZIP_LOCAL_HEADER_SIG)
+    {
+        rom_file->format = ROM_FILE_ZIP;
+
+        uint16_t method = ZIP_STORED;
+        rom_file->malformed = !open_zip_member(rom_file, &method)
+                              || (method != ZIP_STORED && method != ZIP_DEFLATED);
+        compressed = method == ZIP_DEFLATED;
+    }
+
+    rom_file->io_error = ferror(rom_file->file);
+    if (compressed && !rom_file->malformed)
+    {
+        rom_file->inflater = malloc(sizeof(gb_inflater));
+        if (!rom_file->inflater)
+        {
+            close_rom_file(rom_file);
+            return NULL;
+        }
+
+        init_inflater(rom_file->inflater, rom_file->file);
+    }
+
+    return rom_file;
+}
+
+void close_rom_file(gb_rom_file *rom_file)
+{
+    if (!rom_file)
+        return;
+
+    if (rom_file->file)
+        fclose(rom_file->file);
+
+    free(rom_file->inflater);
+    free(rom_file);
+}
+
+// read_rom_file(), but without treating the end of the ROM as an error
+static size_t read_rom_data(gb_rom_file *rom_file, uint8_t *buffer, size_t len)
+{
+    size_t n;
+
+    if (rom_file->malformed || rom_file->io_error)
+        return 0;
+    else if (rom_file->inflater)
+    {
+        n = inflate_read(rom_file->inflater, buffer, len);
+        rom_file->io_error = rom_file->inflater->io_error;
+    }
+    else if (rom_file->format == ROM_FILE_ZIP)
+    {
+        // a stored member ends before the rest of the archive
+        size_t to_read = len < rom_file->stored_left ? len : rom_file->stored_left;
+        n = fread(buffer, 1, to_read, rom_file->file);
+        rom_file->io_error = ferror(rom_file->file);
+        rom_file->stored_left -= n;
+    }
+    else
+    {
+        n = fread(buffer, 1, len, rom_file->file);
+        rom_file->io_error = ferror(rom_file->file);
+        return n;
+    }
+
+    rom_file->crc = update_crc32(rom_file->crc, buffer, n);
+    rom_file->size += n;
+    return n;
+}
+
+size_t read_rom_file(gb_rom_file *rom_file, uint8_t *buffer, size_t len)
+{
+    size_t n = read_rom_data(rom_file, buffer, len);
+    if (n < len && !rom_file->io_error)
+        rom_file->malformed = true;
+
+    return n;
+}
+
+bool finish_rom_file(gb_rom_file *rom_file)
+{
+    if (rom_file->format == ROM_FILE_PLAIN || rom_file->malformed || rom_file->io_error)
+        return !rom_file->malformed && !rom_file->io_error;
+
+    uint8_t buffer[4096];
+    while (read_rom_data(rom_file, buffer, sizeof buffer) == sizeof buffer)
+        ;
+
+    if (rom_file->io_error)
+        return false;
+
+    // the data ended early
+    bool complete = rom_file->inflater ? !rom_file->inflater->error : !rom_file->stored_left;
+
+    if (complete && rom_file->format == ROM_FILE_GZIP)
+    {
+        uint8_t trailer[GZIP_TRAILER_SIZE] = {0};
+        complete = inflate_read_trailer(rom_file->inflater, trailer, sizeof trailer) == sizeof trailer;
+        rom_file->io_error = rom_file->inflater->io_error;
+
+        rom_file->archived_crc = get_le32(trailer);
+        rom_file->archived_size = get_le32(trailer + 4);
+    }
+
+    rom_file->malformed = !complete
+                          || rom_file->crc != rom_file->archived_crc
+                          || rom_file->size != rom_file->archived_size;
+
+    return !rom_file->malformed && !rom_file->io_error;
+}
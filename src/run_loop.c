@@ -0,0 +1,175 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <SDL_events.h>
+#include <SDL_audio.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/memory.h"
+#include "cboy/mbc.h"
+#include "cboy/ppu.h"
+#include "cboy/interrupts.h"
+#include "cboy/instructions.h"
+#include "cboy/joypad.h"
+#include "cboy/apu.h"
+#include "cboy/movie.h"
+#include "cboy/bootcache.h"
+#include "cboy/pacer.h"
+#include "cboy/speed.h"
+#include "cboy/serial.h"
+#include "cboy/link.h"
+#include "cboy/mailbox.h"
+#include "cboy/log.h"
+
+/* Check if a DMA transfer needs to be performed
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * To emulate the DMA transfer timing, we wait until the
+ * number of clocks that a DMA transfer takes has elapsed
+ * since the DMA register was written to, then we perform
+ * the DMA transfer all at once. This works because the
+ * CPU only has access to HRAM while the DMA process is
+ * supposed to be occurring.
+ *
+ * The transfer takes 160 m-cycles (640 clocks)
+ */
+static void dma_transfer_check(gameboy *gb, uint8_t num_clocks)
+{
+    if (gb->dma_requested)
+    {
+        gb->dma_counter += num_clocks;
+        if (gb->dma_counter >= 640)
+        {
+            LOG_DEBUG("Performing DMA Transfer\n");
+            dma_transfer(gb);
+            gb->dma_requested = false;
+            gb->dma_counter = 0;
+            remap_memory(gb);
+        }
+    }
+
+}
+
+// check if we can exit the HALT instruction
+static void check_halt_wakeup(gameboy *gb)
+{
+    // we exit if an interrupt is pending
+    if (gb->cpu.interrupts_pending)
+    {
+        LOG_DEBUG("Exiting HALTed state\n");
+        gb->cpu.is_halted = false;
+    }
+}
+
+/* Wait for half the audio buffer to be consumed before resuming
+ * emulation. Emulation runs ahead of the audio being played, so once
+ * it's done waiting, it has caught up with the host, and input that
+ * came in meanwhile is due straight away (see sync_input_time()).
+ */
+static inline void throttle_emulation(gameboy *gb)
+{
+    do
+    {
+        SDL_Delay(1);
+    } while (buffered_audio_frames(gb->apu) > AUDIO_BUFFER_FRAME_SIZE / 2);
+
+    sync_input_time(gb);
+}
+
+// run the emulator
+void run_gameboy(gameboy *gb)
+{
+    int num_clocks;
+    while (gb->is_on)
+    {
+#ifdef DEBUG
+        // print CPU register contents before each instruction
+        if (!gb->cpu.is_halted)
+            print_registers(gb);
+#endif
+
+        // number of CPU clock ticks this iteration of the event loop
+        num_clocks = 0;
+
+        if (IS_CGB_MODE(gb) && gb->vram_dma_stall)
+        {
+            /* VRAM DMA is copied when it's triggered (see
+             * vram_dma_transfer), but the CPU is stalled for
+             * 8 normal-speed m-cycles per 0x10 bytes copied.
+             */
+            --gb->vram_dma_stall;
+            if (gb->double_speed)
+                num_clocks += 8 * 8;
+            else
+                num_clocks += 4 * 8;
+        }
+        else if (gb->cpu.is_halted)
+        {
+            // same number of CPU clock ticks as a NOP
+            // See: https://gbdev.io/pandocs/CPU_Instruction_Set.html#cpu-control-instructions
+            num_clocks += 4;
+            check_halt_wakeup(gb);
+        }
+        else
+        {
+            // number of CPU clock ticks, given number of m-cycles
+            num_clocks += 4 * execute_instruction(gb);
+        }
+
+        increment_clock_counter(gb, num_clocks);
+
+        dma_transfer_check(gb, num_clocks);
+
+        if (gb->serial_clocks)
+            run_serial(gb, num_clocks);
+
+        // PPU and APU always run at normal speed (RTC as well)
+        if (IS_CGB_MODE(gb) && gb->double_speed)
+            num_clocks /= 2;
+
+        gb->master_clock += num_clocks;
+
+        if (gb->cart->has_rtc)
+        {
+            tick_rtc(gb, num_clocks);
+            gb->cart->time_source.elapsed_clocks += num_clocks;
+        }
+
+        run_apu(gb, num_clocks);
+
+        run_ppu(gb, num_clocks);
+
+        // input from the main thread, once it's due (see mailbox.h)
+        if (gb->master_clock >= gb->next_input_check)
+            process_input(gb, INPUT_DUE);
+
+        if (gb->frame_presented_signal)
+        {
+            gb->frame_presented_signal = false;
+            process_input(gb, INPUT_FRAME_END);
+
+            if (gb->movie)
+                process_movie_frame(gb);
+
+            update_frame_skip(gb);
+        }
+
+        if (gb->audio_sync_signal)
+        {
+            gb->audio_sync_signal = false;
+            bool lcd_on = (gb->ppu->lcdc >> 7) & 1;
+            if (gb->speed.speed != UNCAPPED_SPEED && (gb->sync_mode == SYNC_AUDIO || !lcd_on))
+                throttle_emulation(gb);
+        }
+
+        // once the instruction unmapping the boot ROM has finished
+        if (gb->boot_rom_finished_signal)
+        {
+            gb->boot_rom_finished_signal = false;
+            save_boot_snapshot(gb);
+        }
+
+        // may roll back if linked over a socket, so the state
+        // has to be consistent by now (see socklink.h)
+        if (gb->link)
+            run_link(gb);
+    }
+}
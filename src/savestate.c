@@ -0,0 +1,87 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/savestate.h"
+#include "cboy/cartridge.h"
+#include "cboy/mbc.h"
+#include "cboy/memory.h"
+
+/* The state beyond the boot snapshot's: the serial port and the
+ * cartridge. The MBC's bank pointers are saved along with the
+ * registers they follow.
+ */
+#define SAVESTATE_FIELDS(gb, FIELD) (      \
+    MACHINE_STATE_FIELDS(gb, FIELD)        \
+    && FIELD((gb)->serial_clocks)          \
+    && FIELD(*(gb)->cart->mbc))
+
+#define COUNT_FIELD(field) ((size += sizeof (field)), true)
+#define SAVE_FIELD(field) \
+    ((memcpy(data, &(field), sizeof (field)), data += sizeof (field)), true)
+#define LOAD_FIELD(field) \
+    ((memcpy(&(field), data, sizeof (field)), data += sizeof (field)), true)
+
+static size_t savestate_size(gameboy *gb)
+{
+    size_t size = 0;
+    (void)SAVESTATE_FIELDS(gb, COUNT_FIELD);
+
+    return size + (size_t)gb->cart->num_ram_banks * gb->cart->ram_bank_size;
+}
+
+bool init_savestate(gameboy *gb, gb_savestate *state)
+{
+    state->master_clock = 0;
+    state->data = malloc(savestate_size(gb));
+    return state->data != NULL;
+}
+
+void free_savestate(gb_savestate *state)
+{
+    free(state->data);
+    state->data = NULL;
+}
+
+void save_state(gameboy *gb, gb_savestate *state)
+{
+    // the frame buffer is saved with the rest
+    if (gb->ppu->frame_log)
+        sync_frame_log(gb->ppu->frame_log);
+    sync_apu(gb->apu);
+
+    uint8_t *data = state->data;
+    (void)SAVESTATE_FIELDS(gb, SAVE_FIELD);
+
+    gb_cartridge *cart = gb->cart;
+    for (int i = 0; i < cart->num_ram_banks; ++i)
+    {
+        memcpy(data, cart->ram_banks[i], cart->ram_bank_size);
+        data += cart->ram_bank_size;
+    }
+
+    state->master_clock = gb->master_clock;
+}
+
+void load_state(gameboy *gb, const gb_savestate *state)
+{
+    const uint8_t *data = state->data;
+    (void)SAVESTATE_FIELDS(gb, LOAD_FIELD);
+
+    gb_cartridge *cart = gb->cart;
+    for (int i = 0; i < cart->num_ram_banks; ++i)
+    {
+        memcpy(cart->ram_banks[i], data, cart->ram_bank_size);
+        data += cart->ram_bank_size;
+    }
+
+    // the banks mapped in may have changed
+    remap_memory(gb);
+
+    // the frame buffer may be part way through a frame
+    if (gb->ppu->frame_log)
+        restart_frame_log(gb->ppu->frame_log, gb, false);
+    restart_apu(gb->apu);
+}
@@ -0,0 +1,85 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/serial.h"
+#include "cboy/interrupts.h"
+#include "cboy/link.h"
+#include "cboy/memory.h"
+
+// SB and SC are stored in gb->memory->io
+#define SERIAL_IO(gb, reg) ((gb)->memory->io[(reg) & 0x7f])
+
+uint8_t serial_read(gameboy *gb, uint16_t address)
+{
+    return SERIAL_IO(gb, address);
+}
+
+void serial_write(gameboy *gb, uint16_t address, uint8_t value)
+{
+    SERIAL_IO(gb, address) = value;
+
+    // sync up with the other end before going on, in case this starts
+    // waiting for it to clock a transfer, or it predicts from SB and SC
+    if (gb->link)
+        gb->link->next_sync = 0;
+
+    if (address != SC_REGISTER)
+        return;
+
+    // restarting or stopping a transfer this Game Boy is clocking
+    if (gb->link && gb->serial_clocks)
+        cancel_link_transfer(gb);
+    gb->serial_clocks = 0;
+
+    if ((value & 0x80) && (value & 0x01))
+    {
+        bool fast = IS_CGB_MODE(gb) && (value & 0x02);
+        gb->serial_clocks = 8 * (fast ? FAST_SERIAL_CLOCKS_PER_BIT : SERIAL_CLOCKS_PER_BIT);
+
+        // the other end can tell when this transfer completes from the start
+        if (gb->link)
+        {
+            bool double_speed = IS_CGB_MODE(gb) && gb->double_speed;
+            start_link_transfer(gb, SERIAL_IO(gb, SB_REGISTER),
+                                gb->master_clock + (gb->serial_clocks >> double_speed));
+        }
+    }
+}
+
+static void complete_transfer(gameboy *gb, uint8_t received)
+{
+    SERIAL_IO(gb, SB_REGISTER) = received;
+    SERIAL_IO(gb, SC_REGISTER) &= 0x7f;
+    request_interrupt(gb, SERIAL);
+}
+
+void run_serial(gameboy *gb, uint16_t num_clocks)
+{
+    if (gb->serial_clocks > num_clocks)
+    {
+        gb->serial_clocks -= num_clocks;
+    }
+    else if (gb->serial_clocks)
+    {
+        gb->serial_clocks = 0;
+
+        // with no link cable, the input line is pulled high
+        complete_transfer(gb, gb->link ? finish_link_transfer(gb) : 0xff);
+    }
+}
+
+bool awaiting_serial_clock(gameboy *gb)
+{
+    return (SERIAL_IO(gb, SC_REGISTER) & 0x81) == 0x80;
+}
+
+uint8_t receive_serial_byte(gameboy *gb, uint8_t value)
+{
+    if (!awaiting_serial_clock(gb))
+        return 0xff;
+
+    uint8_t sent = SERIAL_IO(gb, SB_REGISTER);
+    complete_transfer(gb, value);
+    return sent;
+}
@@ -0,0 +1,832 @@
+#define _POSIX_C_SOURCE 200809L // sigaction
+
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/socklink.h"
+#include "cboy/link.h"
+#include "cboy/serial.h"
+#include "cboy/savestate.h"
+#include "cboy/memory.h"
+#include "cboy/pacer.h"
+#include "cboy/log.h"
+
+enum LINK_MESSAGE_TYPE {
+    MSG_PROGRESS, // none of the sender's transfers not sent yet completes before time
+    MSG_TRANSFER, // the sender started clocking out value, the transfer completes at time
+    MSG_CANCEL,   // the sender stopped the transfer completing at time
+    MSG_REPLY,    // value was shifted out in exchange for the transfer completing at time
+    MSG_SERIAL,   // as of time, the sender's SB is value, and it's armed if waiting on a transfer
+};
+
+// both ends are this build on the same host, so messages are sent as they are in memory
+typedef struct link_message {
+    uint64_t time; // link time
+    uint8_t type;
+    uint8_t value;
+    bool armed;
+} link_message;
+
+#define MAX_INCOMING  4
+#define MAX_SNAPSHOTS (LINK_MAX_SPECULATION / LINK_SNAPSHOT_CLOCKS + 4)
+#define INBOX_SIZE    (64 * sizeof(link_message))
+
+// how long a stalled Game Boy waits for messages at a time, in ms
+#define STALL_POLL_MS 1
+
+// times a refused connection is retried, and the wait before each, in ms
+#define REFUSED_RETRIES  5
+#define REFUSED_RETRY_MS 20
+
+typedef struct incoming_transfer {
+    uint64_t time; // master clock it completes at
+    uint8_t value;
+    bool late;     // this end had run past it when it arrived
+} incoming_transfer;
+
+typedef struct link_stats {
+    uint64_t transfers_sent, replies_received;
+    int64_t total_latency_ns, max_latency_ns;
+    uint64_t predictions, mispredictions;
+    uint64_t rollbacks, clocks_replayed;
+    uint64_t missed_rollbacks; // bytes delivered late, with no state to roll back to
+    uint64_t stalls;
+    int64_t stall_ns;
+} link_stats;
+
+/* Times are this Game Boy's master clock, other than in messages,
+ * which carry link time: the master clock less the epoch.
+ */
+struct gb_socket_link {
+    int fd;
+    bool connected;
+    uint64_t epoch;
+
+    // received bytes which don't make up a whole message yet
+    uint8_t inbox[INBOX_SIZE];
+    size_t inbox_len;
+
+    // none of the other end's transfers completes before this other than those received
+    uint64_t peer_progress;
+
+    // the other end's serial registers, to predict its replies from
+    uint8_t peer_sb;
+    bool peer_armed;
+
+    // transfers the other end clocked, not delivered yet, oldest first
+    incoming_transfer incoming[MAX_INCOMING];
+    int num_incoming;
+    uint64_t last_delivered;
+
+    // the transfer this end is clocking, and its reply if it came early
+    bool clocking, transfer_sent;
+    uint8_t transfer_value;
+    uint64_t transfer_time;
+    int64_t transfer_sent_ns;
+    bool reply_received;
+    uint8_t reply;
+
+    // a reply predicted for a transfer that completed, and the state right after
+    bool predicting, save_prediction, mispredicted;
+    uint8_t prediction;
+    uint64_t prediction_time;
+    gb_savestate prediction_state;
+
+    /* The earliest time since peer_progress this end might have been
+     * waiting on the other end to clock a transfer (UINT64_MAX if
+     * none). A byte arriving for any time after this might need a
+     * rollback, so states are saved every so often meanwhile.
+     */
+    uint64_t waiting_since;
+    gb_savestate snapshots[MAX_SNAPSHOTS];
+    int num_snapshots;
+    uint64_t next_snapshot;
+
+    uint64_t replay_until;
+    uint64_t next_poll;
+
+    // what's been sent about this end
+    uint64_t progress_sent;
+    uint8_t sb_sent;
+    bool armed_sent, serial_sent;
+
+    link_stats stats;
+};
+
+static void disconnect(gb_socket_link *link, const char *reason)
+{
+    if (!link->connected)
+        return;
+
+    LOG_INFO("\nLink cable disconnected: %s\n", reason);
+    link->connected = false;
+
+    // nothing more can arrive, so what was predicted stands
+    link->predicting = false;
+    link->mispredicted = false;
+    link->peer_progress = UINT64_MAX;
+    link->waiting_since = UINT64_MAX;
+    link->num_snapshots = 0;
+}
+
+static void send_message(gb_socket_link *link, uint8_t type, uint8_t value, bool armed, uint64_t time)
+{
+    if (!link->connected)
+        return;
+
+    link_message message;
+    memset(&message, 0, sizeof message); // no uninitialized padding on the wire
+    message.time = time - link->epoch;
+    message.type = type;
+    message.value = value;
+    message.armed = armed;
+
+    const uint8_t *bytes = (const uint8_t *)&message;
+    size_t sent = 0;
+    while (sent < sizeof message)
+    {
+        ssize_t n = send(link->fd, bytes + sent, sizeof message - sent, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            disconnect(link, errno == EPIPE || errno == ECONNRESET
+                             ? "the other Game Boy was turned off"
+                             : strerror(errno));
+            return;
+        }
+        sent += n;
+    }
+}
+
+static void handle_message(gb_socket_link *link, const link_message *message)
+{
+    uint64_t time = message->time + link->epoch;
+    switch (message->type)
+    {
+        case MSG_PROGRESS:
+            if (time > link->peer_progress)
+                link->peer_progress = time;
+            break;
+
+        case MSG_TRANSFER:
+            if (link->num_incoming == MAX_INCOMING)
+            {
+                disconnect(link, "too many transfers at once");
+                break;
+            }
+            link->incoming[link->num_incoming++] = (incoming_transfer){
+                .time = time,
+                .value = message->value,
+                .late = false,
+            };
+            break;
+
+        case MSG_CANCEL:
+            // too late if it's been delivered already
+            for (int i = 0; i < link->num_incoming; ++i)
+                if (link->incoming[i].time == time)
+                {
+                    memmove(&link->incoming[i], &link->incoming[i + 1],
+                            (link->num_incoming - i - 1) * sizeof link->incoming[0]);
+                    --link->num_incoming;
+                    break;
+                }
+            break;
+
+        case MSG_REPLY:
+        {
+            int64_t latency = host_time_ns() - link->transfer_sent_ns;
+            ++link->stats.replies_received;
+            link->stats.total_latency_ns += latency;
+            if (latency > link->stats.max_latency_ns)
+                link->stats.max_latency_ns = latency;
+
+            if (link->predicting && time == link->prediction_time)
+            {
+                link->mispredicted = message->value != link->prediction;
+                link->predicting = link->mispredicted;
+                link->reply = message->value;
+            }
+            else if (link->clocking && time == link->transfer_time)
+            {
+                link->reply_received = true;
+                link->reply = message->value;
+            }
+            break;
+        }
+
+        case MSG_SERIAL:
+            link->peer_sb = message->value;
+            link->peer_armed = message->armed;
+            break;
+
+        default:
+            disconnect(link, "unknown message");
+            break;
+    }
+}
+
+/* Handle the messages that have arrived, waiting up to timeout_ms for
+ * one if there are none. Transfers arriving for a time this Game Boy
+ * has run past are marked late.
+ */
+static void receive_messages(gameboy *gb, gb_socket_link *link, int timeout_ms)
+{
+    if (!link->connected)
+        return;
+
+    if (timeout_ms)
+    {
+        struct pollfd pfd = {.fd = link->fd, .events = POLLIN};
+        if (poll(&pfd, 1, timeout_ms) <= 0)
+            return;
+    }
+
+    for (;;)
+    {
+        ssize_t n = recv(link->fd, link->inbox + link->inbox_len,
+                         INBOX_SIZE - link->inbox_len, MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n <= 0)
+        {
+            disconnect(link, n && errno != ECONNRESET
+                             ? strerror(errno)
+                             : "the other Game Boy was turned off");
+            return;
+        }
+
+        link->inbox_len += n;
+        size_t used = 0;
+        while (link->inbox_len - used >= sizeof(link_message))
+        {
+            link_message message;
+            memcpy(&message, link->inbox + used, sizeof message);
+            used += sizeof message;
+
+            int num_incoming = link->num_incoming;
+            handle_message(link, &message);
+            if (link->num_incoming > num_incoming)
+                link->incoming[num_incoming].late = link->incoming[num_incoming].time < gb->master_clock;
+        }
+
+        memmove(link->inbox, link->inbox + used, link->inbox_len - used);
+        link->inbox_len -= used;
+    }
+}
+
+// the shortest transfer this Game Boy can clock, in normal-speed clocks
+static uint64_t min_transfer_clocks(gameboy *gb)
+{
+    return 8 * (IS_CGB_MODE(gb) ? FAST_SERIAL_CLOCKS_PER_BIT / 2 : SERIAL_CLOCKS_PER_BIT);
+}
+
+// the earliest time this Game Boy might roll back to, or UINT64_MAX
+static uint64_t rollback_floor(gb_socket_link *link)
+{
+    uint64_t floor = link->waiting_since;
+    if (link->predicting && link->prediction_time < floor)
+        floor = link->prediction_time;
+
+    return floor;
+}
+
+/* None of the other end's transfers not delivered yet completes
+ * before this time, those that have arrived included
+ */
+static uint64_t known_until(gb_socket_link *link)
+{
+    if (link->num_incoming && link->incoming[0].time < link->peer_progress)
+        return link->incoming[0].time;
+
+    return link->peer_progress;
+}
+
+static void save_snapshot(gameboy *gb, gb_socket_link *link)
+{
+    // the oldest goes if there's no room, which can only make a byte arrive late
+    if (link->num_snapshots == MAX_SNAPSHOTS)
+    {
+        gb_savestate oldest = link->snapshots[0];
+        memmove(&link->snapshots[0], &link->snapshots[1],
+                (MAX_SNAPSHOTS - 1) * sizeof link->snapshots[0]);
+        link->snapshots[MAX_SNAPSHOTS - 1] = oldest;
+        --link->num_snapshots;
+    }
+
+    save_state(gb, &link->snapshots[link->num_snapshots++]);
+    link->next_snapshot = gb->master_clock + LINK_SNAPSHOT_CLOCKS;
+}
+
+/* Drop the saved states no rollback can go back to: bytes can only be
+ * delivered late for times after known_until(), and never before the
+ * last one delivered, so only the last state saved by then is needed.
+ */
+static void drop_old_snapshots(gb_socket_link *link)
+{
+    uint64_t oldest_needed = known_until(link);
+    if (oldest_needed < link->last_delivered)
+        oldest_needed = link->last_delivered;
+
+    int first = 0;
+    while (first + 1 < link->num_snapshots
+           && link->snapshots[first + 1].master_clock <= oldest_needed)
+        ++first;
+
+    for (int i = 0; i < first; ++i)
+    {
+        // keep the buffers, rotated to the end
+        gb_savestate dropped = link->snapshots[0];
+        memmove(&link->snapshots[0], &link->snapshots[1],
+                (MAX_SNAPSHOTS - 1) * sizeof link->snapshots[0]);
+        link->snapshots[MAX_SNAPSHOTS - 1] = dropped;
+        --link->num_snapshots;
+    }
+}
+
+static void update_waiting(gameboy *gb, gb_socket_link *link)
+{
+    if (!link->connected)
+        return;
+
+    uint64_t now = gb->master_clock;
+    uint64_t known = known_until(link);
+    bool armed = awaiting_serial_clock(gb);
+
+    if (link->waiting_since != UINT64_MAX)
+    {
+        // everything that can still arrive is for later, and it isn't waiting now
+        if (!armed && known >= now)
+        {
+            link->waiting_since = UINT64_MAX;
+            link->num_snapshots = 0;
+        }
+        else if (link->waiting_since < known)
+        {
+            link->waiting_since = known;
+        }
+    }
+
+    if (armed && link->waiting_since == UINT64_MAX)
+    {
+        link->waiting_since = known > now ? known : now;
+        save_snapshot(gb, link);
+    }
+}
+
+static void roll_back(gameboy *gb, gb_socket_link *link, const gb_savestate *state)
+{
+    uint64_t now = gb->master_clock;
+
+    load_state(gb, state);
+    ++link->stats.rollbacks;
+    link->stats.clocks_replayed += now - state->master_clock;
+
+    if (!gb->link->replaying || now > link->replay_until)
+        link->replay_until = now;
+    gb->link->replaying = true;
+
+    // states saved after it are of the timeline rolled back from
+    while (link->num_snapshots
+           && link->snapshots[link->num_snapshots - 1].master_clock > state->master_clock)
+        --link->num_snapshots;
+    link->next_snapshot = state->master_clock + LINK_SNAPSHOT_CLOCKS;
+
+    // nothing is sent until it can't be rolled back, so it wasn't clocking
+    link->clocking = false;
+    link->reply_received = false;
+    if (link->predicting && link->prediction_time > state->master_clock)
+        link->predicting = false;
+
+    for (int i = 0; i < link->num_incoming; ++i)
+        link->incoming[i].late = false;
+
+    gb->link->next_sync = 0;
+}
+
+/* The latest saved state a byte arriving late for the given time can be
+ * delivered from, or NULL if there's none
+ */
+static const gb_savestate *snapshot_before(gb_socket_link *link, uint64_t time)
+{
+    const gb_savestate *state = NULL;
+    for (int i = 0; i < link->num_snapshots; ++i)
+        if (link->snapshots[i].master_clock <= time
+            && link->snapshots[i].master_clock >= link->last_delivered)
+            state = &link->snapshots[i];
+
+    if (link->predicting
+        && link->prediction_time <= time
+        && link->prediction_time >= link->last_delivered
+        && (state == NULL || state->master_clock < link->prediction_time))
+        state = &link->prediction_state;
+
+    return state;
+}
+
+/* Deliver the bytes due by now. Returns false if the Game Boy
+ * was rolled back to deliver one on time instead.
+ */
+static bool deliver_transfers(gameboy *gb, gb_socket_link *link)
+{
+    while (link->num_incoming && link->incoming[0].time <= gb->master_clock)
+    {
+        incoming_transfer transfer = link->incoming[0];
+        uint8_t reply = 0xff;
+
+        if (!transfer.late)
+        {
+            reply = receive_serial_byte(gb, transfer.value);
+        }
+        else if (transfer.time >= link->waiting_since)
+        {
+            const gb_savestate *state = snapshot_before(link, transfer.time);
+            if (state != NULL)
+            {
+                roll_back(gb, link, state);
+                return false;
+            }
+
+            ++link->stats.missed_rollbacks;
+            reply = receive_serial_byte(gb, transfer.value);
+        }
+        // otherwise it wasn't waiting on a transfer then, so it shifted out 0xff
+
+        send_message(link, MSG_REPLY, reply, false, transfer.time);
+
+        memmove(&link->incoming[0], &link->incoming[1],
+                (link->num_incoming - 1) * sizeof link->incoming[0]);
+        --link->num_incoming;
+        link->last_delivered = gb->master_clock;
+
+        // later bytes can't roll back to before this one
+        if (link->waiting_since != UINT64_MAX)
+            save_snapshot(gb, link);
+    }
+
+    return true;
+}
+
+/* Handle what's arrived, rolling back if needed. Returns false if the
+ * Game Boy was rolled back.
+ */
+static bool settle(gameboy *gb, gb_socket_link *link)
+{
+    if (link->mispredicted)
+    {
+        link->mispredicted = false;
+        link->predicting = false;
+        ++link->stats.mispredictions;
+
+        // the byte only went to SB, so the state after the transfer just needs it fixed
+        roll_back(gb, link, &link->prediction_state);
+        gb->memory->io[SB_REGISTER & 0x7f] = link->reply;
+        return false;
+    }
+
+    update_waiting(gb, link);
+    return deliver_transfers(gb, link);
+}
+
+static bool must_stall(gameboy *gb, gb_socket_link *link)
+{
+    uint64_t now = gb->master_clock;
+    uint64_t floor = rollback_floor(link);
+
+    // a transfer can't be taken back once sent
+    if (link->clocking && !link->transfer_sent && floor < now)
+        return true;
+
+    return floor != UINT64_MAX && now > floor && now - floor > LINK_MAX_SPECULATION;
+}
+
+static void send_progress(gameboy *gb, gb_socket_link *link, bool force)
+{
+    uint64_t now = gb->master_clock;
+    uint64_t floor = rollback_floor(link);
+
+    uint64_t progress = (floor < now ? floor : now) + min_transfer_clocks(gb);
+    if (link->clocking && !link->transfer_sent && link->transfer_time < progress)
+        progress = link->transfer_time;
+
+    if (progress > link->progress_sent && (force || progress >= link->progress_sent + LINK_SYNC_CLOCKS))
+    {
+        send_message(link, MSG_PROGRESS, 0, false, progress);
+        link->progress_sent = progress;
+    }
+
+    uint8_t sb = gb->memory->io[SB_REGISTER & 0x7f];
+    bool armed = awaiting_serial_clock(gb);
+    if (!link->serial_sent || sb != link->sb_sent || armed != link->armed_sent)
+    {
+        send_message(link, MSG_SERIAL, sb, armed, now);
+        link->sb_sent = sb;
+        link->armed_sent = armed;
+        link->serial_sent = true;
+    }
+}
+
+void start_socket_transfer(gameboy *gb, uint8_t value, uint64_t completion_time)
+{
+    gb_socket_link *link = gb->link->socket;
+
+    // sent once this Game Boy can't roll back to before now (see run_socket_link)
+    link->clocking = true;
+    link->transfer_sent = false;
+    link->transfer_value = value;
+    link->transfer_time = completion_time;
+    link->reply_received = false;
+}
+
+void cancel_socket_transfer(gameboy *gb)
+{
+    gb_socket_link *link = gb->link->socket;
+    if (link->clocking && link->transfer_sent)
+        send_message(link, MSG_CANCEL, 0, false, link->transfer_time);
+
+    link->clocking = false;
+    link->reply_received = false;
+}
+
+uint8_t finish_socket_transfer(gameboy *gb)
+{
+    gb_socket_link *link = gb->link->socket;
+    link->clocking = false;
+
+    if (!link->reply_received)
+        receive_messages(gb, link, 0);
+
+    if (link->reply_received)
+    {
+        link->reply_received = false;
+        return link->reply;
+    }
+
+    if (!link->connected || !link->transfer_sent)
+        return 0xff;
+
+    // the state is saved once this instruction is done
+    link->predicting = true;
+    link->save_prediction = true;
+    link->prediction = link->peer_armed ? link->peer_sb : 0xff;
+    link->prediction_time = link->transfer_time;
+    ++link->stats.predictions;
+    gb->link->next_sync = 0;
+
+    return link->prediction;
+}
+
+void run_socket_link(gameboy *gb)
+{
+    gb_link_port *port = gb->link;
+    gb_socket_link *link = port->socket;
+    if (gb->master_clock < port->next_sync)
+        return;
+
+    if (link->save_prediction)
+    {
+        link->save_prediction = false;
+        save_state(gb, &link->prediction_state);
+    }
+
+    if (port->replaying && gb->master_clock >= link->replay_until)
+        port->replaying = false;
+
+    if (gb->master_clock >= link->next_poll)
+    {
+        link->next_poll = gb->master_clock + LINK_SYNC_CLOCKS;
+        receive_messages(gb, link, 0);
+    }
+
+    if (!settle(gb, link))
+        return;
+
+    // wait for the other end when too much might have to be rolled back
+    if (link->connected && must_stall(gb, link))
+    {
+        int64_t stall_start = host_time_ns();
+        ++link->stats.stalls;
+
+        do
+        {
+            send_progress(gb, link, true);
+            receive_messages(gb, link, STALL_POLL_MS);
+            if (!settle(gb, link))
+            {
+                link->stats.stall_ns += host_time_ns() - stall_start;
+                return;
+            }
+        } while (link->connected && must_stall(gb, link));
+
+        link->stats.stall_ns += host_time_ns() - stall_start;
+    }
+
+    if (link->clocking && !link->transfer_sent && link->connected)
+    {
+        send_message(link, MSG_TRANSFER, link->transfer_value, false, link->transfer_time);
+        link->transfer_sent = true;
+        link->transfer_sent_ns = host_time_ns();
+        ++link->stats.transfers_sent;
+    }
+
+    send_progress(gb, link, false);
+
+    if (link->waiting_since != UINT64_MAX)
+    {
+        if (gb->master_clock >= link->next_snapshot)
+            save_snapshot(gb, link);
+        drop_old_snapshots(link);
+    }
+
+    // next time something's due
+    uint64_t next_sync = link->next_poll;
+    if (link->num_incoming && link->incoming[0].time < next_sync)
+        next_sync = link->incoming[0].time;
+    if (link->waiting_since != UINT64_MAX && link->next_snapshot < next_sync)
+        next_sync = link->next_snapshot;
+    if (port->replaying && link->replay_until < next_sync)
+        next_sync = link->replay_until;
+    port->next_sync = next_sync;
+}
+
+/* Connect to the socket at the address. The other Game Boy may have
+ * bound it but not be listening yet, so a refused connection is tried
+ * again after a short wait. Returns the connected socket, or -1 (with
+ * errno set) on failure.
+ */
+static int try_connect(const struct sockaddr_un *addr)
+{
+    for (int retry = 0; ; ++retry)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+
+        if (!connect(fd, (const struct sockaddr *)addr, sizeof *addr))
+            return fd;
+
+        int error = errno;
+        close(fd);
+        errno = error;
+
+        if (error != ECONNREFUSED || retry == REFUSED_RETRIES)
+            return -1;
+
+        poll(NULL, 0, REFUSED_RETRY_MS);
+    }
+}
+
+/* Connect to the socket at the address, or if nothing's listening
+ * there, listen for the other Game Boy to connect. Returns the
+ * connected socket, or -1 on failure.
+ */
+static int connect_socket(const struct sockaddr_un *addr)
+{
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        int fd = try_connect(addr);
+        if (fd >= 0)
+            return fd;
+
+        if (errno != ENOENT && errno != ECONNREFUSED)
+            return -1;
+
+        // a socket still refusing connections was left behind by a process that's gone
+        if (errno == ECONNREFUSED)
+            unlink(addr->sun_path);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+
+        if (bind(fd, (const struct sockaddr *)addr, sizeof *addr) < 0)
+        {
+            close(fd);
+
+            // the other Game Boy got there first
+            if (errno == EADDRINUSE)
+                continue;
+            return -1;
+        }
+
+        if (listen(fd, 1) < 0)
+        {
+            close(fd);
+            unlink(addr->sun_path);
+            return -1;
+        }
+
+        LOG_INFO("Waiting for the other Game Boy to connect to %s\n", addr->sun_path);
+        int peer;
+        while ((peer = accept(fd, NULL, NULL)) < 0 && errno == EINTR)
+            ;
+
+        close(fd);
+        unlink(addr->sun_path);
+        return peer;
+    }
+
+    return -1;
+}
+
+static void free_socket_link(gb_socket_link *link)
+{
+    for (int i = 0; i < MAX_SNAPSHOTS; ++i)
+        free_savestate(&link->snapshots[i]);
+    free_savestate(&link->prediction_state);
+    free(link);
+}
+
+bool open_socket_link(gameboy *gb, const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof addr.sun_path)
+    {
+        LOG_ERROR("Error: Socket path is too long: %s\n", path);
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+
+    gb_link_port *port = calloc(1, sizeof(gb_link_port));
+    gb_socket_link *link = calloc(1, sizeof(gb_socket_link));
+    bool ok = port != NULL && link != NULL && init_savestate(gb, &link->prediction_state);
+    for (int i = 0; ok && i < MAX_SNAPSHOTS; ++i)
+        ok = init_savestate(gb, &link->snapshots[i]);
+
+    if (!ok)
+    {
+        LOG_ERROR("Error: Not enough memory for the link cable\n");
+        if (link != NULL)
+            free_socket_link(link);
+        free(port);
+        return false;
+    }
+
+    // a write to a closed socket is reported as an error rather than killing the process
+    struct sigaction ignore = {.sa_handler = SIG_IGN};
+    sigaction(SIGPIPE, &ignore, NULL);
+
+    link->fd = connect_socket(&addr);
+    if (link->fd < 0)
+    {
+        LOG_ERROR("Error: Unable to link over %s: %s\n", path, strerror(errno));
+        free_socket_link(link);
+        free(port);
+        return false;
+    }
+
+    LOG_INFO("Linked to the other Game Boy over %s\n", path);
+
+    link->connected = true;
+    link->epoch = gb->master_clock;
+    link->peer_progress = gb->master_clock;
+    link->peer_sb = 0xff;
+    link->waiting_since = UINT64_MAX;
+
+    port->socket = link;
+    gb->link = port;
+    return true;
+}
+
+void close_socket_link(gameboy *gb)
+{
+    gb_socket_link *link = gb->link->socket;
+    link_stats *stats = &link->stats;
+
+    LOG_INFO("Link cable: %" PRIu64 " transfers clocked, replies arrived after %.1f us "
+             "on average and %.1f us at most\n",
+             stats->transfers_sent,
+             stats->replies_received ? stats->total_latency_ns / 1e3 / stats->replies_received : 0.0,
+             stats->max_latency_ns / 1e3);
+    LOG_INFO("Link cable: %" PRIu64 " of %" PRIu64 " predicted replies were wrong, "
+             "%" PRIu64 " rollbacks ran %.1f ms of emulated time again, "
+             "%" PRIu64 " bytes arrived too late to roll back for\n",
+             stats->mispredictions,
+             stats->predictions,
+             stats->rollbacks,
+             stats->clocks_replayed * 1e3 / GB_CPU_FREQUENCY,
+             stats->missed_rollbacks);
+    LOG_INFO("Link cable: stalled %" PRIu64 " times for %.1f ms in total\n",
+             stats->stalls,
+             stats->stall_ns / 1e6);
+
+    close(link->fd);
+    free_socket_link(link);
+    free(gb->link);
+    gb->link = NULL;
+}
@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/speed.h"
+#include "cboy/apu.h"
+#include "cboy/ppu.h"
+#include "cboy/pacer.h"
+
+// host time a Game Boy frame (70224 clocks) lasts at normal speed, in ns
+#define GB_FRAME_NS (70224 * 1000000000LL / GB_CPU_FREQUENCY)
+
+static void reset_decimation(gb_apu *apu, uint8_t decimation)
+{
+    apu->decimation = decimation;
+    apu->decimated_left = 0;
+    apu->decimated_right = 0;
+    apu->num_decimated = 0;
+}
+
+void set_emulation_speed(gameboy *gb, uint8_t speed)
+{
+    gb_speed_control *control = &gb->speed;
+    control->speed = speed;
+
+    // uncapped, the first few frames find out how fast the host is
+    control->frame_ns = speed == UNCAPPED_SPEED ? GB_FRAME_NS : GB_FRAME_NS / speed;
+    control->last_vblank_ns = control->last_drawn_ns = host_time_ns();
+    control->frames_skipped = 0;
+
+    reset_decimation(gb->apu, speed == UNCAPPED_SPEED ? 1 : speed);
+
+    if (gb->pacer && speed != UNCAPPED_SPEED)
+        set_pacer_speed(gb->pacer, speed);
+}
+
+void toggle_fast_forward(gameboy *gb)
+{
+    if (gb->speed.speed == 1)
+        set_emulation_speed(gb, gb->speed.fast_forward_speed);
+    else
+        set_emulation_speed(gb, 1);
+}
+
+void update_frame_skip(gameboy *gb)
+{
+    gb_speed_control *control = &gb->speed;
+
+    // the frame skipped or drawn doesn't change
+    // mid-frame, so it's only decided here
+    if (control->speed == 1)
+    {
+        gb->ppu->skip_render = false;
+        return;
+    }
+
+    int64_t now = host_time_ns();
+    bool frame_drawn = !gb->ppu->skip_render;
+
+    // averaged so one slow frame doesn't throw off the estimate
+    control->frame_ns += (now - control->last_vblank_ns - control->frame_ns) / 8;
+    control->last_vblank_ns = now;
+
+    if (frame_drawn)
+    {
+        control->last_drawn_ns = now;
+        control->frames_skipped = 0;
+    }
+    else
+    {
+        ++control->frames_skipped;
+    }
+
+    if (control->speed == UNCAPPED_SPEED)
+    {
+        int64_t speed = (GB_FRAME_NS + control->frame_ns / 2) / (control->frame_ns ? control->frame_ns : 1);
+        if (speed < 1)
+            speed = 1;
+        else if (speed > UINT8_MAX)
+            speed = UINT8_MAX;
+
+        if (speed != gb->apu->decimation)
+            reset_decimation(gb->apu, speed);
+    }
+
+    bool draw_next;
+    if (!control->frame_skip_allowed)
+        draw_next = true;
+    else if (gb->sync_mode == SYNC_VSYNC && control->speed != UNCAPPED_SPEED)
+        // presenting a frame waits for the display, which sets the pace
+        draw_next = control->frames_skipped + 1 >= control->speed;
+    else
+        // draw the frame ending closest to a display frame after the last drawn one
+        draw_next = now + control->frame_ns + control->frame_ns / 2
+                    >= control->last_drawn_ns + GB_FRAME_NS;
+
+    gb->ppu->skip_render = !draw_next;
+}
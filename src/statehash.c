@@ -0,0 +1,364 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cboy/common.h"
+#include "cboy/gameboy.h"
+#include "cboy/cpu.h"
+#include "cboy/memory.h"
+#include "cboy/cartridge.h"
+#include "cboy/mbc.h"
+#include "cboy/ppu.h"
+#include "cboy/apu.h"
+#include "cboy/joypad.h"
+#include "cboy/framehash.h"
+#include "cboy/statehash.h"
+#include "cboy/log.h"
+
+static const char *state_component_names[NUM_STATE_COMPONENTS] = {
+    [STATE_CPU]    = "cpu",
+    [STATE_TIMER]  = "timer",
+    [STATE_WRAM]   = "wram",
+    [STATE_VRAM]   = "vram",
+    [STATE_OAM]    = "oam",
+    [STATE_HRAM]   = "hram",
+    [STATE_PPU]    = "ppu",
+    [STATE_APU]    = "apu",
+    [STATE_CART]   = "cart",
+    [STATE_SYSTEM] = "system",
+};
+
+/* Structs are hashed field by field (rather than as raw
+ * memory) so that padding bytes, which are left uninitialized
+ * by malloc, don't make identical states hash differently.
+ * Fields are gathered into a buffer, which is hashed (seeding
+ * the next part) whenever it's too full for the next field.
+ */
+typedef struct state_buffer {
+    uint8_t data[256];
+    size_t len;
+    uint64_t hash;
+} state_buffer;
+
+static void put_bytes(state_buffer *buf, const void *src, size_t len)
+{
+    if (buf->len + len > sizeof buf->data)
+    {
+        buf->hash = hash_bytes(buf->data, buf->len, buf->hash);
+        buf->len = 0;
+
+        if (len > sizeof buf->data)
+        {
+            buf->hash = hash_bytes(src, len, buf->hash);
+            return;
+        }
+    }
+
+    memcpy(buf->data + buf->len, src, len);
+    buf->len += len;
+}
+
+#define PUT_FIELD(buf, field) put_bytes((buf), &(field), sizeof (field))
+
+static inline uint64_t hash_buffer(state_buffer *buf)
+{
+    return hash_bytes(buf->data, buf->len, buf->hash);
+}
+
+static uint64_t hash_cpu(gb_cpu *cpu)
+{
+    state_buffer buf = {.len = 0, .hash = 0};
+    gb_registers *reg = &cpu->reg;
+
+    // F isn't stored until the lazily evaluated flags are read
+    uint8_t f = read_af(reg) & 0xff;
+
+    PUT_FIELD(&buf, reg->a);
+    PUT_FIELD(&buf, f);
+    PUT_FIELD(&buf, reg->b);
+    PUT_FIELD(&buf, reg->c);
+    PUT_FIELD(&buf, reg->d);
+    PUT_FIELD(&buf, reg->e);
+    PUT_FIELD(&buf, reg->h);
+    PUT_FIELD(&buf, reg->l);
+    PUT_FIELD(&buf, reg->sp);
+    PUT_FIELD(&buf, reg->pc);
+    PUT_FIELD(&buf, cpu->is_halted);
+    PUT_FIELD(&buf, cpu->ime_flag);
+    PUT_FIELD(&buf, cpu->if_register);
+    PUT_FIELD(&buf, cpu->ie_register);
+    PUT_FIELD(&buf, cpu->halt_bug);
+    PUT_FIELD(&buf, cpu->ime_delayed_set);
+
+    return hash_buffer(&buf);
+}
+
+static uint64_t hash_timer(gameboy *gb)
+{
+    state_buffer buf = {.len = 0, .hash = 0};
+
+    PUT_FIELD(&buf, gb->clock_counter);
+    PUT_FIELD(&buf, gb->tima);
+    PUT_FIELD(&buf, gb->tma);
+    PUT_FIELD(&buf, gb->tac);
+
+    // OAM DMA timing
+    PUT_FIELD(&buf, gb->dma_requested);
+    PUT_FIELD(&buf, gb->dma_counter);
+
+    // time left in a serial transfer this Game Boy is clocking
+    PUT_FIELD(&buf, gb->serial_clocks);
+
+    return hash_buffer(&buf);
+}
+
+static uint64_t hash_ppu(gb_ppu *ppu)
+{
+    state_buffer buf = {.len = 0, .hash = 0};
+
+    PUT_FIELD(&buf, ppu->dot_clock);
+    PUT_FIELD(&buf, ppu->window_line_counter);
+    PUT_FIELD(&buf, ppu->wy_trigger);
+    PUT_FIELD(&buf, ppu->curr_scanline_rendered);
+    PUT_FIELD(&buf, ppu->curr_frame_displayed);
+    PUT_FIELD(&buf, ppu->lyc_stat_line);
+    PUT_FIELD(&buf, ppu->hblank_stat_line);
+    PUT_FIELD(&buf, ppu->vblank_stat_line);
+    PUT_FIELD(&buf, ppu->oam_stat_line);
+    PUT_FIELD(&buf, ppu->lcdc);
+    PUT_FIELD(&buf, ppu->stat);
+    PUT_FIELD(&buf, ppu->scy);
+    PUT_FIELD(&buf, ppu->scx);
+    PUT_FIELD(&buf, ppu->ly);
+    PUT_FIELD(&buf, ppu->lyc);
+    PUT_FIELD(&buf, ppu->dma);
+    PUT_FIELD(&buf, ppu->bgp);
+    PUT_FIELD(&buf, ppu->obp0);
+    PUT_FIELD(&buf, ppu->obp1);
+    PUT_FIELD(&buf, ppu->wx);
+    PUT_FIELD(&buf, ppu->wy);
+    PUT_FIELD(&buf, ppu->bcps);
+    PUT_FIELD(&buf, ppu->ocps);
+    PUT_FIELD(&buf, ppu->opri);
+    PUT_FIELD(&buf, ppu->bg_pram);
+    PUT_FIELD(&buf, ppu->obj_pram);
+
+    // the registers and palettes seed the frame buffer's hash
+    return hash_bytes(ppu->frame_buffer, sizeof ppu->frame_buffer, hash_buffer(&buf));
+}
+
+static void put_pulse_channel(state_buffer *buf, apu_pulse_channel *ch)
+{
+    PUT_FIELD(buf, ch->duty_number);
+    PUT_FIELD(buf, ch->duty_pos);
+    PUT_FIELD(buf, ch->length_timer);
+    PUT_FIELD(buf, ch->wavelength);
+    PUT_FIELD(buf, ch->wavelength_timer);
+    PUT_FIELD(buf, ch->length_timer_enable);
+    PUT_FIELD(buf, ch->initial_volume);
+    PUT_FIELD(buf, ch->env_incrementing);
+    PUT_FIELD(buf, ch->env_period);
+    PUT_FIELD(buf, ch->current_volume);
+    PUT_FIELD(buf, ch->env_period_timer);
+    PUT_FIELD(buf, ch->sweep_enabled);
+    PUT_FIELD(buf, ch->sweep_period);
+    PUT_FIELD(buf, ch->sweep_period_timer);
+    PUT_FIELD(buf, ch->sweep_decrementing);
+    PUT_FIELD(buf, ch->sweep_slope);
+    PUT_FIELD(buf, ch->enabled);
+    PUT_FIELD(buf, ch->dac_enabled);
+}
+
+/* NOTE: the audio sample ring buffer is left out since how
+ * full it is depends on when the audio device drains it.
+ */
+static uint64_t hash_apu(gb_apu *apu)
+{
+    state_buffer buf = {.len = 0, .hash = 0};
+
+    PUT_FIELD(&buf, apu->enabled);
+    PUT_FIELD(&buf, apu->panning_info);
+    PUT_FIELD(&buf, apu->sample_timer);
+    PUT_FIELD(&buf, apu->left_volume);
+    PUT_FIELD(&buf, apu->right_volume);
+    PUT_FIELD(&buf, apu->mix_vin_left);
+    PUT_FIELD(&buf, apu->mix_vin_right);
+    PUT_FIELD(&buf, apu->frame_seq_pos);
+    PUT_FIELD(&buf, apu->clock);
+
+    put_pulse_channel(&buf, &apu->channel_one);
+    put_pulse_channel(&buf, &apu->channel_two);
+
+    apu_wave_channel *wave = &apu->channel_three;
+    PUT_FIELD(&buf, wave->length_timer);
+    PUT_FIELD(&buf, wave->length_timer_enable);
+    PUT_FIELD(&buf, wave->output_level);
+    PUT_FIELD(&buf, wave->wavelength);
+    PUT_FIELD(&buf, wave->wavelength_timer);
+    PUT_FIELD(&buf, wave->wave_loc);
+    PUT_FIELD(&buf, wave->wave_ram);
+    PUT_FIELD(&buf, wave->enabled);
+    PUT_FIELD(&buf, wave->dac_enabled);
+
+    apu_noise_channel *noise = &apu->channel_four;
+    PUT_FIELD(&buf, noise->length_timer);
+    PUT_FIELD(&buf, noise->length_timer_enable);
+    PUT_FIELD(&buf, noise->initial_volume);
+    PUT_FIELD(&buf, noise->current_volume);
+    PUT_FIELD(&buf, noise->env_period);
+    PUT_FIELD(&buf, noise->env_period_timer);
+    PUT_FIELD(&buf, noise->env_incrementing);
+    PUT_FIELD(&buf, noise->clock_shift);
+    PUT_FIELD(&buf, noise->clock_div_code);
+    PUT_FIELD(&buf, noise->lfsr_width_flag);
+    PUT_FIELD(&buf, noise->lfsr);
+    PUT_FIELD(&buf, noise->wavelength_timer);
+    PUT_FIELD(&buf, noise->enabled);
+    PUT_FIELD(&buf, noise->dac_enabled);
+
+    return hash_buffer(&buf);
+}
+
+static uint64_t hash_cart(gb_cartridge *cart)
+{
+    state_buffer buf = {.len = 0, .hash = 0};
+    cartridge_mbc *mbc = cart->mbc;
+
+    switch (cart->mbc_type)
+    {
+        case MBC1:
+            PUT_FIELD(&buf, mbc->mbc1.ram_enabled);
+            PUT_FIELD(&buf, mbc->mbc1.rom_bankno);
+            PUT_FIELD(&buf, mbc->mbc1.ram_bankno);
+            PUT_FIELD(&buf, mbc->mbc1.bank_mode);
+            break;
+
+        case MBC3:
+            PUT_FIELD(&buf, mbc->mbc3.ram_and_rtc_enabled);
+            PUT_FIELD(&buf, mbc->mbc3.rom_bankno);
+            PUT_FIELD(&buf, mbc->mbc3.ram_or_rtc_select);
+            PUT_FIELD(&buf, mbc->mbc3.rtc_latch);
+            PUT_FIELD(&buf, mbc->mbc3.rtc_tick_timer);
+            PUT_FIELD(&buf, mbc->mbc3.rtc_latched_values);
+            PUT_FIELD(&buf, mbc->mbc3.rtc_s);
+            PUT_FIELD(&buf, mbc->mbc3.rtc_m);
+            PUT_FIELD(&buf, mbc->mbc3.rtc_h);
+            PUT_FIELD(&buf, mbc->mbc3.rtc_d);
+            PUT_FIELD(&buf, mbc->mbc3.rtc_halt);
+            PUT_FIELD(&buf, mbc->mbc3.day_carry);
+            break;
+
+        case MBC5:
+            PUT_FIELD(&buf, mbc->mbc5.ram_enabled);
+            PUT_FIELD(&buf, mbc->mbc5.lsb_rom_bankno);
+            PUT_FIELD(&buf, mbc->mbc5.bit9_rom_bankno);
+            PUT_FIELD(&buf, mbc->mbc5.ram_bankno);
+            break;
+
+        default: // no MBC state
+            break;
+    }
+
+    uint64_t hash = hash_buffer(&buf);
+    for (int i = 0; i < cart->num_ram_banks; ++i)
+        hash = hash_bytes(cart->ram_banks[i], cart->ram_bank_size, hash);
+
+    return hash;
+}
+
+static uint64_t hash_system(gameboy *gb)
+{
+    state_buffer buf = {.len = 0, .hash = 0};
+
+    PUT_FIELD(&buf, gb->boot_rom_disabled);
+    PUT_FIELD(&buf, gb->is_stopped);
+    PUT_FIELD(&buf, gb->key0);
+    PUT_FIELD(&buf, gb->vbk);
+    PUT_FIELD(&buf, gb->svbk);
+    PUT_FIELD(&buf, gb->double_speed);
+    PUT_FIELD(&buf, gb->speed_switch_armed);
+    PUT_FIELD(&buf, gb->vram_dma_source);
+    PUT_FIELD(&buf, gb->vram_dma_dest);
+    PUT_FIELD(&buf, gb->vram_dma_length);
+    PUT_FIELD(&buf, gb->hdma_running);
+    PUT_FIELD(&buf, gb->vram_dma_stall);
+    PUT_FIELD(&buf, gb->joypad->dpad_selected);
+    PUT_FIELD(&buf, gb->joypad->action_selected);
+    PUT_FIELD(&buf, gb->joypad->direction_state);
+    PUT_FIELD(&buf, gb->joypad->action_state);
+
+    // serial, infrared, and undocumented registers
+    gb_memory *memory = gb->memory;
+    return hash_bytes(memory->io, sizeof memory->io, hash_buffer(&buf));
+}
+
+void hash_emulator_state(gameboy *gb, uint64_t hashes[NUM_STATE_COMPONENTS])
+{
+    gb_memory *memory = gb->memory;
+
+    hashes[STATE_CPU]    = hash_cpu(&gb->cpu);
+    hashes[STATE_TIMER]  = hash_timer(gb);
+    hashes[STATE_WRAM]   = hash_bytes(memory->wram, sizeof memory->wram, 0);
+    hashes[STATE_VRAM]   = hash_bytes(memory->vram, sizeof memory->vram, 0);
+    hashes[STATE_OAM]    = hash_bytes(memory->oam, sizeof memory->oam, 0);
+    hashes[STATE_HRAM]   = hash_bytes(memory->hram, sizeof memory->hram, 0);
+    hashes[STATE_PPU]    = hash_ppu(gb->ppu);
+    hashes[STATE_APU]    = hash_apu(gb->apu);
+    hashes[STATE_CART]   = hash_cart(gb->cart);
+    hashes[STATE_SYSTEM] = hash_system(gb);
+}
+
+gb_state_hasher *init_state_hasher(const char *filename)
+{
+    gb_state_hasher *hasher = calloc(1, sizeof(gb_state_hasher));
+
+    if (hasher == NULL)
+        return NULL;
+
+    hasher->hash_file = fopen(filename, "wb");
+    if (hasher->hash_file == NULL)
+    {
+        LOG_ERROR("Error: Unable to create state hash file: %s\n", strerror(errno));
+        free(hasher);
+        return NULL;
+    }
+
+    // self-describing header so tools needn't know the component list
+    fputs("CBOYSH01", hasher->hash_file);
+    for (int i = 0; i < NUM_STATE_COMPONENTS; ++i)
+        fprintf(hasher->hash_file, " %s", state_component_names[i]);
+    fputc('\n', hasher->hash_file);
+
+    return hasher;
+}
+
+void free_state_hasher(gb_state_hasher *hasher)
+{
+    if (hasher == NULL)
+        return;
+
+    fclose(hasher->hash_file);
+    free(hasher);
+}
+
+bool record_state_hash(gameboy *gb)
+{
+    uint64_t hashes[NUM_STATE_COMPONENTS];
+    uint8_t bytes[8 * NUM_STATE_COMPONENTS];
+
+    hash_emulator_state(gb, hashes);
+    for (int i = 0; i < NUM_STATE_COMPONENTS; ++i)
+        for (int j = 0; j < 8; ++j)
+            bytes[8*i + j] = hashes[i] >> (8 * j);
+
+    if (fwrite(bytes, 1, sizeof bytes, gb->state_hasher->hash_file) != sizeof bytes)
+    {
+        LOG_ERROR("\nError: Failed to write state hash: %s\n", strerror(errno));
+        return false;
+    }
+
+    ++gb->state_hasher->frame_count;
+    return true;
+}
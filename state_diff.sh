@@ -0,0 +1,81 @@
+#!/bin/sh
+# Runs the emulator twice in parallel, once per configuration, with the
+# same input movie, recording a hash of the emulation state for every
+# frame. Reports the first frame and component where the two diverge.
+#
+# Usage: ./state_diff.sh <movie> <romfile> "<options A>" "<options B>"
+#
+# Each run gets its own copy of the ROM and its save file (if any), so
+# the runs neither share nor clobber cartridge RAM. Pass "-t emulated"
+# in both configurations for cartridges with an RTC.
+
+if [ $# -ne 4 ]; then
+    echo "Usage: $0 <movie> <romfile> \"<options A>\" \"<options B>\"" >&2
+    exit 2
+fi
+
+movie=$1
+romfile=$2
+cboy=${CBOY:-bin/cboy}
+
+tmpdir=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmpdir"' EXIT
+
+for run in a b; do
+    mkdir "$tmpdir/$run"
+    cp "$romfile" "$tmpdir/$run/rom"
+    [ -f "${romfile}cboysav" ] && cp "${romfile}cboysav" "$tmpdir/$run/romcboysav"
+done
+
+# options are intentionally unquoted so they split into arguments
+$cboy $3 -p "$movie" -s "$tmpdir/a/state" "$tmpdir/a/rom" > "$tmpdir/a/log" 2>&1 &
+pid_a=$!
+$cboy $4 -p "$movie" -s "$tmpdir/b/state" "$tmpdir/b/rom" > "$tmpdir/b/log" 2>&1 &
+pid_b=$!
+
+wait $pid_a || { echo "Configuration A failed:" >&2; cat "$tmpdir/a/log" >&2; exit 1; }
+wait $pid_b || { echo "Configuration B failed:" >&2; cat "$tmpdir/b/log" >&2; exit 1; }
+
+header=$(head -n 1 "$tmpdir/a/state")
+if [ "$header" != "$(head -n 1 "$tmpdir/b/state")" ]; then
+    echo "The state hash files have different components" >&2
+    exit 1
+fi
+
+# the header line lists the components in the order they're hashed
+set -- $header
+shift
+num_components=$#
+header_size=$((${#header} + 1))
+record_size=$((8 * num_components))
+
+cmp_output=$(cmp "$tmpdir/a/state" "$tmpdir/b/state" 2>&1)
+case $? in
+    0)
+        frames=$((($(wc -c < "$tmpdir/a/state") - header_size) / record_size))
+        echo "No divergence in $frames frames"
+        exit 0
+        ;;
+    2)
+        echo "$cmp_output" >&2
+        exit 1
+        ;;
+esac
+
+# one run stopped early (e.g. "cmp: EOF on ... after byte N")
+case $cmp_output in
+    *EOF*)
+        echo "The runs produced a different number of frames: $cmp_output"
+        exit 1
+        ;;
+esac
+
+# GNU cmp reports "byte N", BSD cmp reports "char N" (1-based)
+byte=$(echo "$cmp_output" | awk '{ for (i = 1; i < NF; ++i) if ($i == "byte" || $i == "char") { n = $(i + 1); sub(",", "", n); print n } }')
+offset=$((byte - 1 - header_size))
+frame=$((offset / record_size))
+component=$(((offset % record_size) / 8 + 1))
+
+eval "name=\${$component}"
+echo "First divergence at frame $frame in component: $name"
+exit 1